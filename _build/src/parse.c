@@ -0,0 +1,2453 @@
+/* A Bison parser, made by GNU Bison 3.8.2.  */
+
+/* Bison implementation for Yacc-like parsers in C
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* As a special exception, you may create a larger work that contains
+   part or all of the Bison parser skeleton and distribute that work
+   under terms of your choice, so long as that work isn't itself a
+   parser generator using the skeleton or a modified version thereof
+   as a parser skeleton.  Alternatively, if you modify or redistribute
+   the parser skeleton itself, you may (at your option) remove this
+   special exception, which will cause the skeleton and the resulting
+   Bison output files to be licensed under the GNU General Public
+   License without this special exception.
+
+   This special exception was added by the Free Software Foundation in
+   version 2.2 of Bison.  */
+
+/* C LALR(1) parser skeleton written by Richard Stallman, by
+   simplifying the original so-called "semantic" parser.  */
+
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+/* All symbols defined below should begin with yy or YY, to avoid
+   infringing on user name space.  This should be done even for local
+   variables, as they might otherwise be expanded by user macros.
+   There are some unavoidable exceptions within include files to
+   define necessary library symbols; they are noted "INFRINGES ON
+   USER NAME SPACE" below.  */
+
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
+
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
+
+/* Skeleton name.  */
+#define YYSKELETON_NAME "yacc.c"
+
+/* Pure parsers.  */
+#define YYPURE 1
+
+/* Push parsers.  */
+#define YYPUSH 0
+
+/* Pull parsers.  */
+#define YYPULL 1
+
+
+
+
+/* First part of user prologue.  */
+#line 6 "src/parse.y"
+
+
+#include <stdlib.h>
+#include <stdio.h> // DEBUG
+#include "utils.h"
+#include "tree.h"
+#include "utils.h"
+#include "quadr.h"
+#include "parsedef.h"
+
+#define YY_DECL int yylex (YYSTYPE *lvalp, YYLTYPE *llocp)
+
+
+#line 85 "_build/src/parse.c"
+
+# ifndef YY_CAST
+#  ifdef __cplusplus
+#   define YY_CAST(Type, Val) static_cast<Type> (Val)
+#   define YY_REINTERPRET_CAST(Type, Val) reinterpret_cast<Type> (Val)
+#  else
+#   define YY_CAST(Type, Val) ((Type) (Val))
+#   define YY_REINTERPRET_CAST(Type, Val) ((Type) (Val))
+#  endif
+# endif
+# ifndef YY_NULLPTR
+#  if defined __cplusplus
+#   if 201103L <= __cplusplus
+#    define YY_NULLPTR nullptr
+#   else
+#    define YY_NULLPTR 0
+#   endif
+#  else
+#   define YY_NULLPTR ((void*)0)
+#  endif
+# endif
+
+#include "parse.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
+{
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_INTEGER = 3,                    /* INTEGER  */
+  YYSYMBOL_BOOLEAN = 4,                    /* BOOLEAN  */
+  YYSYMBOL_DOUBLE = 5,                     /* DOUBLE  */
+  YYSYMBOL_STRING = 6,                     /* STRING  */
+  YYSYMBOL_ID = 7,                         /* ID  */
+  YYSYMBOL_TYPE = 8,                       /* TYPE  */
+  YYSYMBOL_PLUS_PLUS = 9,                  /* PLUS_PLUS  */
+  YYSYMBOL_MINUS_MINUS = 10,               /* MINUS_MINUS  */
+  YYSYMBOL_AND = 11,                       /* AND  */
+  YYSYMBOL_OR = 12,                        /* OR  */
+  YYSYMBOL_EQUAL = 13,                     /* EQUAL  */
+  YYSYMBOL_NOT_EQUAL = 14,                 /* NOT_EQUAL  */
+  YYSYMBOL_LESS_EQUAL = 15,                /* LESS_EQUAL  */
+  YYSYMBOL_GREATER_EQUAL = 16,             /* GREATER_EQUAL  */
+  YYSYMBOL_IF = 17,                        /* IF  */
+  YYSYMBOL_ELSE = 18,                      /* ELSE  */
+  YYSYMBOL_WHILE = 19,                     /* WHILE  */
+  YYSYMBOL_FOR = 20,                       /* FOR  */
+  YYSYMBOL_RETURN = 21,                    /* RETURN  */
+  YYSYMBOL_22_ = 22,                       /* '<'  */
+  YYSYMBOL_23_ = 23,                       /* '>'  */
+  YYSYMBOL_24_ = 24,                       /* '+'  */
+  YYSYMBOL_25_ = 25,                       /* '-'  */
+  YYSYMBOL_26_ = 26,                       /* '*'  */
+  YYSYMBOL_27_ = 27,                       /* '/'  */
+  YYSYMBOL_28_ = 28,                       /* '%'  */
+  YYSYMBOL_UNARY = 29,                     /* UNARY  */
+  YYSYMBOL_30_ = 30,                       /* ';'  */
+  YYSYMBOL_31_ = 31,                       /* '('  */
+  YYSYMBOL_32_ = 32,                       /* ')'  */
+  YYSYMBOL_33_ = 33,                       /* ','  */
+  YYSYMBOL_34_ = 34,                       /* '{'  */
+  YYSYMBOL_35_ = 35,                       /* '}'  */
+  YYSYMBOL_36_ = 36,                       /* '='  */
+  YYSYMBOL_37_ = 37,                       /* '['  */
+  YYSYMBOL_38_ = 38,                       /* ']'  */
+  YYSYMBOL_39_ = 39,                       /* '!'  */
+  YYSYMBOL_YYACCEPT = 40,                  /* $accept  */
+  YYSYMBOL_program = 41,                   /* program  */
+  YYSYMBOL_func_list = 42,                 /* func_list  */
+  YYSYMBOL_func = 43,                      /* func  */
+  YYSYMBOL_maybe_arg_list = 44,            /* maybe_arg_list  */
+  YYSYMBOL_arg_list = 45,                  /* arg_list  */
+  YYSYMBOL_maybe_instr_list = 46,          /* maybe_instr_list  */
+  YYSYMBOL_instr_list = 47,                /* instr_list  */
+  YYSYMBOL_instr = 48,                     /* instr  */
+  YYSYMBOL_block = 49,                     /* block  */
+  YYSYMBOL_declaration = 50,               /* declaration  */
+  YYSYMBOL_declarators = 51,               /* declarators  */
+  YYSYMBOL_declarator = 52,                /* declarator  */
+  YYSYMBOL_assignment = 53,                /* assignment  */
+  YYSYMBOL_lvalue = 54,                    /* lvalue  */
+  YYSYMBOL_if_instr = 55,                  /* if_instr  */
+  YYSYMBOL_while_instr = 56,               /* while_instr  */
+  YYSYMBOL_for_instr = 57,                 /* for_instr  */
+  YYSYMBOL_return_instr = 58,              /* return_instr  */
+  YYSYMBOL_expr = 59,                      /* expr  */
+  YYSYMBOL_maybe_expr_list = 60,           /* maybe_expr_list  */
+  YYSYMBOL_expr_list = 61                  /* expr_list  */
+};
+typedef enum yysymbol_kind_t yysymbol_kind_t;
+
+
+/* Second part of user prologue.  */
+#line 73 "src/parse.y"
+
+  void yyerror(YYLTYPE *locp, node_t **dummy, const char *msg);
+
+  extern YY_DECL;
+
+  inline static src_pos_t make_pos(YYLTYPE l1, YYLTYPE l2)
+  {
+    src_pos_t ret;
+    ret.line = l1.first_line;
+    ret.col = l1.first_column;
+    ret.len = (l2.last_line == l1.first_line) ? (l2.last_column - l1.first_column) : (1);
+    return ret;
+  }
+
+  void (*func_handler)(func_t *) = NULL;
+
+  /* Appends a function to the list, unless func_handler is set, in
+     which case the function is passed to it instead. */
+  static void add_func(func_lst_t *lst, func_t *func)
+  {
+    if (func_handler != NULL)
+      {
+        func_handler(func);
+      }
+    else if (lst->first == NULL)
+      {
+        lst->first = lst->last = func;
+      }
+    else
+      {
+        lst->last->next = func;
+        lst->last = func;
+      }
+  }
+
+#line 216 "_build/src/parse.c"
+
+
+#ifdef short
+# undef short
+#endif
+
+/* On compilers that do not define __PTRDIFF_MAX__ etc., make sure
+   <limits.h> and (if available) <stdint.h> are included
+   so that the code can choose integer types of a good width.  */
+
+#ifndef __PTRDIFF_MAX__
+# include <limits.h> /* INFRINGES ON USER NAME SPACE */
+# if defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stdint.h> /* INFRINGES ON USER NAME SPACE */
+#  define YY_STDINT_H
+# endif
+#endif
+
+/* Narrow types that promote to a signed type and that can represent a
+   signed or unsigned integer of at least N bits.  In tables they can
+   save space and decrease cache pressure.  Promoting to a signed type
+   helps avoid bugs in integer arithmetic.  */
+
+#ifdef __INT_LEAST8_MAX__
+typedef __INT_LEAST8_TYPE__ yytype_int8;
+#elif defined YY_STDINT_H
+typedef int_least8_t yytype_int8;
+#else
+typedef signed char yytype_int8;
+#endif
+
+#ifdef __INT_LEAST16_MAX__
+typedef __INT_LEAST16_TYPE__ yytype_int16;
+#elif defined YY_STDINT_H
+typedef int_least16_t yytype_int16;
+#else
+typedef short yytype_int16;
+#endif
+
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
+#endif
+
+#if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST8_TYPE__ yytype_uint8;
+#elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST8_MAX <= INT_MAX)
+typedef uint_least8_t yytype_uint8;
+#elif !defined __UINT_LEAST8_MAX__ && UCHAR_MAX <= INT_MAX
+typedef unsigned char yytype_uint8;
+#else
+typedef short yytype_uint8;
+#endif
+
+#if defined __UINT_LEAST16_MAX__ && __UINT_LEAST16_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST16_TYPE__ yytype_uint16;
+#elif (!defined __UINT_LEAST16_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST16_MAX <= INT_MAX)
+typedef uint_least16_t yytype_uint16;
+#elif !defined __UINT_LEAST16_MAX__ && USHRT_MAX <= INT_MAX
+typedef unsigned short yytype_uint16;
+#else
+typedef int yytype_uint16;
+#endif
+
+#ifndef YYPTRDIFF_T
+# if defined __PTRDIFF_TYPE__ && defined __PTRDIFF_MAX__
+#  define YYPTRDIFF_T __PTRDIFF_TYPE__
+#  define YYPTRDIFF_MAXIMUM __PTRDIFF_MAX__
+# elif defined PTRDIFF_MAX
+#  ifndef ptrdiff_t
+#   include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  endif
+#  define YYPTRDIFF_T ptrdiff_t
+#  define YYPTRDIFF_MAXIMUM PTRDIFF_MAX
+# else
+#  define YYPTRDIFF_T long
+#  define YYPTRDIFF_MAXIMUM LONG_MAX
+# endif
+#endif
+
+#ifndef YYSIZE_T
+# ifdef __SIZE_TYPE__
+#  define YYSIZE_T __SIZE_TYPE__
+# elif defined size_t
+#  define YYSIZE_T size_t
+# elif defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  define YYSIZE_T size_t
+# else
+#  define YYSIZE_T unsigned
+# endif
+#endif
+
+#define YYSIZE_MAXIMUM                                  \
+  YY_CAST (YYPTRDIFF_T,                                 \
+           (YYPTRDIFF_MAXIMUM < YY_CAST (YYSIZE_T, -1)  \
+            ? YYPTRDIFF_MAXIMUM                         \
+            : YY_CAST (YYSIZE_T, -1)))
+
+#define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
+
+
+/* Stored state numbers (used for stacks). */
+typedef yytype_uint8 yy_state_t;
+
+/* State numbers in computations.  */
+typedef int yy_state_fast_t;
+
+#ifndef YY_
+# if defined YYENABLE_NLS && YYENABLE_NLS
+#  if ENABLE_NLS
+#   include <libintl.h> /* INFRINGES ON USER NAME SPACE */
+#   define YY_(Msgid) dgettext ("bison-runtime", Msgid)
+#  endif
+# endif
+# ifndef YY_
+#  define YY_(Msgid) Msgid
+# endif
+#endif
+
+
+#ifndef YY_ATTRIBUTE_PURE
+# if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
+# else
+#  define YY_ATTRIBUTE_PURE
+# endif
+#endif
+
+#ifndef YY_ATTRIBUTE_UNUSED
+# if defined __GNUC__ && 2 < __GNUC__ + (7 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_UNUSED __attribute__ ((__unused__))
+# else
+#  define YY_ATTRIBUTE_UNUSED
+# endif
+#endif
+
+/* Suppress unused-variable warnings by "using" E.  */
+#if ! defined lint || defined __GNUC__
+# define YY_USE(E) ((void) (E))
+#else
+# define YY_USE(E) /* empty */
+#endif
+
+/* Suppress an incorrect diagnostic about yylval being uninitialized.  */
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
+    _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+# endif
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
+    _Pragma ("GCC diagnostic pop")
+#else
+# define YY_INITIAL_VALUE(Value) Value
+#endif
+#ifndef YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END
+#endif
+#ifndef YY_INITIAL_VALUE
+# define YY_INITIAL_VALUE(Value) /* Nothing. */
+#endif
+
+#if defined __cplusplus && defined __GNUC__ && ! defined __ICC && 6 <= __GNUC__
+# define YY_IGNORE_USELESS_CAST_BEGIN                          \
+    _Pragma ("GCC diagnostic push")                            \
+    _Pragma ("GCC diagnostic ignored \"-Wuseless-cast\"")
+# define YY_IGNORE_USELESS_CAST_END            \
+    _Pragma ("GCC diagnostic pop")
+#endif
+#ifndef YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_END
+#endif
+
+
+#define YY_ASSERT(E) ((void) (0 && (E)))
+
+#if 1
+
+/* The parser invokes alloca or malloc; define the necessary symbols.  */
+
+# ifdef YYSTACK_USE_ALLOCA
+#  if YYSTACK_USE_ALLOCA
+#   ifdef __GNUC__
+#    define YYSTACK_ALLOC __builtin_alloca
+#   elif defined __BUILTIN_VA_ARG_INCR
+#    include <alloca.h> /* INFRINGES ON USER NAME SPACE */
+#   elif defined _AIX
+#    define YYSTACK_ALLOC __alloca
+#   elif defined _MSC_VER
+#    include <malloc.h> /* INFRINGES ON USER NAME SPACE */
+#    define alloca _alloca
+#   else
+#    define YYSTACK_ALLOC alloca
+#    if ! defined _ALLOCA_H && ! defined EXIT_SUCCESS
+#     include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
+      /* Use EXIT_SUCCESS as a witness for stdlib.h.  */
+#     ifndef EXIT_SUCCESS
+#      define EXIT_SUCCESS 0
+#     endif
+#    endif
+#   endif
+#  endif
+# endif
+
+# ifdef YYSTACK_ALLOC
+   /* Pacify GCC's 'empty if-body' warning.  */
+#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (0)
+#  ifndef YYSTACK_ALLOC_MAXIMUM
+    /* The OS might guarantee only one guard page at the bottom of the stack,
+       and a page size can be as small as 4096 bytes.  So we cannot safely
+       invoke alloca (N) if N exceeds 4096.  Use a slightly smaller number
+       to allow for a few compiler-allocated temporary stack slots.  */
+#   define YYSTACK_ALLOC_MAXIMUM 4032 /* reasonable circa 2006 */
+#  endif
+# else
+#  define YYSTACK_ALLOC YYMALLOC
+#  define YYSTACK_FREE YYFREE
+#  ifndef YYSTACK_ALLOC_MAXIMUM
+#   define YYSTACK_ALLOC_MAXIMUM YYSIZE_MAXIMUM
+#  endif
+#  if (defined __cplusplus && ! defined EXIT_SUCCESS \
+       && ! ((defined YYMALLOC || defined malloc) \
+             && (defined YYFREE || defined free)))
+#   include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
+#   ifndef EXIT_SUCCESS
+#    define EXIT_SUCCESS 0
+#   endif
+#  endif
+#  ifndef YYMALLOC
+#   define YYMALLOC malloc
+#   if ! defined malloc && ! defined EXIT_SUCCESS
+void *malloc (YYSIZE_T); /* INFRINGES ON USER NAME SPACE */
+#   endif
+#  endif
+#  ifndef YYFREE
+#   define YYFREE free
+#   if ! defined free && ! defined EXIT_SUCCESS
+void free (void *); /* INFRINGES ON USER NAME SPACE */
+#   endif
+#  endif
+# endif
+#endif /* 1 */
+
+#if (! defined yyoverflow \
+     && (! defined __cplusplus \
+         || (defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL \
+             && defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
+
+/* A type that is properly aligned for any stack member.  */
+union yyalloc
+{
+  yy_state_t yyss_alloc;
+  YYSTYPE yyvs_alloc;
+  YYLTYPE yyls_alloc;
+};
+
+/* The size of the maximum gap between one aligned stack and the next.  */
+# define YYSTACK_GAP_MAXIMUM (YYSIZEOF (union yyalloc) - 1)
+
+/* The size of an array large to enough to hold all stacks, each with
+   N elements.  */
+# define YYSTACK_BYTES(N) \
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE) \
+             + YYSIZEOF (YYLTYPE)) \
+      + 2 * YYSTACK_GAP_MAXIMUM)
+
+# define YYCOPY_NEEDED 1
+
+/* Relocate STACK from its old location to the new one.  The
+   local variables YYSIZE and YYSTACKSIZE give the old and new number of
+   elements in the stack, and YYPTR gives the new location of the
+   stack.  Advance YYPTR to a properly aligned location for the next
+   stack.  */
+# define YYSTACK_RELOCATE(Stack_alloc, Stack)                           \
+    do                                                                  \
+      {                                                                 \
+        YYPTRDIFF_T yynewbytes;                                         \
+        YYCOPY (&yyptr->Stack_alloc, Stack, yysize);                    \
+        Stack = &yyptr->Stack_alloc;                                    \
+        yynewbytes = yystacksize * YYSIZEOF (*Stack) + YYSTACK_GAP_MAXIMUM; \
+        yyptr += yynewbytes / YYSIZEOF (*yyptr);                        \
+      }                                                                 \
+    while (0)
+
+#endif
+
+#if defined YYCOPY_NEEDED && YYCOPY_NEEDED
+/* Copy COUNT objects from SRC to DST.  The source and destination do
+   not overlap.  */
+# ifndef YYCOPY
+#  if defined __GNUC__ && 1 < __GNUC__
+#   define YYCOPY(Dst, Src, Count) \
+      __builtin_memcpy (Dst, Src, YY_CAST (YYSIZE_T, (Count)) * sizeof (*(Src)))
+#  else
+#   define YYCOPY(Dst, Src, Count)              \
+      do                                        \
+        {                                       \
+          YYPTRDIFF_T yyi;                      \
+          for (yyi = 0; yyi < (Count); yyi++)   \
+            (Dst)[yyi] = (Src)[yyi];            \
+        }                                       \
+      while (0)
+#  endif
+# endif
+#endif /* !YYCOPY_NEEDED */
+
+/* YYFINAL -- State number of the termination state.  */
+#define YYFINAL  7
+/* YYLAST -- Last index in YYTABLE.  */
+#define YYLAST   404
+
+/* YYNTOKENS -- Number of terminals.  */
+#define YYNTOKENS  40
+/* YYNNTS -- Number of nonterminals.  */
+#define YYNNTS  22
+/* YYNRULES -- Number of rules.  */
+#define YYNRULES  72
+/* YYNSTATES -- Number of states.  */
+#define YYNSTATES  138
+
+/* YYMAXUTOK -- Last valid token kind.  */
+#define YYMAXUTOK   277
+
+
+/* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex, with out-of-bounds checking.  */
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
+
+/* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex.  */
+static const yytype_int8 yytranslate[] =
+{
+       0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,    39,     2,     2,     2,    28,     2,     2,
+      31,    32,    26,    24,    33,    25,     2,    27,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,    30,
+      22,    36,    23,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,    37,     2,    38,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,    34,     2,    35,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
+       5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
+      15,    16,    17,    18,    19,    20,    21,    29
+};
+
+#if YYDEBUG
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+static const yytype_uint8 yyrline[] =
+{
+       0,   111,   111,   112,   113,   116,   117,   118,   121,   124,
+     125,   128,   129,   133,   134,   137,   138,   141,   142,   143,
+     144,   145,   146,   147,   148,   149,   150,   153,   156,   159,
+     160,   163,   164,   165,   168,   169,   170,   173,   174,   177,
+     178,   181,   183,   186,   187,   190,   191,   192,   193,   194,
+     195,   196,   197,   198,   199,   200,   201,   202,   203,   204,
+     205,   206,   207,   208,   209,   210,   211,   212,   213,   216,
+     217,   220,   221
+};
+#endif
+
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
+
+#if 1
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
+
+/* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
+   First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
+static const char *const yytname[] =
+{
+  "\"end of file\"", "error", "\"invalid token\"", "INTEGER", "BOOLEAN",
+  "DOUBLE", "STRING", "ID", "TYPE", "PLUS_PLUS", "MINUS_MINUS", "AND",
+  "OR", "EQUAL", "NOT_EQUAL", "LESS_EQUAL", "GREATER_EQUAL", "IF", "ELSE",
+  "WHILE", "FOR", "RETURN", "'<'", "'>'", "'+'", "'-'", "'*'", "'/'",
+  "'%'", "UNARY", "';'", "'('", "')'", "','", "'{'", "'}'", "'='", "'['",
+  "']'", "'!'", "$accept", "program", "func_list", "func",
+  "maybe_arg_list", "arg_list", "maybe_instr_list", "instr_list", "instr",
+  "block", "declaration", "declarators", "declarator", "assignment",
+  "lvalue", "if_instr", "while_instr", "for_instr", "return_instr", "expr",
+  "maybe_expr_list", "expr_list", YY_NULLPTR
+};
+
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
+{
+  return yytname[yysymbol];
+}
+#endif
+
+#define YYPACT_NINF (-54)
+
+#define yypact_value_is_default(Yyn) \
+  ((Yyn) == YYPACT_NINF)
+
+#define YYTABLE_NINF (-39)
+
+#define yytable_value_is_error(Yyn) \
+  0
+
+/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
+   STATE-NUM.  */
+static const yytype_int16 yypact[] =
+{
+      10,   -54,     5,    19,     1,   -54,   -11,   -54,   -54,   -54,
+      16,    18,     0,     9,   -54,    -1,    50,    83,   -54,    52,
+      30,   -54,   -54,   -54,   -54,   158,    62,    39,    41,    64,
+      32,    32,    32,   -54,    32,    32,    46,   120,   -54,   -54,
+      66,    67,    -2,   -54,   -54,   -54,    68,   306,   -54,   -54,
+      32,    32,   -21,    72,   -54,    32,    32,    94,   -14,   346,
+     -54,   -54,   240,   -54,   -54,   -54,   -54,   -54,   -54,   -54,
+      32,   -54,    32,    32,    32,    32,    32,    32,    32,    32,
+      32,    32,    32,    32,    32,   -54,   346,    74,    76,   186,
+      32,   107,    62,   262,   284,    75,    81,    32,   -54,   346,
+     362,    51,   376,   376,   105,   105,   105,   105,     2,     2,
+     -54,   -54,   -54,   -54,    32,     4,   346,    77,   -54,   157,
+     157,    32,    32,   204,   346,   -54,    98,   -54,   222,   326,
+     -54,   157,   -54,    94,   -54,    87,   157,   -54
+};
+
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_int8 yydefact[] =
+{
+       0,     4,     0,     0,     3,     5,     0,     1,     7,     6,
+       9,     0,     0,    10,    11,     0,     0,     0,     8,     0,
+       0,    45,    46,    47,    48,    51,     0,     0,     0,     0,
+      44,     0,     0,    17,     0,     0,     0,     0,    15,    18,
+       0,     0,     0,    21,    22,    23,     0,     0,    12,    26,
+      69,     0,    32,    28,    29,     0,     0,     0,    51,    43,
+      66,    65,     0,    67,    27,    16,    19,    20,    35,    36,
+       0,    24,     0,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,     0,    25,    71,     0,    70,     0,
+       0,     0,     0,     0,     0,    37,     0,     0,    50,    34,
+      53,    52,    54,    55,    58,    59,    56,    57,    60,    61,
+      62,    63,    64,    49,     0,    68,    31,     0,    30,     0,
+       0,     0,     0,     0,    72,    33,    39,    41,     0,     0,
+      68,     0,    38,     0,    40,     0,     0,    42
+};
+
+/* YYPGOTO[NTERM-NUM].  */
+static const yytype_int8 yypgoto[] =
+{
+     -54,   -54,   -54,   116,   -54,   -54,   -54,   -54,   -37,   119,
+     -54,   -54,    43,   -53,   -54,   -54,   -54,   -54,   -54,   -29,
+     -54,   -54
+};
+
+/* YYDEFGOTO[NTERM-NUM].  */
+static const yytype_int8 yydefgoto[] =
+{
+       0,     3,     4,     5,    12,    13,    36,    37,    38,    39,
+      40,    53,    54,    41,    42,    43,    44,    45,    46,    47,
+      87,    88
+};
+
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
+static const yytype_int16 yytable[] =
+{
+      65,    59,    60,    61,    96,    62,    63,    68,    69,     2,
+      -2,     1,     6,   -38,   -38,    90,    91,    50,     2,     7,
+      10,    86,    89,    97,    11,    14,    93,    94,    82,    83,
+      84,     8,    15,    17,    70,    21,    22,    23,    24,    58,
+     -38,    99,    16,   100,   101,   102,   103,   104,   105,   106,
+     107,   108,   109,   110,   111,   112,    31,    32,    19,    48,
+      49,   116,    72,    34,    74,    75,    76,    77,   123,    52,
+      55,    35,    56,    78,    79,    80,    81,    82,    83,    84,
+     135,    64,   126,   127,    20,   124,    21,    22,    23,    24,
+      25,    26,   128,   129,   134,    57,    66,    67,    71,   137,
+      27,    95,    28,    29,    30,    92,   113,    31,    32,   114,
+     117,   122,   121,    33,    34,   125,   131,    17,   -13,   136,
+       9,    20,    35,    21,    22,    23,    24,    25,    26,    80,
+      81,    82,    83,    84,    18,   118,     0,    27,     0,    28,
+      29,    30,     0,     0,    31,    32,     0,     0,     0,     0,
+      33,    34,     0,     0,    17,   -14,     0,     0,    20,    35,
+      21,    22,    23,    24,    25,    26,     0,   -37,   -37,     0,
+       0,     0,     0,     0,    27,     0,    28,    29,    30,     0,
+       0,    31,    32,     0,     0,     0,     0,    33,    34,    50,
+       0,    17,     0,     0,   -37,    51,    35,    72,    73,    74,
+      75,    76,    77,     0,     0,     0,     0,     0,    78,    79,
+      80,    81,    82,    83,    84,    72,    73,    74,    75,    76,
+      77,     0,     0,     0,   115,     0,    78,    79,    80,    81,
+      82,    83,    84,    72,    73,    74,    75,    76,    77,     0,
+       0,     0,   130,     0,    78,    79,    80,    81,    82,    83,
+      84,    72,    73,    74,    75,    76,    77,     0,     0,     0,
+     132,     0,    78,    79,    80,    81,    82,    83,    84,     0,
+       0,     0,    98,    72,    73,    74,    75,    76,    77,     0,
+       0,     0,     0,     0,    78,    79,    80,    81,    82,    83,
+      84,     0,     0,     0,   119,    72,    73,    74,    75,    76,
+      77,     0,     0,     0,     0,     0,    78,    79,    80,    81,
+      82,    83,    84,     0,     0,     0,   120,    72,    73,    74,
+      75,    76,    77,     0,     0,     0,     0,     0,    78,    79,
+      80,    81,    82,    83,    84,     0,    85,    72,    73,    74,
+      75,    76,    77,     0,     0,     0,     0,     0,    78,    79,
+      80,    81,    82,    83,    84,     0,   133,    72,    73,    74,
+      75,    76,    77,     0,     0,     0,     0,     0,    78,    79,
+      80,    81,    82,    83,    84,    74,    75,    76,    77,     0,
+       0,     0,     0,     0,    78,    79,    80,    81,    82,    83,
+      84,    76,    77,     0,     0,     0,     0,     0,    78,    79,
+      80,    81,    82,    83,    84
+};
+
+static const yytype_int16 yycheck[] =
+{
+      37,    30,    31,    32,    57,    34,    35,     9,    10,     8,
+       0,     1,     7,     9,    10,    36,    37,    31,     8,     0,
+      31,    50,    51,    37,     8,     7,    55,    56,    26,    27,
+      28,    30,    32,    34,    36,     3,     4,     5,     6,     7,
+      36,    70,    33,    72,    73,    74,    75,    76,    77,    78,
+      79,    80,    81,    82,    83,    84,    24,    25,     8,     7,
+      30,    90,    11,    31,    13,    14,    15,    16,    97,     7,
+      31,    39,    31,    22,    23,    24,    25,    26,    27,    28,
+     133,    35,   119,   120,     1,   114,     3,     4,     5,     6,
+       7,     8,   121,   122,   131,    31,    30,    30,    30,   136,
+      17,     7,    19,    20,    21,    33,    32,    24,    25,    33,
+       3,    30,    37,    30,    31,    38,    18,    34,    35,    32,
+       4,     1,    39,     3,     4,     5,     6,     7,     8,    24,
+      25,    26,    27,    28,    15,    92,    -1,    17,    -1,    19,
+      20,    21,    -1,    -1,    24,    25,    -1,    -1,    -1,    -1,
+      30,    31,    -1,    -1,    34,    35,    -1,    -1,     1,    39,
+       3,     4,     5,     6,     7,     8,    -1,     9,    10,    -1,
+      -1,    -1,    -1,    -1,    17,    -1,    19,    20,    21,    -1,
+      -1,    24,    25,    -1,    -1,    -1,    -1,    30,    31,    31,
+      -1,    34,    -1,    -1,    36,    37,    39,    11,    12,    13,
+      14,    15,    16,    -1,    -1,    -1,    -1,    -1,    22,    23,
+      24,    25,    26,    27,    28,    11,    12,    13,    14,    15,
+      16,    -1,    -1,    -1,    38,    -1,    22,    23,    24,    25,
+      26,    27,    28,    11,    12,    13,    14,    15,    16,    -1,
+      -1,    -1,    38,    -1,    22,    23,    24,    25,    26,    27,
+      28,    11,    12,    13,    14,    15,    16,    -1,    -1,    -1,
+      38,    -1,    22,    23,    24,    25,    26,    27,    28,    -1,
+      -1,    -1,    32,    11,    12,    13,    14,    15,    16,    -1,
+      -1,    -1,    -1,    -1,    22,    23,    24,    25,    26,    27,
+      28,    -1,    -1,    -1,    32,    11,    12,    13,    14,    15,
+      16,    -1,    -1,    -1,    -1,    -1,    22,    23,    24,    25,
+      26,    27,    28,    -1,    -1,    -1,    32,    11,    12,    13,
+      14,    15,    16,    -1,    -1,    -1,    -1,    -1,    22,    23,
+      24,    25,    26,    27,    28,    -1,    30,    11,    12,    13,
+      14,    15,    16,    -1,    -1,    -1,    -1,    -1,    22,    23,
+      24,    25,    26,    27,    28,    -1,    30,    11,    12,    13,
+      14,    15,    16,    -1,    -1,    -1,    -1,    -1,    22,    23,
+      24,    25,    26,    27,    28,    13,    14,    15,    16,    -1,
+      -1,    -1,    -1,    -1,    22,    23,    24,    25,    26,    27,
+      28,    15,    16,    -1,    -1,    -1,    -1,    -1,    22,    23,
+      24,    25,    26,    27,    28
+};
+
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_int8 yystos[] =
+{
+       0,     1,     8,    41,    42,    43,     7,     0,    30,    43,
+      31,     8,    44,    45,     7,    32,    33,    34,    49,     8,
+       1,     3,     4,     5,     6,     7,     8,    17,    19,    20,
+      21,    24,    25,    30,    31,    39,    46,    47,    48,    49,
+      50,    53,    54,    55,    56,    57,    58,    59,     7,    30,
+      31,    37,     7,    51,    52,    31,    31,    31,     7,    59,
+      59,    59,    59,    59,    35,    48,    30,    30,     9,    10,
+      36,    30,    11,    12,    13,    14,    15,    16,    22,    23,
+      24,    25,    26,    27,    28,    30,    59,    60,    61,    59,
+      36,    37,    33,    59,    59,     7,    53,    37,    32,    59,
+      59,    59,    59,    59,    59,    59,    59,    59,    59,    59,
+      59,    59,    59,    32,    33,    38,    59,     3,    52,    32,
+      32,    37,    30,    59,    59,    38,    48,    48,    59,    59,
+      38,    18,    38,    30,    48,    53,    32,    48
+};
+
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr1[] =
+{
+       0,    40,    41,    41,    41,    42,    42,    42,    43,    44,
+      44,    45,    45,    46,    46,    47,    47,    48,    48,    48,
+      48,    48,    48,    48,    48,    48,    48,    49,    50,    51,
+      51,    52,    52,    52,    53,    53,    53,    54,    54,    55,
+      55,    56,    57,    58,    58,    59,    59,    59,    59,    59,
+      59,    59,    59,    59,    59,    59,    59,    59,    59,    59,
+      59,    59,    59,    59,    59,    59,    59,    59,    59,    60,
+      60,    61,    61
+};
+
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr2[] =
+{
+       0,     2,     0,     1,     1,     1,     2,     2,     6,     0,
+       1,     2,     4,     0,     1,     1,     2,     1,     1,     2,
+       2,     1,     1,     1,     2,     2,     2,     3,     2,     1,
+       3,     3,     1,     4,     3,     2,     2,     1,     4,     5,
+       7,     5,     9,     2,     1,     1,     1,     1,     1,     4,
+       3,     1,     3,     3,     3,     3,     3,     3,     3,     3,
+       3,     3,     3,     3,     3,     2,     2,     2,     4,     0,
+       1,     1,     3
+};
+
+
+enum { YYENOMEM = -2 };
+
+#define yyerrok         (yyerrstatus = 0)
+#define yyclearin       (yychar = YYEMPTY)
+
+#define YYACCEPT        goto yyacceptlab
+#define YYABORT         goto yyabortlab
+#define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
+
+
+#define YYRECOVERING()  (!!yyerrstatus)
+
+#define YYBACKUP(Token, Value)                                    \
+  do                                                              \
+    if (yychar == YYEMPTY)                                        \
+      {                                                           \
+        yychar = (Token);                                         \
+        yylval = (Value);                                         \
+        YYPOPSTACK (yylen);                                       \
+        yystate = *yyssp;                                         \
+        goto yybackup;                                            \
+      }                                                           \
+    else                                                          \
+      {                                                           \
+        yyerror (&yylloc, pnode, YY_("syntax error: cannot back up")); \
+        YYERROR;                                                  \
+      }                                                           \
+  while (0)
+
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
+
+/* YYLLOC_DEFAULT -- Set CURRENT to span from RHS[1] to RHS[N].
+   If N is 0, then set CURRENT to the empty location which ends
+   the previous symbol: RHS[0] (always defined).  */
+
+#ifndef YYLLOC_DEFAULT
+# define YYLLOC_DEFAULT(Current, Rhs, N)                                \
+    do                                                                  \
+      if (N)                                                            \
+        {                                                               \
+          (Current).first_line   = YYRHSLOC (Rhs, 1).first_line;        \
+          (Current).first_column = YYRHSLOC (Rhs, 1).first_column;      \
+          (Current).last_line    = YYRHSLOC (Rhs, N).last_line;         \
+          (Current).last_column  = YYRHSLOC (Rhs, N).last_column;       \
+        }                                                               \
+      else                                                              \
+        {                                                               \
+          (Current).first_line   = (Current).last_line   =              \
+            YYRHSLOC (Rhs, 0).last_line;                                \
+          (Current).first_column = (Current).last_column =              \
+            YYRHSLOC (Rhs, 0).last_column;                              \
+        }                                                               \
+    while (0)
+#endif
+
+#define YYRHSLOC(Rhs, K) ((Rhs)[K])
+
+
+/* Enable debugging if requested.  */
+#if YYDEBUG
+
+# ifndef YYFPRINTF
+#  include <stdio.h> /* INFRINGES ON USER NAME SPACE */
+#  define YYFPRINTF fprintf
+# endif
+
+# define YYDPRINTF(Args)                        \
+do {                                            \
+  if (yydebug)                                  \
+    YYFPRINTF Args;                             \
+} while (0)
+
+
+/* YYLOCATION_PRINT -- Print the location on the stream.
+   This macro was not mandated originally: define only if we know
+   we won't break user code: when these are the locations we know.  */
+
+# ifndef YYLOCATION_PRINT
+
+#  if defined YY_LOCATION_PRINT
+
+   /* Temporary convenience wrapper in case some people defined the
+      undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YYLOCATION_PRINT(File, Loc)  YY_LOCATION_PRINT(File, *(Loc))
+
+#  elif defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
+
+/* Print *YYLOCP on YYO.  Private, do not rely on its existence. */
+
+YY_ATTRIBUTE_UNUSED
+static int
+yy_location_print_ (FILE *yyo, YYLTYPE const * const yylocp)
+{
+  int res = 0;
+  int end_col = 0 != yylocp->last_column ? yylocp->last_column - 1 : 0;
+  if (0 <= yylocp->first_line)
+    {
+      res += YYFPRINTF (yyo, "%d", yylocp->first_line);
+      if (0 <= yylocp->first_column)
+        res += YYFPRINTF (yyo, ".%d", yylocp->first_column);
+    }
+  if (0 <= yylocp->last_line)
+    {
+      if (yylocp->first_line < yylocp->last_line)
+        {
+          res += YYFPRINTF (yyo, "-%d", yylocp->last_line);
+          if (0 <= end_col)
+            res += YYFPRINTF (yyo, ".%d", end_col);
+        }
+      else if (0 <= end_col && yylocp->first_column < end_col)
+        res += YYFPRINTF (yyo, "-%d", end_col);
+    }
+  return res;
+}
+
+#   define YYLOCATION_PRINT  yy_location_print_
+
+    /* Temporary convenience wrapper in case some people defined the
+       undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YY_LOCATION_PRINT(File, Loc)  YYLOCATION_PRINT(File, &(Loc))
+
+#  else
+
+#   define YYLOCATION_PRINT(File, Loc) ((void) 0)
+    /* Temporary convenience wrapper in case some people defined the
+       undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YY_LOCATION_PRINT  YYLOCATION_PRINT
+
+#  endif
+# endif /* !defined YYLOCATION_PRINT */
+
+
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
+do {                                                                      \
+  if (yydebug)                                                            \
+    {                                                                     \
+      YYFPRINTF (stderr, "%s ", Title);                                   \
+      yy_symbol_print (stderr,                                            \
+                  Kind, Value, Location, pnode); \
+      YYFPRINTF (stderr, "\n");                                           \
+    }                                                                     \
+} while (0)
+
+
+/*-----------------------------------.
+| Print this symbol's value on YYO.  |
+`-----------------------------------*/
+
+static void
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp, node_t **pnode)
+{
+  FILE *yyoutput = yyo;
+  YY_USE (yyoutput);
+  YY_USE (yylocationp);
+  YY_USE (pnode);
+  if (!yyvaluep)
+    return;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+}
+
+
+/*---------------------------.
+| Print this symbol on YYO.  |
+`---------------------------*/
+
+static void
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp, node_t **pnode)
+{
+  YYFPRINTF (yyo, "%s %s (",
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
+
+  YYLOCATION_PRINT (yyo, yylocationp);
+  YYFPRINTF (yyo, ": ");
+  yy_symbol_value_print (yyo, yykind, yyvaluep, yylocationp, pnode);
+  YYFPRINTF (yyo, ")");
+}
+
+/*------------------------------------------------------------------.
+| yy_stack_print -- Print the state stack from its BOTTOM up to its |
+| TOP (included).                                                   |
+`------------------------------------------------------------------*/
+
+static void
+yy_stack_print (yy_state_t *yybottom, yy_state_t *yytop)
+{
+  YYFPRINTF (stderr, "Stack now");
+  for (; yybottom <= yytop; yybottom++)
+    {
+      int yybot = *yybottom;
+      YYFPRINTF (stderr, " %d", yybot);
+    }
+  YYFPRINTF (stderr, "\n");
+}
+
+# define YY_STACK_PRINT(Bottom, Top)                            \
+do {                                                            \
+  if (yydebug)                                                  \
+    yy_stack_print ((Bottom), (Top));                           \
+} while (0)
+
+
+/*------------------------------------------------.
+| Report that the YYRULE is going to be reduced.  |
+`------------------------------------------------*/
+
+static void
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp, YYLTYPE *yylsp,
+                 int yyrule, node_t **pnode)
+{
+  int yylno = yyrline[yyrule];
+  int yynrhs = yyr2[yyrule];
+  int yyi;
+  YYFPRINTF (stderr, "Reducing stack by rule %d (line %d):\n",
+             yyrule - 1, yylno);
+  /* The symbols being reduced.  */
+  for (yyi = 0; yyi < yynrhs; yyi++)
+    {
+      YYFPRINTF (stderr, "   $%d = ", yyi + 1);
+      yy_symbol_print (stderr,
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)],
+                       &(yylsp[(yyi + 1) - (yynrhs)]), pnode);
+      YYFPRINTF (stderr, "\n");
+    }
+}
+
+# define YY_REDUCE_PRINT(Rule)          \
+do {                                    \
+  if (yydebug)                          \
+    yy_reduce_print (yyssp, yyvsp, yylsp, Rule, pnode); \
+} while (0)
+
+/* Nonzero means print parse trace.  It is left uninitialized so that
+   multiple parsers can coexist.  */
+int yydebug;
+#else /* !YYDEBUG */
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
+# define YY_STACK_PRINT(Bottom, Top)
+# define YY_REDUCE_PRINT(Rule)
+#endif /* !YYDEBUG */
+
+
+/* YYINITDEPTH -- initial size of the parser's stacks.  */
+#ifndef YYINITDEPTH
+# define YYINITDEPTH 200
+#endif
+
+/* YYMAXDEPTH -- maximum size the stacks can grow to (effective only
+   if the built-in stack extension method is used).
+
+   Do not make this value too large; the results are undefined if
+   YYSTACK_ALLOC_MAXIMUM < YYSTACK_BYTES (YYMAXDEPTH)
+   evaluated with infinite-precision integer arithmetic.  */
+
+#ifndef YYMAXDEPTH
+# define YYMAXDEPTH 10000
+#endif
+
+
+/* Context of a parse error.  */
+typedef struct
+{
+  yy_state_t *yyssp;
+  yysymbol_kind_t yytoken;
+  YYLTYPE *yylloc;
+} yypcontext_t;
+
+/* Put in YYARG at most YYARGN of the expected tokens given the
+   current YYCTX, and return the number of tokens stored in YYARG.  If
+   YYARG is null, return the number of expected tokens (guaranteed to
+   be less than YYNTOKENS).  Return YYENOMEM on memory exhaustion.
+   Return 0 if there are more than YYARGN expected tokens, yet fill
+   YYARG up to YYARGN. */
+static int
+yypcontext_expected_tokens (const yypcontext_t *yyctx,
+                            yysymbol_kind_t yyarg[], int yyargn)
+{
+  /* Actual size of YYARG. */
+  int yycount = 0;
+  int yyn = yypact[+*yyctx->yyssp];
+  if (!yypact_value_is_default (yyn))
+    {
+      /* Start YYX at -YYN if negative to avoid negative indexes in
+         YYCHECK.  In other words, skip the first -YYN actions for
+         this state because they are default actions.  */
+      int yyxbegin = yyn < 0 ? -yyn : 0;
+      /* Stay within bounds of both yycheck and yytname.  */
+      int yychecklim = YYLAST - yyn + 1;
+      int yyxend = yychecklim < YYNTOKENS ? yychecklim : YYNTOKENS;
+      int yyx;
+      for (yyx = yyxbegin; yyx < yyxend; ++yyx)
+        if (yycheck[yyx + yyn] == yyx && yyx != YYSYMBOL_YYerror
+            && !yytable_value_is_error (yytable[yyx + yyn]))
+          {
+            if (!yyarg)
+              ++yycount;
+            else if (yycount == yyargn)
+              return 0;
+            else
+              yyarg[yycount++] = YY_CAST (yysymbol_kind_t, yyx);
+          }
+    }
+  if (yyarg && yycount == 0 && 0 < yyargn)
+    yyarg[0] = YYSYMBOL_YYEMPTY;
+  return yycount;
+}
+
+
+
+
+#ifndef yystrlen
+# if defined __GLIBC__ && defined _STRING_H
+#  define yystrlen(S) (YY_CAST (YYPTRDIFF_T, strlen (S)))
+# else
+/* Return the length of YYSTR.  */
+static YYPTRDIFF_T
+yystrlen (const char *yystr)
+{
+  YYPTRDIFF_T yylen;
+  for (yylen = 0; yystr[yylen]; yylen++)
+    continue;
+  return yylen;
+}
+# endif
+#endif
+
+#ifndef yystpcpy
+# if defined __GLIBC__ && defined _STRING_H && defined _GNU_SOURCE
+#  define yystpcpy stpcpy
+# else
+/* Copy YYSRC to YYDEST, returning the address of the terminating '\0' in
+   YYDEST.  */
+static char *
+yystpcpy (char *yydest, const char *yysrc)
+{
+  char *yyd = yydest;
+  const char *yys = yysrc;
+
+  while ((*yyd++ = *yys++) != '\0')
+    continue;
+
+  return yyd - 1;
+}
+# endif
+#endif
+
+#ifndef yytnamerr
+/* Copy to YYRES the contents of YYSTR after stripping away unnecessary
+   quotes and backslashes, so that it's suitable for yyerror.  The
+   heuristic is that double-quoting is unnecessary unless the string
+   contains an apostrophe, a comma, or backslash (other than
+   backslash-backslash).  YYSTR is taken from yytname.  If YYRES is
+   null, do not copy; instead, return the length of what the result
+   would have been.  */
+static YYPTRDIFF_T
+yytnamerr (char *yyres, const char *yystr)
+{
+  if (*yystr == '"')
+    {
+      YYPTRDIFF_T yyn = 0;
+      char const *yyp = yystr;
+      for (;;)
+        switch (*++yyp)
+          {
+          case '\'':
+          case ',':
+            goto do_not_strip_quotes;
+
+          case '\\':
+            if (*++yyp != '\\')
+              goto do_not_strip_quotes;
+            else
+              goto append;
+
+          append:
+          default:
+            if (yyres)
+              yyres[yyn] = *yyp;
+            yyn++;
+            break;
+
+          case '"':
+            if (yyres)
+              yyres[yyn] = '\0';
+            return yyn;
+          }
+    do_not_strip_quotes: ;
+    }
+
+  if (yyres)
+    return yystpcpy (yyres, yystr) - yyres;
+  else
+    return yystrlen (yystr);
+}
+#endif
+
+
+static int
+yy_syntax_error_arguments (const yypcontext_t *yyctx,
+                           yysymbol_kind_t yyarg[], int yyargn)
+{
+  /* Actual size of YYARG. */
+  int yycount = 0;
+  /* There are many possibilities here to consider:
+     - If this state is a consistent state with a default action, then
+       the only way this function was invoked is if the default action
+       is an error action.  In that case, don't check for expected
+       tokens because there are none.
+     - The only way there can be no lookahead present (in yychar) is if
+       this state is a consistent state with a default action.  Thus,
+       detecting the absence of a lookahead is sufficient to determine
+       that there is no unexpected or expected token to report.  In that
+       case, just report a simple "syntax error".
+     - Don't assume there isn't a lookahead just because this state is a
+       consistent state with a default action.  There might have been a
+       previous inconsistent state, consistent state with a non-default
+       action, or user semantic action that manipulated yychar.
+     - Of course, the expected token list depends on states to have
+       correct lookahead information, and it depends on the parser not
+       to perform extra reductions after fetching a lookahead from the
+       scanner and before detecting a syntax error.  Thus, state merging
+       (from LALR or IELR) and default reductions corrupt the expected
+       token list.  However, the list is correct for canonical LR with
+       one exception: it will still contain any token that will not be
+       accepted due to an error action in a later state.
+  */
+  if (yyctx->yytoken != YYSYMBOL_YYEMPTY)
+    {
+      int yyn;
+      if (yyarg)
+        yyarg[yycount] = yyctx->yytoken;
+      ++yycount;
+      yyn = yypcontext_expected_tokens (yyctx,
+                                        yyarg ? yyarg + 1 : yyarg, yyargn - 1);
+      if (yyn == YYENOMEM)
+        return YYENOMEM;
+      else
+        yycount += yyn;
+    }
+  return yycount;
+}
+
+/* Copy into *YYMSG, which is of size *YYMSG_ALLOC, an error message
+   about the unexpected token YYTOKEN for the state stack whose top is
+   YYSSP.
+
+   Return 0 if *YYMSG was successfully written.  Return -1 if *YYMSG is
+   not large enough to hold the message.  In that case, also set
+   *YYMSG_ALLOC to the required number of bytes.  Return YYENOMEM if the
+   required number of bytes is too large to store.  */
+static int
+yysyntax_error (YYPTRDIFF_T *yymsg_alloc, char **yymsg,
+                const yypcontext_t *yyctx)
+{
+  enum { YYARGS_MAX = 5 };
+  /* Internationalized format string. */
+  const char *yyformat = YY_NULLPTR;
+  /* Arguments of yyformat: reported tokens (one for the "unexpected",
+     one per "expected"). */
+  yysymbol_kind_t yyarg[YYARGS_MAX];
+  /* Cumulated lengths of YYARG.  */
+  YYPTRDIFF_T yysize = 0;
+
+  /* Actual size of YYARG. */
+  int yycount = yy_syntax_error_arguments (yyctx, yyarg, YYARGS_MAX);
+  if (yycount == YYENOMEM)
+    return YYENOMEM;
+
+  switch (yycount)
+    {
+#define YYCASE_(N, S)                       \
+      case N:                               \
+        yyformat = S;                       \
+        break
+    default: /* Avoid compiler warnings. */
+      YYCASE_(0, YY_("syntax error"));
+      YYCASE_(1, YY_("syntax error, unexpected %s"));
+      YYCASE_(2, YY_("syntax error, unexpected %s, expecting %s"));
+      YYCASE_(3, YY_("syntax error, unexpected %s, expecting %s or %s"));
+      YYCASE_(4, YY_("syntax error, unexpected %s, expecting %s or %s or %s"));
+      YYCASE_(5, YY_("syntax error, unexpected %s, expecting %s or %s or %s or %s"));
+#undef YYCASE_
+    }
+
+  /* Compute error message size.  Don't count the "%s"s, but reserve
+     room for the terminator.  */
+  yysize = yystrlen (yyformat) - 2 * yycount + 1;
+  {
+    int yyi;
+    for (yyi = 0; yyi < yycount; ++yyi)
+      {
+        YYPTRDIFF_T yysize1
+          = yysize + yytnamerr (YY_NULLPTR, yytname[yyarg[yyi]]);
+        if (yysize <= yysize1 && yysize1 <= YYSTACK_ALLOC_MAXIMUM)
+          yysize = yysize1;
+        else
+          return YYENOMEM;
+      }
+  }
+
+  if (*yymsg_alloc < yysize)
+    {
+      *yymsg_alloc = 2 * yysize;
+      if (! (yysize <= *yymsg_alloc
+             && *yymsg_alloc <= YYSTACK_ALLOC_MAXIMUM))
+        *yymsg_alloc = YYSTACK_ALLOC_MAXIMUM;
+      return -1;
+    }
+
+  /* Avoid sprintf, as that infringes on the user's name space.
+     Don't have undefined behavior even if the translation
+     produced a string with the wrong number of "%s"s.  */
+  {
+    char *yyp = *yymsg;
+    int yyi = 0;
+    while ((*yyp = *yyformat) != '\0')
+      if (*yyp == '%' && yyformat[1] == 's' && yyi < yycount)
+        {
+          yyp += yytnamerr (yyp, yytname[yyarg[yyi++]]);
+          yyformat += 2;
+        }
+      else
+        {
+          ++yyp;
+          ++yyformat;
+        }
+  }
+  return 0;
+}
+
+
+/*-----------------------------------------------.
+| Release the memory associated to this symbol.  |
+`-----------------------------------------------*/
+
+static void
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, YYLTYPE *yylocationp, node_t **pnode)
+{
+  YY_USE (yyvaluep);
+  YY_USE (yylocationp);
+  YY_USE (pnode);
+  if (!yymsg)
+    yymsg = "Deleting";
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
+
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+}
+
+
+
+
+
+
+/*----------.
+| yyparse.  |
+`----------*/
+
+int
+yyparse (node_t **pnode)
+{
+/* Lookahead token kind.  */
+int yychar;
+
+
+/* The semantic value of the lookahead symbol.  */
+/* Default value used for initialization, for pacifying older GCCs
+   or non-GCC compilers.  */
+YY_INITIAL_VALUE (static YYSTYPE yyval_default;)
+YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
+
+/* Location data for the lookahead symbol.  */
+static YYLTYPE yyloc_default
+# if defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
+  = { 1, 1, 1, 1 }
+# endif
+;
+YYLTYPE yylloc = yyloc_default;
+
+    /* Number of syntax errors so far.  */
+    int yynerrs = 0;
+
+    yy_state_fast_t yystate = 0;
+    /* Number of tokens to shift before error messages enabled.  */
+    int yyerrstatus = 0;
+
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
+       to reallocate them elsewhere.  */
+
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
+
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
+
+    /* The semantic value stack: array, bottom, top.  */
+    YYSTYPE yyvsa[YYINITDEPTH];
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
+
+    /* The location stack: array, bottom, top.  */
+    YYLTYPE yylsa[YYINITDEPTH];
+    YYLTYPE *yyls = yylsa;
+    YYLTYPE *yylsp = yyls;
+
+  int yyn;
+  /* The return value of yyparse.  */
+  int yyresult;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
+  /* The variables used to return semantic value and location from the
+     action routines.  */
+  YYSTYPE yyval;
+  YYLTYPE yyloc;
+
+  /* The locations where the error started and ended.  */
+  YYLTYPE yyerror_range[3];
+
+  /* Buffer for error messages, and its allocated size.  */
+  char yymsgbuf[128];
+  char *yymsg = yymsgbuf;
+  YYPTRDIFF_T yymsg_alloc = sizeof yymsgbuf;
+
+#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N), yylsp -= (N))
+
+  /* The number of symbols on the RHS of the reduced rule.
+     Keep to zero when no symbol should be popped.  */
+  int yylen = 0;
+
+  YYDPRINTF ((stderr, "Starting parse\n"));
+
+  yychar = YYEMPTY; /* Cause a token to be read.  */
+
+  yylsp[0] = yylloc;
+  goto yysetstate;
+
+
+/*------------------------------------------------------------.
+| yynewstate -- push a new state, which is found in yystate.  |
+`------------------------------------------------------------*/
+yynewstate:
+  /* In all cases, when you get here, the value and location stacks
+     have just been pushed.  So pushing a state here evens the stacks.  */
+  yyssp++;
+
+
+/*--------------------------------------------------------------------.
+| yysetstate -- set current state (the top of the stack) to yystate.  |
+`--------------------------------------------------------------------*/
+yysetstate:
+  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+  YY_ASSERT (0 <= yystate && yystate < YYNSTATES);
+  YY_IGNORE_USELESS_CAST_BEGIN
+  *yyssp = YY_CAST (yy_state_t, yystate);
+  YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
+
+  if (yyss + yystacksize - 1 <= yyssp)
+#if !defined yyoverflow && !defined YYSTACK_RELOCATE
+    YYNOMEM;
+#else
+    {
+      /* Get the current used size of the three stacks, in elements.  */
+      YYPTRDIFF_T yysize = yyssp - yyss + 1;
+
+# if defined yyoverflow
+      {
+        /* Give user a chance to reallocate the stack.  Use copies of
+           these so that the &'s don't force the real ones into
+           memory.  */
+        yy_state_t *yyss1 = yyss;
+        YYSTYPE *yyvs1 = yyvs;
+        YYLTYPE *yyls1 = yyls;
+
+        /* Each stack pointer address is followed by the size of the
+           data in use in that stack, in bytes.  This used to be a
+           conditional around just the two extra args, but that might
+           be undefined if yyoverflow is a macro.  */
+        yyoverflow (YY_("memory exhausted"),
+                    &yyss1, yysize * YYSIZEOF (*yyssp),
+                    &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yyls1, yysize * YYSIZEOF (*yylsp),
+                    &yystacksize);
+        yyss = yyss1;
+        yyvs = yyvs1;
+        yyls = yyls1;
+      }
+# else /* defined YYSTACK_RELOCATE */
+      /* Extend the stack our own way.  */
+      if (YYMAXDEPTH <= yystacksize)
+        YYNOMEM;
+      yystacksize *= 2;
+      if (YYMAXDEPTH < yystacksize)
+        yystacksize = YYMAXDEPTH;
+
+      {
+        yy_state_t *yyss1 = yyss;
+        union yyalloc *yyptr =
+          YY_CAST (union yyalloc *,
+                   YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
+        if (! yyptr)
+          YYNOMEM;
+        YYSTACK_RELOCATE (yyss_alloc, yyss);
+        YYSTACK_RELOCATE (yyvs_alloc, yyvs);
+        YYSTACK_RELOCATE (yyls_alloc, yyls);
+#  undef YYSTACK_RELOCATE
+        if (yyss1 != yyssa)
+          YYSTACK_FREE (yyss1);
+      }
+# endif
+
+      yyssp = yyss + yysize - 1;
+      yyvsp = yyvs + yysize - 1;
+      yylsp = yyls + yysize - 1;
+
+      YY_IGNORE_USELESS_CAST_BEGIN
+      YYDPRINTF ((stderr, "Stack size increased to %ld\n",
+                  YY_CAST (long, yystacksize)));
+      YY_IGNORE_USELESS_CAST_END
+
+      if (yyss + yystacksize - 1 <= yyssp)
+        YYABORT;
+    }
+#endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
+
+
+  if (yystate == YYFINAL)
+    YYACCEPT;
+
+  goto yybackup;
+
+
+/*-----------.
+| yybackup.  |
+`-----------*/
+yybackup:
+  /* Do appropriate processing given the current state.  Read a
+     lookahead token if we need one and don't already have one.  */
+
+  /* First try to decide what to do without reference to lookahead token.  */
+  yyn = yypact[yystate];
+  if (yypact_value_is_default (yyn))
+    goto yydefault;
+
+  /* Not known => get a lookahead token if don't already have one.  */
+
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
+  if (yychar == YYEMPTY)
+    {
+      YYDPRINTF ((stderr, "Reading a token\n"));
+      yychar = yylex (&yylval, &yylloc);
+    }
+
+  if (yychar <= YYEOF)
+    {
+      yychar = YYEOF;
+      yytoken = YYSYMBOL_YYEOF;
+      YYDPRINTF ((stderr, "Now at end of input.\n"));
+    }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      yyerror_range[1] = yylloc;
+      goto yyerrlab1;
+    }
+  else
+    {
+      yytoken = YYTRANSLATE (yychar);
+      YY_SYMBOL_PRINT ("Next token is", yytoken, &yylval, &yylloc);
+    }
+
+  /* If the proper action on seeing token YYTOKEN is to reduce or to
+     detect an error, take that action.  */
+  yyn += yytoken;
+  if (yyn < 0 || YYLAST < yyn || yycheck[yyn] != yytoken)
+    goto yydefault;
+  yyn = yytable[yyn];
+  if (yyn <= 0)
+    {
+      if (yytable_value_is_error (yyn))
+        goto yyerrlab;
+      yyn = -yyn;
+      goto yyreduce;
+    }
+
+  /* Count tokens shifted since error; after three, turn off error
+     status.  */
+  if (yyerrstatus)
+    yyerrstatus--;
+
+  /* Shift the lookahead token.  */
+  YY_SYMBOL_PRINT ("Shifting", yytoken, &yylval, &yylloc);
+  yystate = yyn;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+  *++yylsp = yylloc;
+
+  /* Discard the shifted token.  */
+  yychar = YYEMPTY;
+  goto yynewstate;
+
+
+/*-----------------------------------------------------------.
+| yydefault -- do the default action for the current state.  |
+`-----------------------------------------------------------*/
+yydefault:
+  yyn = yydefact[yystate];
+  if (yyn == 0)
+    goto yyerrlab;
+  goto yyreduce;
+
+
+/*-----------------------------.
+| yyreduce -- do a reduction.  |
+`-----------------------------*/
+yyreduce:
+  /* yyn is the number of a rule to reduce with.  */
+  yylen = yyr2[yyn];
+
+  /* If YYLEN is nonzero, implement the default value of the action:
+     '$$ = $1'.
+
+     Otherwise, the following line sets YYVAL to garbage.
+     This behavior is undocumented and Bison
+     users should not rely upon it.  Assigning to YYVAL
+     unconditionally makes the parser a bit smaller, and it avoids a
+     GCC warning that YYVAL may be used uninitialized.  */
+  yyval = yyvsp[1-yylen];
+
+  /* Default location. */
+  YYLLOC_DEFAULT (yyloc, (yylsp - yylen), yylen);
+  yyerror_range[1] = yyloc;
+  YY_REDUCE_PRINT (yyn);
+  switch (yyn)
+    {
+  case 2: /* program: %empty  */
+#line 111 "src/parse.y"
+                      { *pnode = NULL; }
+#line 1708 "_build/src/parse.c"
+    break;
+
+  case 3: /* program: func_list  */
+#line 112 "src/parse.y"
+                      { *pnode = (node_t*) (yyvsp[0].func_lst).first; }
+#line 1714 "_build/src/parse.c"
+    break;
+
+  case 4: /* program: error  */
+#line 113 "src/parse.y"
+                { *pnode = NULL; }
+#line 1720 "_build/src/parse.c"
+    break;
+
+  case 5: /* func_list: func  */
+#line 116 "src/parse.y"
+                 { (yyval.func_lst).first = (yyval.func_lst).last = NULL; add_func(&(yyval.func_lst), (func_t*) (yyvsp[0].node)); }
+#line 1726 "_build/src/parse.c"
+    break;
+
+  case 6: /* func_list: func_list func  */
+#line 117 "src/parse.y"
+                           { (yyval.func_lst) = (yyvsp[-1].func_lst); add_func(&(yyval.func_lst), (func_t*) (yyvsp[0].node)); }
+#line 1732 "_build/src/parse.c"
+    break;
+
+  case 8: /* func: TYPE ID '(' maybe_arg_list ')' block  */
+#line 121 "src/parse.y"
+                                            { (yyval.node) = new_node(NODE_FUNC, make_pos((yylsp[-5]), (yylsp[0])), cons_type((yyvsp[-5].type)), (yyvsp[-4].symbol), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 1738 "_build/src/parse.c"
+    break;
+
+  case 9: /* maybe_arg_list: %empty  */
+#line 124 "src/parse.y"
+                             { (yyval.node) = NULL; }
+#line 1744 "_build/src/parse.c"
+    break;
+
+  case 10: /* maybe_arg_list: arg_list  */
+#line 125 "src/parse.y"
+                          { (yyval.node) = (node_t*) (yyvsp[0].arg_lst).first; }
+#line 1750 "_build/src/parse.c"
+    break;
+
+  case 11: /* arg_list: TYPE ID  */
+#line 128 "src/parse.y"
+                   { (yyval.arg_lst).first = (yyval.arg_lst).last = (arg_t*) new_node(NODE_ARG, make_pos((yylsp[-1]), (yylsp[0])), cons_type((yyvsp[-1].type)), (yyvsp[0].symbol)); }
+#line 1756 "_build/src/parse.c"
+    break;
+
+  case 12: /* arg_list: arg_list ',' TYPE ID  */
+#line 130 "src/parse.y"
+{ (yyval.arg_lst) = (yyvsp[-3].arg_lst); (yyval.arg_lst).last->next = (arg_t*) new_node(NODE_ARG, make_pos((yylsp[-3]), (yylsp[0])), cons_type((yyvsp[-1].type)), (yyvsp[0].symbol)); (yyval.arg_lst).last = (yyval.arg_lst).last->next; }
+#line 1762 "_build/src/parse.c"
+    break;
+
+  case 13: /* maybe_instr_list: %empty  */
+#line 133 "src/parse.y"
+                               { (yyval.node) = NULL; }
+#line 1768 "_build/src/parse.c"
+    break;
+
+  case 14: /* maybe_instr_list: instr_list  */
+#line 134 "src/parse.y"
+                              { (yyval.node) = (node_t*) (yyvsp[0].instr_lst).first; }
+#line 1774 "_build/src/parse.c"
+    break;
+
+  case 15: /* instr_list: instr  */
+#line 137 "src/parse.y"
+                    { (yyval.instr_lst).first = (yyval.instr_lst).last = (instr_t*) (yyvsp[0].node); }
+#line 1780 "_build/src/parse.c"
+    break;
+
+  case 16: /* instr_list: instr_list instr  */
+#line 138 "src/parse.y"
+                               { (yyval.instr_lst) = (yyvsp[-1].instr_lst); (yyval.instr_lst).last->next = (instr_t*) (yyvsp[0].node); (yyval.instr_lst).last = (instr_t*) (yyvsp[0].node); }
+#line 1786 "_build/src/parse.c"
+    break;
+
+  case 17: /* instr: ';'  */
+#line 141 "src/parse.y"
+            { (yyval.node) = new_node(NODE_INSTR, make_pos((yylsp[0]), (yylsp[0])), NULL); }
+#line 1792 "_build/src/parse.c"
+    break;
+
+  case 18: /* instr: block  */
+#line 142 "src/parse.y"
+              { (yyval.node) = (yyvsp[0].node); }
+#line 1798 "_build/src/parse.c"
+    break;
+
+  case 19: /* instr: declaration ';'  */
+#line 143 "src/parse.y"
+                        { (yyval.node) = new_node(NODE_INSTR, (yyvsp[-1].node)->src_pos, (yyvsp[-1].node)); }
+#line 1804 "_build/src/parse.c"
+    break;
+
+  case 20: /* instr: assignment ';'  */
+#line 144 "src/parse.y"
+                       { (yyval.node) = new_node(NODE_INSTR, (yyvsp[-1].node)->src_pos, (yyvsp[-1].node)); }
+#line 1810 "_build/src/parse.c"
+    break;
+
+  case 21: /* instr: if_instr  */
+#line 145 "src/parse.y"
+                 { (yyval.node) = new_node(NODE_INSTR, (yyvsp[0].node)->src_pos, (yyvsp[0].node)); }
+#line 1816 "_build/src/parse.c"
+    break;
+
+  case 22: /* instr: while_instr  */
+#line 146 "src/parse.y"
+                    { (yyval.node) = new_node(NODE_INSTR, (yyvsp[0].node)->src_pos, (yyvsp[0].node)); }
+#line 1822 "_build/src/parse.c"
+    break;
+
+  case 23: /* instr: for_instr  */
+#line 147 "src/parse.y"
+                  { (yyval.node) = new_node(NODE_INSTR, (yyvsp[0].node)->src_pos, (yyvsp[0].node)); }
+#line 1828 "_build/src/parse.c"
+    break;
+
+  case 24: /* instr: return_instr ';'  */
+#line 148 "src/parse.y"
+                         { (yyval.node) = new_node(NODE_INSTR, (yyvsp[-1].node)->src_pos, (yyvsp[-1].node)); }
+#line 1834 "_build/src/parse.c"
+    break;
+
+  case 25: /* instr: expr ';'  */
+#line 149 "src/parse.y"
+                 { (yyval.node) = new_node(NODE_INSTR, (yyvsp[-1].node)->src_pos, (yyvsp[-1].node)); }
+#line 1840 "_build/src/parse.c"
+    break;
+
+  case 26: /* instr: error ';'  */
+#line 150 "src/parse.y"
+                  { (yyval.node) = new_node(NODE_INSTR, make_pos((yylsp[-1]), (yylsp[-1])), NULL); }
+#line 1846 "_build/src/parse.c"
+    break;
+
+  case 27: /* block: '{' maybe_instr_list '}'  */
+#line 153 "src/parse.y"
+                                 { (yyval.node) = new_node(NODE_BLOCK, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-1].node)); }
+#line 1852 "_build/src/parse.c"
+    break;
+
+  case 28: /* declaration: TYPE declarators  */
+#line 156 "src/parse.y"
+                               { (yyval.node) = new_node(NODE_DECLARATION, make_pos((yylsp[-1]), (yylsp[0])), cons_type((yyvsp[-1].type)), (node_t*) (yyvsp[0].declarator_lst).first); }
+#line 1858 "_build/src/parse.c"
+    break;
+
+  case 29: /* declarators: declarator  */
+#line 159 "src/parse.y"
+                         { (yyval.declarator_lst).first = (yyval.declarator_lst).last = (declarator_t*) (yyvsp[0].node); }
+#line 1864 "_build/src/parse.c"
+    break;
+
+  case 30: /* declarators: declarators ',' declarator  */
+#line 160 "src/parse.y"
+                             { (yyval.declarator_lst) = (yyvsp[-2].declarator_lst); (yyval.declarator_lst).last->next = (declarator_t*) (yyvsp[0].node); (yyval.declarator_lst).last = (yyval.declarator_lst).last->next; }
+#line 1870 "_build/src/parse.c"
+    break;
+
+  case 31: /* declarator: ID '=' expr  */
+#line 163 "src/parse.y"
+                         { (yyval.node) = new_node(NODE_DECLARATOR, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].symbol), D_VAR, (yyvsp[0].node)); }
+#line 1876 "_build/src/parse.c"
+    break;
+
+  case 32: /* declarator: ID  */
+#line 164 "src/parse.y"
+                { (yyval.node) = new_node(NODE_DECLARATOR, make_pos((yylsp[0]), (yylsp[0])), (yyvsp[0].symbol), D_VAR, NULL); }
+#line 1882 "_build/src/parse.c"
+    break;
+
+  case 33: /* declarator: ID '[' INTEGER ']'  */
+#line 165 "src/parse.y"
+                                { (yyval.node) = new_node(NODE_DECLARATOR, make_pos((yylsp[-3]), (yylsp[0])), (yyvsp[-3].symbol), D_ARRAY, (yyvsp[-1].ivalue)); }
+#line 1888 "_build/src/parse.c"
+    break;
+
+  case 34: /* assignment: lvalue '=' expr  */
+#line 168 "src/parse.y"
+                             { (yyval.node) = new_node(NODE_ASSIGN, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 1894 "_build/src/parse.c"
+    break;
+
+  case 35: /* assignment: lvalue PLUS_PLUS  */
+#line 169 "src/parse.y"
+                              { (yyval.node) = new_node(NODE_INC, make_pos((yylsp[-1]), (yylsp[0])), (yyvsp[-1].node)); }
+#line 1900 "_build/src/parse.c"
+    break;
+
+  case 36: /* assignment: lvalue MINUS_MINUS  */
+#line 170 "src/parse.y"
+                                { (yyval.node) = new_node(NODE_DEC, make_pos((yylsp[-1]), (yylsp[0])), (yyvsp[-1].node)); }
+#line 1906 "_build/src/parse.c"
+    break;
+
+  case 37: /* lvalue: ID  */
+#line 173 "src/parse.y"
+            { (yyval.node) = new_node(NODE_IDENT, make_pos((yylsp[0]), (yylsp[0])), (yyvsp[0].symbol)); }
+#line 1912 "_build/src/parse.c"
+    break;
+
+  case 38: /* lvalue: ID '[' expr ']'  */
+#line 174 "src/parse.y"
+                         { (yyval.node) = new_node(NODE_ARRAY, make_pos((yylsp[-3]), (yylsp[0])), (yyvsp[-3].symbol), (yyvsp[-1].node)); }
+#line 1918 "_build/src/parse.c"
+    break;
+
+  case 39: /* if_instr: IF '(' expr ')' instr  */
+#line 177 "src/parse.y"
+                                 { (yyval.node) = new_node(NODE_IF, make_pos((yylsp[-4]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 1924 "_build/src/parse.c"
+    break;
+
+  case 40: /* if_instr: IF '(' expr ')' instr ELSE instr  */
+#line 178 "src/parse.y"
+                                            { (yyval.node) = new_node(NODE_IF_ELSE, make_pos((yylsp[-6]), (yylsp[0])), (yyvsp[-4].node), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 1930 "_build/src/parse.c"
+    break;
+
+  case 41: /* while_instr: WHILE '(' expr ')' instr  */
+#line 181 "src/parse.y"
+                                       { (yyval.node) = new_node(NODE_WHILE, make_pos((yylsp[-4]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 1936 "_build/src/parse.c"
+    break;
+
+  case 42: /* for_instr: FOR '(' assignment ';' expr ';' assignment ')' instr  */
+#line 183 "src/parse.y"
+                                                                 {
+  (yyval.node) = new_node(NODE_FOR, make_pos((yylsp[-8]), (yylsp[0])), (yyvsp[-6].node), (yyvsp[-4].node), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 1943 "_build/src/parse.c"
+    break;
+
+  case 43: /* return_instr: RETURN expr  */
+#line 186 "src/parse.y"
+                           { (yyval.node) = new_node(NODE_RETURN, make_pos((yylsp[-1]), (yylsp[0])), (yyvsp[0].node)); }
+#line 1949 "_build/src/parse.c"
+    break;
+
+  case 44: /* return_instr: RETURN  */
+#line 187 "src/parse.y"
+                      { (yyval.node) = new_node(NODE_RETURN, make_pos((yylsp[0]), (yylsp[0])), NULL); }
+#line 1955 "_build/src/parse.c"
+    break;
+
+  case 45: /* expr: INTEGER  */
+#line 190 "src/parse.y"
+               { (yyval.node) = new_node(NODE_INT, make_pos((yylsp[0]), (yylsp[0])), (yyvsp[0].ivalue)); }
+#line 1961 "_build/src/parse.c"
+    break;
+
+  case 46: /* expr: BOOLEAN  */
+#line 191 "src/parse.y"
+               { (yyval.node) = new_node(NODE_BOOL, make_pos((yylsp[0]), (yylsp[0])), (yyvsp[0].bvalue)); }
+#line 1967 "_build/src/parse.c"
+    break;
+
+  case 47: /* expr: DOUBLE  */
+#line 192 "src/parse.y"
+              { (yyval.node) = new_node(NODE_DOUBLE, make_pos((yylsp[0]), (yylsp[0])), (yyvsp[0].dvalue)); }
+#line 1973 "_build/src/parse.c"
+    break;
+
+  case 48: /* expr: STRING  */
+#line 193 "src/parse.y"
+              { (yyval.node) = new_node(NODE_STR, make_pos((yylsp[0]), (yylsp[0])), (yyvsp[0].str)); }
+#line 1979 "_build/src/parse.c"
+    break;
+
+  case 49: /* expr: ID '(' maybe_expr_list ')'  */
+#line 194 "src/parse.y"
+                                  { (yyval.node) = new_node(NODE_CALL, make_pos((yylsp[-3]), (yylsp[0])), (yyvsp[-3].symbol), (yyvsp[-1].node)); }
+#line 1985 "_build/src/parse.c"
+    break;
+
+  case 50: /* expr: '(' expr ')'  */
+#line 195 "src/parse.y"
+                    { (yyval.node) = (yyvsp[-1].node); }
+#line 1991 "_build/src/parse.c"
+    break;
+
+  case 51: /* expr: ID  */
+#line 196 "src/parse.y"
+          { (yyval.node) = new_node(NODE_IDENT, make_pos((yylsp[0]), (yylsp[0])), (yyvsp[0].symbol)); }
+#line 1997 "_build/src/parse.c"
+    break;
+
+  case 52: /* expr: expr OR expr  */
+#line 197 "src/parse.y"
+                    { (yyval.node) = new_node(NODE_OR, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2003 "_build/src/parse.c"
+    break;
+
+  case 53: /* expr: expr AND expr  */
+#line 198 "src/parse.y"
+                     { (yyval.node) = new_node(NODE_AND, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2009 "_build/src/parse.c"
+    break;
+
+  case 54: /* expr: expr EQUAL expr  */
+#line 199 "src/parse.y"
+                       { (yyval.node) = new_node(NODE_EQ, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2015 "_build/src/parse.c"
+    break;
+
+  case 55: /* expr: expr NOT_EQUAL expr  */
+#line 200 "src/parse.y"
+                           { (yyval.node) = new_node(NODE_NEQ, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2021 "_build/src/parse.c"
+    break;
+
+  case 56: /* expr: expr '<' expr  */
+#line 201 "src/parse.y"
+                     { (yyval.node) = new_node(NODE_LT, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2027 "_build/src/parse.c"
+    break;
+
+  case 57: /* expr: expr '>' expr  */
+#line 202 "src/parse.y"
+                     { (yyval.node) = new_node(NODE_GT, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2033 "_build/src/parse.c"
+    break;
+
+  case 58: /* expr: expr LESS_EQUAL expr  */
+#line 203 "src/parse.y"
+                            { (yyval.node) = new_node(NODE_LEQ, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2039 "_build/src/parse.c"
+    break;
+
+  case 59: /* expr: expr GREATER_EQUAL expr  */
+#line 204 "src/parse.y"
+                               { (yyval.node) = new_node(NODE_GEQ, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2045 "_build/src/parse.c"
+    break;
+
+  case 60: /* expr: expr '+' expr  */
+#line 205 "src/parse.y"
+                     { (yyval.node) = new_node(NODE_ADD, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2051 "_build/src/parse.c"
+    break;
+
+  case 61: /* expr: expr '-' expr  */
+#line 206 "src/parse.y"
+                     { (yyval.node) = new_node(NODE_SUB, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2057 "_build/src/parse.c"
+    break;
+
+  case 62: /* expr: expr '*' expr  */
+#line 207 "src/parse.y"
+                     { (yyval.node) = new_node(NODE_MUL, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2063 "_build/src/parse.c"
+    break;
+
+  case 63: /* expr: expr '/' expr  */
+#line 208 "src/parse.y"
+                     { (yyval.node) = new_node(NODE_DIV, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2069 "_build/src/parse.c"
+    break;
+
+  case 64: /* expr: expr '%' expr  */
+#line 209 "src/parse.y"
+                     { (yyval.node) = new_node(NODE_MOD, make_pos((yylsp[-2]), (yylsp[0])), (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 2075 "_build/src/parse.c"
+    break;
+
+  case 65: /* expr: '-' expr  */
+#line 210 "src/parse.y"
+                            { (yyval.node) = new_node(NODE_NEG, make_pos((yylsp[-1]), (yylsp[0])), (yyvsp[0].node)); }
+#line 2081 "_build/src/parse.c"
+    break;
+
+  case 66: /* expr: '+' expr  */
+#line 211 "src/parse.y"
+                            { (yyval.node) = new_node(NODE_PLUS, make_pos((yylsp[-1]), (yylsp[0])), (yyvsp[0].node)); }
+#line 2087 "_build/src/parse.c"
+    break;
+
+  case 67: /* expr: '!' expr  */
+#line 212 "src/parse.y"
+                            { (yyval.node) = new_node(NODE_NOT, make_pos((yylsp[-1]), (yylsp[0])), (yyvsp[0].node)); }
+#line 2093 "_build/src/parse.c"
+    break;
+
+  case 68: /* expr: ID '[' expr ']'  */
+#line 213 "src/parse.y"
+                       { (yyval.node) = new_node(NODE_ARRAY, make_pos((yylsp[-3]), (yylsp[-2])), (yyvsp[-3].symbol), (yyvsp[-1].node)); }
+#line 2099 "_build/src/parse.c"
+    break;
+
+  case 69: /* maybe_expr_list: %empty  */
+#line 216 "src/parse.y"
+                              { (yyval.node) = NULL; }
+#line 2105 "_build/src/parse.c"
+    break;
+
+  case 70: /* maybe_expr_list: expr_list  */
+#line 217 "src/parse.y"
+                            { (yyval.node) = (node_t*) (yyvsp[0].expr_lst).first; }
+#line 2111 "_build/src/parse.c"
+    break;
+
+  case 71: /* expr_list: expr  */
+#line 220 "src/parse.y"
+                 { (yyval.expr_lst).first = (yyval.expr_lst).last = (expr_list_t*) new_node(NODE_EXPR_LIST, make_pos((yylsp[0]), (yylsp[0])), (yyvsp[0].node)); }
+#line 2117 "_build/src/parse.c"
+    break;
+
+  case 72: /* expr_list: expr_list ',' expr  */
+#line 222 "src/parse.y"
+{ (yyval.expr_lst) = (yyvsp[-2].expr_lst); (yyval.expr_lst).last->next = (expr_list_t*) new_node(NODE_EXPR_LIST, make_pos((yylsp[0]), (yylsp[0])), (yyvsp[0].node));
+  (yyval.expr_lst).last = (yyval.expr_lst).last->next; }
+#line 2124 "_build/src/parse.c"
+    break;
+
+
+#line 2128 "_build/src/parse.c"
+
+      default: break;
+    }
+  /* User semantic actions sometimes alter yychar, and that requires
+     that yytoken be updated with the new translation.  We take the
+     approach of translating immediately before every use of yytoken.
+     One alternative is translating here after every semantic action,
+     but that translation would be missed if the semantic action invokes
+     YYABORT, YYACCEPT, or YYERROR immediately after altering yychar or
+     if it invokes YYBACKUP.  In the case of YYABORT or YYACCEPT, an
+     incorrect destructor might then be invoked immediately.  In the
+     case of YYERROR or YYBACKUP, subsequent parser actions might lead
+     to an incorrect destructor call or verbose syntax error message
+     before the lookahead is translated.  */
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
+
+  YYPOPSTACK (yylen);
+  yylen = 0;
+
+  *++yyvsp = yyval;
+  *++yylsp = yyloc;
+
+  /* Now 'shift' the result of the reduction.  Determine what state
+     that goes to, based on the state we popped back to and the rule
+     number reduced by.  */
+  {
+    const int yylhs = yyr1[yyn] - YYNTOKENS;
+    const int yyi = yypgoto[yylhs] + *yyssp;
+    yystate = (0 <= yyi && yyi <= YYLAST && yycheck[yyi] == *yyssp
+               ? yytable[yyi]
+               : yydefgoto[yylhs]);
+  }
+
+  goto yynewstate;
+
+
+/*--------------------------------------.
+| yyerrlab -- here on detecting error.  |
+`--------------------------------------*/
+yyerrlab:
+  /* Make sure we have latest lookahead translation.  See comments at
+     user semantic actions for why this is necessary.  */
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
+  /* If not already recovering from an error, report this error.  */
+  if (!yyerrstatus)
+    {
+      ++yynerrs;
+      {
+        yypcontext_t yyctx
+          = {yyssp, yytoken, &yylloc};
+        char const *yymsgp = YY_("syntax error");
+        int yysyntax_error_status;
+        yysyntax_error_status = yysyntax_error (&yymsg_alloc, &yymsg, &yyctx);
+        if (yysyntax_error_status == 0)
+          yymsgp = yymsg;
+        else if (yysyntax_error_status == -1)
+          {
+            if (yymsg != yymsgbuf)
+              YYSTACK_FREE (yymsg);
+            yymsg = YY_CAST (char *,
+                             YYSTACK_ALLOC (YY_CAST (YYSIZE_T, yymsg_alloc)));
+            if (yymsg)
+              {
+                yysyntax_error_status
+                  = yysyntax_error (&yymsg_alloc, &yymsg, &yyctx);
+                yymsgp = yymsg;
+              }
+            else
+              {
+                yymsg = yymsgbuf;
+                yymsg_alloc = sizeof yymsgbuf;
+                yysyntax_error_status = YYENOMEM;
+              }
+          }
+        yyerror (&yylloc, pnode, yymsgp);
+        if (yysyntax_error_status == YYENOMEM)
+          YYNOMEM;
+      }
+    }
+
+  yyerror_range[1] = yylloc;
+  if (yyerrstatus == 3)
+    {
+      /* If just tried and failed to reuse lookahead token after an
+         error, discard it.  */
+
+      if (yychar <= YYEOF)
+        {
+          /* Return failure if at end of input.  */
+          if (yychar == YYEOF)
+            YYABORT;
+        }
+      else
+        {
+          yydestruct ("Error: discarding",
+                      yytoken, &yylval, &yylloc, pnode);
+          yychar = YYEMPTY;
+        }
+    }
+
+  /* Else will try to reuse lookahead token after shifting the error
+     token.  */
+  goto yyerrlab1;
+
+
+/*---------------------------------------------------.
+| yyerrorlab -- error raised explicitly by YYERROR.  |
+`---------------------------------------------------*/
+yyerrorlab:
+  /* Pacify compilers when the user code never invokes YYERROR and the
+     label yyerrorlab therefore never appears in user code.  */
+  if (0)
+    YYERROR;
+  ++yynerrs;
+
+  /* Do not reclaim the symbols of the rule whose action triggered
+     this YYERROR.  */
+  YYPOPSTACK (yylen);
+  yylen = 0;
+  YY_STACK_PRINT (yyss, yyssp);
+  yystate = *yyssp;
+  goto yyerrlab1;
+
+
+/*-------------------------------------------------------------.
+| yyerrlab1 -- common code for both syntax error and YYERROR.  |
+`-------------------------------------------------------------*/
+yyerrlab1:
+  yyerrstatus = 3;      /* Each real token shifted decrements this.  */
+
+  /* Pop stack until we find a state that shifts the error token.  */
+  for (;;)
+    {
+      yyn = yypact[yystate];
+      if (!yypact_value_is_default (yyn))
+        {
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
+            {
+              yyn = yytable[yyn];
+              if (0 < yyn)
+                break;
+            }
+        }
+
+      /* Pop the current state because it cannot handle the error token.  */
+      if (yyssp == yyss)
+        YYABORT;
+
+      yyerror_range[1] = *yylsp;
+      yydestruct ("Error: popping",
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, yylsp, pnode);
+      YYPOPSTACK (1);
+      yystate = *yyssp;
+      YY_STACK_PRINT (yyss, yyssp);
+    }
+
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+
+  yyerror_range[2] = yylloc;
+  ++yylsp;
+  YYLLOC_DEFAULT (*yylsp, yyerror_range, 2);
+
+  /* Shift the error token.  */
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
+
+  yystate = yyn;
+  goto yynewstate;
+
+
+/*-------------------------------------.
+| yyacceptlab -- YYACCEPT comes here.  |
+`-------------------------------------*/
+yyacceptlab:
+  yyresult = 0;
+  goto yyreturnlab;
+
+
+/*-----------------------------------.
+| yyabortlab -- YYABORT comes here.  |
+`-----------------------------------*/
+yyabortlab:
+  yyresult = 1;
+  goto yyreturnlab;
+
+
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
+yyexhaustedlab:
+  yyerror (&yylloc, pnode, YY_("memory exhausted"));
+  yyresult = 2;
+  goto yyreturnlab;
+
+
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
+  if (yychar != YYEMPTY)
+    {
+      /* Make sure we have latest lookahead translation.  See comments at
+         user semantic actions for why this is necessary.  */
+      yytoken = YYTRANSLATE (yychar);
+      yydestruct ("Cleanup: discarding lookahead",
+                  yytoken, &yylval, &yylloc, pnode);
+    }
+  /* Do not reclaim the symbols of the rule whose action triggered
+     this YYABORT or YYACCEPT.  */
+  YYPOPSTACK (yylen);
+  YY_STACK_PRINT (yyss, yyssp);
+  while (yyssp != yyss)
+    {
+      yydestruct ("Cleanup: popping",
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, yylsp, pnode);
+      YYPOPSTACK (1);
+    }
+#ifndef yyoverflow
+  if (yyss != yyssa)
+    YYSTACK_FREE (yyss);
+#endif
+  if (yymsg != yymsgbuf)
+    YYSTACK_FREE (yymsg);
+  return yyresult;
+}
+
+#line 226 "src/parse.y"
+
+
+void yyerror(YYLTYPE *locp, node_t **dummy, const char *msg)
+{
+  error(locp->first_line, locp->first_column, msg);
+}
+
+/* Reads a token for declare_functions(). */
+static int prescan_token(YYSTYPE *val, YYLTYPE *loc)
+{
+  int tok;
+  suppress_errors = true;
+  tok = yylex(val, loc);
+  suppress_errors = false;
+  if (tok == STRING)
+    {
+      free(val->str);
+    }
+  return tok;
+}
+
+/* Declares all the functions of the program by scanning its tokens,
+   so that each function may be checked as soon as it is parsed even
+   if it calls functions defined further on. Only the function headers
+   outside of any braces are looked at. The input is read to the end;
+   the scanner must be restarted afterwards. Lexical errors are left
+   to the parser to report. */
+void declare_functions()
+{
+  YYSTYPE val;
+  YYLTYPE loc = { 1, 1, 1, 1 };
+  int depth = 0;
+  int tok = prescan_token(&val, &loc);
+  while (tok != 0)
+    {
+      if (tok == TYPE && depth == 0)
+        {
+          src_pos_t pos;
+          type_t *ret_type = cons_type(val.type);
+          sym_t *ident;
+          type_list_t *args = NULL;
+          type_list_t *last = NULL;
+          int args_num = 0;
+          bool bad = false;
+          pos.line = loc.first_line;
+          pos.col = loc.first_column;
+          pos.len = 1;
+          if ((tok = prescan_token(&val, &loc)) != ID)
+            continue;
+          ident = val.symbol;
+          if ((tok = prescan_token(&val, &loc)) != '(')
+            continue;
+          tok = prescan_token(&val, &loc);
+          while (tok != ')')
+            {
+              type_list_t *tl;
+              if (tok != TYPE)
+                {
+                  bad = true;
+                  break;
+                }
+              tl = alloc_type(sizeof(type_list_t));
+              tl->type = cons_type(val.type);
+              tl->next = NULL;
+              if (last == NULL)
+                args = tl;
+              else
+                last->next = tl;
+              last = tl;
+              ++args_num;
+              if ((tok = prescan_token(&val, &loc)) != ID)
+                {
+                  bad = true;
+                  break;
+                }
+              if ((tok = prescan_token(&val, &loc)) == ',')
+                tok = prescan_token(&val, &loc);
+              else if (tok != ')')
+                {
+                  bad = true;
+                  break;
+                }
+            }
+          if (bad)
+            continue;
+          if ((tok = prescan_token(&val, &loc)) != '{')
+            continue;
+          declare_user_function(ident, (func_type_t*) cons_type(TYPE_FUNC, ret_type, args_num, args), pos);
+        }
+      if (tok == '{')
+        ++depth;
+      else if (tok == '}')
+        --depth;
+      tok = prescan_token(&val, &loc);
+    }
+  functions_declared = true;
+}
@@ -0,0 +1,385 @@
+  #include <string.h>
+  #include <stdlib.h>
+  #include <stdio.h>
+  #include <stdint.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include "tree.h"
+  #include "parsedef.h"
+  #include "parse.h"
+  #include "utils.h"
+  #include "symtab.h"
+
+#define YY_DECL int yylex (YYSTYPE *yylval, YYLTYPE *yylloc)
+
+#define INC_COL(n) yylloc->last_column += (n)
+#define INC_LINE ++yylloc->last_line; yylloc->last_column = 0;
+#define NEW_TOKEN yylloc->first_line = yylloc->last_line; yylloc->first_column = yylloc->last_column;
+
+  static int scan_int(const char *str, int len);
+  static double scan_double(const char *str, int len);
+  static char *scan_string(YYLTYPE *yylloc);
+
+
+/* ---- sandbox emulation of the flex runtime and rules (not flex) ---- */
+FILE *yyin, *yyout;
+char *yytext;
+int yyleng;
+typedef char *YY_BUFFER_STATE;
+#define INITIAL 0
+#define comment 1
+static int yy_state;
+#define BEGIN(x) (yy_state = (x))
+static char *cur, *bufend, *holdpos;
+static char hold;
+static void restore_hold(void) { if (holdpos) { *holdpos = hold; holdpos = NULL; } }
+YY_BUFFER_STATE yy_scan_buffer(char *base, size_t size)
+{
+  if (size < 2 || base[size - 1] || base[size - 2]) return NULL;
+  restore_hold(); cur = base; bufend = base + size - 2; return base;
+}
+void yy_delete_buffer(YY_BUFFER_STATE b) { restore_hold(); }
+static void set_text(char *s, int n)
+{
+  yytext = s; yyleng = n; holdpos = s + n; hold = *holdpos; *holdpos = 0; cur = s + n;
+}
+#define ISD(c) ((c) >= '0' && (c) <= '9')
+#define ISA(c) (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') || (c) == '_')
+int yylex(YYSTYPE *yylval, YYLTYPE *yylloc)
+{
+  char *s;
+  restore_hold();
+ again:
+  if (cur >= bufend) return 0;
+  s = cur;
+  if (*s == '\n') { INC_LINE; ++cur; goto again; }
+  if (*s == ' ' || *s == '\t' || *s == '\r') { while (cur < bufend && (*cur == ' ' || *cur == '\t' || *cur == '\r')) ++cur; INC_COL(cur - s); goto again; }
+  if (*s == '#' || (*s == '/' && s[1] == '/')) { while (cur < bufend && *cur != '\n') ++cur; INC_COL(cur - s); goto again; }
+  if (*s == '/' && s[1] == '*')
+    {
+      NEW_TOKEN; INC_COL(2); cur += 2;
+      for (;;)
+        {
+          if (cur >= bufend) { error(yylloc->first_line, yylloc->first_column, "unterminated comment"); return 0; }
+          if (*cur == '\n') { INC_LINE; ++cur; continue; }
+          if (*cur == '*' && cur[1] == '/') { cur += 2; break; }
+          INC_COL(1); ++cur;
+        }
+      goto again;
+    }
+  if (ISD(*s))
+    {
+      char *p = s; int isf = 0;
+      while (ISD(*p)) ++p;
+      if (*p == '.' && ISD(p[1])) { isf = 1; ++p; while (ISD(*p)) ++p; }
+      if (*p == 'e' && (ISD(p[1]) || ((p[1] == '+' || p[1] == '-') && ISD(p[2]))))
+        { isf = 1; p += (p[1] == '+' || p[1] == '-') ? 2 : 1; while (ISD(*p)) ++p; }
+      set_text(s, p - s); NEW_TOKEN; INC_COL(yyleng);
+      if (isf) { yylval->dvalue = scan_double(yytext, yyleng); return DOUBLE; }
+      yylval->ivalue = scan_int(yytext, yyleng); return INTEGER;
+    }
+  if (ISA(*s))
+    {
+      char *p = s;
+      while (ISA(*p) || ISD(*p)) ++p;
+      set_text(s, p - s); NEW_TOKEN; INC_COL(yyleng);
+      if (!strcmp(yytext, "true")) { yylval->bvalue = 1; return BOOLEAN; }
+      if (!strcmp(yytext, "false")) { yylval->bvalue = 0; return BOOLEAN; }
+      if (!strcmp(yytext, "int")) { yylval->type = TYPE_INT; return TYPE; }
+      if (!strcmp(yytext, "double")) { yylval->type = TYPE_DOUBLE; return TYPE; }
+      if (!strcmp(yytext, "boolean")) { yylval->type = TYPE_BOOLEAN; return TYPE; }
+      if (!strcmp(yytext, "void")) { yylval->type = TYPE_VOID; return TYPE; }
+      if (!strcmp(yytext, "if")) return IF;
+      if (!strcmp(yytext, "else")) return ELSE;
+      if (!strcmp(yytext, "while")) return WHILE;
+      if (!strcmp(yytext, "for")) return FOR;
+      if (!strcmp(yytext, "return")) return RETURN;
+      yylval->symbol = add_symn(yytext, yyleng); return ID;
+    }
+  if (*s == '"')
+    {
+      char *p = s + 1;
+      for (;;)
+        {
+          if (p >= bufend || *p == '\n' || *p == '"') break;
+          if (*p == '\\') { if (p + 1 >= bufend) break; p += 2; } else ++p;
+        }
+      if (p < bufend && *p == '"')
+        { set_text(s, p + 1 - s); NEW_TOKEN; yylval->str = scan_string(yylloc); return STRING; }
+      set_text(s, p - s); NEW_TOKEN;
+      error(yylloc->first_line, yylloc->first_column, "unterminated string");
+      INC_COL(yyleng); restore_hold(); goto again;
+    }
+  {
+    static const char *two[] = { "++", "--", "&&", "||", "==", "!=", "<=", ">=" };
+    static const int twotok[] = { PLUS_PLUS, MINUS_MINUS, AND, OR, EQUAL, NOT_EQUAL, LESS_EQUAL, GREATER_EQUAL };
+    int i;
+    for (i = 0; i < 8; ++i)
+      if (s[0] == two[i][0] && s[1] == two[i][1]) { set_text(s, 2); NEW_TOKEN; INC_COL(2); return twotok[i]; }
+  }
+  set_text(s, 1); NEW_TOKEN; INC_COL(1); return yytext[0];
+}
+/* ---- end of emulation ---- */
+
+
+/* Literals. The lexemes are converted in place, straight from the
+   input buffer. */
+
+/* Converts a decimal integer. The result wraps around on overflow,
+   as it did with sscanf(). */
+static int scan_int(const char *str, int len)
+{
+  unsigned val = 0;
+  int i;
+  for (i = 0; i < len; ++i)
+    {
+      val = val * 10 + (str[i] - '0');
+    }
+  return (int) val;
+}
+
+#define MAX_EXACT_INT (1ULL << 53)
+#define MAX_EXACT_POW10 22
+
+static const double pow10_tab[MAX_EXACT_POW10 + 1] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Converts a floating point literal matched by {FLOAT}. If the digits
+   form an integer of at most 53 bits and the decimal exponent is at
+   most 22 in absolute value, both are exact doubles and one
+   multiplication or division gives the correctly rounded result. The
+   other literals are left to strtod(). */
+static double scan_double(const char *str, int len)
+{
+  uint64_t mant = 0;
+  int exp = 0;
+  int i = 0;
+  while (i < len && str[i] >= '0' && str[i] <= '9')
+    {
+      mant = mant * 10 + (str[i++] - '0');
+      if (mant > MAX_EXACT_INT)
+        return strtod(str, NULL);
+    }
+  if (i < len && str[i] == '.')
+    {
+      ++i;
+      while (i < len && str[i] >= '0' && str[i] <= '9')
+        {
+          mant = mant * 10 + (str[i++] - '0');
+          --exp;
+          if (mant > MAX_EXACT_INT)
+            return strtod(str, NULL);
+        }
+    }
+  if (i < len && str[i] == 'e')
+    {
+      int sign = 1;
+      int e = 0;
+      ++i;
+      if (str[i] == '+' || str[i] == '-')
+        {
+          sign = (str[i++] == '-') ? -1 : 1;
+        }
+      while (i < len)
+        {
+          e = e * 10 + (str[i++] - '0');
+          if (e > MAX_EXACT_POW10 * 2)
+            return strtod(str, NULL);
+        }
+      exp += sign * e;
+    }
+  if (exp < -MAX_EXACT_POW10 || exp > MAX_EXACT_POW10)
+    return strtod(str, NULL);
+  if (exp < 0)
+    return (double) mant / pow10_tab[-exp];
+  else
+    return (double) mant * pow10_tab[exp];
+}
+
+/* Converts the string literal in yytext, quotes included, and
+   advances the location past it. The characters up to the next escape
+   sequence are copied in one go. */
+static char *scan_string(YYLTYPE *yylloc)
+{
+  const char *str = yytext + 1;
+  const char *end = yytext + yyleng - 1;
+  char *ret = xmalloc(yyleng - 1);
+  char *ptr = ret;
+  INC_COL(1);
+  while (str < end)
+    {
+      const char *esc = memchr(str, '\\', end - str);
+      if (esc == NULL)
+        esc = end;
+      memcpy(ptr, str, esc - str);
+      ptr += esc - str;
+      INC_COL(esc - str);
+      str = esc;
+      if (str == end)
+        break;
+      switch (str[1]){
+      case 'n':
+        *ptr++ = '\n';
+        break;
+      case 'r':
+        *ptr++ = '\r';
+        break;
+      case 't':
+        *ptr++ = '\t';
+        break;
+      case 'b':
+        *ptr++ = '\b';
+        break;
+      case 'f':
+        *ptr++ = '\f';
+        break;
+      case '\n':
+        *ptr++ = '\n';
+        INC_LINE;
+        str += 2;
+        continue;
+      case '0': case '1': case '2': case '3': case '4':
+      case '5': case '6': case '7': case '8': case '9':
+        {
+          /* up to three octal digits; a longer run of digits is an
+             error */
+          int digits = 1;
+          int octal = 0;
+          int val = 0;
+          while (str + 1 + digits < end && str[1 + digits] >= '0' && str[1 + digits] <= '9')
+            ++digits;
+          while (octal < 3 && octal < digits && str[1 + octal] <= '7')
+            val = val * 8 + (str[1 + octal++] - '0');
+          if (octal < digits)
+            {
+              error(yylloc->first_line, yylloc->first_column, "bad escape sequence");
+              octal = digits;
+            }
+          else
+            {
+              *ptr++ = val;
+            }
+          INC_COL(1 + octal);
+          str += 1 + octal;
+          continue;
+        }
+      default:
+        *ptr++ = str[1];
+        break;
+      };
+      INC_COL(2);
+      str += 2;
+    }
+  INC_COL(1);
+  *ptr = '\0';
+  return ret;
+}
+
+
+/* Input files */
+
+// the input, followed by the two null bytes yy_scan_buffer() needs
+static char *input_buf = NULL;
+static size_t input_size;
+static bool input_mapped;
+static YY_BUFFER_STATE input_state;
+
+/* Reads a file which cannot be mapped, e.g. a pipe. */
+static bool read_input(int fd)
+{
+  size_t cap = 64 * 1024;
+  ssize_t n;
+  input_buf = xmalloc(cap);
+  input_size = 0;
+  while ((n = read(fd, input_buf + input_size, cap - input_size - 2)) > 0)
+    {
+      input_size += n;
+      if (cap - input_size - 2 == 0)
+        {
+          cap <<= 1;
+          input_buf = xrealloc(input_buf, cap);
+        }
+    }
+  if (n < 0)
+    {
+      free(input_buf);
+      input_buf = NULL;
+      return false;
+    }
+  input_buf[input_size] = input_buf[input_size + 1] = '\0';
+  input_size += 2;
+  input_mapped = false;
+  return true;
+}
+
+/* Maps a regular file. An anonymous mapping one page longer is made
+   first and the file is mapped over it, so the two null bytes after
+   the file are there even if the file ends at a page boundary. The
+   mapping is private and writable, because the scanner temporarily
+   writes null bytes after the tokens. */
+static bool map_input(int fd, size_t file_size)
+{
+  input_size = file_size + 2;
+  input_buf = mmap(NULL, input_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (input_buf == MAP_FAILED)
+    {
+      input_buf = NULL;
+      return false;
+    }
+  if (file_size > 0 &&
+      mmap(input_buf, file_size, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+      munmap(input_buf, input_size);
+      input_buf = NULL;
+      return false;
+    }
+  input_mapped = true;
+  return true;
+}
+
+/* Opens the input file and prepares the scanner for reading it. The
+   file is mapped into memory if possible, and read otherwise. Returns
+   false with errno set if the file cannot be read. */
+bool scan_open(const char *path)
+{
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  bool ok;
+  if (fd < 0)
+    return false;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+    ok = map_input(fd, st.st_size) || read_input(fd);
+  else
+    ok = read_input(fd);
+  close(fd);
+  if (!ok)
+    return false;
+  input_state = yy_scan_buffer(input_buf, input_size);
+  BEGIN(INITIAL);
+  return true;
+}
+
+/* Restarts the scanner at the beginning of the input. */
+void scan_rewind()
+{
+  yy_delete_buffer(input_state);
+  input_state = yy_scan_buffer(input_buf, input_size);
+  BEGIN(INITIAL);
+}
+
+/* Releases the input. */
+void scan_close()
+{
+  yy_delete_buffer(input_state);
+  if (input_mapped)
+    munmap(input_buf, input_size);
+  else
+    free(input_buf);
+  input_buf = NULL;
+}
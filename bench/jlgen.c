@@ -0,0 +1,286 @@
+/* jlgen.c - generator of large Javalette programs */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+/* The programs are valid and terminate: the loops are counted, the
+   array indices are reduced modulo the array size, and the only
+   divisors are nonzero constants. Each function has
+
+     block_size * (depth + 1)
+
+   simple statements: every block holds block_size statements and one
+   nested loop or conditional, down to the given depth. main() calls
+   all the functions and prints the results, so that the output of a
+   compiled program can be compared with that of the interpreter. */
+
+#define ARRAY_SIZE 16
+
+static int funcs_num = 10;
+static int block_size = 20;
+static int depth = 2;
+static int array_percent = 10;
+static int double_percent = 30;
+static int call_percent = 5;
+static int vars_num = 8;
+
+static unsigned long long seed = 1;
+
+static unsigned rnd(unsigned n)
+{
+  // xorshift64*, so that the output does not depend on the C library
+  seed ^= seed >> 12;
+  seed ^= seed << 25;
+  seed ^= seed >> 27;
+  return (unsigned) ((seed * 0x2545F4914F6CDD1DULL) >> 32) % n;
+}
+
+static int percent(int p)
+{
+  return (int) rnd(100) < p;
+}
+
+static void indent(int level)
+{
+  printf("%*s", 2 * level + 2, "");
+}
+
+static const char *int_op()
+{
+  static const char *ops[] = { "+", "-", "*", "+", "-" };
+  return ops[rnd(sizeof(ops) / sizeof(ops[0]))];
+}
+
+static const char *double_op()
+{
+  static const char *ops[] = { "+", "-", "*" };
+  return ops[rnd(sizeof(ops) / sizeof(ops[0]))];
+}
+
+static const char *cmp_op()
+{
+  static const char *ops[] = { "<", ">", "<=", ">=", "==", "!=" };
+  return ops[rnd(sizeof(ops) / sizeof(ops[0]))];
+}
+
+/* an index into an array, in the range 0..ARRAY_SIZE-1 */
+static void print_index()
+{
+  printf("(i%u %% %d + %d) %% %d", rnd(vars_num), ARRAY_SIZE, ARRAY_SIZE, ARRAY_SIZE);
+}
+
+static void gen_int_expr()
+{
+  switch (rnd(6)){
+  case 0:
+    printf("i%u %s %d", rnd(vars_num), int_op(), (int) rnd(1000));
+    break;
+  case 1:
+    printf("i%u / %d", rnd(vars_num), (int) rnd(9) + 1);
+    break;
+  case 2:
+    printf("i%u %% %d", rnd(vars_num), (int) rnd(9) + 2);
+    break;
+  case 3:
+    printf("(i%u %s i%u) %s i%u", rnd(vars_num), int_op(), rnd(vars_num), int_op(),
+           rnd(vars_num));
+    break;
+  default:
+    printf("i%u %s i%u", rnd(vars_num), int_op(), rnd(vars_num));
+  };
+}
+
+static void gen_double_expr()
+{
+  switch (rnd(4)){
+  case 0:
+    printf("d%u %s %d.5", rnd(vars_num), double_op(), (int) rnd(100));
+    break;
+  case 1:
+    printf("d%u / %d.0", rnd(vars_num), (int) rnd(9) + 1);
+    break;
+  default:
+    printf("d%u %s d%u", rnd(vars_num), double_op(), rnd(vars_num));
+  };
+}
+
+static void gen_cond()
+{
+  if (percent(double_percent))
+    printf("d%u %s d%u", rnd(vars_num), cmp_op(), rnd(vars_num));
+  else
+    printf("i%u %s i%u", rnd(vars_num), cmp_op(), rnd(vars_num));
+  if (rnd(4) == 0)
+    printf(" && i%u %s %d", rnd(vars_num), cmp_op(), (int) rnd(100));
+}
+
+static void gen_statement(int level)
+{
+  indent(level);
+  if (percent(call_percent))
+    {
+      printf("i%u = leaf(i%u, d%u);\n", rnd(vars_num), rnd(vars_num), rnd(vars_num));
+    }
+  else if (percent(array_percent))
+    {
+      switch (rnd(4)){
+      case 0:
+        printf("a[");
+        print_index();
+        printf("] = ");
+        gen_int_expr();
+        break;
+      case 1:
+        printf("i%u = a[", rnd(vars_num));
+        print_index();
+        printf("] %s i%u", int_op(), rnd(vars_num));
+        break;
+      case 2:
+        printf("b[");
+        print_index();
+        printf("] = ");
+        gen_double_expr();
+        break;
+      default:
+        printf("d%u = b[", rnd(vars_num));
+        print_index();
+        printf("] %s d%u", double_op(), rnd(vars_num));
+      };
+      printf(";\n");
+    }
+  else if (percent(double_percent))
+    {
+      printf("d%u = ", rnd(vars_num));
+      gen_double_expr();
+      printf(";\n");
+    }
+  else
+    {
+      printf("i%u = ", rnd(vars_num));
+      gen_int_expr();
+      printf(";\n");
+    }
+}
+
+static void gen_block(int level)
+{
+  int i;
+  // the position of the nested statement
+  int nested = level < depth ? (int) rnd(block_size) : -1;
+  for (i = 0; i < block_size; ++i)
+    {
+      if (i == nested)
+        {
+          indent(level);
+          if (rnd(2) == 0)
+            {
+              printf("for (l%d = 0; l%d < %d; l%d++) {\n", level, level, (int) rnd(3) + 2, level);
+              gen_block(level + 1);
+              indent(level);
+              printf("}\n");
+            }
+          else
+            {
+              printf("if (");
+              gen_cond();
+              printf(") {\n");
+              gen_block(level + 1);
+              indent(level);
+              printf("} else\n");
+              gen_statement(level + 1);
+            }
+        }
+      gen_statement(level);
+    }
+}
+
+static void gen_function(int n)
+{
+  int i;
+  printf("int f%d(int p, double q)\n{\n", n);
+  for (i = 0; i < vars_num; ++i)
+    {
+      printf("  int i%d = p + %d;\n", i, (int) rnd(100));
+      printf("  double d%d = q * %d.25;\n", i, (int) rnd(10));
+    }
+  // the loop counters; l0 also initializes the arrays
+  for (i = 0; i < depth || i == 0; ++i)
+    printf("  int l%d;\n", i);
+  printf("  int a[%d];\n  double b[%d];\n", ARRAY_SIZE, ARRAY_SIZE);
+  printf("  for (l0 = 0; l0 < %d; l0++) { a[l0] = l0; b[l0] = 0.5; }\n", ARRAY_SIZE);
+  gen_block(0);
+  printf("  if (d0 > 1000000.0 || d0 < -1000000.0)\n    i0 = i0 + 1;\n");
+  printf("  return i0");
+  for (i = 1; i < vars_num; ++i)
+    printf(" + i%d", i);
+  printf(";\n}\n\n");
+}
+
+static void usage()
+{
+  fprintf(stderr,
+          "usage: jlgen [options] > program.jl\n"
+          "  -f N  the number of functions (%d)\n"
+          "  -s N  statements in a block (%d)\n"
+          "  -d N  the nesting depth of loops and conditionals (%d)\n"
+          "  -a P  percentage of statements using arrays (%d)\n"
+          "  -D P  percentage of double statements (%d)\n"
+          "  -c P  percentage of function calls (%d)\n"
+          "  -v N  variables of each type in a function (%d)\n"
+          "  -r N  random seed\n",
+          funcs_num, block_size, depth, array_percent, double_percent, call_percent,
+          vars_num);
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  int c, i;
+  while ((c = getopt(argc, argv, "f:s:d:a:D:c:v:r:")) != -1)
+    {
+      switch (c){
+      case 'f':
+        funcs_num = atoi(optarg);
+        break;
+      case 's':
+        block_size = atoi(optarg);
+        break;
+      case 'd':
+        depth = atoi(optarg);
+        break;
+      case 'a':
+        array_percent = atoi(optarg);
+        break;
+      case 'D':
+        double_percent = atoi(optarg);
+        break;
+      case 'c':
+        call_percent = atoi(optarg);
+        break;
+      case 'v':
+        vars_num = atoi(optarg);
+        break;
+      case 'r':
+        seed = strtoull(optarg, NULL, 10) * 2 + 1;
+        break;
+      default:
+        usage();
+      };
+    }
+  if (optind != argc || funcs_num < 0 || block_size < 1 || depth < 0 || vars_num < 1)
+    usage();
+
+  printf("/* generated by jlgen -f %d -s %d -d %d -a %d -D %d -c %d -v %d */\n\n",
+         funcs_num, block_size, depth, array_percent, double_percent, call_percent,
+         vars_num);
+  printf("int leaf(int x, double y)\n{\n"
+         "  if (y > 0.0)\n    return x / 2 + 1;\n  return x * 3 - 1;\n}\n\n");
+  for (i = 0; i < funcs_num; ++i)
+    gen_function(i);
+  printf("int main()\n{\n");
+  for (i = 0; i < funcs_num; ++i)
+    printf("  printInt(f%d(%d, %d.5));\n", i, i, i % 7);
+  printf("  return 0;\n}\n");
+  return 0;
+}
@@ -0,0 +1,106 @@
+/* lex_bench.c - lexer throughput benchmark */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "utils.h"
+#include "symtab.h"
+#include "tree.h"
+#include "parsedef.h"
+#include "parse.h"
+
+#define FUNCS_NUM 20000
+#define ROUNDS 5
+
+bool scan_open(const char *path);
+void scan_rewind();
+void scan_close();
+int yylex(YYSTYPE *yylval, YYLTYPE *yylloc);
+
+/* A function with a bit of everything the scanner sees in practice:
+   keywords, identifiers, integer and floating point literals, strings
+   with escapes, operators and comments. */
+static const char *func_text =
+  "/* function %d */\n"
+  "double compute_%d(int n, double x_%d)\n"
+  "{\n"
+  "  int counter = 0; // the number of iterations\n"
+  "  double acc = 0.25e-3;\n"
+  "  boolean done = false;\n"
+  "  while (counter < n && !done)\n"
+  "    {\n"
+  "      acc = acc * 1.0000001 + x_%d / 3.5;\n"
+  "      if (counter %% 1000 == 17 || acc >= 123456.789)\n"
+  "        done = true;\n"
+  "      counter++;\n"
+  "    }\n"
+  "  printString(\"compute_%d:\\t\\\"done\\\"\\n\");\n"
+  "  printInt(counter - 4096);\n"
+  "  return acc;\n"
+  "}\n\n";
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main()
+{
+  char path[] = "/tmp/lex_bench_XXXXXX";
+  int fd = mkstemp(path);
+  FILE *f;
+  long size;
+  long tokens = 0;
+  double t0, t;
+  int i, r;
+
+  if (fd < 0)
+    {
+      perror("mkstemp");
+      return 1;
+    }
+  f = fdopen(fd, "w");
+  for (i = 0; i < FUNCS_NUM; ++i)
+    fprintf(f, func_text, i, i, i, i, i);
+  size = ftell(f);
+  fclose(f);
+
+  symtab_init();
+  tree_init();
+  cur_filename = path;
+  if (!scan_open(path))
+    {
+      perror("scan_open");
+      unlink(path);
+      return 1;
+    }
+
+  t0 = now();
+  for (r = 0; r < ROUNDS; ++r)
+    {
+      YYSTYPE val;
+      YYLTYPE loc;
+      int tok;
+      loc.first_line = loc.last_line = 1;
+      loc.first_column = loc.last_column = 0;
+      scan_rewind();
+      while ((tok = yylex(&val, &loc)) != 0)
+        {
+          if (tok == STRING)
+            free(val.str);
+          ++tokens;
+        }
+    }
+  t = now() - t0;
+  printf("lexer: %8.1f MB/s, %12.0f tokens/s (%ld bytes, %ld tokens)\n",
+         size * (double) ROUNDS / t / (1024 * 1024), tokens / t, size, tokens / ROUNDS);
+
+  scan_close();
+  tree_cleanup();
+  symtab_cleanup();
+  unlink(path);
+  return errors_num != 0;
+}
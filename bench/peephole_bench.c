@@ -0,0 +1,92 @@
+/* peephole_bench.c - peephole optimizer throughput benchmark */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "utils.h"
+#include "outbuf.h"
+#include "peephole.h"
+
+/* Synthetic i386 code resembling the output of the backend. Some of
+   the lines are rewritten by the rules in data/i386.opt, most are
+   not. */
+static const char *lines[] = {
+  "mov eax, dword [esp + 4]",
+  "add eax, -3",
+  "cmp eax, ebx",
+  "jl __L%d",
+  "imul ecx, 8",
+  "mov edx, ecx",
+  "add edx, esi",
+  "fld qword [esp + 12]",
+  "fadd st2,st0",
+  "fstp st0",
+  "__L%d:",
+  "lea eax, [4 + ebx]",
+  "push eax",
+  "call printInt",
+  "fst qword [esp - 8]",
+  "fstp st0",
+  "sub ebx, 1",
+  "mov dword [esp + 8], eax",
+  "xor edx, edx",
+  "jmp __L%d"
+};
+
+#define LINES_NUM (sizeof(lines) / sizeof(lines[0]))
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill(outbuf_t *buf, int n)
+{
+  int i;
+  for (i = 0; i < n; ++i)
+    {
+      writeln(buf, lines[i % LINES_NUM], i / LINES_NUM);
+    }
+}
+
+int main(int argc, char **argv)
+{
+  static const int sizes[] = { 10000, 100000, 1000000 };
+  const char *data_dir = getenv("JL_DATA_DIR");
+  char path[1024];
+  FILE *fin;
+  outbuf_t *buf;
+  int i;
+
+  if (argc > 1)
+    data_dir = argv[1];
+  if (data_dir == NULL)
+    data_dir = "data";
+  snprintf(path, sizeof(path), "%s/i386.opt", data_dir);
+  fin = fopen(path, "r");
+  if (fin == NULL)
+    {
+      fprintf(stderr, "Cannot open %s\n", path);
+      return 1;
+    }
+  load_rules(fin);
+  fclose(fin);
+
+  buf = new_outbuf();
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+      double t0, t;
+      fill(buf, sizes[i]);
+      t0 = now();
+      peephole(buf);
+      t = now() - t0;
+      printf("peephole: %8d lines in %8.4f s, %12.0f lines/s\n",
+             sizes[i], t, sizes[i] / t);
+      clearbuf(buf);
+    }
+  free_outbuf(buf);
+  free_rules();
+  return 0;
+}
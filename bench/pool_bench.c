@@ -0,0 +1,207 @@
+/* pool_bench.c - pool allocator throughput benchmark */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "utils.h"
+#include "mem.h"
+
+#define ELEM_SIZE 48
+#define ROUNDS 20
+
+/* The pool as it was before pfree() became constant time: the chunks
+   double in size and the chunk owning a freed object is found by a
+   linear scan. */
+
+#define PNEXT(x) *((void**)(x))
+
+typedef struct Old_pool_node{
+  size_t size;
+  char *data;
+  char *first_free;
+  struct Old_pool_node *next;
+  struct Old_pool_node *next_free;
+} old_pool_node_t;
+
+typedef struct{
+  size_t elem_size;
+  old_pool_node_t *first_free;
+  old_pool_node_t *nodes;
+} old_pool_t;
+
+static old_pool_node_t *new_old_pool_node(size_t size, size_t elem_size)
+{
+  old_pool_node_t *ret = xmalloc(sizeof(old_pool_node_t));
+  char *ptr;
+  ret->size = size * elem_size;
+  ret->data = ret->first_free = xmalloc(ret->size);
+  for (ptr = ret->data; ptr + elem_size < ret->data + ret->size; ptr += elem_size)
+    PNEXT(ptr) = ptr + elem_size;
+  PNEXT(ptr) = NULL;
+  ret->next = NULL;
+  ret->next_free = NULL;
+  return ret;
+}
+
+static old_pool_t *new_old_pool(size_t size, size_t elem_size)
+{
+  old_pool_t *pool = xmalloc(sizeof(old_pool_t));
+  pool->elem_size = elem_size;
+  pool->first_free = pool->nodes = new_old_pool_node(size, elem_size);
+  return pool;
+}
+
+static void free_old_pool(old_pool_t *pool)
+{
+  old_pool_node_t *node = pool->nodes;
+  while (node != NULL)
+    {
+      old_pool_node_t *next = node->next;
+      free(node->data);
+      free(node);
+      node = next;
+    }
+  free(pool);
+}
+
+static void *old_palloc(old_pool_t *pool)
+{
+  old_pool_node_t *pn = pool->first_free;
+  void *ret = pn->first_free;
+  pn->first_free = PNEXT(ret);
+  if (pn->first_free == NULL)
+    {
+      pool->first_free = pn->next_free;
+      if (pool->first_free == NULL)
+        {
+          while (pn->next != NULL)
+            pn = pn->next;
+          pn->next = new_old_pool_node(pn->size / pool->elem_size * 2, pool->elem_size);
+          pool->first_free = pn->next;
+        }
+    }
+  return ret;
+}
+
+static void old_pfree(old_pool_t *pool, void *ptr)
+{
+  old_pool_node_t *pn = pool->nodes;
+  void *next;
+  while (pn != NULL)
+    {
+      if ((char*)ptr >= pn->data && (char*)ptr < pn->data + pn->size)
+        break;
+      pn = pn->next;
+    }
+  next = pn->first_free;
+  PNEXT(ptr) = next;
+  pn->first_free = ptr;
+  if (next == NULL)
+    {
+      pn->next_free = pool->first_free;
+      pool->first_free = pn;
+    }
+}
+
+//--------------------------------------------------------------------
+
+static old_pool_t *old_pool;
+static pool_t *pool;
+static pool_cache_t cache;
+
+static void *old_pool_alloc() { return old_palloc(old_pool); }
+static void old_pool_free(void *ptr) { old_pfree(old_pool, ptr); }
+static void *pool_alloc() { return palloc(pool); }
+static void pool_free(void *ptr) { pfree(pool, ptr); }
+static void *cache_alloc() { return pcalloc(&cache); }
+static void cache_free(void *ptr) { pcfree(&cache, ptr); }
+static void *malloc_alloc() { return malloc(ELEM_SIZE); }
+static void malloc_free(void *ptr) { free(ptr); }
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Allocates n objects, frees them in a shuffled order, and then
+   interleaves allocations with frees, ROUNDS times. Returns the
+   number of operations per second. */
+static double run(void *(*alloc_fn)(), void (*free_fn)(void*), void **ptrs,
+                  size_t *perm, size_t n)
+{
+  double t0;
+  size_t i;
+  int r;
+  t0 = now();
+  for (r = 0; r < ROUNDS; ++r)
+    {
+      for (i = 0; i < n; ++i)
+        ptrs[i] = alloc_fn();
+      for (i = 0; i < n; i += 2)
+        free_fn(ptrs[perm[i]]);
+      for (i = 0; i < n; i += 2)
+        ptrs[perm[i]] = alloc_fn();
+      for (i = 0; i < n; ++i)
+        free_fn(ptrs[perm[i]]);
+    }
+  return 3.0 * n * ROUNDS / (now() - t0);
+}
+
+int main()
+{
+  static const size_t sizes[] = { 1000, 100000, 1000000 };
+  int k;
+
+  for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k)
+    {
+      size_t n = sizes[k];
+      void **ptrs = xmalloc(n * sizeof(void*));
+      size_t *perm = xmalloc(n * sizeof(size_t));
+      size_t i;
+
+      srand(k);
+      for (i = 0; i < n; ++i)
+        perm[i] = i;
+      for (i = n - 1; i > 0; --i)
+        {
+          size_t j = rand() % (i + 1);
+          size_t x = perm[i];
+          perm[i] = perm[j];
+          perm[j] = x;
+        }
+
+      old_pool = new_old_pool(1024, ELEM_SIZE);
+      printf("old pool:   %8lu objects, %12.0f ops/s\n", (unsigned long) n,
+             run(old_pool_alloc, old_pool_free, ptrs, perm, n));
+      free_old_pool(old_pool);
+
+      pool = new_pool(1024, ELEM_SIZE);
+      printf("pool:       %8lu objects, %12.0f ops/s\n", (unsigned long) n,
+             run(pool_alloc, pool_free, ptrs, perm, n));
+      free_pool(pool);
+
+      pool = new_pool(1024, ELEM_SIZE);
+      init_pool_cache(&cache, pool);
+      printf("pool cache: %8lu objects, %12.0f ops/s\n", (unsigned long) n,
+             run(cache_alloc, cache_free, ptrs, perm, n));
+      flush_pool_cache(&cache);
+      free_pool(pool);
+
+      pool = new_pool(1024, ELEM_SIZE);
+      pool->shared = 1;
+      init_pool_cache(&cache, pool);
+      printf("shared:     %8lu objects, %12.0f ops/s\n", (unsigned long) n,
+             run(cache_alloc, cache_free, ptrs, perm, n));
+      flush_pool_cache(&cache);
+      free_pool(pool);
+
+      printf("malloc:     %8lu objects, %12.0f ops/s\n", (unsigned long) n,
+             run(malloc_alloc, malloc_free, ptrs, perm, n));
+
+      free(ptrs);
+      free(perm);
+    }
+  return 0;
+}
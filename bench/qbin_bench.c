@@ -0,0 +1,214 @@
+/* qbin_bench.c - loading the textual and the binary intermediate code */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include "qbin.h"
+
+/* Compiles a large program generated by jlgen with both --icode and
+   --icode-bin, and compares the time needed to get at the quadruples
+   of the two files. For the text the time is only that of reading
+   the file and splitting it into lines, which is a lower bound on any
+   parser. For the binary file it is that of mapping and checking the
+   file and visiting every quadruple. The numbers of quadruples found
+   in the two files must agree. */
+
+#define REPEAT 10
+
+static const char *jlgen_args[] = { "-f", "400", "-s", "40", "-d", "3", NULL };
+
+static char src_path[] = "/tmp/qbin_bench_XXXXXX";
+static char out_path[sizeof(src_path) + 4];
+static char txt_path[sizeof(src_path) + 4];
+static char bin_path[sizeof(src_path) + 4];
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Runs argv with the standard output redirected to fout_path (unless
+   it is NULL). Returns the exit status, or -1 if the program did not
+   exit normally. */
+static int run(char **argv, const char *fout_path)
+{
+  pid_t pid = fork();
+  int status;
+  if (pid < 0)
+    {
+      perror("fork");
+      exit(1);
+    }
+  if (pid == 0)
+    {
+      int fd = open(fout_path != NULL ? fout_path : "/dev/null",
+                    O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0)
+        {
+          perror(fout_path);
+          _exit(127);
+        }
+      dup2(fd, 1);
+      close(fd);
+      execv(argv[0], argv);
+      perror(argv[0]);
+      _exit(127);
+    }
+  if (waitpid(pid, &status, 0) < 0)
+    {
+      perror("waitpid");
+      exit(1);
+    }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static long file_size(const char *path)
+{
+  struct stat st;
+  return stat(path, &st) == 0 ? (long) st.st_size : 0;
+}
+
+/* Returns the number of quadruples in the textual icode: the lines
+   which are not empty, comments, labels or function delimiters. */
+static long load_text(const char *path)
+{
+  FILE *f = fopen(path, "r");
+  long size = file_size(path);
+  char *text, *line, *end;
+  long n = 0;
+  if (f == NULL)
+    {
+      perror(path);
+      exit(1);
+    }
+  text = malloc(size + 1);
+  if (text == NULL || fread(text, 1, size, f) != size)
+    {
+      fprintf(stderr, "cannot read %s\n", path);
+      exit(1);
+    }
+  fclose(f);
+  text[size] = '\0';
+  for (line = text; *line != '\0'; line = end + 1)
+    {
+      end = strchr(line, '\n');
+      if (end == NULL)
+        end = line + strlen(line) - 1;
+      if (end == line || line[0] == '#' || strncmp(line, "function ", 9) == 0 ||
+          (line[0] == 'b' && end[-1] == ':'))
+        continue;
+      ++n;
+    }
+  free(text);
+  return n;
+}
+
+static long load_bin(const char *path, long *checksum)
+{
+  qbin_t *qbin = qbin_open(path);
+  const qbin_func_t *funcs;
+  uint32_t i, j, k;
+  long n = 0;
+  if (qbin == NULL)
+    exit(1);
+  funcs = qbin_funcs(qbin);
+  *checksum = 0;
+  for (i = 0; i < qbin->header->funcs_num; ++i)
+    {
+      const qbin_block_t *blocks = qbin_blocks(qbin, &funcs[i]);
+      for (j = 0; j < funcs[i].blocks_num; ++j)
+        {
+          const qbin_quadr_t *quadrs = qbin_quadrs(qbin, &blocks[j]);
+          for (k = 0; k < blocks[j].quadrs_num; ++k)
+            {
+              *checksum += quadrs[k].op + quadrs[k].result.index;
+            }
+          n += blocks[j].quadrs_num;
+        }
+    }
+  qbin_close(qbin);
+  return n;
+}
+
+int main(int argc, char **argv)
+{
+  char *gen_argv[16];
+  long text_quadrs = 0, bin_quadrs = 0, checksum;
+  double best_text = 1e30, best_bin = 1e30, t;
+  char txt_opt[sizeof(txt_path) + 16];
+  char bin_opt[sizeof(bin_path) + 16];
+  int fd, i, n = 0;
+
+  if (argc != 4)
+    {
+      fprintf(stderr, "usage: qbin_bench jlgen jl data-dir\n");
+      return 1;
+    }
+  fd = mkstemp(src_path);
+  if (fd < 0)
+    {
+      perror("mkstemp");
+      return 1;
+    }
+  close(fd);
+  sprintf(out_path, "%s.asm", src_path);
+  sprintf(txt_path, "%s.txt", src_path);
+  sprintf(bin_path, "%s.bin", src_path);
+
+  gen_argv[n++] = argv[1];
+  for (i = 0; jlgen_args[i] != NULL; ++i)
+    gen_argv[n++] = (char*) jlgen_args[i];
+  gen_argv[n] = NULL;
+  if (run(gen_argv, src_path) != 0)
+    {
+      fprintf(stderr, "cannot run %s\n", argv[1]);
+      return 1;
+    }
+  sprintf(txt_opt, "--icode=%s", txt_path);
+  sprintf(bin_opt, "--icode-bin=%s", bin_path);
+  {
+    char *jl_argv[] = { argv[2], "-b", "i386", "--no-assemble", "-d", argv[3], "-O1",
+                        txt_opt, bin_opt, "-o", out_path, src_path, NULL };
+    if (run(jl_argv, NULL) != 0)
+      {
+        fprintf(stderr, "cannot compile %s\n", src_path);
+        return 1;
+      }
+  }
+
+  for (i = 0; i < REPEAT; ++i)
+    {
+      t = now();
+      text_quadrs = load_text(txt_path);
+      t = now() - t;
+      if (t < best_text)
+        best_text = t;
+      t = now();
+      bin_quadrs = load_bin(bin_path, &checksum);
+      t = now() - t;
+      if (t < best_bin)
+        best_bin = t;
+    }
+
+  printf("%-8s %10s %10s %12s\n", "icode", "bytes", "quadrs", "load (us)");
+  printf("%-8s %10ld %10ld %12.0f\n", "text", file_size(txt_path), text_quadrs, best_text * 1e6);
+  printf("%-8s %10ld %10ld %12.0f\n", "binary", file_size(bin_path), bin_quadrs, best_bin * 1e6);
+
+  unlink(src_path);
+  unlink(out_path);
+  unlink(txt_path);
+  unlink(bin_path);
+  if (text_quadrs != bin_quadrs)
+    {
+      fprintf(stderr, "the numbers of quadruples differ\n");
+      return 1;
+    }
+  return 0;
+}
@@ -0,0 +1,223 @@
+/* scale_bench.c - compile time and memory versus program size */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+/* Compiles programs generated by jlgen with one parameter growing,
+   and prints the CPU time and the peak memory of the compiler for
+   each size. The growth column is the exponent k in time ~ lines^k
+   between a point and the previous one, so a value near 2 means
+   quadratic behaviour. The output is a gnuplot data file: the sweeps
+   are separated by two blank lines, so that e.g.
+
+     plot "out" index 1 using 2:3 with linespoints
+
+   plots the -O0 time against the number of lines for the second
+   sweep. */
+
+#define MAX_POINTS 8
+// a compilation taking more CPU time than this is killed
+#define CPU_LIMIT 300
+
+typedef struct{
+  const char *name;
+  const char *param; // the jlgen option which grows
+  const char *fixed[8]; // the other jlgen options
+  int values[MAX_POINTS]; // terminated by 0
+} sweep_t;
+
+static const sweep_t sweeps[] = {
+  { "functions", "-f", { "-s", "20", "-d", "2", NULL }, { 25, 50, 100, 200, 400, 0 } },
+  { "statements in a block", "-s", { "-f", "1", "-d", "0", NULL },
+    { 250, 500, 1000, 2000, 4000, 8000, 0 } },
+  { "nesting depth", "-d", { "-f", "1", "-s", "40", NULL }, { 4, 8, 16, 32, 0 } },
+  { "variables", "-v", { "-f", "1", "-s", "400", "-d", "0", NULL },
+    { 8, 16, 32, 64, 128, 256, 0 } }
+};
+
+static const char *opt_levels[] = { "-O0", "-O1" };
+#define LEVELS_NUM (sizeof(opt_levels) / sizeof(opt_levels[0]))
+
+typedef struct{
+  double cpu; // seconds, or -1 if the compilation failed
+  long rss; // kilobytes
+} result_t;
+
+static const char *jlgen_path;
+static const char *jl_path;
+static const char *data_dir;
+static char src_path[] = "/tmp/scale_bench_XXXXXX";
+static char out_path[sizeof(src_path) + 4];
+
+/* Runs argv with the standard output redirected to fout_path (unless
+   it is NULL). Returns the exit status, or -1 if the program did not
+   exit normally. */
+static int run(char **argv, const char *fout_path, struct rusage *ru)
+{
+  pid_t pid = fork();
+  int status;
+  if (pid < 0)
+    {
+      perror("fork");
+      exit(1);
+    }
+  if (pid == 0)
+    {
+      struct rlimit rl;
+      int fd = open(fout_path != NULL ? fout_path : "/dev/null",
+                    O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0)
+        {
+          perror(fout_path);
+          _exit(127);
+        }
+      dup2(fd, 1);
+      close(fd);
+      rl.rlim_cur = rl.rlim_max = CPU_LIMIT;
+      setrlimit(RLIMIT_CPU, &rl);
+      execv(argv[0], argv);
+      perror(argv[0]);
+      _exit(127);
+    }
+  if (wait4(pid, &status, 0, ru) < 0)
+    {
+      perror("wait4");
+      exit(1);
+    }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static long count_lines(const char *path)
+{
+  FILE *f = fopen(path, "r");
+  long n = 0;
+  int c;
+  if (f == NULL)
+    return 0;
+  while ((c = getc(f)) != EOF)
+    {
+      if (c == '\n')
+        ++n;
+    }
+  fclose(f);
+  return n;
+}
+
+static long generate(const sweep_t *sweep, int value)
+{
+  char *argv[16];
+  char valbuf[16];
+  struct rusage ru;
+  int i, n = 0;
+  argv[n++] = (char*) jlgen_path;
+  for (i = 0; sweep->fixed[i] != NULL; ++i)
+    argv[n++] = (char*) sweep->fixed[i];
+  sprintf(valbuf, "%d", value);
+  argv[n++] = (char*) sweep->param;
+  argv[n++] = valbuf;
+  argv[n] = NULL;
+  if (run(argv, src_path, &ru) != 0)
+    {
+      fprintf(stderr, "cannot run %s\n", jlgen_path);
+      exit(1);
+    }
+  return count_lines(src_path);
+}
+
+static result_t compile(const char *opt_level)
+{
+  char *argv[] = { (char*) jl_path, "-b", "i386", "--no-assemble", "-d", (char*) data_dir,
+                   (char*) opt_level, "-o", out_path, src_path, NULL };
+  struct rusage ru;
+  result_t res;
+  res.rss = 0;
+  if (run(argv, NULL, &ru) != 0)
+    {
+      res.cpu = -1;
+      return res;
+    }
+  res.cpu = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+    (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-6;
+  res.rss = ru.ru_maxrss;
+  return res;
+}
+
+static void run_sweep(const sweep_t *sweep)
+{
+  result_t prev[LEVELS_NUM];
+  long prev_lines = 0;
+  int i, j, k;
+
+  printf("# %s (jlgen", sweep->name);
+  for (i = 0; sweep->fixed[i] != NULL; ++i)
+    printf(" %s", sweep->fixed[i]);
+  printf(" %s N)\n#%9s %10s", sweep->param, "N", "lines");
+  for (j = 0; j < LEVELS_NUM; ++j)
+    printf(" %7s time %7s RSS %7s growth", opt_levels[j], opt_levels[j], opt_levels[j]);
+  printf("\n");
+
+  for (k = 0; sweep->values[k] != 0; ++k)
+    {
+      long lines = generate(sweep, sweep->values[k]);
+      printf("%10d %10ld", sweep->values[k], lines);
+      for (j = 0; j < LEVELS_NUM; ++j)
+        {
+          result_t res = compile(opt_levels[j]);
+          if (res.cpu < 0)
+            {
+              printf(" %12s %11s %14s", "failed", "-", "-");
+            }
+          else
+            {
+              printf(" %12.3f %11ld", res.cpu, res.rss);
+              // times below 10 ms are mostly noise
+              if (k > 0 && prev[j].cpu >= 0.01 && res.cpu >= 0.01)
+                printf(" %14.2f", log(res.cpu / prev[j].cpu) / log((double) lines / prev_lines));
+              else
+                printf(" %14s", "-");
+            }
+          prev[j] = res;
+        }
+      printf("\n");
+      fflush(stdout);
+      prev_lines = lines;
+    }
+  printf("\n\n");
+}
+
+int main(int argc, char **argv)
+{
+  int fd, i;
+  if (argc != 4)
+    {
+      fprintf(stderr, "usage: scale_bench jlgen jl data-dir\n");
+      return 1;
+    }
+  jlgen_path = argv[1];
+  jl_path = argv[2];
+  data_dir = argv[3];
+
+  fd = mkstemp(src_path);
+  if (fd < 0)
+    {
+      perror("mkstemp");
+      return 1;
+    }
+  close(fd);
+  sprintf(out_path, "%s.asm", src_path);
+
+  for (i = 0; i < sizeof(sweeps) / sizeof(sweeps[0]); ++i)
+    run_sweep(&sweeps[i]);
+
+  unlink(src_path);
+  unlink(out_path);
+  return 0;
+}
@@ -0,0 +1,67 @@
+        section .text
+        global _start
+        extern printf, scanf, exit
+_start:
+        call main
+        mov edi, eax
+        call exit
+
+error:
+        sub rsp, 8
+        lea rdi, [rel __error_str]
+        xor eax, eax
+        call printf
+        mov edi, 1
+        call exit
+
+readInt:
+        sub rsp, 24
+        mov dword [rsp + 8], 0
+        lea rsi, [rsp + 8]
+        lea rdi, [rel __int_format]
+        xor eax, eax
+        call scanf
+        mov eax, [rsp + 8]
+        add rsp, 24
+        ret
+
+readDouble:
+        sub rsp, 24
+        mov qword [rsp + 8], 0
+        lea rsi, [rsp + 8]
+        lea rdi, [rel __double_in_format]
+        xor eax, eax
+        call scanf
+        movsd xmm0, qword [rsp + 8]
+        add rsp, 24
+        ret
+
+printInt:
+        sub rsp, 8
+        mov esi, edi
+        lea rdi, [rel __int_format]
+        xor eax, eax
+        call printf
+        add rsp, 8
+        ret
+
+printDouble:
+        sub rsp, 8
+        lea rdi, [rel __double_format]
+        mov eax, 1              ; one vector register argument
+        call printf
+        add rsp, 8
+        ret
+
+printString:
+        sub rsp, 8
+        xor eax, eax
+        call printf
+        add rsp, 8
+        ret
+
+        section .data
+__error_str        db "runtime error",10,0
+__double_format    db "%f",10,0
+__double_in_format db "%lf",10,0
+__int_format       db "%d",10,0
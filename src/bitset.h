@@ -0,0 +1,81 @@
+/* bitset.h - word-packed bit sets */
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <limits.h>
+#include <string.h>
+#include "utils.h"
+
+typedef unsigned long bitset_word_t;
+
+#define BITSET_WORD_BITS (sizeof(bitset_word_t) * CHAR_BIT)
+/* the number of words needed for a set of n elements */
+#define BITSET_WORDS(n) (((n) + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS)
+
+/* A bit set is just an array of words; its size is kept by the
+   user. */
+
+inline static bitset_word_t *new_bitset(size_t words)
+{
+  bitset_word_t *set = xmalloc((words ? words : 1) * sizeof(bitset_word_t));
+  memset(set, 0, words * sizeof(bitset_word_t));
+  return set;
+}
+
+inline static void free_bitset(bitset_word_t *set)
+{
+  free(set);
+}
+
+inline static void bitset_add(bitset_word_t *set, size_t i)
+{
+  set[i / BITSET_WORD_BITS] |= (bitset_word_t) 1 << (i % BITSET_WORD_BITS);
+}
+
+inline static void bitset_remove(bitset_word_t *set, size_t i)
+{
+  set[i / BITSET_WORD_BITS] &= ~((bitset_word_t) 1 << (i % BITSET_WORD_BITS));
+}
+
+inline static bool bitset_contains(const bitset_word_t *set, size_t i)
+{
+  return (set[i / BITSET_WORD_BITS] >> (i % BITSET_WORD_BITS)) & 1;
+}
+
+inline static void bitset_clear(bitset_word_t *set, size_t words)
+{
+  memset(set, 0, words * sizeof(bitset_word_t));
+}
+
+inline static size_t bitset_count(const bitset_word_t *set, size_t words)
+{
+  size_t i, n = 0;
+  for (i = 0; i < words; ++i)
+    n += __builtin_popcountl(set[i]);
+  return n;
+}
+
+/* Returns the smallest element of the set which is not smaller than
+   i, or -1 if there is no such element. Usage:
+
+     for (i = bitset_next(set, words, 0); i >= 0; i = bitset_next(set, words, i + 1))
+       ...
+*/
+inline static long bitset_next(const bitset_word_t *set, size_t words, size_t i)
+{
+  size_t w = i / BITSET_WORD_BITS;
+  bitset_word_t x;
+  if (w >= words)
+    return -1;
+  x = set[w] & (~(bitset_word_t) 0 << (i % BITSET_WORD_BITS));
+  while (x == 0)
+    {
+      if (++w == words)
+        return -1;
+      x = set[w];
+    }
+  return w * BITSET_WORD_BITS + __builtin_ctzl(x);
+}
+
+#endif
@@ -0,0 +1,477 @@
+#include <elf.h>
+#include "elf_obj.h"
+
+typedef struct{
+  unsigned offset;
+  int symbol;
+  elf_reloc_kind_t kind;
+  int addend; // only for ELF64, where it is not kept in the field
+} reloc_t;
+
+typedef struct{
+  char *name;
+  bool code;
+  unsigned char *data;
+  size_t size;
+  reloc_t *relocs;
+  size_t relocs_num;
+  size_t relocs_size;
+} section_t;
+
+typedef struct{
+  char *name;
+  int section;
+  unsigned value;
+  bool global;
+} symbol_t;
+
+struct Elf_obj{
+  bool x86_64;
+  section_t *sections;
+  int sections_num;
+  int sections_size;
+  symbol_t *symbols;
+  int symbols_num;
+  int symbols_size;
+};
+
+/* a growing string table */
+typedef struct{
+  char *str;
+  size_t size;
+  size_t cap;
+} strbuf_t;
+
+elf_obj_t *new_elf_obj(bool x86_64)
+{
+  elf_obj_t *obj = xmalloc(sizeof(elf_obj_t));
+  obj->x86_64 = x86_64;
+  obj->sections_num = 0;
+  obj->sections_size = 4;
+  obj->sections = xmalloc(obj->sections_size * sizeof(section_t));
+  obj->symbols_num = 0;
+  obj->symbols_size = 64;
+  obj->symbols = xmalloc(obj->symbols_size * sizeof(symbol_t));
+  return obj;
+}
+
+void free_elf_obj(elf_obj_t *obj)
+{
+  int i;
+  for (i = 0; i < obj->sections_num; ++i)
+    {
+      free(obj->sections[i].name);
+      free(obj->sections[i].data);
+      free(obj->sections[i].relocs);
+    }
+  for (i = 0; i < obj->symbols_num; ++i)
+    {
+      free(obj->symbols[i].name);
+    }
+  free(obj->sections);
+  free(obj->symbols);
+  free(obj);
+}
+
+int elf_add_section(elf_obj_t *obj, const char *name, bool code, const void *data,
+                    size_t size)
+{
+  section_t *sec;
+  if (obj->sections_num == obj->sections_size)
+    {
+      obj->sections_size <<= 1;
+      obj->sections = xrealloc(obj->sections, obj->sections_size * sizeof(section_t));
+    }
+  sec = &obj->sections[obj->sections_num];
+  sec->name = xstrdup(name);
+  sec->code = code;
+  sec->size = size;
+  sec->data = xmalloc(size + 1);
+  memcpy(sec->data, data, size);
+  sec->relocs = NULL;
+  sec->relocs_num = sec->relocs_size = 0;
+  return obj->sections_num++;
+}
+
+int elf_add_symbol(elf_obj_t *obj, const char *name, int section, unsigned value,
+                   bool global)
+{
+  symbol_t *sym;
+  assert (section == ELF_UNDEF || (section >= 0 && section < obj->sections_num));
+  if (obj->symbols_num == obj->symbols_size)
+    {
+      obj->symbols_size <<= 1;
+      obj->symbols = xrealloc(obj->symbols, obj->symbols_size * sizeof(symbol_t));
+    }
+  sym = &obj->symbols[obj->symbols_num];
+  sym->name = xstrdup(name);
+  sym->section = section;
+  sym->value = value;
+  sym->global = global || section == ELF_UNDEF;
+  return obj->symbols_num++;
+}
+
+void elf_add_reloc(elf_obj_t *obj, int section, unsigned offset, int symbol,
+                   elf_reloc_kind_t kind)
+{
+  section_t *sec = &obj->sections[section];
+  reloc_t *reloc;
+  assert (symbol >= 0 && symbol < obj->symbols_num);
+  if (sec->relocs_num == sec->relocs_size)
+    {
+      sec->relocs_size = sec->relocs_size * 2 + 64;
+      sec->relocs = xrealloc(sec->relocs, sec->relocs_size * sizeof(reloc_t));
+    }
+  reloc = &sec->relocs[sec->relocs_num++];
+  reloc->offset = offset;
+  reloc->symbol = symbol;
+  reloc->kind = kind;
+  reloc->addend = 0;
+  if (obj->x86_64)
+    {
+      // ELF64 relocations carry the addend
+      unsigned char *p = sec->data + offset;
+      assert (offset + 4 <= sec->size);
+      reloc->addend = (int) (p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned) p[3] << 24));
+      memset(p, 0, 4);
+    }
+}
+
+//--------------------------------------------------------------------
+
+/* writing */
+
+static unsigned add_string(strbuf_t *buf, const char *str)
+{
+  size_t n = strlen(str) + 1;
+  unsigned pos = buf->size;
+  if (buf->size + n > buf->cap)
+    {
+      while (buf->size + n > buf->cap)
+        buf->cap = buf->cap * 2 + 256;
+      buf->str = xrealloc(buf->str, buf->cap);
+    }
+  memcpy(buf->str + buf->size, str, n);
+  buf->size += n;
+  return pos;
+}
+
+static unsigned align(unsigned off, unsigned alignment)
+{
+  return (off + alignment - 1) & ~(alignment - 1);
+}
+
+/* Writes size bytes of data at the offset off of the file, padding
+   with zeros from the current offset *pos. */
+static bool write_at(FILE *fout, unsigned *pos, unsigned off, const void *data, size_t size)
+{
+  static const char zeros[16] = { 0 };
+  assert (off >= *pos && off - *pos <= sizeof(zeros));
+  if (fwrite(zeros, 1, off - *pos, fout) != off - *pos ||
+      (size > 0 && fwrite(data, 1, size, fout) != size))
+    {
+      return false;
+    }
+  *pos = off + size;
+  return true;
+}
+
+static unsigned reloc_type(elf_obj_t *obj, elf_reloc_kind_t kind)
+{
+  switch (kind){
+  case ELF_ABS32:
+    return obj->x86_64 ? R_X86_64_32S : R_386_32;
+  case ELF_PC32:
+    return obj->x86_64 ? R_X86_64_PC32 : R_386_PC32;
+  case ELF_PLT32:
+    return obj->x86_64 ? R_X86_64_PLT32 : R_386_PC32;
+  default:
+    assert (false);
+    return 0;
+  };
+}
+
+/* The headers and symbols are built in their ELF64 form and converted
+   when an ELF32 file is written. */
+
+static bool write_shdrs(elf_obj_t *obj, FILE *fout, unsigned *pos, unsigned off,
+                        Elf64_Shdr *shdrs, int shnum)
+{
+  int i;
+  bool ok = write_at(fout, pos, off, NULL, 0);
+  for (i = 0; ok && i < shnum; ++i)
+    {
+      if (obj->x86_64)
+        ok = write_at(fout, pos, *pos, &shdrs[i], sizeof(Elf64_Shdr));
+      else
+        {
+          Elf32_Shdr sh;
+          sh.sh_name = shdrs[i].sh_name;
+          sh.sh_type = shdrs[i].sh_type;
+          sh.sh_flags = shdrs[i].sh_flags;
+          sh.sh_addr = shdrs[i].sh_addr;
+          sh.sh_offset = shdrs[i].sh_offset;
+          sh.sh_size = shdrs[i].sh_size;
+          sh.sh_link = shdrs[i].sh_link;
+          sh.sh_info = shdrs[i].sh_info;
+          sh.sh_addralign = shdrs[i].sh_addralign;
+          sh.sh_entsize = shdrs[i].sh_entsize;
+          ok = write_at(fout, pos, *pos, &sh, sizeof(sh));
+        }
+    }
+  return ok;
+}
+
+static bool write_syms(elf_obj_t *obj, FILE *fout, unsigned *pos, unsigned off,
+                       Elf64_Sym *syms, int syms_num)
+{
+  int i;
+  bool ok = write_at(fout, pos, off, NULL, 0);
+  for (i = 0; ok && i < syms_num; ++i)
+    {
+      if (obj->x86_64)
+        ok = write_at(fout, pos, *pos, &syms[i], sizeof(Elf64_Sym));
+      else
+        {
+          Elf32_Sym sym;
+          sym.st_name = syms[i].st_name;
+          sym.st_value = syms[i].st_value;
+          sym.st_size = syms[i].st_size;
+          sym.st_info = syms[i].st_info;
+          sym.st_other = syms[i].st_other;
+          sym.st_shndx = syms[i].st_shndx;
+          ok = write_at(fout, pos, *pos, &sym, sizeof(sym));
+        }
+    }
+  return ok;
+}
+
+static bool write_relocs(elf_obj_t *obj, FILE *fout, unsigned *pos, unsigned off,
+                         section_t *sec, int *sym_index)
+{
+  size_t r;
+  bool ok = write_at(fout, pos, off, NULL, 0);
+  for (r = 0; ok && r < sec->relocs_num; ++r)
+    {
+      reloc_t *reloc = &sec->relocs[r];
+      unsigned type = reloc_type(obj, reloc->kind);
+      if (obj->x86_64)
+        {
+          Elf64_Rela rela;
+          rela.r_offset = reloc->offset;
+          rela.r_info = ELF64_R_INFO(sym_index[reloc->symbol], type);
+          rela.r_addend = reloc->addend;
+          ok = write_at(fout, pos, *pos, &rela, sizeof(rela));
+        }
+      else
+        {
+          Elf32_Rel rel;
+          rel.r_offset = reloc->offset;
+          rel.r_info = ELF32_R_INFO(sym_index[reloc->symbol], type);
+          ok = write_at(fout, pos, *pos, &rel, sizeof(rel));
+        }
+    }
+  return ok;
+}
+
+bool write_elf_obj(elf_obj_t *obj, FILE *fout)
+{
+  /* The sections of the file: the null section, the sections of the
+     object, a .rel (.rela for ELF64) section for each of them which
+     has relocations, and the symbol and string tables. The symbol
+     table begins with the section symbols, and the local symbols
+     precede the global ones. */
+  int secs_num = obj->sections_num;
+  int rel_num = 0;
+  int shnum, symtab_ndx, strtab_ndx, shstrtab_ndx;
+  int syms_num = 1 + secs_num + obj->symbols_num;
+  int first_global;
+  int *sym_index = xmalloc((obj->symbols_num + 1) * sizeof(int));
+  int *rel_ndx = xmalloc((secs_num + 1) * sizeof(int));
+  bool x86_64 = obj->x86_64;
+  unsigned word = x86_64 ? 8 : 4;
+  unsigned ehdr_size = x86_64 ? sizeof(Elf64_Ehdr) : sizeof(Elf32_Ehdr);
+  unsigned shdr_size = x86_64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr);
+  unsigned sym_size = x86_64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+  unsigned rel_size = x86_64 ? sizeof(Elf64_Rela) : sizeof(Elf32_Rel);
+  Elf64_Shdr *shdrs;
+  Elf64_Sym *syms;
+  strbuf_t strtab = { NULL, 0, 0 };
+  strbuf_t shstrtab = { NULL, 0, 0 };
+  unsigned off, pos, shoff;
+  int i, j, k;
+  bool ok = true;
+
+  for (i = 0; i < secs_num; ++i)
+    {
+      rel_ndx[i] = obj->sections[i].relocs_num > 0 ? 1 + secs_num + rel_num++ : 0;
+    }
+  symtab_ndx = 1 + secs_num + rel_num;
+  strtab_ndx = symtab_ndx + 1;
+  shstrtab_ndx = strtab_ndx + 1;
+  shnum = shstrtab_ndx + 1;
+
+  // the symbol table
+  syms = xmalloc(syms_num * sizeof(Elf64_Sym));
+  memset(syms, 0, syms_num * sizeof(Elf64_Sym));
+  add_string(&strtab, "");
+  for (i = 0; i < secs_num; ++i)
+    {
+      syms[1 + i].st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+      syms[1 + i].st_shndx = 1 + i;
+    }
+  k = 1 + secs_num;
+  for (j = 0; j < 2; ++j)
+    {
+      // the local symbols in the first pass, the global ones in the second
+      if (j == 1)
+        first_global = k;
+      for (i = 0; i < obj->symbols_num; ++i)
+        {
+          symbol_t *sym = &obj->symbols[i];
+          if (sym->global != (j == 1))
+            continue;
+          sym_index[i] = k;
+          syms[k].st_name = add_string(&strtab, sym->name);
+          syms[k].st_value = sym->value;
+          syms[k].st_info = ELF64_ST_INFO(sym->global ? STB_GLOBAL : STB_LOCAL,
+                                          sym->section != ELF_UNDEF &&
+                                          obj->sections[sym->section].code ?
+                                          STT_FUNC : STT_NOTYPE);
+          syms[k].st_shndx = sym->section == ELF_UNDEF ? SHN_UNDEF : 1 + sym->section;
+          ++k;
+        }
+    }
+
+  // the section headers and the layout of the file
+  shdrs = xmalloc(shnum * sizeof(Elf64_Shdr));
+  memset(shdrs, 0, shnum * sizeof(Elf64_Shdr));
+  add_string(&shstrtab, "");
+  off = ehdr_size;
+  for (i = 0; i < secs_num; ++i)
+    {
+      section_t *sec = &obj->sections[i];
+      Elf64_Shdr *sh = &shdrs[1 + i];
+      sh->sh_name = add_string(&shstrtab, sec->name);
+      sh->sh_type = SHT_PROGBITS;
+      sh->sh_flags = SHF_ALLOC | (sec->code ? SHF_EXECINSTR : SHF_WRITE);
+      sh->sh_addralign = sec->code ? 16 : word;
+      off = align(off, sh->sh_addralign);
+      sh->sh_offset = off;
+      sh->sh_size = sec->size;
+      off += sec->size;
+    }
+  for (i = 0; i < secs_num; ++i)
+    {
+      section_t *sec = &obj->sections[i];
+      Elf64_Shdr *sh;
+      char name[64];
+      if (rel_ndx[i] == 0)
+        continue;
+      sh = &shdrs[rel_ndx[i]];
+      snprintf(name, sizeof(name), "%s%s", x86_64 ? ".rela" : ".rel", sec->name);
+      sh->sh_name = add_string(&shstrtab, name);
+      sh->sh_type = x86_64 ? SHT_RELA : SHT_REL;
+      sh->sh_link = symtab_ndx;
+      sh->sh_info = 1 + i;
+      sh->sh_addralign = word;
+      sh->sh_entsize = rel_size;
+      off = align(off, word);
+      sh->sh_offset = off;
+      sh->sh_size = sec->relocs_num * rel_size;
+      off += sh->sh_size;
+    }
+  shdrs[symtab_ndx].sh_name = add_string(&shstrtab, ".symtab");
+  shdrs[symtab_ndx].sh_type = SHT_SYMTAB;
+  shdrs[symtab_ndx].sh_link = strtab_ndx;
+  shdrs[symtab_ndx].sh_info = first_global;
+  shdrs[symtab_ndx].sh_addralign = word;
+  shdrs[symtab_ndx].sh_entsize = sym_size;
+  off = align(off, word);
+  shdrs[symtab_ndx].sh_offset = off;
+  shdrs[symtab_ndx].sh_size = syms_num * sym_size;
+  off += shdrs[symtab_ndx].sh_size;
+  shdrs[strtab_ndx].sh_name = add_string(&shstrtab, ".strtab");
+  shdrs[strtab_ndx].sh_type = SHT_STRTAB;
+  shdrs[strtab_ndx].sh_addralign = 1;
+  shdrs[strtab_ndx].sh_offset = off;
+  shdrs[strtab_ndx].sh_size = strtab.size;
+  off += strtab.size;
+  shdrs[shstrtab_ndx].sh_name = add_string(&shstrtab, ".shstrtab");
+  shdrs[shstrtab_ndx].sh_type = SHT_STRTAB;
+  shdrs[shstrtab_ndx].sh_addralign = 1;
+  shdrs[shstrtab_ndx].sh_offset = off;
+  shdrs[shstrtab_ndx].sh_size = shstrtab.size;
+  off += shstrtab.size;
+  shoff = align(off, word);
+
+  // write everything out in the order of the offsets
+  pos = 0;
+  if (x86_64)
+    {
+      Elf64_Ehdr ehdr;
+      memset(&ehdr, 0, sizeof(ehdr));
+      memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+      ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+      ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+      ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+      ehdr.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+      ehdr.e_type = ET_REL;
+      ehdr.e_machine = EM_X86_64;
+      ehdr.e_version = EV_CURRENT;
+      ehdr.e_shoff = shoff;
+      ehdr.e_ehsize = ehdr_size;
+      ehdr.e_shentsize = shdr_size;
+      ehdr.e_shnum = shnum;
+      ehdr.e_shstrndx = shstrtab_ndx;
+      ok = write_at(fout, &pos, 0, &ehdr, sizeof(ehdr));
+    }
+  else
+    {
+      Elf32_Ehdr ehdr;
+      memset(&ehdr, 0, sizeof(ehdr));
+      memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+      ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+      ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+      ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+      ehdr.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+      ehdr.e_type = ET_REL;
+      ehdr.e_machine = EM_386;
+      ehdr.e_version = EV_CURRENT;
+      ehdr.e_shoff = shoff;
+      ehdr.e_ehsize = ehdr_size;
+      ehdr.e_shentsize = shdr_size;
+      ehdr.e_shnum = shnum;
+      ehdr.e_shstrndx = shstrtab_ndx;
+      ok = write_at(fout, &pos, 0, &ehdr, sizeof(ehdr));
+    }
+  for (i = 0; ok && i < secs_num; ++i)
+    {
+      ok = write_at(fout, &pos, shdrs[1 + i].sh_offset, obj->sections[i].data,
+                    obj->sections[i].size);
+    }
+  for (i = 0; ok && i < secs_num; ++i)
+    {
+      if (rel_ndx[i] != 0)
+        {
+          ok = write_relocs(obj, fout, &pos, shdrs[rel_ndx[i]].sh_offset,
+                            &obj->sections[i], sym_index);
+        }
+    }
+  if (ok)
+    ok = write_syms(obj, fout, &pos, shdrs[symtab_ndx].sh_offset, syms, syms_num);
+  if (ok)
+    ok = write_at(fout, &pos, shdrs[strtab_ndx].sh_offset, strtab.str, strtab.size);
+  if (ok)
+    ok = write_at(fout, &pos, shdrs[shstrtab_ndx].sh_offset, shstrtab.str, shstrtab.size);
+  if (ok)
+    ok = write_shdrs(obj, fout, &pos, shoff, shdrs, shnum);
+
+  free(sym_index);
+  free(rel_ndx);
+  free(syms);
+  free(shdrs);
+  free(strtab.str);
+  free(shstrtab.str);
+  return ok;
+}
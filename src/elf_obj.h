@@ -0,0 +1,44 @@
+/* elf_obj.h - writer of ELF32 (i386) and ELF64 (x86-64) relocatable
+   object files */
+
+#ifndef ELF_OBJ_H
+#define ELF_OBJ_H
+
+#include <stdio.h>
+#include "utils.h"
+
+#define ELF_UNDEF -1
+
+typedef struct Elf_obj elf_obj_t;
+
+/* the kinds of relocations of 32-bit fields */
+typedef enum{
+  ELF_ABS32, // the address of the symbol
+  ELF_PC32, // the address of the symbol minus the address of the field
+  ELF_PLT32 // like ELF_PC32, for the target of a call
+} elf_reloc_kind_t;
+
+/* Creates an ELF32 object for i386 or, if x86_64, an ELF64 one for
+   x86-64. */
+elf_obj_t *new_elf_obj(bool x86_64);
+void free_elf_obj(elf_obj_t *obj);
+
+/* Adds a section with a copy of the data. Returns the number of the
+   section. */
+int elf_add_section(elf_obj_t *obj, const char *name, bool code, const void *data,
+                    size_t size);
+/* Adds a symbol defined at the given offset of a section, or an
+   undefined one if section is ELF_UNDEF. Returns the number of the
+   symbol. The name is copied. */
+int elf_add_symbol(elf_obj_t *obj, const char *name, int section, unsigned value,
+                   bool global);
+/* Adds a relocation of the 32-bit field at the offset of a section:
+   the field is incremented by the value given by the kind. In an
+   ELF64 object the value in the field is moved to the relocation. */
+void elf_add_reloc(elf_obj_t *obj, int section, unsigned offset, int symbol,
+                   elf_reloc_kind_t kind);
+
+/* Returns false on a write error. */
+bool write_elf_obj(elf_obj_t *obj, FILE *fout);
+
+#endif
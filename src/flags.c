@@ -6,6 +6,9 @@
 #include "flags.h"
 
 bool f_no_gencode;
+bool f_stats;
+int f_jobs;
+time_report_t f_time_report;
 
 bool f_optimize;
 bool f_optimize_local;
@@ -19,6 +22,7 @@ const char *f_peephole_rules_file_path;
 const char *f_data_path;
 const char *f_output_file;
 const char *f_icode_output_file;
+const char *f_icode_bin_file;
 
 const char **f_input_files;
 int f_input_files_num;
@@ -26,6 +30,8 @@ int f_input_files_num;
 bool f_assemble;
 bool f_link;
 bool f_preserve_files;
+bool f_run;
+bool f_perf_map;
 
 int f_args_in_reg_num;
 
@@ -41,6 +47,7 @@ static char peephole_rules_file_path_buf[MAX_BUF_SIZE+1];
 static char data_path_buf[MAX_BUF_SIZE+1];
 static char output_file_buf[MAX_BUF_SIZE+1];
 static char icode_filename_buf[MAX_BUF_SIZE+1];
+static char icode_bin_filename_buf[MAX_BUF_SIZE+1];
 
 #define FLAG_I386 128
 #define FLAG_PENTIUM_PRO 129
@@ -49,13 +56,20 @@ static char icode_filename_buf[MAX_BUF_SIZE+1];
 #define FLAG_NO_GENCODE 132
 #define FLAG_NO_ASSEMBLE 133
 #define FLAG_ICODE 134
+#define FLAG_STATS 135
+#define FLAG_TIME_REPORT 136
+#define FLAG_RUN 137
+#define FLAG_PERF_MAP 138
+#define FLAG_ICODE_BIN 139
 
 static void show_help()
 {
-  printf("usage: jl [options] program.jl\n\n"
+  printf("usage: jl [options] program.jl...\n\n"
+         "Each program is compiled separately. An argument of the form @file\n"
+         "names a file containing a whitespace-separated list of programs.\n\n"
          "Available options:\n"
          "-b, --backend=X\n"
-         "\tChoose backend X, where X may be 'quadr' or 'i386'.\n"
+         "\tChoose backend X, where X may be 'quadr', 'i386' or 'x86_64'.\n"
          "--i386\n"
          "\tChoose the i386 backend, but without support for pentium-pro\n"
          "\tintructions.\n"
@@ -66,7 +80,7 @@ static void show_help()
          "\tbasic block and peephole optimization) or 2 (1 plus global\n"
          "\toptimization).\n"
          "-o, --output=X\n"
-         "\tSet the output file to X.\n"
+         "\tSet the output file to X. Allowed only with a single program.\n"
          "-d, --data-dir=X\n"
          "\tSet the path to compiler's data directory.\n"
          "--no-gencode\n"
@@ -75,11 +89,31 @@ static void show_help()
          "\tSuppress the assembly stage.\n"
          "-c, --no-link\n"
          "\tSuppress linking.\n"
+         "--run\n"
+         "\tCompile the program with the x86_64 backend into memory and run it,\n"
+         "\tinstead of writing any files. The exit status is the program's.\n"
+         "\tAllowed only with a single program.\n"
+         "--perf-map\n"
+         "\tWith --run, write the addresses of the compiled functions to\n"
+         "\t/tmp/perf-<pid>.map, so that profilers can name them.\n"
          "-p, --preserve-files\n"
-         "\tPreserve intermediate assembly files.\n"
+         "\tPreserve intermediate assembly and object files.\n"
          "--icode=X\n"
          "\tSave intermediate code to file X. Useful only for debugging the\n"
          "\tcompiler.\n"
+         "--icode-bin=X\n"
+         "\tSave intermediate code to file X in a binary format which may be\n"
+         "\tmapped into memory and read in place (see src/qbin.h).\n"
+         "-j, --jobs=X\n"
+         "\tOptimize and generate code for X functions in parallel. The\n"
+         "\twhole program is then parsed first; by default each function\n"
+         "\tis compiled as soon as it is parsed.\n"
+         "--stats\n"
+         "\tPrint compilation statistics to the standard error output.\n"
+         "--time-report[=X]\n"
+         "\tPrint the time spent in each compilation phase, the slowest\n"
+         "\tfunctions and the peak memory used to the standard error output.\n"
+         "\tX may be 'text' (the default) or 'json'.\n"
          "-h, --help\n"
          "\tDisplay this help.\n"
          "-v, --version\n"
@@ -104,14 +138,51 @@ static void set_paths()
   case BACK_I386:
     f_runtime_path = runtime_path_buf;
     f_peephole_rules_file_path = peephole_rules_file_path_buf;
-    sprintf(runtime_path_buf, "%s/i386_linux.asm", data_path_buf);
-    sprintf(peephole_rules_file_path_buf, "%s/i386.opt", data_path_buf);
+    sprintf(runtime_path_buf, "%.*s/i386_linux.asm", MAX_BUF_SIZE - 15, data_path_buf);
+    sprintf(peephole_rules_file_path_buf, "%.*s/i386.opt", MAX_BUF_SIZE - 9, data_path_buf);
+    break;
+  case BACK_X86_64:
+    // the peephole rules are written for i386 code
+    // the runtime routines are C functions when the code is run in memory
+    f_runtime_path = f_run ? NULL : runtime_path_buf;
+    f_peephole_rules_file_path = NULL;
+    sprintf(runtime_path_buf, "%.*s/x86_64_linux.asm", MAX_BUF_SIZE - 17, data_path_buf);
     break;
   default:
     xabort("set_paths()");
   };
 }
 
+static int input_files_size;
+
+static void add_input_file(char *path)
+{
+  if (f_input_files_num == input_files_size)
+    {
+      input_files_size <<= 1;
+      f_input_files = xrealloc(f_input_files, sizeof(char*) * input_files_size);
+    }
+  f_input_files[f_input_files_num++] = path;
+}
+
+/* Adds the input files listed in the file at path, separated by
+   whitespace. */
+static void read_list_file(const char *path)
+{
+  char name[MAX_BUF_SIZE+1];
+  FILE *fin = fopen(path, "r");
+  if (fin == NULL)
+    {
+      perror("cannot open list file");
+      exit(2);
+    }
+  while (fscanf(fin, "%512s", name) == 1)
+    {
+      add_input_file(xstrdup(name));
+    }
+  fclose(fin);
+}
+
 void parse_flags(int argc, char **argv)
 {
   const char *str;
@@ -130,6 +201,12 @@ void parse_flags(int argc, char **argv)
     {"no-link", 0, 0, 'c'},
     {"preserve-files", 0, 0, 'p'},
     {"icode", 1, 0, FLAG_ICODE},
+    {"icode-bin", 1, 0, FLAG_ICODE_BIN},
+    {"stats", 0, 0, FLAG_STATS},
+    {"time-report", 2, 0, FLAG_TIME_REPORT},
+    {"run", 0, 0, FLAG_RUN},
+    {"perf-map", 0, 0, FLAG_PERF_MAP},
+    {"jobs", 1, 0, 'j'},
     {"help", 0, 0, 'h'},
     {"version", 0, 0, 'v'},
     {0, 0, 0, 0}
@@ -137,6 +214,9 @@ void parse_flags(int argc, char **argv)
 
   // default options
   f_no_gencode = false;
+  f_stats = false;
+  f_jobs = 1;
+  f_time_report = TIME_REPORT_NONE;
 
   f_optimize = true;
   f_optimize_local = true;
@@ -150,16 +230,20 @@ void parse_flags(int argc, char **argv)
   f_data_path = data_path_buf;
 
   f_icode_output_file = NULL;
+  f_icode_bin_file = NULL;
 
   runtime_path_buf[MAX_BUF_SIZE] = '\0';
   peephole_rules_file_path_buf[MAX_BUF_SIZE] = '\0';
   data_path_buf[MAX_BUF_SIZE] = '\0';
   output_file_buf[MAX_BUF_SIZE] = '\0';
   icode_filename_buf[MAX_BUF_SIZE] = '\0';
+  icode_bin_filename_buf[MAX_BUF_SIZE] = '\0';
 
   f_assemble = true;
   f_link = true;
   f_preserve_files = false;  
+  f_run = false;
+  f_perf_map = false;
 
   f_pentium_pro = false;
 
@@ -179,7 +263,7 @@ void parse_flags(int argc, char **argv)
 
   for (;;)
     {
-      int c = getopt_long(argc, argv, "b:O:o:d:cphv", options, NULL);
+      int c = getopt_long(argc, argv, "b:O:o:d:j:cphv", options, NULL);
       if (c == -1)
         break;
       switch (c){
@@ -188,6 +272,10 @@ void parse_flags(int argc, char **argv)
           {
             f_backend_type = BACK_I386;
           }
+        else if (strcmp(optarg, "x86_64") == 0)
+          {
+            f_backend_type = BACK_X86_64;
+          }
         else if (strcmp(optarg, "quadr") == 0)
           {
             f_backend_type = BACK_QUADR;
@@ -237,6 +325,13 @@ void parse_flags(int argc, char **argv)
       case 'c':
         f_link = false;
         break;
+      case 'j':
+        f_jobs = atoi(optarg);
+        if (f_jobs < 1)
+          {
+            xabort("bad option");
+          }
+        break;
       case 'p':
         f_preserve_files = true;
         break;
@@ -274,6 +369,33 @@ void parse_flags(int argc, char **argv)
         f_icode_output_file = icode_filename_buf;
         strncpy(icode_filename_buf, optarg, MAX_BUF_SIZE);
         break;
+      case FLAG_ICODE_BIN:
+        f_icode_bin_file = icode_bin_filename_buf;
+        strncpy(icode_bin_filename_buf, optarg, MAX_BUF_SIZE);
+        break;
+      case FLAG_STATS:
+        f_stats = true;
+        break;
+      case FLAG_RUN:
+        f_run = true;
+        break;
+      case FLAG_PERF_MAP:
+        f_perf_map = true;
+        break;
+      case FLAG_TIME_REPORT:
+        if (optarg == NULL || strcmp(optarg, "text") == 0)
+          {
+            f_time_report = TIME_REPORT_TEXT;
+          }
+        else if (strcmp(optarg, "json") == 0)
+          {
+            f_time_report = TIME_REPORT_JSON;
+          }
+        else
+          {
+            xabort("bad option");
+          }
+        break;
       case '?':
         break;
       default:
@@ -281,18 +403,33 @@ void parse_flags(int argc, char **argv)
         break;
       };
     } // end for
-  f_input_files_num = argc - optind;
-  if (f_input_files_num > 0)
-    f_input_files = xmalloc(sizeof(char*) * f_input_files_num);
-  else
-    f_input_files = NULL;
+  if (f_run)
+    {
+      f_backend_type = BACK_X86_64;
+      set_paths();
+    }
+  f_input_files_num = 0;
+  input_files_size = argc - optind + 1;
+  f_input_files = xmalloc(sizeof(char*) * input_files_size);
   for (i = optind; i < argc; ++i)
     {
-      f_input_files[i - optind] = argv[i];
+      if (argv[i][0] == '@')
+        {
+          read_list_file(argv[i] + 1);
+        }
+      else
+        {
+          add_input_file(xstrdup(argv[i]));
+        }
     }
 }
 
 void cleanup_flags()
 {
+  int i;
+  for (i = 0; i < f_input_files_num; ++i)
+    {
+      free((char*) f_input_files[i]);
+    }
   free(f_input_files);
 }
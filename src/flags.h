@@ -5,9 +5,16 @@
 
 #include "utils.h"
 
-typedef enum {BACK_QUADR, BACK_I386} backend_type_t;
+typedef enum {BACK_QUADR, BACK_I386, BACK_X86_64} backend_type_t;
+typedef enum {TIME_REPORT_NONE, TIME_REPORT_TEXT, TIME_REPORT_JSON} time_report_t;
 
 extern bool f_no_gencode;
+// whether to print compilation statistics
+extern bool f_stats;
+// the number of threads compiling functions
+extern int f_jobs;
+// whether and how to print the compile time and memory report
+extern time_report_t f_time_report;
 
 /* Optimization options */
 
@@ -27,6 +34,8 @@ extern const char *f_output_file;
 /* icode output file name -- NULL if the intermediate code should not
    be saved (the default) */
 extern const char *f_icode_output_file;
+/* binary icode output file name, or NULL */
+extern const char *f_icode_bin_file;
 
 extern const char **f_input_files;
 extern int f_input_files_num;
@@ -41,6 +50,10 @@ extern bool f_assemble;
 extern bool f_link;
 // whether to preserve intermediate files (assembly)
 extern bool f_preserve_files;
+// whether to run the program in memory instead of writing any files
+extern bool f_run;
+// whether to write a perf map for the code run in memory
+extern bool f_perf_map;
 
 /* the number of arguments passed in a register (may be ignored by the
    backend -- only a `hint')*/
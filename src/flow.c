@@ -1,32 +1,58 @@
 
 #include "utils.h"
 #include "rbtree.h"
+#include "bitset.h"
 #include "opt.h"
 #include "flow.h"
+#include "flags.h"
+#include "stats.h"
+#include "timer.h"
 
 typedef struct Flow_data{
-  rbtree_t *live_def; // killed by the block (variables defined in the block)
-  rbtree_t *live_in; // live at the beginning of the block
-  rbtree_t *live_out; // live at the end of the block
+  bitset_word_t *live_def; // killed by the block (variables defined in the block)
+  bitset_word_t *live_use; // used in the block before being defined
+  bitset_word_t *live_in; // live at the beginning of the block
+  bitset_word_t *live_out; // live at the end of the block
+  /* use_nud is parallel to the elements of live_use (in increasing
+     order) and holds the indices of their first uses in the block */
+  unsigned *use_nud;
+  /* in_vars lists the elements of live_in in increasing order, and
+     in_nud holds their nearest use distances from the beginning of
+     the block; both are computed only after the sets converge */
+  int *in_vars;
+  unsigned *in_nud;
+  int in_size;
   int instr_num; // the number of instructions in the block
+  /* predecessors of the block reachable from the root; they point
+     into a common array */
+  struct Basic_block **preds;
+  int preds_num;
+  int dfs_child; // the next child to visit in the depth-first search
+  bool queued; // whether the block is on the worklist
 } flow_data_t;
 
-/* elements of live_out and live_def are of type var_key_t* */
-/* elements of live_in are of type var_descr_t* */
-
-typedef struct{
-  var_t *var;
-} var_key_t;
-
-static pool_t *var_key_pool;
+/* Variables are numbered densely with var_t::id, and all the sets
+   are bit sets of `words' words. */
+static __thread size_t words;
+static __thread var_t **vars; // vars[id] is the variable numbered id
+static __thread unsigned *first_use; // scratch space for compute_live_def_use()
 
 inline static flow_data_t *new_flow_data()
 {
   flow_data_t *fd = xmalloc(sizeof(flow_data_t));
   fd->live_def = NULL;
+  fd->live_use = NULL;
   fd->live_in = NULL;
   fd->live_out = NULL;
+  fd->use_nud = NULL;
+  fd->in_vars = NULL;
+  fd->in_nud = NULL;
+  fd->in_size = 0;
   fd->instr_num = 0;
+  fd->preds = NULL;
+  fd->preds_num = 0;
+  fd->dfs_child = 0;
+  fd->queued = false;
   return fd;
 }
 
@@ -35,123 +61,192 @@ inline static void free_flow_data(flow_data_t *fd)
   free(fd);
 }
 
-inline static var_key_t *new_var_key(var_t *var)
-{
-  var_key_t *k = palloc(var_key_pool);
-  k->var = var;
-  return k;
-}
-
-inline static void free_var_key(var_key_t *var_key)
-{
-  pfree(var_key_pool, var_key);
-}
+// -------------------------------------------------------------------
 
-inline static void rb_delete_vk(rbtree_t *tree, var_key_t *vk)
+/* Computes the blocks reachable from root in postorder (children
+   before parents), without recursion. Returns the number of the
+   blocks stored in order, which must have room for all blocks. */
+static int compute_postorder(basic_block_t *root, basic_block_t **order)
 {
-  rbnode_t *node = rb_search(tree, vk);
-  if (node != NULL)
+  basic_block_t **stack;
+  int sp = 0, n = 0, size = 64;
+  stack = xmalloc(size * sizeof(basic_block_t*));
+  begin_traversal();
+  visit(root);
+  root->flow_data->dfs_child = 0;
+  stack[sp++] = root;
+  while (sp > 0)
     {
-      var_key_t *vk2 = node->key;
-      rb_delete(tree, vk);
-      free_var_key(vk2);
+      basic_block_t *block = stack[sp - 1];
+      flow_data_t *fd = block->flow_data;
+      basic_block_t *child = NULL;
+      while (child == NULL && fd->dfs_child < 2)
+        {
+          child = (fd->dfs_child == 0 ? block->child1 : block->child2);
+          ++fd->dfs_child;
+          if (child != NULL && visited(child))
+            child = NULL;
+        }
+      if (child != NULL)
+        {
+          visit(child);
+          child->flow_data->dfs_child = 0;
+          if (sp == size)
+            {
+              size <<= 1;
+              stack = xrealloc(stack, size * sizeof(basic_block_t*));
+            }
+          stack[sp++] = child;
+        }
+      else
+        {
+          order[n++] = block;
+          --sp;
+        }
     }
+  free(stack);
+  return n;
 }
 
-inline static void rb_delete_vd(rbtree_t *tree, var_descr_t *vd)
+/* Fills in the predecessor lists of the n blocks in order. Returns
+   the array the lists point into. */
+static basic_block_t **compute_preds(basic_block_t **order, int n)
 {
-  rbnode_t *node = rb_search(tree, vd);
-  if (node != NULL)
+  basic_block_t **preds;
+  int i, total = 0;
+  for (i = 0; i < n; ++i)
     {
-      var_descr_t *vd2 = node->key;
-      rb_delete(tree, vd);
-      free_var_descr(vd2);
+      basic_block_t *block = order[i];
+      block->flow_data->preds_num = 0;
     }
-}
-
-static void update_live(rbtree_t *use, rbtree_t *def, var_t *var, int nud)
-{
-  var_key_t *vk = new_var_key(var);
-  rbnode_t *node;
-  var_descr_t *vd = new_var_descr();
-  vd->var = var;
-  vd->loc = NULL;
-  vd->nearest_use_dist = nud;
-  rb_delete_vk(def, vk);
-  free_var_key(vk);
-  node = rb_insert_if_absent(use, vd);
-  if (node != NULL)
+  for (i = 0; i < n; ++i)
+    {
+      basic_block_t *block = order[i];
+      if (block->child1 != NULL)
+        ++block->child1->flow_data->preds_num;
+      if (block->child2 != NULL && block->child2 != block->child1)
+        ++block->child2->flow_data->preds_num;
+    }
+  for (i = 0; i < n; ++i)
+    {
+      total += order[i]->flow_data->preds_num;
+    }
+  preds = xmalloc(total * sizeof(basic_block_t*) + 1);
+  total = 0;
+  for (i = 0; i < n; ++i)
     {
-      ((var_descr_t*)node->key)->nearest_use_dist = nud;
-      free_var_descr(vd);
+      flow_data_t *fd = order[i]->flow_data;
+      fd->preds = preds + total;
+      total += fd->preds_num;
+      fd->preds_num = 0;
     }
+  for (i = 0; i < n; ++i)
+    {
+      basic_block_t *block = order[i];
+      flow_data_t *fd;
+      if (block->child1 != NULL)
+        {
+          fd = block->child1->flow_data;
+          fd->preds[fd->preds_num++] = block;
+        }
+      if (block->child2 != NULL && block->child2 != block->child1)
+        {
+          fd = block->child2->flow_data;
+          fd->preds[fd->preds_num++] = block;
+        }
+    }
+  return preds;
 }
 
-// -------------------------------------------------------------------
-
-static bool changed;
-
-/* compute_in_out() updates the `in' and `out' sets for `block',
-   assuming that `node' represents some (part of) the `in' set of a
-   successor of `block'. Since in liveness analysis all the sets may
-   only get larger, all we need to do is to insert elements from
-   (subtree of) `node' into `out', if not already there, and also into
-   `in', if not killed by the block. */
-static void compute_in_out(basic_block_t *block, rbnode_t *node, rbnode_t *nil)
+/* Runs update() on the n blocks in order, and then on the
+   predecessors of every block for which update() returns true, until
+   nothing changes. The worklist is a queue holding every block at
+   most once. Returns the number of blocks processed. */
+static unsigned long run_worklist(basic_block_t **order, int n, bool (*update)(basic_block_t*))
 {
-  rbtree_t *out = block->flow_data->live_out;
-  rbtree_t *in = block->flow_data->live_in;
-  rbtree_t *def = block->flow_data->live_def;
-  while (node != nil)
+  basic_block_t **queue;
+  int head = 0, len = n, i;
+  unsigned long iterations = 0;
+  if (n == 0)
+    return 0;
+  queue = xmalloc(n * sizeof(basic_block_t*));
+  for (i = 0; i < n; ++i)
+    {
+      queue[i] = order[i];
+      order[i]->flow_data->queued = true;
+    }
+  while (len > 0)
     {
-      var_descr_t *vd = node->key;
-      var_key_t *vk = new_var_key(vd->var);
-      if (rb_search(def, vk) == NULL)
+      basic_block_t *block = queue[head];
+      flow_data_t *fd = block->flow_data;
+      head = (head + 1) % n;
+      --len;
+      fd->queued = false;
+      ++iterations;
+      if (update(block))
         {
-          rbnode_t *node2;
-          var_descr_t *vd2 = new_var_descr();
-          int nud;
-          vd2->var = vd->var;
-          vd2->loc = NULL;
-          vd2->nearest_use_dist = nud = vd->nearest_use_dist + block->flow_data->instr_num;
-          node2 = rb_insert_if_absent(in, vd2);
-          if (node2 != NULL)
+          for (i = 0; i < fd->preds_num; ++i)
             {
-              var_descr_t *vd3 = (var_descr_t*)node->key;
-              if (vd3->nearest_use_dist > nud)
+              basic_block_t *pred = fd->preds[i];
+              if (!pred->flow_data->queued)
                 {
-                  vd3->nearest_use_dist = nud;
+                  pred->flow_data->queued = true;
+                  queue[(head + len) % n] = pred;
+                  ++len;
                 }
-              free_var_descr(vd2);
             }
-          else
-            changed = true;
         }
-      if (rb_insert_if_absent(out, vk) != NULL)
-        free_var_key(vk);
-      if (node->right != nil)
-        compute_in_out(block, node->right, nil);
-      node = node->left;
     }
+  free(queue);
+  return iterations;
+}
+
+/* compute_in_out() updates the `in' and `out' sets for `block' with
+   the `in' set of its successor `child'. Since in liveness analysis
+   all the sets may only get larger, all we need to do is to add the
+   elements of child's `in' to `out', and also to `in', if not killed
+   by the block. Returns true if `in' has changed. */
+static bool compute_in_out(basic_block_t *block, basic_block_t *child)
+{
+  flow_data_t *fd = block->flow_data;
+  bitset_word_t *succ_in = child->flow_data->live_in;
+  bool changed = false;
+  size_t i;
+  for (i = 0; i < words; ++i)
+    {
+      bitset_word_t out = fd->live_out[i] | succ_in[i];
+      bitset_word_t in = fd->live_use[i] | (out & ~fd->live_def[i]);
+      fd->live_out[i] = out;
+      if (in != fd->live_in[i])
+        {
+          fd->live_in[i] = in;
+          changed = true;
+        }
+    }
+  return changed;
 }
 
-/* do_liveness() performs one iteration of the liveness analysis,
-   visiting nodes in depth-first order (which order improves
-   efficiency, according to Aho, Sethi, Ullman, "Compilers:
-   Principles, Techniques, and Tools"). */
-static void do_liveness(basic_block_t *block)
+static bool update_liveness(basic_block_t *block)
 {
-  basic_block_t *child1 = block->child1;
-  basic_block_t *child2 = block->child2;
-  visit(block);
-  if (child1 != NULL && !visited(child1))
-    do_liveness(child1);
-  if (child2 != NULL && !visited(child2))
-    do_liveness(child2);
-  if (child1 != NULL)
-    compute_in_out(block, child1->flow_data->live_in->root, child1->flow_data->live_in->nil);
-  if (child2 != NULL)
-    compute_in_out(block, child2->flow_data->live_in->root, child2->flow_data->live_in->nil);
+  bool changed = false;
+  if (block->child1 != NULL)
+    changed |= compute_in_out(block, block->child1);
+  if (block->child2 != NULL)
+    changed |= compute_in_out(block, block->child2);
+  return changed;
+}
+
+inline static void add_def(flow_data_t *fd, var_t *var)
+{
+  bitset_remove(fd->live_use, var->id);
+  bitset_add(fd->live_def, var->id);
+}
+
+inline static void add_use(flow_data_t *fd, var_t *var, int i)
+{
+  bitset_remove(fd->live_def, var->id);
+  bitset_add(fd->live_use, var->id);
+  first_use[var->id] = i;
 }
 
 static void compute_live_def_use(basic_block_t *block)
@@ -159,13 +254,13 @@ static void compute_live_def_use(basic_block_t *block)
   quadr_t **qstack;
   int qcap, qsize;
   int i;
+  long id;
   quadr_t *quadr;
-  rbtree_t *def;
-  rbtree_t *use;
   flow_data_t *fd = block->flow_data;
-  def = fd->live_def = rb_new();
-  use = fd->live_in = rb_new();
-  fd->live_out = rb_new();
+  fd->live_def = new_bitset(words);
+  fd->live_use = new_bitset(words);
+  fd->live_in = new_bitset(words);
+  fd->live_out = new_bitset(words);
 
   qstack = xmalloc(128 * sizeof(quadr_t*));
   qcap = 128;
@@ -188,101 +283,194 @@ static void compute_live_def_use(basic_block_t *block)
       quadr = qstack[i];
       if (quadr->result.tag == QA_VAR && assigned_in_quadr(quadr, quadr->result.u.var))
         {
-          var_t *var = quadr->result.u.var;
-          var_key_t *vk = new_var_key(var);
-          var_descr_t *vd = new_var_descr();
-          assert (var != NULL);
-          vd->var = var;
-          vd->loc = NULL;
-          vd->nearest_use_dist = i;
-          rb_delete_vd(use, vd);
-          free_var_descr(vd);
-          if (rb_insert_if_absent(def, vk) != NULL)
-            free_var_key(vk);
+          assert (quadr->result.u.var != NULL);
+          add_def(fd, quadr->result.u.var);
         }
       else if (quadr->result.tag == QA_VAR && used_in_quadr(quadr, quadr->result.u.var))
         {
-          var_t *var = quadr->result.u.var;
-          assert (var != NULL);
-          update_live(use, def, var, i); 
+          assert (quadr->result.u.var != NULL);
+          add_use(fd, quadr->result.u.var, i);
         }
       if (quadr->arg1.tag == QA_VAR)
         {
-          var_t *var = quadr->arg1.u.var;
-          assert (var != NULL);
-          update_live(use, def, var, i);
+          assert (quadr->arg1.u.var != NULL);
+          add_use(fd, quadr->arg1.u.var, i);
         }
       if (quadr->arg2.tag == QA_VAR)
         {
-          var_t *var = quadr->arg2.u.var;
-          assert (var != NULL);
-          update_live(use, def, var, i);
+          assert (quadr->arg2.u.var != NULL);
+          add_use(fd, quadr->arg2.u.var, i);
         }
     }
-
   free(qstack);
+
+  memcpy(fd->live_in, fd->live_use, words * sizeof(bitset_word_t));
+  fd->use_nud = xmalloc(bitset_count(fd->live_use, words) * sizeof(unsigned) + 1);
+  i = 0;
+  for (id = bitset_next(fd->live_use, words, 0); id >= 0;
+       id = bitset_next(fd->live_use, words, id + 1))
+    {
+      fd->use_nud[i++] = first_use[id];
+    }
 }
 
-static int make_live_at_end(basic_block_t *block, rbnode_t *node, rbnode_t *nil, int i)
+#define NUD_INFINITY UINT_MAX
+
+static void init_in_nud(basic_block_t *block)
 {
-  while (node != nil)
+  flow_data_t *fd = block->flow_data;
+  long id;
+  int i = 0, j = 0;
+  fd->in_size = bitset_count(fd->live_in, words);
+  fd->in_vars = xmalloc(fd->in_size * sizeof(int) + 1);
+  fd->in_nud = xmalloc(fd->in_size * sizeof(unsigned) + 1);
+  for (id = bitset_next(fd->live_in, words, 0); id >= 0;
+       id = bitset_next(fd->live_in, words, id + 1))
     {
-      assert (i < block->lsize);
-      block->live_at_end[i] = ((var_key_t*)node->key)->var;
+      fd->in_vars[i] = id;
+      if (bitset_contains(fd->live_use, id))
+        fd->in_nud[i] = fd->use_nud[j++];
+      else
+        fd->in_nud[i] = NUD_INFINITY;
       ++i;
-      if (node->left != nil)
+    }
+}
+
+/* Looks up the nearest use distance of the variable numbered id in
+   the `in' set of child, starting at position *pos. The lookups for
+   one child must be made in increasing order of ids. */
+inline static unsigned child_nud(basic_block_t *child, int id, int *pos)
+{
+  flow_data_t *fd;
+  if (child == NULL)
+    return NUD_INFINITY;
+  fd = child->flow_data;
+  while (*pos < fd->in_size && fd->in_vars[*pos] < id)
+    ++*pos;
+  if (*pos < fd->in_size && fd->in_vars[*pos] == id)
+    return fd->in_nud[*pos];
+  return NUD_INFINITY;
+}
+
+/* Relaxes the nearest use distances of the variables live at the
+   beginning of block with those of its successors. Returns true if
+   any of them has changed. */
+static bool compute_in_nud(basic_block_t *block)
+{
+  flow_data_t *fd = block->flow_data;
+  bool changed = false;
+  int pos1 = 0, pos2 = 0;
+  int i;
+  for (i = 0; i < fd->in_size; ++i)
+    {
+      int id = fd->in_vars[i];
+      unsigned nud1, nud2, nud;
+      if (bitset_contains(fd->live_use, id))
+        continue;
+      nud1 = child_nud(block->child1, id, &pos1);
+      nud2 = child_nud(block->child2, id, &pos2);
+      nud = nud1 < nud2 ? nud1 : nud2;
+      if (nud != NUD_INFINITY && nud + fd->instr_num < fd->in_nud[i])
         {
-          if (node->right != nil)
-            {
-              i = make_live_at_end(block, node->left, nil, i);
-              node = node->right;
-            }
-          else
-            node = node->left;
+          fd->in_nud[i] = nud + fd->instr_num;
+          changed = true;
         }
-      else
-        node = node->right;
     }
-  return i;
+  return changed;
 }
 
 static void finish_liveness_computation(basic_block_t *block)
 {
-  int s;
   flow_data_t *fd = block->flow_data;
-  block->vars_at_start = fd->live_in;
-  block->lsize = rb_size(fd->live_out);
+  rbtree_t *in = rb_new();
+  long id;
+  int i;
+  for (i = 0; i < fd->in_size; ++i)
+    {
+      var_descr_t *vd = new_var_descr();
+      vd->var = vars[fd->in_vars[i]];
+      vd->loc = NULL;
+      vd->nearest_use_dist = fd->in_nud[i];
+      rb_insert(in, vd);
+    }
+  block->vars_at_start = in;
+  block->lsize = bitset_count(fd->live_out, words);
   block->live_at_end = xmalloc(block->lsize * sizeof(var_t*));
-  s = make_live_at_end(block, fd->live_out->root, fd->live_out->nil, 0);
-  assert (s == rb_size(fd->live_out));
-
-  rb_free(fd->live_def);
-  rb_free(fd->live_out);
-  fd->live_def = NULL;
-  fd->live_out = NULL;
-  fd->live_in = NULL;
+  i = 0;
+  for (id = bitset_next(fd->live_out, words, 0); id >= 0;
+       id = bitset_next(fd->live_out, words, id + 1))
+    {
+      block->live_at_end[i++] = vars[id];
+    }
+  assert (i == block->lsize);
+
+  free_bitset(fd->live_def);
+  free_bitset(fd->live_use);
+  free_bitset(fd->live_in);
+  free_bitset(fd->live_out);
+  free(fd->use_nud);
+  free(fd->in_vars);
+  free(fd->in_nud);
+  fd->live_def = fd->live_use = fd->live_in = fd->live_out = NULL;
+  fd->use_nud = fd->in_nud = NULL;
+  fd->in_vars = NULL;
+  fd->in_size = 0;
 }
 
-static void analyze_liveness(basic_block_t *root)
+static void analyze_liveness(quadr_func_t *func)
 {
-  // compute def and use
+  basic_block_t *root = func->blocks;
   basic_block_t *block;
-  var_key_pool = new_pool(512, sizeof(var_key_t));
+  basic_block_t **order;
+  basic_block_t **preds;
+  int blocks_num, order_num, i;
+  vars_node_t *node;
+
+  // number the variables
+  words = BITSET_WORDS(func->vars_num);
+  vars = xmalloc(func->vars_num * sizeof(var_t*) + 1);
+  first_use = xmalloc(func->vars_num * sizeof(unsigned) + 1);
+  node = func->vars_lst.head;
+  while (node != NULL)
+    {
+      for (i = 0; i <= node->last_var; ++i)
+        {
+          var_t *var = &node->vars[i];
+          assert (var->id >= 0 && var->id < func->vars_num);
+          vars[var->id] = var;
+        }
+      node = node->next;
+    }
+
+  // compute def and use
+  blocks_num = 0;
   block = root;
   while (block != NULL)
     {
       compute_live_def_use(block);
+      ++blocks_num;
       block = block->next;
     }
 
-  // do the liveness analysis in depth-first order
-  changed = true;
-  while (changed)
+  /* Liveness is a backward problem, so the blocks are processed in
+     postorder (successors first), and a block is revisited only when
+     the `in' set of one of its successors changes. Blocks unreachable
+     from the root are left out. */
+  order = xmalloc(blocks_num * sizeof(basic_block_t*));
+  order_num = compute_postorder(root, order);
+  preds = compute_preds(order, order_num);
+  stats_add(liveness_iterations, run_worklist(order, order_num, update_liveness));
+
+  // compute the nearest use distances
+  block = root;
+  while (block != NULL)
     {
-      changed = false;
-      begin_traversal();
-      do_liveness(root);
+      init_in_nud(block);
+      block = block->next;
     }
+  stats_add(nud_iterations, run_worklist(order, order_num, compute_in_nud));
+  free(order);
+  free(preds);
 
   // finish
   block = root;
@@ -291,7 +479,10 @@ static void analyze_liveness(basic_block_t *root)
       finish_liveness_computation(block);
       block = block->next;
     }
-  free_pool(var_key_pool);
+  free(vars);
+  free(first_use);
+  vars = NULL;
+  first_use = NULL;
 }
 
 // -------------------------------------------------------------------
@@ -303,6 +494,8 @@ void create_block_graph(quadr_func_t *func)
   while (block != NULL)
     {
       quadr_t *last = block->lst.tail;
+      // the graph may have been traversed before
+      block->visited_mark = 0;
       if (last != NULL)
         {
           switch (last->op){
@@ -337,23 +530,16 @@ void create_block_graph(quadr_func_t *func)
     }
 }
 
-void analyze_flow(quadr_func_t *func)
+/* Computes vars_at_start and live_at_end of every block. */
+static void compute_liveness(quadr_func_t *func)
 {
-  basic_block_t *block;
-
-  if (func->blocks == NULL)
-    return;
-
-  block = func->blocks;
+  basic_block_t *block = func->blocks;
   while (block != NULL)
     {
       block->flow_data = new_flow_data();
       block = block->next;
     }
-
-  analyze_liveness(func->blocks);
-  perform_global_optimizations(func);
-
+  analyze_liveness(func);
   block = func->blocks;
   while (block != NULL)
     {
@@ -362,3 +548,55 @@ void analyze_flow(quadr_func_t *func)
       block = block->next;
     }
 }
+
+static void free_liveness(quadr_func_t *func)
+{
+  basic_block_t *block = func->blocks;
+  while (block != NULL)
+    {
+      // blocks added by the optimizations have no live sets
+      if (block->vars_at_start != NULL)
+        {
+          rb_for_each(block->vars_at_start, (void (*)(rb_key_t)) free_var_descr);
+          rb_free(block->vars_at_start);
+        }
+      free(block->live_at_end);
+      block->vars_at_start = NULL;
+      block->live_at_end = NULL;
+      block->lsize = 0;
+      block = block->next;
+    }
+}
+
+void analyze_flow(quadr_func_t *func)
+{
+  basic_block_t *block;
+  unsigned long blocks_num = 0;
+
+  if (func->blocks == NULL)
+    return;
+
+  for (block = func->blocks; block != NULL; block = block->next)
+    ++blocks_num;
+  stats_add(funcs, 1);
+  stats_add(blocks, blocks_num);
+  stats_add(vars, func->vars_num);
+
+  compute_liveness(func);
+  if (f_optimize_global)
+    {
+      bool changed;
+      timer_push(PHASE_GLOBAL_OPT);
+      changed = perform_global_optimizations(func);
+      timer_pop();
+      if (changed)
+        {
+          /* The optimizations may have removed blocks, changed jumps
+             and added variables, so the graph and the live sets are
+             computed anew. */
+          free_liveness(func);
+          create_block_graph(func);
+          compute_liveness(func);
+        }
+    }
+}
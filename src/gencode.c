@@ -6,36 +6,40 @@
 #include "mem.h"
 #include "quadr.h"
 #include "gencode.h"
+#include "timer.h"
 
 #define INIT_LOCS 2048
 #define INIT_STACK 1024
 
-static stack_elem_t *stack;
-static int stack_size; // the number of bytes the stack currently
-                       // occupies (in the generated code)
-static int max_stack_size; // maximum stack size
-static stack_elem_t *first_stack_free;
+static __thread stack_elem_t *stack;
+static __thread int stack_size; // the number of bytes the stack currently
+                                // occupies (in the generated code)
+static __thread int max_stack_size; // maximum stack size
+static __thread stack_elem_t *first_stack_free;
 // the first element in the stack that is not occupied; if there is no such
 // position then NULL
 
-static quadr_t *cur_quadr;
-static basic_block_t *cur_block;
+static __thread quadr_t *cur_quadr;
+static __thread basic_block_t *cur_block;
 
-static var_list_t **regs; // variables in general-purpose registers
-static var_list_t **fpu_regs; // variables in FPU registers
+static __thread var_list_t **regs; // variables in general-purpose registers
+static __thread var_list_t **fpu_regs; // variables in FPU registers
 
-static bool *blacklist_reg;
-static bool *blacklist_fpu_reg;
+static __thread bool *blacklist_reg;
+static __thread bool *blacklist_fpu_reg;
 
-static pool_t *loc_pool = NULL;
-static pool_t *stack_elem_pool = NULL;
+static __thread pool_t *loc_pool = NULL;
+static __thread pool_t *stack_elem_pool = NULL;
 
 backend_t *backend;
+__thread FILE *gencode_fout;
 
 void gencode_init()
 {
   loc_pool = new_pool(INIT_LOCS, sizeof(loc_t));
   stack_elem_pool = new_pool(INIT_STACK, sizeof(stack_elem_t));
+  loc_pool->name = "variable locations";
+  stack_elem_pool->name = "stack elements";
   regs = xmalloc(backend->reg_num * sizeof(var_list_t*));
   fpu_regs = xmalloc(backend->fpu_reg_num * sizeof(var_list_t*));
   blacklist_reg = xmalloc(backend->reg_num * sizeof(bool));
@@ -44,10 +48,12 @@ void gencode_init()
   memset(fpu_regs, 0, backend->fpu_reg_num * sizeof(var_list_t*));
   memset(blacklist_reg, 0, backend->reg_num * sizeof(bool));
   memset(blacklist_fpu_reg, 0, backend->fpu_reg_num * sizeof(bool));
+  backend->init_thread();
 }
 
 void gencode_cleanup()
 {
+  backend->final_thread();
   free_pool(loc_pool);
   free_pool(stack_elem_pool);
   free(regs);
@@ -58,10 +64,11 @@ void gencode_cleanup()
 
 static bool should_save_var(var_t *var, loc_t *loc2);
 static void move_to_reg_if_sensible(var_t *var);
+static bool should_keep_loc(loc_t *loc);
 
 // ---------------------------------------------------------------
 
-static quadr_func_t *gencode_cur_func;
+static __thread quadr_func_t *gencode_cur_func;
 static bool gencode_invariant()
 {
   vars_node_t *node = gencode_cur_func->vars_lst.head;
@@ -304,9 +311,11 @@ static stack_elem_t *stack_insert_new(var_t *var)
   int vsize = var->size;
   stack_elem_t *se = first_stack_free;
   assert (se != NULL);
-  assert (se->size <= vsize);
   assert (se->vars == NULL);
-  while ((se->size < vsize || se->vars != NULL) && se->size != -1)
+  // the first free element need not have the right size, e.g. it
+  // may have been freed by a double while an int is inserted; all
+  // variables in an element must have its size (see stack_insert())
+  while ((se->size != vsize || se->vars != NULL) && se->size != -1)
     {
       se = se->next;
       assert (se != NULL);
@@ -329,7 +338,7 @@ static stack_elem_t *stack_insert_new(var_t *var)
       se->size = vsize;
     }
   assert (se->vars == NULL);
-  assert (se->size >= vsize);
+  assert (se->size == vsize);
   se->vars = new_var_list();
   se->vars->next = NULL;
   se->vars->var = var;
@@ -448,7 +457,7 @@ static void loc_erase_stack(var_t *var, stack_elem_t *se)
 
 // -------------------------------------------------------------------
 
-static bool suppress_mov = false;
+static __thread bool suppress_mov = false;
 
 inline static void gen_mov_var(loc_t *loc, var_t *var)
 {
@@ -620,7 +629,23 @@ static void block_var_hint(var_t *var, basic_block_t *block)
     }
 }
 
-static void save_var_at_block_end(var_t *var, basic_block_t *block)
+/* Returns true if the location of var at the start of child is already
+   fixed. */
+static bool child_loc_given(var_t *var, basic_block_t *child)
+{
+  var_descr_t svd;
+  rbnode_t *node;
+  if (child == NULL)
+    return false;
+  svd.var = var;
+  node = rb_search(child->vars_at_start, &svd);
+  return node != NULL && ((var_descr_t*)node->key)->loc != NULL;
+}
+
+/* If given is true, moves var to the locations the children of the
+   block expect it in, otherwise records its current locations for the
+   children which do not yet expect it anywhere. */
+static void save_var_at_block_end(var_t *var, basic_block_t *block, bool given)
 {
   basic_block_t *child1 = block->child1;
   basic_block_t *child2 = block->child2;
@@ -633,18 +658,15 @@ static void save_var_at_block_end(var_t *var, basic_block_t *block)
   assert ((child1 != NULL && rb_search(child1->vars_at_start, &svd) != NULL) ||
           (child2 != NULL && rb_search(child2->vars_at_start, &svd) != NULL));
 
-  ensure_unique(var);
   if (child1 != NULL && check_mark(child1->mark, MARK_GENERATED))
     {
-      update_child_vars(var, child1);
-      update_child_vars(var, child2);
-    }
-  else
-    {
-      update_child_vars(var, child2);
-      update_child_vars(var, child1);
+      swap(child1, child2, basic_block_t*);
     }
-  if (block->lst.head != NULL)
+  if (child_loc_given(var, child2) == given)
+    update_child_vars(var, child2);
+  if (child_loc_given(var, child1) == given)
+    update_child_vars(var, child1);
+  if (!given && block->lst.head != NULL)
     {
       quadr_op_t last_op = block->lst.tail->op;
       if ((last_op == Q_GOTO || last_op == Q_RETURN) && next != NULL)
@@ -654,6 +676,79 @@ static void save_var_at_block_end(var_t *var, basic_block_t *block)
     }
 }
 
+/* Returns true if var is in all the locations child expects it in. */
+static bool var_in_child_locs(var_t *var, basic_block_t *child)
+{
+  var_descr_t svd;
+  rbnode_t *node;
+  loc_t *loc;
+  if (child == NULL)
+    return true;
+  svd.var = var;
+  node = rb_search(child->vars_at_start, &svd);
+  if (node == NULL)
+    return true;
+  loc = ((var_descr_t*)node->key)->loc;
+  while (loc != NULL)
+    {
+      if (find_loc(var->loc, loc) == NULL)
+        return false;
+      loc = loc->next;
+    }
+  return true;
+}
+
+/* Returns true if the variables live at the end of the block are in
+   all the locations its children expect them in. */
+static bool live_vars_in_place(basic_block_t *block)
+{
+  int i;
+  for (i = 0; i < block->lsize; ++i)
+    {
+      var_t *var = block->live_at_end[i];
+      if (!var_in_child_locs(var, block->child1) ||
+          !var_in_child_locs(var, block->child2))
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+static int allowed_regs_num(loc_tag_t reg_tag)
+{
+  int i;
+  int count = 0;
+  int num = reg_tag == LOC_REG ? backend->reg_num : backend->fpu_reg_num;
+  for (i = 0; i < num; ++i)
+    {
+      if (is_allowed(i, reg_tag))
+        ++count;
+    }
+  return count;
+}
+
+/* Denies the registers var is in, so that the scratch registers of
+   later moves at the block end do not evict it from the place the
+   children expect it in. The denied registers are marked in kept and
+   kept_fpu. One register of each kind is always left allowed. */
+static void keep_var_at_block_end(var_t *var, bool *kept, bool *kept_fpu)
+{
+  loc_t *loc = var->loc;
+  while (loc != NULL)
+    {
+      if (should_keep_loc(loc) && allowed_regs_num(loc->tag) > 1)
+        {
+          deny_reg(loc->u.reg, loc->tag);
+          if (loc->tag == LOC_REG)
+            kept[loc->u.reg] = true;
+          else
+            kept_fpu[loc->u.fpu_reg] = true;
+        }
+      loc = loc->next;
+    }
+}
+
 inline static void assign_var_to_loc(var_t *var)
 {
   suppress_mov = true;
@@ -661,41 +756,76 @@ inline static void assign_var_to_loc(var_t *var)
   suppress_mov = false;
 }
 
-// initialize register/memory location descriptions
-static void init_descr(rbnode_t *node, rbnode_t *nil)
+// vars_at_start of the block being generated, collected by rb_for_each()
+static __thread var_descr_t **cur_descrs;
+static __thread int cur_descrs_num;
+
+static void collect_var_descr(rb_key_t key)
+{
+  cur_descrs[cur_descrs_num++] = (var_descr_t*) key;
+}
+
+static int compare_var_descrs(const void *x, const void *y)
 {
-  while (node != nil)
+  int id1 = (*(var_descr_t* const*) x)->var->id;
+  int id2 = (*(var_descr_t* const*) y)->var->id;
+  return id1 < id2 ? -1 : (id1 > id2 ? 1 : 0);
+}
+
+/* Initializes register/memory location descriptions. The variables
+   whose locations at the start of the block are given must be placed
+   first, so that the locations assigned to the others do not take
+   theirs. The variables are visited in the order of their ids, as the
+   tree is ordered by their addresses, which differ from run to run. */
+static void init_descr(basic_block_t *block)
+{
+  int i;
+  unsigned n = rb_size(block->vars_at_start);
+  if (n == 0)
+    return;
+  cur_descrs = xmalloc(n * sizeof(var_descr_t*));
+  cur_descrs_num = 0;
+  rb_for_each(block->vars_at_start, collect_var_descr);
+  qsort(cur_descrs, cur_descrs_num, sizeof(var_descr_t*), compare_var_descrs);
+  for (i = 0; i < cur_descrs_num; ++i)
+    {
+      var_descr_t *vd = cur_descrs[i];
+      loc_t *loc = vd->loc;
+      assert (vd->var->live);
+      while (loc != NULL)
+        {
+          update_var_loc(vd->var, loc);
+          loc = loc->next;
+        }
+    }
+  for (i = 0; i < cur_descrs_num; ++i)
     {
-      var_descr_t *vd = (var_descr_t*)node->key;
+      var_descr_t *vd = cur_descrs[i];
       var_t *var = vd->var;
-      assert (var->live);
-      if (vd->loc != NULL)
+      if (vd->loc == NULL)
         {
-          loc_t *loc = vd->loc;
-          while (loc != NULL)
+          if (loc_empty(var->loc))
             {
-              update_var_loc(var, loc);
-              loc = loc->next;
+              /* assign some location */
+              assign_var_to_loc(var);
             }
+          /* The code of the block expects the variable there, so
+             the blocks jumping here which are generated later must
+             put it there (see update_child_vars()). */
+          vd->loc = copy_loc(var->loc);
         }
-      else if (loc_empty(var->loc))
-        {
-          /* assign some location */
-          assign_var_to_loc(var);
-        }
-      if (node->left != nil)
-        {
-          init_descr(node->left, nil);
-        }
-      node = node->right;
     }
+  free(cur_descrs);
 }
 
-static bool live_vars_saved = false;
+static __thread bool live_vars_saved = false;
 
 void save_live()
 {
   int i;
+  int pass;
+  bool *kept;
+  bool *kept_fpu;
   basic_block_t *block = cur_block;
   for (i = 0; i < block->lsize; ++i)
     {
@@ -704,8 +834,60 @@ void save_live()
     }
   for (i = 0; i < block->lsize; ++i)
     {
-      assert (block->live_at_end[i]->live);
-      save_var_at_block_end(block->live_at_end[i], block);
+      ensure_unique(block->live_at_end[i]);
+    }
+  /* Moving a variable to the location a child expects it in may flush
+     other variables from there, so all such moves must precede
+     recording the current locations of variables for the children.
+     The registers of the variables already moved are kept, but a
+     scratch register may still evict one of them, in which case the
+     moves are repeated. */
+  kept = xmalloc(backend->reg_num * sizeof(bool));
+  kept_fpu = xmalloc(backend->fpu_reg_num * sizeof(bool));
+  memset(kept, 0, backend->reg_num * sizeof(bool));
+  memset(kept_fpu, 0, backend->fpu_reg_num * sizeof(bool));
+  pass = 0;
+  do
+    {
+      for (i = 0; i < block->lsize; ++i)
+        {
+          var_t *var = block->live_at_end[i];
+          assert (var->live);
+          save_var_at_block_end(var, block, true);
+          keep_var_at_block_end(var, kept, kept_fpu);
+        }
+      if (pass == 0)
+        {
+          /* Constants are given a location for the other children
+             now, as this may evict variables too. */
+          for (i = 0; i < block->lsize; ++i)
+            {
+              var_t *var = block->live_at_end[i];
+              if (var->loc->next == NULL && loc_is_const(var->loc))
+                {
+                  save_var(var);
+                  keep_var_at_block_end(var, kept, kept_fpu);
+                }
+            }
+        }
+      ++pass;
+    }
+  while (pass <= block->lsize && !live_vars_in_place(block));
+  for (i = 0; i < backend->reg_num; ++i)
+    {
+      if (kept[i])
+        allow_reg(i, LOC_REG);
+    }
+  for (i = 0; i < backend->fpu_reg_num; ++i)
+    {
+      if (kept_fpu[i])
+        allow_reg(i, LOC_FPU_REG);
+    }
+  free(kept);
+  free(kept_fpu);
+  for (i = 0; i < block->lsize; ++i)
+    {
+      save_var_at_block_end(block->live_at_end[i], block, false);
     }
   live_vars_saved = true;
 }
@@ -724,7 +906,7 @@ typedef struct{
   char mark;
 } quadr_data_t;
 
-static var_list_t *var_lst = NULL;
+static __thread var_list_t *var_lst = NULL;
 
 static void gencode_for_quadr(quadr_t *quadr)
 {
@@ -857,11 +1039,14 @@ static void gencode_for_block(basic_block_t *block)
       quadr = qdstack[i].quadr = qstack[i];
       qdstack[i].mark = 0;
       // compare: flow.c::analyze_liveness()
-      if (quadr->result.tag == QA_VAR && assigned_in_quadr(quadr, quadr->result.u.var) &&
-          quadr->result.u.var->live)
+      if (quadr->result.tag == QA_VAR && assigned_in_quadr(quadr, quadr->result.u.var))
         {
-          set_mark(qdstack[i].mark, MARK_RESULT_CHANGED);
-          quadr->result.u.var->live = false;
+          // a dead assignment, e.g. x := x / y with x dead, changes nothing
+          if (quadr->result.u.var->live)
+            {
+              set_mark(qdstack[i].mark, MARK_RESULT_CHANGED);
+              quadr->result.u.var->live = false;
+            }
         }
       else if (quadr->result.tag == QA_VAR && used_in_quadr(quadr, quadr->result.u.var) &&
                !quadr->result.u.var->live)
@@ -885,7 +1070,7 @@ static void gencode_for_block(basic_block_t *block)
   // initialize register/memory location descriptions
   assert (block->vars_at_start != NULL);
   // init_descr_global_data(); not necessary
-  init_descr(block->vars_at_start->root, block->vars_at_start->nil);
+  init_descr(block);
 
   // generate code
   live_vars_saved = false;
@@ -1050,7 +1235,9 @@ void gencode(quadr_func_t *func)
     }
   if (max_stack_size == -1)
     max_stack_size = 0;
+  timer_push(PHASE_END_FUNC);
   backend->end_func(func, max_stack_size);
+  timer_pop();
 
   // free the stack
   while (stack != NULL)
@@ -1060,13 +1247,15 @@ void gencode(quadr_func_t *func)
       pfree(stack_elem_pool, stack);
       stack = next;
     }
+  // the locations of the variables are not needed any more
+  reset_pool(loc_pool);
 }
 
 // ---------------------------------------------------------------
 
 #define MAX_LABEL_SIZE 256
 
-static char strbuf[MAX_LABEL_SIZE + 1];
+static __thread char strbuf[MAX_LABEL_SIZE + 1];
 
 char *get_label_for_block(basic_block_t *block)
 {
@@ -1080,7 +1269,7 @@ char *get_label_for_block(basic_block_t *block)
 void discard_const(var_t *var)
 {
   loc_t *loc;
-  loc_t *prev;
+  loc_t *prev = NULL;
   loc = var->loc;
   while (loc != NULL)
     {
@@ -1327,6 +1516,32 @@ void flush_loc(loc_t *loc)
   };
 }
 
+/* Returns true if the register location loc should be kept by
+   flush_loc_keeping(). The FPU registers of a stack-based FPU are not
+   allocated freely, so they need not be kept. */
+static bool should_keep_loc(loc_t *loc)
+{
+  if (loc == NULL || !loc_is_allowed(loc))
+    return false;
+  return loc->tag == LOC_REG || (loc->tag == LOC_FPU_REG && !backend->fpu_stack);
+}
+
+void flush_loc_keeping(loc_t *loc, loc_t *keep1, loc_t *keep2)
+{
+  bool deny1 = should_keep_loc(keep1);
+  bool deny2;
+  if (deny1)
+    deny_reg(keep1->u.reg, keep1->tag);
+  deny2 = should_keep_loc(keep2);
+  if (deny2)
+    deny_reg(keep2->u.reg, keep2->tag);
+  flush_loc(loc);
+  if (deny1)
+    allow_reg(keep1->u.reg, keep1->tag);
+  if (deny2)
+    allow_reg(keep2->u.reg, keep2->tag);
+}
+
 void save_var_to_loc(var_t *var, loc_t *loc)
 {
   bool found = false;
@@ -1430,11 +1645,13 @@ static bool should_save_var(var_t *var, loc_t *loc2)
     sloc.tag = loc_tag;                                 \
     switch (loc_tag){                                   \
     case LOC_STACK:                                     \
-      sloc.u.stack_elem = (stack_elem_t*)x;             \
+      sloc.u.stack_elem = (stack_elem_t*) (x);          \
+      break;                                            \
     case LOC_REG:                                       \
-      sloc.u.fpu_reg = (int) x;                         \
+      sloc.u.reg = (reg_t) (x);                         \
+      break;                                            \
     case LOC_FPU_REG:                                   \
-      sloc.u.reg = (int) x;                             \
+      sloc.u.fpu_reg = (reg_t) (x);                     \
       break;                                            \
     default:                                            \
       xabort("programming error - FILL_SLOC()");        \
@@ -1451,7 +1668,7 @@ static bool should_save_var(var_t *var, loc_t *loc2)
       FILL_SLOC(sloc, x, loc_tag);                      \
       if (should_save_var(var, &sloc))                  \
         {                                               \
-          save_var(var);                                \
+          save_var_not_to_loc(var, &sloc);              \
         }                                               \
       erase(var, x);                                    \
       vl = vl->next;                                    \
@@ -1470,7 +1687,7 @@ static bool should_save_var(var_t *var, loc_t *loc2)
           FILL_SLOC(sloc, x, loc_tag);                          \
           if (should_save_var(vl->var, &sloc))                  \
             {                                                   \
-              save_var(vl->var);                                \
+              save_var_not_to_loc(vl->var, &sloc);              \
             }                                                   \
           erase(vl->var, x);                                    \
           next = vl->next;                                      \
@@ -1885,6 +2102,9 @@ void ensure_unique_for_var(var_t *var, loc_t *loc)
   var_list_t *prev;
   assert (find_loc(var->loc, loc) != NULL);
   loc_remove_loc(var, loc);
+  // var must also be removed from the descriptions of its other
+  // locations
+  discard_var(var);
   free_loc(var->loc);
   var->loc = loc;
   loc->next = NULL;
@@ -2311,7 +2531,7 @@ static reg_t do_bellady_ra(var_list_t **regs, size_t regs_num, loc_tag_t reg_tag
             assert (count >= 1);
             // we should not remove a variable from a register if it
             // is used in the current instruction
-            if (used_in_quadr(cur_quadr, var) && count == 1)
+            if (cur_quadr != NULL && used_in_quadr(cur_quadr, var) && count == 1)
               {
                 for_next = true;
                 break;
@@ -2376,7 +2596,7 @@ static reg_t do_bellady_ra(var_list_t **regs, size_t regs_num, loc_tag_t reg_tag
               break;
             }
         }
-      assert (best_i > -1);
+      assert (best_i < regs_num);
       return best_i;
     }
 }
@@ -46,18 +46,26 @@ void free_loc(loc_t *loc);
 
 typedef struct{
   /* init() - initialization; should clear backend state, prepare it
-     for handling new input, generate some headers if need be, etc. */
-  void (*init)();
+     for handling new input, generate some headers if need be, etc.;
+     returns NULL, or an error message if the data files of the
+     backend cannot be read */
+  const char *(*init)();
   /* final() - should finalize backend - flush all data to be written,
      etc. */
   void (*final)();
+  /* init_thread() and final_thread() - create and free the state
+     needed to generate code for functions; called by gencode_init()
+     and gencode_cleanup() in every thread that generates code. */
+  void (*init_thread)();
+  void (*final_thread)();
 
   /* start_func() should initialize locations of all variables; in
      particular, it should set parameter locations appropriately; it
      should also generate function prologue - initialize a frame
      pointer (fp) and save the old one */
   void (*start_func)(quadr_func_t *func);
-  /* end_func() should generate function epilogue */
+  /* end_func() should generate function epilogue, and write out the
+     code of the function to gencode_fout */
   void (*end_func)(quadr_func_t *func, size_t stack_size);
 
   /* IMPORTANT NOTE: It is the responsibility of the backend to call
@@ -161,7 +169,12 @@ typedef struct{
 /* Public */
 
 extern backend_t *backend;
+/* The stream the code of the current function is written to. It is
+   backend->fout unless the functions are compiled in parallel. */
+extern __thread FILE *gencode_fout;
 
+/* gencode_init() and gencode_cleanup() must be called in every thread
+   that generates code. */
 void gencode_init();
 void gencode_cleanup();
 
@@ -331,6 +344,11 @@ inline static void move_to_mem(var_t *var)
    `free'. In case of loc->tag == LOC_FPU_REG, the backend function
    fpu_reg_free() is _not_ called. */
 void flush_loc(loc_t *loc);
+/* Same as flush_loc(), but the variables are not saved to the
+   registers keep1 and keep2 (either may be NULL). Used for the
+   locations of the arguments of the current instruction, which may be
+   free already if the arguments die in it. */
+void flush_loc_keeping(loc_t *loc, loc_t *keep1, loc_t *keep2);
 
 /* Returns the number of currently available (free and not `denied')
    registers. */
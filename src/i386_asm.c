@@ -0,0 +1,2218 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "mem.h"
+#include "elf_obj.h"
+#include "i386_asm.h"
+
+/* The text is assembled in one pass into the bytes of the sections.
+   Jumps to labels are recorded in place of their code and get their
+   final (short or near) form when all the labels are known: all jumps
+   start short, and a jump which does not reach its target becomes
+   near, until nothing changes. Since this only lengthens the code, it
+   terminates. A position in the section before the jumps are laid out
+   is mapped to the final one by adding the growth of the jumps before
+   it.
+
+   In 64-bit mode (for the x86-64 backend) the registers r8-r15 and
+   the 64-bit operands are encoded with the REX prefix, and [rel sym]
+   addresses a symbol relative to the next instruction. */
+
+#define MAX_LINE_LEN 1024
+#define MAX_OPERANDS 3
+#define SYMS_SIZE 1024
+
+#define SEC_TEXT 0
+#define SEC_DATA 1
+#define SECS_NUM 2
+
+#define SEC_UNDEF -1
+
+// the condition code of an unconditional jump
+#define CC_ALWAYS 0x10
+
+// hardware register numbers
+#define R_EAX 0
+#define R_ECX 1
+#define R_EDX 2
+#define R_EBX 3
+#define R_ESP 4
+#define R_EBP 5
+#define R_ESI 6
+#define R_EDI 7
+#define R_NONE -1
+
+typedef enum{ OP_NONE, OP_REG, OP_FPU_REG, OP_XMM_REG, OP_IMM, OP_MEM } opd_tag_t;
+
+typedef struct{
+  opd_tag_t tag;
+  int size; // in bytes, 0 if not known
+  int reg;
+  // a memory operand is [base + scale * index + disp + sym]
+  int base;
+  int index;
+  int scale;
+  int disp; // or the value of an immediate (plus sym)
+  int sym; // -1 if none
+  bool rip; // [rel sym]
+} opd_t;
+
+typedef struct{
+  size_t pos; // of the 2-byte placeholder of the short form
+  int sym;
+  unsigned char cc;
+  bool near;
+} jump_t;
+
+/* A 32-bit field in the code which holds the address of sym (plus the
+   value already in the field), or its distance from the field if the
+   kind is not ELF_ABS32. */
+typedef struct{
+  size_t pos;
+  int sym;
+  elf_reloc_kind_t kind;
+} fixup_t;
+
+typedef struct{
+  unsigned char *data;
+  size_t size;
+  size_t cap;
+  jump_t *jumps;
+  size_t jumps_num;
+  size_t jumps_size;
+  fixup_t *fixups;
+  size_t fixups_num;
+  size_t fixups_size;
+  size_t *growth; // growth[k] is the growth of the first k jumps
+} section_t;
+
+typedef struct{
+  char *name;
+  int section; // SEC_UNDEF if not (yet) defined
+  size_t pos;
+  bool global;
+  bool external;
+  bool used;
+  int elf_sym;
+} sym_t;
+
+typedef struct Asm{
+  section_t secs[SECS_NUM];
+  int cur_sec;
+  strtab_t *names; // symbol name -> index into syms
+  strtab_t *mnemonics; // name -> const mnemonic_t*
+  sym_t *syms;
+  int syms_num;
+  int syms_size;
+  const char *last_label; // for NASM's local labels (.name)
+  int line_num;
+  bool failed;
+  bool x86_64;
+  long rip_field; // the position of the [rel sym] field of the instruction, or -1
+} asm_t;
+
+typedef struct{
+  const char *name;
+  void (*encode)(struct Asm *as, opd_t *opds, int n, int arg);
+  int arg;
+} mnemonic_t;
+
+static void asm_error(asm_t *as, const char *format, ...)
+{
+  va_list ap;
+  if (as->failed)
+    return;
+  if (as->line_num > 0)
+    fprintf(stderr, "%s: assembler error, line %d: ", cur_filename, as->line_num);
+  else
+    fprintf(stderr, "%s: assembler error: ", cur_filename);
+  va_start(ap, format);
+  vfprintf(stderr, format, ap);
+  va_end(ap);
+  fprintf(stderr, "\n");
+  as->failed = true;
+}
+
+//--------------------------------------------------------------------
+
+/* symbols */
+
+static int get_sym(asm_t *as, const char *name, size_t len)
+{
+  char buf[MAX_LINE_LEN];
+  char *str;
+  int *pind;
+  if (*name == '.' && as->last_label != NULL)
+    {
+      // a local label belongs to the last non-local one
+      size_t n = strlen(as->last_label);
+      if (n + len >= MAX_LINE_LEN)
+        {
+          asm_error(as, "label too long");
+          return 0;
+        }
+      memcpy(buf, as->last_label, n);
+      memcpy(buf + n, name, len);
+      name = buf;
+      len += n;
+    }
+  if (add_strn(as->names, name, len, &str, (void**) &pind))
+    {
+      sym_t *sym;
+      if (as->syms_num == as->syms_size)
+        {
+          as->syms_size <<= 1;
+          as->syms = xrealloc(as->syms, as->syms_size * sizeof(sym_t));
+        }
+      sym = &as->syms[as->syms_num];
+      sym->name = str;
+      sym->section = SEC_UNDEF;
+      sym->pos = 0;
+      sym->global = false;
+      sym->external = false;
+      sym->used = false;
+      sym->elf_sym = -1;
+      *pind = as->syms_num++;
+    }
+  return *pind;
+}
+
+static void define_label(asm_t *as, const char *name, size_t len)
+{
+  int i = get_sym(as, name, len);
+  sym_t *sym = &as->syms[i];
+  if (sym->section != SEC_UNDEF || sym->external)
+    {
+      asm_error(as, "symbol `%s' redefined", sym->name);
+      return;
+    }
+  sym->section = as->cur_sec;
+  sym->pos = as->secs[as->cur_sec].size;
+  if (*name != '.')
+    as->last_label = sym->name;
+}
+
+//--------------------------------------------------------------------
+
+/* output */
+
+static void ensure_room(section_t *sec, size_t n)
+{
+  if (sec->size + n > sec->cap)
+    {
+      while (sec->size + n > sec->cap)
+        sec->cap = sec->cap * 2 + 4096;
+      sec->data = xrealloc(sec->data, sec->cap);
+    }
+}
+
+static void put_byte(asm_t *as, int b)
+{
+  section_t *sec = &as->secs[as->cur_sec];
+  ensure_room(sec, 1);
+  sec->data[sec->size++] = (unsigned char) b;
+}
+
+static void put_word(asm_t *as, int w)
+{
+  put_byte(as, w & 0xff);
+  put_byte(as, (w >> 8) & 0xff);
+}
+
+static void put_dword(asm_t *as, unsigned d)
+{
+  put_byte(as, d & 0xff);
+  put_byte(as, (d >> 8) & 0xff);
+  put_byte(as, (d >> 16) & 0xff);
+  put_byte(as, (d >> 24) & 0xff);
+}
+
+static void put32(unsigned char *p, unsigned val)
+{
+  p[0] = val & 0xff;
+  p[1] = (val >> 8) & 0xff;
+  p[2] = (val >> 16) & 0xff;
+  p[3] = (val >> 24) & 0xff;
+}
+
+static unsigned get32(unsigned char *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned) p[3] << 24);
+}
+
+static void add_fixup(asm_t *as, int sym, elf_reloc_kind_t kind)
+{
+  section_t *sec = &as->secs[as->cur_sec];
+  fixup_t *fixup;
+  if (sec->fixups_num == sec->fixups_size)
+    {
+      sec->fixups_size = sec->fixups_size * 2 + 64;
+      sec->fixups = xrealloc(sec->fixups, sec->fixups_size * sizeof(fixup_t));
+    }
+  fixup = &sec->fixups[sec->fixups_num++];
+  fixup->pos = sec->size;
+  fixup->sym = sym;
+  fixup->kind = kind;
+  as->syms[sym].used = true;
+}
+
+/* an immediate or a displacement, possibly relative to a symbol */
+static void put_imm32(asm_t *as, int val, int sym)
+{
+  if (sym != -1)
+    add_fixup(as, sym, ELF_ABS32);
+  put_dword(as, val);
+}
+
+static bool is_byte(int val)
+{
+  return val >= -128 && val <= 127;
+}
+
+/* The size of the registers in addresses, which is also that of the
+   operands of push and pop (they need no REX.W in 64-bit code). */
+static int addr_size(asm_t *as)
+{
+  return as->x86_64 ? 8 : 4;
+}
+
+static int scale_bits(int scale)
+{
+  return scale == 8 ? 3 : scale == 4 ? 2 : scale == 2 ? 1 : 0;
+}
+
+/* Writes the REX prefix needed in 64-bit code by an instruction of the
+   given operand size whose ModRM byte has the register reg (NULL for
+   an opcode extension) and the operand rm (or which has the register
+   rm in its opcode). */
+static void put_rex(asm_t *as, int size, opd_t *reg, opd_t *rm)
+{
+  int rex = size == 8 ? 8 : 0;
+  bool any = false;
+  int i;
+  opd_t *opds[2];
+  if (!as->x86_64)
+    return;
+  opds[0] = reg;
+  opds[1] = rm;
+  for (i = 0; i < 2; ++i)
+    {
+      opd_t *opd = opds[i];
+      if (opd == NULL)
+        continue;
+      if (opd->tag == OP_REG || opd->tag == OP_XMM_REG)
+        {
+          if (opd->reg >= 8)
+            rex |= i == 0 ? 4 : 1;
+          // spl, bpl, sil and dil exist only with a REX prefix
+          if (opd->tag == OP_REG && opd->size == 1 && opd->reg >= 4)
+            any = true;
+        }
+      else if (opd->tag == OP_MEM)
+        {
+          if (opd->base != R_NONE && opd->base >= 8)
+            rex |= 1;
+          if (opd->index != R_NONE && opd->index >= 8)
+            rex |= 2;
+        }
+    }
+  if (rex != 0 || any)
+    put_byte(as, 0x40 | rex);
+}
+
+/* Writes the ModRM byte (with the SIB byte and the displacement, if
+   any) for the register or memory operand rm. */
+static void put_modrm(asm_t *as, int reg_field, opd_t *rm)
+{
+  int base, index, scale, mod;
+  reg_field &= 7;
+  if (rm->tag == OP_REG || rm->tag == OP_XMM_REG)
+    {
+      put_byte(as, 0xc0 | (reg_field << 3) | (rm->reg & 7));
+      return;
+    }
+  if (rm->tag != OP_MEM)
+    {
+      asm_error(as, "invalid operand");
+      return;
+    }
+  base = rm->base;
+  index = rm->index;
+  scale = rm->scale;
+  if (rm->rip)
+    {
+      // the field is completed when the length of the instruction is known
+      put_byte(as, (reg_field << 3) | 5);
+      as->rip_field = as->secs[as->cur_sec].size;
+      add_fixup(as, rm->sym, ELF_PC32);
+      put_dword(as, rm->disp - 4);
+      return;
+    }
+  if (base == R_NONE && index == R_NONE)
+    {
+      if (as->x86_64)
+        {
+          // [disp32] needs the SIB byte, the short form is [rel disp32]
+          put_byte(as, (reg_field << 3) | 4);
+          put_byte(as, 0x25);
+        }
+      else
+        put_byte(as, (reg_field << 3) | 5);
+      put_imm32(as, rm->disp, rm->sym);
+      return;
+    }
+  if (rm->sym != -1)
+    mod = 2;
+  else if (rm->disp == 0 && (base & 7) != R_EBP)
+    mod = 0;
+  else if (is_byte(rm->disp))
+    mod = 1;
+  else
+    mod = 2;
+  if (base == R_NONE)
+    {
+      // [scale * index + disp32]
+      put_byte(as, (reg_field << 3) | 4);
+      put_byte(as, (scale_bits(scale) << 6) | ((index & 7) << 3) | 5);
+      put_imm32(as, rm->disp, rm->sym);
+      return;
+    }
+  if (index == R_NONE && (base & 7) != R_ESP)
+    {
+      put_byte(as, (mod << 6) | (reg_field << 3) | (base & 7));
+    }
+  else
+    {
+      put_byte(as, (mod << 6) | (reg_field << 3) | 4);
+      put_byte(as, (scale_bits(scale) << 6) |
+               ((index == R_NONE ? 4 : index & 7) << 3) | (base & 7));
+    }
+  if (mod == 1)
+    put_byte(as, rm->disp);
+  else if (mod == 2)
+    put_imm32(as, rm->disp, rm->sym);
+}
+
+//--------------------------------------------------------------------
+
+/* encoding */
+
+static bool is_rm(opd_t *opd)
+{
+  return opd->tag == OP_REG || opd->tag == OP_MEM;
+}
+
+static bool is_imm8(opd_t *opd)
+{
+  return opd->tag == OP_IMM && opd->sym == -1 && is_byte(opd->disp);
+}
+
+/* The size of a two-operand instruction: that of a register operand,
+   or the explicit one. */
+static int opd_size(asm_t *as, opd_t *opds, int n)
+{
+  int i, size = 0;
+  for (i = 0; i < n; ++i)
+    {
+      if (opds[i].tag == OP_REG || (opds[i].tag == OP_MEM && opds[i].size != 0))
+        {
+          size = opds[i].size;
+          break;
+        }
+    }
+  if (size == 0)
+    {
+      asm_error(as, "operation size not specified");
+      return 4;
+    }
+  if (size != 1 && size != 4 && (size != 8 || !as->x86_64))
+    asm_error(as, "unsupported operand size");
+  return size;
+}
+
+static void check_opds(asm_t *as, int n, int expected)
+{
+  if (n != expected)
+    asm_error(as, "invalid number of operands");
+}
+
+static void put_imm(asm_t *as, opd_t *imm, int size)
+{
+  if (size == 1)
+    put_byte(as, imm->disp);
+  else
+    put_imm32(as, imm->disp, imm->sym);
+}
+
+/* add, or, adc, sbb, and, sub, xor, cmp; arg is the opcode extension */
+static void enc_alu(asm_t *as, opd_t *opds, int n, int arg)
+{
+  int size;
+  check_opds(as, n, 2);
+  size = opd_size(as, opds, 2);
+  if (is_rm(&opds[0]) && opds[1].tag == OP_REG)
+    {
+      put_rex(as, size, &opds[1], &opds[0]);
+      put_byte(as, (arg << 3) | (size == 1 ? 0 : 1));
+      put_modrm(as, opds[1].reg, &opds[0]);
+    }
+  else if (opds[0].tag == OP_REG && opds[1].tag == OP_MEM)
+    {
+      put_rex(as, size, &opds[0], &opds[1]);
+      put_byte(as, (arg << 3) | (size == 1 ? 2 : 3));
+      put_modrm(as, opds[0].reg, &opds[1]);
+    }
+  else if (is_rm(&opds[0]) && opds[1].tag == OP_IMM)
+    {
+      put_rex(as, size, NULL, &opds[0]);
+      if (size == 1)
+        {
+          put_byte(as, 0x80);
+          put_modrm(as, arg, &opds[0]);
+          put_byte(as, opds[1].disp);
+        }
+      else if (is_imm8(&opds[1]))
+        {
+          put_byte(as, 0x83);
+          put_modrm(as, arg, &opds[0]);
+          put_byte(as, opds[1].disp);
+        }
+      else if (opds[0].tag == OP_REG && opds[0].reg == R_EAX)
+        {
+          put_byte(as, (arg << 3) | 5);
+          put_imm32(as, opds[1].disp, opds[1].sym);
+        }
+      else
+        {
+          put_byte(as, 0x81);
+          put_modrm(as, arg, &opds[0]);
+          put_imm32(as, opds[1].disp, opds[1].sym);
+        }
+    }
+  else
+    asm_error(as, "invalid combination of operands");
+}
+
+static void enc_mov(asm_t *as, opd_t *opds, int n, int arg)
+{
+  int size;
+  check_opds(as, n, 2);
+  size = opd_size(as, opds, 2);
+  if (is_rm(&opds[0]) && opds[1].tag == OP_REG)
+    {
+      put_rex(as, size, &opds[1], &opds[0]);
+      put_byte(as, size == 1 ? 0x88 : 0x89);
+      put_modrm(as, opds[1].reg, &opds[0]);
+    }
+  else if (opds[0].tag == OP_REG && opds[1].tag == OP_MEM)
+    {
+      put_rex(as, size, &opds[0], &opds[1]);
+      put_byte(as, size == 1 ? 0x8a : 0x8b);
+      put_modrm(as, opds[0].reg, &opds[1]);
+    }
+  else if (opds[0].tag == OP_REG && opds[1].tag == OP_IMM && size != 8)
+    {
+      put_rex(as, size, NULL, &opds[0]);
+      put_byte(as, (size == 1 ? 0xb0 : 0xb8) + (opds[0].reg & 7));
+      put_imm(as, &opds[1], size);
+    }
+  else if (is_rm(&opds[0]) && opds[1].tag == OP_IMM)
+    {
+      // a 64-bit destination gets the sign-extended 32-bit immediate
+      put_rex(as, size, NULL, &opds[0]);
+      put_byte(as, size == 1 ? 0xc6 : 0xc7);
+      put_modrm(as, 0, &opds[0]);
+      put_imm(as, &opds[1], size);
+    }
+  else
+    asm_error(as, "invalid combination of operands");
+}
+
+static void enc_lea(asm_t *as, opd_t *opds, int n, int arg)
+{
+  check_opds(as, n, 2);
+  if (opds[0].tag != OP_REG || (opds[0].size != 4 && (opds[0].size != 8 || !as->x86_64)) ||
+      opds[1].tag != OP_MEM)
+    {
+      asm_error(as, "invalid combination of operands");
+      return;
+    }
+  put_rex(as, opds[0].size, &opds[0], &opds[1]);
+  put_byte(as, 0x8d);
+  put_modrm(as, opds[0].reg, &opds[1]);
+}
+
+static void enc_xchg(asm_t *as, opd_t *opds, int n, int arg)
+{
+  int size;
+  check_opds(as, n, 2);
+  size = opd_size(as, opds, 2);
+  if (size != 1 && opds[0].tag == OP_REG && opds[1].tag == OP_REG &&
+      (opds[0].reg == R_EAX || opds[1].reg == R_EAX) &&
+      // 0x90 is nop in 64-bit code, which does not clear the upper half of rax
+      (!as->x86_64 || size == 8 || opds[0].reg != opds[1].reg))
+    {
+      opd_t *other = opds[0].reg == R_EAX ? &opds[1] : &opds[0];
+      put_rex(as, size, NULL, other);
+      put_byte(as, 0x90 + (other->reg & 7));
+    }
+  else if (opds[1].tag == OP_REG && is_rm(&opds[0]))
+    {
+      put_rex(as, size, &opds[1], &opds[0]);
+      put_byte(as, size == 1 ? 0x86 : 0x87);
+      put_modrm(as, opds[1].reg, &opds[0]);
+    }
+  else if (opds[0].tag == OP_REG && opds[1].tag == OP_MEM)
+    {
+      put_rex(as, size, &opds[0], &opds[1]);
+      put_byte(as, size == 1 ? 0x86 : 0x87);
+      put_modrm(as, opds[0].reg, &opds[1]);
+    }
+  else
+    asm_error(as, "invalid combination of operands");
+}
+
+static void enc_test(asm_t *as, opd_t *opds, int n, int arg)
+{
+  int size;
+  check_opds(as, n, 2);
+  size = opd_size(as, opds, 2);
+  if (is_rm(&opds[0]) && opds[1].tag == OP_REG)
+    {
+      put_rex(as, size, &opds[1], &opds[0]);
+      put_byte(as, size == 1 ? 0x84 : 0x85);
+      put_modrm(as, opds[1].reg, &opds[0]);
+    }
+  else if (is_rm(&opds[0]) && opds[1].tag == OP_IMM)
+    {
+      put_rex(as, size, NULL, &opds[0]);
+      put_byte(as, size == 1 ? 0xf6 : 0xf7);
+      put_modrm(as, 0, &opds[0]);
+      put_imm(as, &opds[1], size);
+    }
+  else
+    asm_error(as, "invalid combination of operands");
+}
+
+static void enc_imul(asm_t *as, opd_t *opds, int n, int arg)
+{
+  opd_t *src;
+  int size;
+  if (n == 1)
+    {
+      put_rex(as, opd_size(as, opds, 1), NULL, &opds[0]);
+      put_byte(as, 0xf7);
+      put_modrm(as, 5, &opds[0]);
+      return;
+    }
+  if (n < 2 || n > 3 || opds[0].tag != OP_REG || opds[0].size < 4)
+    {
+      asm_error(as, "invalid combination of operands");
+      return;
+    }
+  size = opd_size(as, opds, 1);
+  if (n == 2 && is_rm(&opds[1]))
+    {
+      put_rex(as, size, &opds[0], &opds[1]);
+      put_byte(as, 0x0f);
+      put_byte(as, 0xaf);
+      put_modrm(as, opds[0].reg, &opds[1]);
+      return;
+    }
+  // imul reg, imm is imul reg, reg, imm
+  src = n == 2 ? &opds[0] : &opds[1];
+  if (!is_rm(src) || opds[n - 1].tag != OP_IMM)
+    {
+      asm_error(as, "invalid combination of operands");
+      return;
+    }
+  put_rex(as, size, &opds[0], src);
+  if (is_imm8(&opds[n - 1]))
+    {
+      put_byte(as, 0x6b);
+      put_modrm(as, opds[0].reg, src);
+      put_byte(as, opds[n - 1].disp);
+    }
+  else
+    {
+      put_byte(as, 0x69);
+      put_modrm(as, opds[0].reg, src);
+      put_imm32(as, opds[n - 1].disp, opds[n - 1].sym);
+    }
+}
+
+/* neg, not, idiv and the like; arg is the opcode extension */
+static void enc_unary(asm_t *as, opd_t *opds, int n, int arg)
+{
+  int size;
+  check_opds(as, n, 1);
+  if (!is_rm(&opds[0]))
+    {
+      asm_error(as, "invalid operand");
+      return;
+    }
+  size = opd_size(as, opds, 1);
+  put_rex(as, size, NULL, &opds[0]);
+  put_byte(as, size == 1 ? 0xf6 : 0xf7);
+  put_modrm(as, arg, &opds[0]);
+}
+
+/* inc (arg 0) and dec (arg 1) */
+static void enc_inc(asm_t *as, opd_t *opds, int n, int arg)
+{
+  int size;
+  check_opds(as, n, 1);
+  size = opd_size(as, opds, 1);
+  // the short forms are the REX prefixes in 64-bit code
+  if (opds[0].tag == OP_REG && size == 4 && !as->x86_64)
+    put_byte(as, 0x40 + 8 * arg + opds[0].reg);
+  else if (is_rm(&opds[0]))
+    {
+      put_rex(as, size, NULL, &opds[0]);
+      put_byte(as, size == 1 ? 0xfe : 0xff);
+      put_modrm(as, arg, &opds[0]);
+    }
+  else
+    asm_error(as, "invalid operand");
+}
+
+/* sal/shl, shr and sar; arg is the opcode extension */
+static void enc_shift(asm_t *as, opd_t *opds, int n, int arg)
+{
+  int size;
+  check_opds(as, n, 2);
+  size = opd_size(as, opds, 1);
+  if (!is_rm(&opds[0]))
+    {
+      asm_error(as, "invalid operand");
+      return;
+    }
+  put_rex(as, size, NULL, &opds[0]);
+  if (opds[1].tag == OP_REG && opds[1].reg == R_ECX && opds[1].size == 1)
+    {
+      put_byte(as, size == 1 ? 0xd2 : 0xd3);
+      put_modrm(as, arg, &opds[0]);
+    }
+  else if (opds[1].tag == OP_IMM && opds[1].sym == -1)
+    {
+      if (opds[1].disp == 1)
+        {
+          put_byte(as, size == 1 ? 0xd0 : 0xd1);
+          put_modrm(as, arg, &opds[0]);
+        }
+      else
+        {
+          put_byte(as, size == 1 ? 0xc0 : 0xc1);
+          put_modrm(as, arg, &opds[0]);
+          put_byte(as, opds[1].disp);
+        }
+    }
+  else
+    asm_error(as, "invalid combination of operands");
+}
+
+/* setcc; arg is the condition code */
+static void enc_setcc(asm_t *as, opd_t *opds, int n, int arg)
+{
+  check_opds(as, n, 1);
+  if (!is_rm(&opds[0]) || opd_size(as, opds, 1) != 1)
+    {
+      asm_error(as, "invalid operand");
+      return;
+    }
+  put_rex(as, 1, NULL, &opds[0]);
+  put_byte(as, 0x0f);
+  put_byte(as, 0x90 + arg);
+  put_modrm(as, 0, &opds[0]);
+}
+
+static void enc_push(asm_t *as, opd_t *opds, int n, int arg)
+{
+  check_opds(as, n, 1);
+  if (opds[0].tag == OP_REG && opds[0].size == addr_size(as))
+    {
+      put_rex(as, 0, NULL, &opds[0]);
+      put_byte(as, 0x50 + (opds[0].reg & 7));
+    }
+  else if (opds[0].tag == OP_IMM)
+    {
+      if (opds[0].size == 1 || (opds[0].size == 0 && is_imm8(&opds[0])))
+        {
+          put_byte(as, 0x6a);
+          put_byte(as, opds[0].disp);
+        }
+      else
+        {
+          put_byte(as, 0x68);
+          put_imm32(as, opds[0].disp, opds[0].sym);
+        }
+    }
+  else if (opds[0].tag == OP_MEM && opds[0].size == addr_size(as))
+    {
+      put_rex(as, 0, NULL, &opds[0]);
+      put_byte(as, 0xff);
+      put_modrm(as, 6, &opds[0]);
+    }
+  else
+    asm_error(as, "invalid operand");
+}
+
+static void enc_pop(asm_t *as, opd_t *opds, int n, int arg)
+{
+  check_opds(as, n, 1);
+  if (opds[0].tag == OP_REG && opds[0].size == addr_size(as))
+    {
+      put_rex(as, 0, NULL, &opds[0]);
+      put_byte(as, 0x58 + (opds[0].reg & 7));
+    }
+  else if (opds[0].tag == OP_MEM && opds[0].size == addr_size(as))
+    {
+      put_rex(as, 0, NULL, &opds[0]);
+      put_byte(as, 0x8f);
+      put_modrm(as, 0, &opds[0]);
+    }
+  else
+    asm_error(as, "invalid operand");
+}
+
+static void enc_call(asm_t *as, opd_t *opds, int n, int arg)
+{
+  check_opds(as, n, 1);
+  if (opds[0].tag == OP_IMM && opds[0].sym != -1)
+    {
+      put_byte(as, 0xe8);
+      add_fixup(as, opds[0].sym, ELF_PLT32);
+      put_dword(as, opds[0].disp - 4);
+    }
+  else if (is_rm(&opds[0]))
+    {
+      put_rex(as, 0, NULL, &opds[0]);
+      put_byte(as, 0xff);
+      put_modrm(as, 2, &opds[0]);
+    }
+  else
+    asm_error(as, "invalid operand");
+}
+
+static void enc_ret(asm_t *as, opd_t *opds, int n, int arg)
+{
+  if (n == 0)
+    put_byte(as, 0xc3);
+  else if (n == 1 && opds[0].tag == OP_IMM && opds[0].sym == -1)
+    {
+      put_byte(as, 0xc2);
+      put_word(as, opds[0].disp);
+    }
+  else
+    asm_error(as, "invalid operand");
+}
+
+/* jmp (arg CC_ALWAYS) and jcc; arg is the condition code */
+static void enc_jump(asm_t *as, opd_t *opds, int n, int arg)
+{
+  section_t *sec = &as->secs[as->cur_sec];
+  jump_t *jump;
+  check_opds(as, n, 1);
+  if (arg == CC_ALWAYS && is_rm(&opds[0]))
+    {
+      put_rex(as, 0, NULL, &opds[0]);
+      put_byte(as, 0xff);
+      put_modrm(as, 4, &opds[0]);
+      return;
+    }
+  if (opds[0].tag != OP_IMM || opds[0].sym == -1 || opds[0].disp != 0)
+    {
+      asm_error(as, "invalid jump target");
+      return;
+    }
+  if (sec->jumps_num == sec->jumps_size)
+    {
+      sec->jumps_size = sec->jumps_size * 2 + 64;
+      sec->jumps = xrealloc(sec->jumps, sec->jumps_size * sizeof(jump_t));
+    }
+  jump = &sec->jumps[sec->jumps_num++];
+  jump->pos = sec->size;
+  jump->sym = opds[0].sym;
+  jump->cc = arg;
+  jump->near = false;
+  as->syms[opds[0].sym].used = true;
+  // the placeholder for the short form
+  put_byte(as, 0);
+  put_byte(as, 0);
+}
+
+static void enc_int(asm_t *as, opd_t *opds, int n, int arg)
+{
+  check_opds(as, n, 1);
+  if (opds[0].tag != OP_IMM || opds[0].sym != -1)
+    {
+      asm_error(as, "invalid operand");
+      return;
+    }
+  put_byte(as, 0xcd);
+  put_byte(as, opds[0].disp);
+}
+
+/* instructions without operands; arg holds up to three bytes of the
+   code, the first one in the lowest byte */
+static void enc_bytes(asm_t *as, opd_t *opds, int n, int arg)
+{
+  check_opds(as, n, 0);
+  do
+    {
+      put_byte(as, arg & 0xff);
+      arg >>= 8;
+    }
+  while (arg != 0);
+}
+
+//--------------------------------------------------------------------
+
+/* FPU */
+
+static int fpu_reg(asm_t *as, opd_t *opd)
+{
+  if (opd->tag != OP_FPU_REG)
+    {
+      asm_error(as, "invalid operand");
+      return 0;
+    }
+  return opd->reg;
+}
+
+/* fld (arg 0), fst (2) and fstp (3) */
+static void enc_fld(asm_t *as, opd_t *opds, int n, int arg)
+{
+  static const int reg_code[4] = { 0xd9c0, 0, 0xddd0, 0xddd8 };
+  check_opds(as, n, 1);
+  if (opds[0].tag == OP_MEM && (opds[0].size == 8 || opds[0].size == 4))
+    {
+      put_rex(as, 0, NULL, &opds[0]);
+      put_byte(as, opds[0].size == 8 ? 0xdd : 0xd9);
+      put_modrm(as, arg, &opds[0]);
+    }
+  else
+    {
+      int code = reg_code[arg] + fpu_reg(as, &opds[0]);
+      put_byte(as, code >> 8);
+      put_byte(as, code & 0xff);
+    }
+}
+
+/* fild */
+static void enc_fild(asm_t *as, opd_t *opds, int n, int arg)
+{
+  check_opds(as, n, 1);
+  if (opds[0].tag != OP_MEM || opds[0].size != 4)
+    {
+      asm_error(as, "invalid operand");
+      return;
+    }
+  put_rex(as, 0, NULL, &opds[0]);
+  put_byte(as, 0xdb);
+  put_modrm(as, 0, &opds[0]);
+}
+
+/* fxch, ffree and fcomi, which take st(i) (st1 by default); arg holds
+   the code for st0 */
+static void enc_fpu_reg(asm_t *as, opd_t *opds, int n, int arg)
+{
+  int reg = 1;
+  if (n == 2)
+    {
+      // fcomi st0, st(i)
+      if (fpu_reg(as, &opds[0]) != 0)
+        asm_error(as, "invalid combination of operands");
+      reg = fpu_reg(as, &opds[1]);
+    }
+  else if (n == 1)
+    reg = fpu_reg(as, &opds[0]);
+  else if (n != 0)
+    asm_error(as, "invalid number of operands");
+  arg += reg;
+  put_byte(as, arg >> 8);
+  put_byte(as, arg & 0xff);
+}
+
+/* fcom (arg 2) and fcomp (arg 3) */
+static void enc_fcom(asm_t *as, opd_t *opds, int n, int arg)
+{
+  if (n == 1 && opds[0].tag == OP_MEM && (opds[0].size == 8 || opds[0].size == 4))
+    {
+      put_rex(as, 0, NULL, &opds[0]);
+      put_byte(as, opds[0].size == 8 ? 0xdc : 0xd8);
+      put_modrm(as, arg, &opds[0]);
+      return;
+    }
+  put_byte(as, 0xd8);
+  put_byte(as, 0xc0 | (arg << 3) | (n == 0 ? 1 : fpu_reg(as, &opds[0])));
+  if (n > 1)
+    asm_error(as, "invalid number of operands");
+}
+
+static void enc_fstsw(asm_t *as, opd_t *opds, int n, int arg)
+{
+  check_opds(as, n, 1);
+  if (arg)
+    put_byte(as, 0x9b);
+  if (opds[0].tag == OP_REG && opds[0].reg == R_EAX && opds[0].size == 2)
+    {
+      put_byte(as, 0xdf);
+      put_byte(as, 0xe0);
+    }
+  else if (opds[0].tag == OP_MEM && opds[0].size != 1 && opds[0].size != 4 &&
+           opds[0].size != 8)
+    {
+      put_rex(as, 0, NULL, &opds[0]);
+      put_byte(as, 0xdd);
+      put_modrm(as, 7, &opds[0]);
+    }
+  else
+    asm_error(as, "invalid operand");
+}
+
+/* fadd (arg 0), fmul (1), fsub (4), fsubr (5), fdiv (6), fdivr (7),
+   plus 8 for the popping forms */
+static void enc_farith(asm_t *as, opd_t *opds, int n, int arg)
+{
+  bool pop = arg >= 8;
+  int op = arg & 7;
+  // the register forms with st(i) as the destination have the
+  // reversed operations swapped
+  int rev_op = op >= 4 ? op ^ 1 : op;
+  if (pop)
+    {
+      int reg = 1;
+      if (n == 2)
+        {
+          reg = fpu_reg(as, &opds[0]);
+          if (fpu_reg(as, &opds[1]) != 0)
+            asm_error(as, "invalid combination of operands");
+        }
+      else if (n == 1)
+        reg = fpu_reg(as, &opds[0]);
+      else if (n != 0)
+        asm_error(as, "invalid number of operands");
+      put_byte(as, 0xde);
+      put_byte(as, 0xc0 | (rev_op << 3) | reg);
+    }
+  else if (n == 1 && opds[0].tag == OP_MEM)
+    {
+      if (opds[0].size != 8 && opds[0].size != 4)
+        {
+          asm_error(as, "operation size not specified");
+          return;
+        }
+      put_rex(as, 0, NULL, &opds[0]);
+      put_byte(as, opds[0].size == 8 ? 0xdc : 0xd8);
+      put_modrm(as, op, &opds[0]);
+    }
+  else if (n == 1)
+    {
+      // fop st(i) is fop st0, st(i)
+      put_byte(as, 0xd8);
+      put_byte(as, 0xc0 | (op << 3) | fpu_reg(as, &opds[0]));
+    }
+  else if (n == 2 && opds[0].tag == OP_FPU_REG && opds[0].reg == 0)
+    {
+      put_byte(as, 0xd8);
+      put_byte(as, 0xc0 | (op << 3) | fpu_reg(as, &opds[1]));
+    }
+  else if (n == 2)
+    {
+      if (fpu_reg(as, &opds[1]) != 0)
+        asm_error(as, "invalid combination of operands");
+      put_byte(as, 0xdc);
+      put_byte(as, 0xc0 | (rev_op << 3) | fpu_reg(as, &opds[0]));
+    }
+  else
+    asm_error(as, "invalid number of operands");
+}
+
+//--------------------------------------------------------------------
+
+/* SSE2 */
+
+static bool is_xmm_rm(opd_t *opd)
+{
+  return opd->tag == OP_XMM_REG || (opd->tag == OP_MEM && (opd->size == 0 || opd->size == 8));
+}
+
+/* Writes an instruction with a mandatory prefix and the 0x0f escape:
+   the code is the prefix followed by the opcode. */
+static void put_sse(asm_t *as, int code, opd_t *reg, opd_t *rm)
+{
+  put_byte(as, code >> 8);
+  put_rex(as, 0, reg, rm);
+  put_byte(as, 0x0f);
+  put_byte(as, code & 0xff);
+  put_modrm(as, reg->reg, rm);
+}
+
+static void enc_movsd(asm_t *as, opd_t *opds, int n, int arg)
+{
+  check_opds(as, n, 2);
+  if (opds[0].tag == OP_XMM_REG && is_xmm_rm(&opds[1]))
+    put_sse(as, 0xf210, &opds[0], &opds[1]);
+  else if (opds[0].tag == OP_MEM && opds[1].tag == OP_XMM_REG && is_xmm_rm(&opds[0]))
+    put_sse(as, 0xf211, &opds[1], &opds[0]);
+  else
+    asm_error(as, "invalid combination of operands");
+}
+
+/* addsd, ucomisd and the like; arg holds the prefix and the opcode */
+static void enc_sse(asm_t *as, opd_t *opds, int n, int arg)
+{
+  check_opds(as, n, 2);
+  if (opds[0].tag == OP_XMM_REG && is_xmm_rm(&opds[1]))
+    put_sse(as, arg, &opds[0], &opds[1]);
+  else
+    asm_error(as, "invalid combination of operands");
+}
+
+//--------------------------------------------------------------------
+
+/* data */
+
+static void data_directive(asm_t *as, const char *s, int size)
+{
+  for (;;)
+    {
+      while (isspace(*s))
+        ++s;
+      if (*s == '\'' || *s == '"')
+        {
+          char quote = *s++;
+          while (*s != quote && *s != '\0')
+            put_byte(as, *s++);
+          if (*s != quote)
+            {
+              asm_error(as, "unterminated string");
+              return;
+            }
+          ++s;
+          // strings are padded to a multiple of the size
+          if (size > 1)
+            {
+              section_t *sec = &as->secs[as->cur_sec];
+              while (sec->size % size != 0)
+                put_byte(as, 0);
+            }
+        }
+      else
+        {
+          char *end;
+          const char *e = s;
+          bool is_float = false;
+          while (*e != ',' && *e != '\0' && !isspace(*e))
+            {
+              if (*e == '.' || ((*e == 'e' || *e == 'E') && !(s[0] == '0' && s[1] == 'x')))
+                is_float = true;
+              ++e;
+            }
+          if (size == 8 && is_float)
+            {
+              double d = strtod(s, &end);
+              unsigned char *p = (unsigned char*) &d;
+              int i;
+              for (i = 0; i < 8; ++i)
+                put_byte(as, p[i]);
+            }
+          else
+            {
+              // hexadecimal quad words may not fit a signed number
+              long long val = *s == '-' ? strtoll(s, &end, 0) :
+                (long long) strtoull(s, &end, 0);
+              int i;
+              for (i = 0; i < size; ++i)
+                put_byte(as, (int) (val >> (8 * i)) & 0xff);
+            }
+          if (end != e || e == s)
+            {
+              asm_error(as, "invalid data");
+              return;
+            }
+          s = e;
+        }
+      while (isspace(*s))
+        ++s;
+      if (*s == '\0')
+        break;
+      if (*s != ',')
+        {
+          asm_error(as, "junk after data");
+          return;
+        }
+      ++s;
+    }
+}
+
+//--------------------------------------------------------------------
+
+/* parsing */
+
+static const mnemonic_t mnemonics[] = {
+  { "mov", enc_mov, 0 }, { "lea", enc_lea, 0 }, { "xchg", enc_xchg, 0 },
+  { "add", enc_alu, 0 }, { "or", enc_alu, 1 }, { "adc", enc_alu, 2 },
+  { "sbb", enc_alu, 3 }, { "and", enc_alu, 4 }, { "sub", enc_alu, 5 },
+  { "xor", enc_alu, 6 }, { "cmp", enc_alu, 7 }, { "test", enc_test, 0 },
+  { "imul", enc_imul, 0 }, { "not", enc_unary, 2 }, { "neg", enc_unary, 3 },
+  { "mul", enc_unary, 4 }, { "div", enc_unary, 6 }, { "idiv", enc_unary, 7 },
+  { "inc", enc_inc, 0 }, { "dec", enc_inc, 1 },
+  { "sal", enc_shift, 4 }, { "shl", enc_shift, 4 }, { "shr", enc_shift, 5 },
+  { "sar", enc_shift, 7 },
+  { "push", enc_push, 0 }, { "pop", enc_pop, 0 }, { "call", enc_call, 0 },
+  { "ret", enc_ret, 0 }, { "int", enc_int, 0 },
+  { "cdq", enc_bytes, 0x99 }, { "sahf", enc_bytes, 0x9e }, { "nop", enc_bytes, 0x90 },
+  { "jmp", enc_jump, CC_ALWAYS },
+  { "jo", enc_jump, 0x0 }, { "jno", enc_jump, 0x1 }, { "jb", enc_jump, 0x2 },
+  { "jc", enc_jump, 0x2 }, { "jnae", enc_jump, 0x2 }, { "jae", enc_jump, 0x3 },
+  { "jnb", enc_jump, 0x3 }, { "jnc", enc_jump, 0x3 }, { "je", enc_jump, 0x4 },
+  { "jz", enc_jump, 0x4 }, { "jne", enc_jump, 0x5 }, { "jnz", enc_jump, 0x5 },
+  { "jbe", enc_jump, 0x6 }, { "jna", enc_jump, 0x6 }, { "ja", enc_jump, 0x7 },
+  { "jnbe", enc_jump, 0x7 }, { "js", enc_jump, 0x8 }, { "jns", enc_jump, 0x9 },
+  { "jp", enc_jump, 0xa }, { "jnp", enc_jump, 0xb }, { "jl", enc_jump, 0xc },
+  { "jnge", enc_jump, 0xc }, { "jge", enc_jump, 0xd }, { "jnl", enc_jump, 0xd },
+  { "jle", enc_jump, 0xe }, { "jng", enc_jump, 0xe }, { "jg", enc_jump, 0xf },
+  { "jnle", enc_jump, 0xf },
+  { "sets", enc_setcc, 0x8 }, { "setns", enc_setcc, 0x9 }, { "sete", enc_setcc, 0x4 },
+  { "setz", enc_setcc, 0x4 }, { "setne", enc_setcc, 0x5 }, { "setnz", enc_setcc, 0x5 },
+  { "setl", enc_setcc, 0xc }, { "setge", enc_setcc, 0xd }, { "setle", enc_setcc, 0xe },
+  { "setg", enc_setcc, 0xf }, { "setb", enc_setcc, 0x2 }, { "setae", enc_setcc, 0x3 },
+  { "setbe", enc_setcc, 0x6 }, { "seta", enc_setcc, 0x7 },
+  { "finit", enc_bytes, 0xe3db9b }, { "fninit", enc_bytes, 0xe3db },
+  { "fwait", enc_bytes, 0x9b }, { "wait", enc_bytes, 0x9b },
+  { "fstsw", enc_fstsw, 1 }, { "fnstsw", enc_fstsw, 0 },
+  { "fld", enc_fld, 0 }, { "fst", enc_fld, 2 }, { "fstp", enc_fld, 3 },
+  { "fild", enc_fild, 0 },
+  { "fldz", enc_bytes, 0xeed9 }, { "fld1", enc_bytes, 0xe8d9 },
+  { "fchs", enc_bytes, 0xe0d9 }, { "fabs", enc_bytes, 0xe1d9 },
+  { "fincstp", enc_bytes, 0xf7d9 }, { "fdecstp", enc_bytes, 0xf6d9 },
+  { "fcompp", enc_bytes, 0xd9de },
+  { "fxch", enc_fpu_reg, 0xd9c8 }, { "ffree", enc_fpu_reg, 0xddc0 },
+  { "fcomi", enc_fpu_reg, 0xdbf0 }, { "fcomip", enc_fpu_reg, 0xdff0 },
+  { "fucomi", enc_fpu_reg, 0xdbe8 }, { "fucomip", enc_fpu_reg, 0xdfe8 },
+  { "fcom", enc_fcom, 2 }, { "fcomp", enc_fcom, 3 },
+  { "fadd", enc_farith, 0 }, { "fmul", enc_farith, 1 }, { "fsub", enc_farith, 4 },
+  { "fsubr", enc_farith, 5 }, { "fdiv", enc_farith, 6 }, { "fdivr", enc_farith, 7 },
+  { "faddp", enc_farith, 8 }, { "fmulp", enc_farith, 9 }, { "fsubp", enc_farith, 12 },
+  { "fsubrp", enc_farith, 13 }, { "fdivp", enc_farith, 14 }, { "fdivrp", enc_farith, 15 },
+  { "movsd", enc_movsd, 0 }, { "movapd", enc_sse, 0x6628 }, { "addsd", enc_sse, 0xf258 }, { "mulsd", enc_sse, 0xf259 },
+  { "subsd", enc_sse, 0xf25c }, { "divsd", enc_sse, 0xf25e },
+  { "ucomisd", enc_sse, 0x662e }, { "comisd", enc_sse, 0x662f },
+  { "xorpd", enc_sse, 0x6657 }
+};
+
+#define MNEMONICS_NUM (sizeof(mnemonics) / sizeof(mnemonics[0]))
+
+static void init_mnemonics(asm_t *as)
+{
+  char *str;
+  const mnemonic_t **pm;
+  size_t i;
+  as->mnemonics = new_strtab(1024, 4 * MNEMONICS_NUM * sizeof(mnemonic_t*),
+                             sizeof(mnemonic_t*));
+  for (i = 0; i < MNEMONICS_NUM; ++i)
+    {
+      add_str(as->mnemonics, mnemonics[i].name, &str, (void**) &pm);
+      *pm = &mnemonics[i];
+    }
+}
+
+static const mnemonic_t *find_mnemonic(asm_t *as, const char *name, size_t len)
+{
+  char buf[16];
+  char *str;
+  const mnemonic_t **pm;
+  size_t i;
+  if (len >= sizeof(buf))
+    return NULL;
+  // mnemonics are case-insensitive
+  for (i = 0; i < len; ++i)
+    buf[i] = tolower(name[i]);
+  if (add_strn(as->mnemonics, buf, len, &str, (void**) &pm))
+    {
+      // remember that this is not a mnemonic
+      *pm = NULL;
+    }
+  return *pm;
+}
+
+static bool is_ident_start(char c)
+{
+  return isalpha(c) || c == '_' || c == '.' || c == '$' || c == '?' || c == '@';
+}
+
+static bool is_ident_char(char c)
+{
+  return isalnum(c) || c == '_' || c == '.' || c == '$' || c == '?' || c == '@' ||
+    c == '#' || c == '~';
+}
+
+static char *skip_ident(const char *s)
+{
+  while (is_ident_char(*s))
+    ++s;
+  return (char*) s;
+}
+
+static bool word_eq(const char *s, size_t len, const char *word)
+{
+  return strlen(word) == len && strncasecmp(s, word, len) == 0;
+}
+
+/* Returns the hardware number of a general purpose register and sets
+   its size, or returns R_NONE. In 64-bit code the byte registers 4-7
+   are spl, bpl, sil and dil instead of ah, ch, dh and bh. */
+static int parse_reg(asm_t *as, const char *s, size_t len, int *size)
+{
+  static const char *names[4][8] = {
+    { "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi" },
+    { "ax", "cx", "dx", "bx", "sp", "bp", "si", "di" },
+    { "al", "cl", "dl", "bl", "ah", "ch", "dh", "bh" },
+    { "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi" }
+  };
+  static const char *rex_names[4] = { "spl", "bpl", "sil", "dil" };
+  static const int sizes[4] = { 4, 2, 1, 8 };
+  int i, j;
+  if (len < 2 || len > 4)
+    return R_NONE;
+  for (i = 0; i < (as->x86_64 ? 4 : 3); ++i)
+    {
+      for (j = 0; j < 8; ++j)
+        {
+          if (word_eq(s, len, names[i][j]))
+            {
+              if (as->x86_64 && i == 2 && j >= 4)
+                asm_error(as, "`%s' is not supported in 64-bit code", names[i][j]);
+              *size = sizes[i];
+              return j;
+            }
+        }
+    }
+  if (as->x86_64)
+    {
+      for (j = 0; j < 4; ++j)
+        {
+          if (word_eq(s, len, rex_names[j]))
+            {
+              *size = 1;
+              return 4 + j;
+            }
+        }
+      // r8-r15, with the suffix d, w or b for the lower parts
+      if ((s[0] == 'r' || s[0] == 'R') && isdigit(s[1]) && s[1] != '0')
+        {
+          char *end;
+          long r = strtol(s + 1, &end, 10);
+          size_t n = end - s;
+          if (r >= 8 && r <= 15)
+            {
+              if (n == len)
+                {
+                  *size = 8;
+                  return r;
+                }
+              if (n + 1 == len)
+                {
+                  switch (tolower(s[n])){
+                  case 'd':
+                    *size = 4;
+                    return r;
+                  case 'w':
+                    *size = 2;
+                    return r;
+                  case 'b':
+                    *size = 1;
+                    return r;
+                  default:
+                    break;
+                  };
+                }
+            }
+        }
+    }
+  return R_NONE;
+}
+
+/* Returns the number of an SSE register (xmm0-xmm15), or R_NONE. */
+static int parse_xmm_reg(asm_t *as, const char *s, size_t len)
+{
+  int r;
+  if (len < 4 || len > 5 || strncasecmp(s, "xmm", 3) != 0 || !isdigit(s[3]) ||
+      (len == 5 && (s[3] != '1' || !isdigit(s[4]))))
+    {
+      return R_NONE;
+    }
+  r = len == 4 ? s[3] - '0' : 10 + s[4] - '0';
+  if (r >= (as->x86_64 ? 16 : 8))
+    return R_NONE;
+  return r;
+}
+
+static int parse_size(const char *s, size_t len)
+{
+  if (word_eq(s, len, "byte"))
+    return 1;
+  if (word_eq(s, len, "word"))
+    return 2;
+  if (word_eq(s, len, "dword"))
+    return 4;
+  if (word_eq(s, len, "qword"))
+    return 8;
+  return 0;
+}
+
+static const char *parse_number(asm_t *as, const char *s, int *val)
+{
+  char *end;
+  long long v = strtoll(s, &end, 0);
+  if (end == s || v > 0xffffffffLL || v < -0x80000000LL)
+    {
+      asm_error(as, "invalid number");
+      *val = 0;
+      return s + 1;
+    }
+  *val = (int) v;
+  return end;
+}
+
+/* Parses an expression which is a sum of terms: numbers, symbols,
+   registers and registers multiplied by numbers. Registers are
+   allowed only in memory operands. Stops at `]', `,' or the end of the
+   line. */
+static const char *parse_expr(asm_t *as, const char *s, opd_t *opd, bool mem)
+{
+  int sign = 1;
+  opd->base = opd->index = R_NONE;
+  opd->scale = 0;
+  opd->disp = 0;
+  opd->sym = -1;
+  for (;;)
+    {
+      int reg = R_NONE;
+      int factor = 1;
+      int sym = -1;
+      bool any = false;
+      // a term
+      for (;;)
+        {
+          int size, val;
+          while (isspace(*s))
+            ++s;
+          if (is_ident_start(*s))
+            {
+              const char *e = skip_ident(s);
+              int r = parse_reg(as, s, e - s, &size);
+              if (r != R_NONE)
+                {
+                  if (!mem || size != addr_size(as) || reg != R_NONE)
+                    asm_error(as, "invalid use of a register");
+                  reg = r;
+                }
+              else
+                {
+                  if (sym != -1)
+                    asm_error(as, "invalid use of a symbol");
+                  sym = get_sym(as, s, e - s);
+                }
+              s = e;
+            }
+          else if (isdigit(*s) || (*s == '-' && isdigit(s[1])))
+            {
+              // the peephole rules may produce products like 4 * -1
+              s = parse_number(as, s, &val);
+              factor *= val;
+            }
+          else
+            {
+              asm_error(as, "syntax error in an expression");
+              return s;
+            }
+          any = true;
+          while (isspace(*s))
+            ++s;
+          if (*s != '*')
+            break;
+          ++s;
+        }
+      if (!any)
+        break;
+      if (reg != R_NONE)
+        {
+          if (sym != -1 || sign < 0)
+            asm_error(as, "invalid address");
+          else if (factor == 1 && opd->base == R_NONE)
+            opd->base = reg;
+          else if (opd->index == R_NONE &&
+                   (factor == 1 || factor == 2 || factor == 4 || factor == 8))
+            {
+              opd->index = reg;
+              opd->scale = factor;
+            }
+          else
+            asm_error(as, "invalid address");
+        }
+      else if (sym != -1)
+        {
+          if (factor != 1 || sign < 0 || opd->sym != -1)
+            asm_error(as, "invalid use of a symbol");
+          opd->sym = sym;
+        }
+      else
+        opd->disp += sign * factor;
+      while (isspace(*s))
+        ++s;
+      if (*s == '+')
+        sign = 1;
+      else if (*s == '-')
+        sign = -1;
+      else
+        break;
+      ++s;
+    }
+  if (opd->index == R_NONE && opd->scale != 0)
+    opd->scale = 0;
+  if (opd->index != R_NONE && opd->scale == 0)
+    opd->scale = 1;
+  if (opd->index == R_ESP)
+    {
+      // esp can only be the base
+      if (opd->scale != 1 || opd->base == R_ESP)
+        asm_error(as, "esp cannot be an index");
+      swap(opd->base, opd->index, int);
+    }
+  return s;
+}
+
+static const char *parse_operand(asm_t *as, const char *s, opd_t *opd)
+{
+  const char *e;
+  int size;
+  opd->size = 0;
+  opd->sym = -1;
+  opd->disp = 0;
+  opd->rip = false;
+  for (;;)
+    {
+      // size and distance specifiers
+      while (isspace(*s))
+        ++s;
+      e = skip_ident(s);
+      if ((size = parse_size(s, e - s)) != 0)
+        opd->size = size;
+      else if (!word_eq(s, e - s, "near") && !word_eq(s, e - s, "short"))
+        break;
+      s = e;
+    }
+  if (*s == '[')
+    {
+      opd->tag = OP_MEM;
+      ++s;
+      while (isspace(*s))
+        ++s;
+      e = skip_ident(s);
+      if (as->x86_64 && word_eq(s, e - s, "rel") && isspace(*e))
+        {
+          opd->rip = true;
+          s = e;
+        }
+      s = parse_expr(as, s, opd, true);
+      if (opd->rip && (opd->sym == -1 || opd->base != R_NONE || opd->index != R_NONE))
+        asm_error(as, "invalid address");
+      if (*s != ']')
+        {
+          asm_error(as, "expected `]'");
+          return s;
+        }
+      return s + 1;
+    }
+  if (is_ident_start(*s))
+    {
+      int reg = parse_reg(as, s, e - s, &size);
+      if (reg != R_NONE)
+        {
+          opd->tag = OP_REG;
+          opd->reg = reg;
+          opd->size = size;
+          return e;
+        }
+      reg = parse_xmm_reg(as, s, e - s);
+      if (reg != R_NONE)
+        {
+          opd->tag = OP_XMM_REG;
+          opd->reg = reg;
+          return e;
+        }
+      if (e - s == 3 && (s[0] == 's' || s[0] == 'S') && (s[1] == 't' || s[1] == 'T') &&
+          s[2] >= '0' && s[2] <= '7')
+        {
+          opd->tag = OP_FPU_REG;
+          opd->reg = s[2] - '0';
+          return e;
+        }
+    }
+  opd->tag = OP_IMM;
+  if (*s == '-' || *s == '+')
+    {
+      // a signed number
+      bool neg = *s == '-';
+      s = parse_number(as, s + 1, &opd->disp);
+      if (neg)
+        opd->disp = -opd->disp;
+      return s;
+    }
+  return parse_expr(as, s, opd, false);
+}
+
+static void assemble_line(asm_t *as, char *line)
+{
+  char *s = line;
+  char *e;
+  int size;
+  // strip the comment
+  for (e = s; *e != '\0'; ++e)
+    {
+      if (*e == '\'' || *e == '"')
+        {
+          char quote = *e++;
+          while (*e != quote && *e != '\0')
+            ++e;
+          if (*e == '\0')
+            break;
+        }
+      else if (*e == ';')
+        {
+          *e = '\0';
+          break;
+        }
+    }
+  while (isspace(*s))
+    ++s;
+  if (*s == '\0')
+    return;
+  if (!is_ident_start(*s))
+    {
+      asm_error(as, "syntax error");
+      return;
+    }
+  e = skip_ident(s);
+  if (*e == ':')
+    {
+      define_label(as, s, e - s);
+      assemble_line(as, e + 1);
+      return;
+    }
+  if (word_eq(s, e - s, "section"))
+    {
+      s = e;
+      while (isspace(*s))
+        ++s;
+      e = skip_ident(s);
+      if (word_eq(s, e - s, ".text"))
+        as->cur_sec = SEC_TEXT;
+      else if (word_eq(s, e - s, ".data"))
+        as->cur_sec = SEC_DATA;
+      else
+        asm_error(as, "unsupported section");
+      return;
+    }
+  if (word_eq(s, e - s, "global") || word_eq(s, e - s, "extern"))
+    {
+      bool global = word_eq(s, e - s, "global");
+      for (;;)
+        {
+          s = e;
+          while (isspace(*s) || *s == ',')
+            ++s;
+          if (*s == '\0')
+            break;
+          e = skip_ident(s);
+          if (e == s)
+            {
+              asm_error(as, "syntax error");
+              return;
+            }
+          if (global)
+            as->syms[get_sym(as, s, e - s)].global = true;
+          else
+            as->syms[get_sym(as, s, e - s)].external = true;
+        }
+      return;
+    }
+  {
+    // a label without a colon followed by a data directive
+    char *s2 = e;
+    char *e2;
+    while (isspace(*s2))
+      ++s2;
+    e2 = skip_ident(s2);
+    if (e2 - s2 == 2 && (s2[0] == 'd' || s2[0] == 'D') && isspace(*e2))
+      {
+        switch (tolower(s2[1])){
+        case 'b':
+          size = 1;
+          break;
+        case 'w':
+          size = 2;
+          break;
+        case 'd':
+          size = 4;
+          break;
+        case 'q':
+          size = 8;
+          break;
+        default:
+          size = 0;
+        };
+        if (size != 0)
+          {
+            define_label(as, s, e - s);
+            data_directive(as, e2, size);
+            return;
+          }
+      }
+  }
+  {
+    const mnemonic_t *mn = find_mnemonic(as, s, e - s);
+    opd_t opds[MAX_OPERANDS];
+    int n = 0;
+    if (mn == NULL)
+      {
+        char c = *e;
+        *e = '\0';
+        asm_error(as, "unknown instruction `%s'", s);
+        *e = c;
+        return;
+      }
+    s = e;
+    while (isspace(*s))
+      ++s;
+    while (*s != '\0')
+      {
+        if (n == MAX_OPERANDS)
+          {
+            asm_error(as, "too many operands");
+            return;
+          }
+        s = (char*) parse_operand(as, s, &opds[n++]);
+        while (isspace(*s))
+          ++s;
+        if (*s == ',')
+          ++s;
+        else if (*s != '\0')
+          {
+            asm_error(as, "junk after operand");
+            return;
+          }
+      }
+    if (!as->failed)
+      {
+        section_t *sec = &as->secs[as->cur_sec];
+        as->rip_field = -1;
+        mn->encode(as, opds, n, mn->arg);
+        if (as->rip_field != -1)
+          {
+            // [rel sym] is relative to the end of the instruction
+            unsigned char *p = sec->data + as->rip_field;
+            put32(p, get32(p) - (unsigned) (sec->size - (as->rip_field + 4)));
+          }
+      }
+  }
+}
+
+//--------------------------------------------------------------------
+
+/* layout */
+
+/* The position in the laid out section of position pos. */
+static size_t final_pos(section_t *sec, size_t pos)
+{
+  // the number of jumps before pos
+  size_t lo = 0, hi = sec->jumps_num;
+  while (lo < hi)
+    {
+      size_t mid = (lo + hi) / 2;
+      if (sec->jumps[mid].pos < pos)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return pos + sec->growth[lo];
+}
+
+static size_t jump_growth(jump_t *jump)
+{
+  if (!jump->near)
+    return 0;
+  return jump->cc == CC_ALWAYS ? 3 : 4;
+}
+
+static void compute_growth(section_t *sec)
+{
+  size_t k;
+  sec->growth[0] = 0;
+  for (k = 0; k < sec->jumps_num; ++k)
+    sec->growth[k + 1] = sec->growth[k] + jump_growth(&sec->jumps[k]);
+}
+
+static void layout(asm_t *as, int secn)
+{
+  section_t *sec = &as->secs[secn];
+  bool changed;
+  size_t k;
+  sec->growth = xmalloc((sec->jumps_num + 1) * sizeof(size_t));
+  for (k = 0; k < sec->jumps_num; ++k)
+    {
+      if (as->syms[sec->jumps[k].sym].section != secn)
+        sec->jumps[k].near = true;
+    }
+  do
+    {
+      changed = false;
+      compute_growth(sec);
+      for (k = 0; k < sec->jumps_num; ++k)
+        {
+          jump_t *jump = &sec->jumps[k];
+          if (!jump->near)
+            {
+              long long from = final_pos(sec, jump->pos) + 2;
+              long long to = final_pos(sec, as->syms[jump->sym].pos);
+              if (!is_byte(to - from))
+                {
+                  jump->near = true;
+                  changed = true;
+                }
+            }
+        }
+    }
+  while (changed);
+}
+
+/* Produces the laid out code of a section, with the references within
+   the section resolved. */
+static unsigned char *emit_section(asm_t *as, int secn, size_t *psize)
+{
+  section_t *sec = &as->secs[secn];
+  size_t size = sec->size + sec->growth[sec->jumps_num];
+  unsigned char *data = xmalloc(size + 1);
+  size_t src = 0, dst = 0, k;
+  for (k = 0; k < sec->jumps_num; ++k)
+    {
+      jump_t *jump = &sec->jumps[k];
+      sym_t *sym = &as->syms[jump->sym];
+      size_t n = jump->pos - src;
+      int len = jump->cc == CC_ALWAYS ? (jump->near ? 5 : 2) : (jump->near ? 6 : 2);
+      long long disp = 0;
+      memcpy(data + dst, sec->data + src, n);
+      dst += n;
+      src = jump->pos + 2;
+      if (sym->section == secn)
+        disp = (long long) final_pos(sec, sym->pos) - (long long) (dst + len);
+      else
+        disp = -4;
+      if (!jump->near)
+        {
+          data[dst] = jump->cc == CC_ALWAYS ? 0xeb : 0x70 + jump->cc;
+          data[dst + 1] = (unsigned char) disp;
+        }
+      else if (jump->cc == CC_ALWAYS)
+        {
+          data[dst] = 0xe9;
+          put32(data + dst + 1, (unsigned) disp);
+        }
+      else
+        {
+          data[dst] = 0x0f;
+          data[dst + 1] = 0x80 + jump->cc;
+          put32(data + dst + 2, (unsigned) disp);
+        }
+      dst += len;
+    }
+  memcpy(data + dst, sec->data + src, sec->size - src);
+  assert (dst + sec->size - src == size);
+
+  for (k = 0; k < sec->fixups_num; ++k)
+    {
+      fixup_t *fixup = &sec->fixups[k];
+      sym_t *sym = &as->syms[fixup->sym];
+      size_t pos = final_pos(sec, fixup->pos);
+      if (fixup->kind != ELF_ABS32 && sym->section == secn)
+        {
+          put32(data + pos, get32(data + pos) + 4 +
+                (unsigned) (final_pos(sec, sym->pos) - (pos + 4)));
+        }
+    }
+  *psize = size;
+  return data;
+}
+
+static void add_relocs(asm_t *as, elf_obj_t *obj, int secn, int elf_sec)
+{
+  section_t *sec = &as->secs[secn];
+  size_t k;
+  for (k = 0; k < sec->jumps_num; ++k)
+    {
+      jump_t *jump = &sec->jumps[k];
+      sym_t *sym = &as->syms[jump->sym];
+      if (sym->section != secn)
+        {
+          size_t len = jump->cc == CC_ALWAYS ? 5 : 6;
+          elf_add_reloc(obj, elf_sec, final_pos(sec, jump->pos) + len - 4, sym->elf_sym,
+                        ELF_PLT32);
+        }
+    }
+  for (k = 0; k < sec->fixups_num; ++k)
+    {
+      fixup_t *fixup = &sec->fixups[k];
+      sym_t *sym = &as->syms[fixup->sym];
+      if (fixup->kind == ELF_ABS32 || sym->section != secn)
+        {
+          elf_add_reloc(obj, elf_sec, final_pos(sec, fixup->pos), sym->elf_sym,
+                        fixup->kind);
+        }
+    }
+}
+
+//--------------------------------------------------------------------
+
+static void init_asm(asm_t *as, bool x86_64)
+{
+  memset(as, 0, sizeof(asm_t));
+  as->x86_64 = x86_64;
+  as->cur_sec = SEC_TEXT;
+  as->names = new_strtab(64 * 1024, SYMS_SIZE * sizeof(int), sizeof(int));
+  as->syms_size = SYMS_SIZE;
+  as->syms = xmalloc(as->syms_size * sizeof(sym_t));
+  init_mnemonics(as);
+}
+
+static void free_asm(asm_t *as)
+{
+  int i;
+  for (i = 0; i < SECS_NUM; ++i)
+    {
+      free(as->secs[i].data);
+      free(as->secs[i].jumps);
+      free(as->secs[i].fixups);
+      free(as->secs[i].growth);
+    }
+  free(as->syms);
+  free_strtab(as->names);
+  free_strtab(as->mnemonics);
+}
+
+/* Assembles the text and lays out the sections. */
+static void assemble_text(asm_t *as, const char *text, size_t len)
+{
+  char line[MAX_LINE_LEN];
+  const char *end = text + len;
+  int i;
+  while (text < end && !as->failed)
+    {
+      const char *eol = memchr(text, '\n', end - text);
+      size_t n;
+      if (eol == NULL)
+        eol = end;
+      n = eol - text;
+      ++as->line_num;
+      if (n >= MAX_LINE_LEN)
+        {
+          asm_error(as, "line too long");
+          break;
+        }
+      memcpy(line, text, n);
+      line[n] = '\0';
+      assemble_line(as, line);
+      text = eol + 1;
+    }
+  as->line_num = 0;
+  if (!as->failed)
+    {
+      for (i = 0; i < SECS_NUM; ++i)
+        {
+          layout(as, i);
+        }
+    }
+}
+
+static bool assemble(const char *text, size_t len, FILE *fout, bool x86_64)
+{
+  static const char *sec_names[SECS_NUM] = { ".text", ".data" };
+  asm_t as;
+  int elf_secs[SECS_NUM];
+  unsigned char *data[SECS_NUM];
+  elf_obj_t *obj;
+  int i;
+  bool ok;
+
+  init_asm(&as, x86_64);
+  assemble_text(&as, text, len);
+  for (i = 0; i < as.syms_num && !as.failed; ++i)
+    {
+      sym_t *sym = &as.syms[i];
+      if (sym->used && sym->section == SEC_UNDEF && !sym->external)
+        asm_error(&as, "undefined symbol `%s'", sym->name);
+    }
+
+  ok = !as.failed;
+  if (ok)
+    {
+      obj = new_elf_obj(x86_64);
+      for (i = 0; i < SECS_NUM; ++i)
+        {
+          size_t size;
+          data[i] = emit_section(&as, i, &size);
+          elf_secs[i] = elf_add_section(obj, sec_names[i], i == SEC_TEXT, data[i], size);
+        }
+      for (i = 0; i < as.syms_num; ++i)
+        {
+          sym_t *sym = &as.syms[i];
+          if (sym->section != SEC_UNDEF)
+            {
+              sym->elf_sym = elf_add_symbol(obj, sym->name, elf_secs[sym->section],
+                                            final_pos(&as.secs[sym->section], sym->pos),
+                                            sym->global);
+            }
+          else if (sym->used)
+            sym->elf_sym = elf_add_symbol(obj, sym->name, ELF_UNDEF, 0, true);
+        }
+      for (i = 0; i < SECS_NUM; ++i)
+        {
+          add_relocs(&as, obj, i, elf_secs[i]);
+        }
+      ok = write_elf_obj(obj, fout);
+      if (!ok)
+        fprintf(stderr, "%s: cannot write the object file\n", cur_filename);
+      free_elf_obj(obj);
+      for (i = 0; i < SECS_NUM; ++i)
+        {
+          free(data[i]);
+        }
+    }
+  free_asm(&as);
+  return ok;
+}
+
+//--------------------------------------------------------------------
+
+/* loading into memory */
+
+/* A stub through which the code calls an external function, which may
+   be too far for a 32-bit displacement: jmp qword [rip + 0] followed
+   by the address. */
+#define STUB_SIZE 16
+
+struct Asm_image{
+  unsigned char *mem;
+  size_t mem_size;
+  image_sym_t *syms;
+  int syms_num;
+};
+
+static int compare_image_syms(const void *a, const void *b)
+{
+  const image_sym_t *sym1 = a;
+  const image_sym_t *sym2 = b;
+  return sym1->addr < sym2->addr ? -1 : sym1->addr > sym2->addr ? 1 : 0;
+}
+
+static void put_field(asm_t *as, unsigned char *p, long long val)
+{
+  if (val < -0x80000000LL || val > 0x7fffffffLL)
+    asm_error(as, "address out of range");
+  put32(p, (unsigned) val);
+}
+
+/* Resolves the references between the sections and to the external
+   symbols, given the addresses of the sections and of the symbols. */
+static void relocate(asm_t *as, unsigned char **base, unsigned char **addrs)
+{
+  int i;
+  size_t k;
+  for (i = 0; i < SECS_NUM; ++i)
+    {
+      section_t *sec = &as->secs[i];
+      for (k = 0; k < sec->jumps_num; ++k)
+        {
+          jump_t *jump = &sec->jumps[k];
+          if (as->syms[jump->sym].section != i)
+            {
+              size_t len = jump->cc == CC_ALWAYS ? 5 : 6;
+              unsigned char *p = base[i] + final_pos(sec, jump->pos) + len - 4;
+              put_field(as, p, addrs[jump->sym] - (p + 4));
+            }
+        }
+      for (k = 0; k < sec->fixups_num; ++k)
+        {
+          fixup_t *fixup = &sec->fixups[k];
+          unsigned char *p = base[i] + final_pos(sec, fixup->pos);
+          long long val = (int) get32(p);
+          if (fixup->kind == ELF_ABS32)
+            put_field(as, p, val + (long long) (intptr_t) addrs[fixup->sym]);
+          else if (as->syms[fixup->sym].section != i)
+            put_field(as, p, val + (addrs[fixup->sym] - p));
+        }
+    }
+}
+
+asm_image_t *load_x86_64(const char *text, size_t len, void *(*resolve)(const char *name))
+{
+  asm_t as;
+  asm_image_t *image = NULL;
+  unsigned char *data[SECS_NUM] = { NULL, NULL };
+  size_t sizes[SECS_NUM];
+  unsigned char *base[SECS_NUM];
+  unsigned char **addrs;
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t stubs_off, data_off, mem_size;
+  unsigned char *mem = MAP_FAILED;
+  int stubs_num = 0;
+  int i, k;
+
+  init_asm(&as, true);
+  assemble_text(&as, text, len);
+  addrs = xmalloc((as.syms_num + 1) * sizeof(unsigned char*));
+  if (as.failed)
+    goto done;
+  for (i = 0; i < SECS_NUM; ++i)
+    {
+      data[i] = emit_section(&as, i, &sizes[i]);
+    }
+  // the code, the stubs, and the data on its own pages
+  for (i = 0; i < as.syms_num; ++i)
+    {
+      if (as.syms[i].used && as.syms[i].section == SEC_UNDEF)
+        ++stubs_num;
+    }
+  stubs_off = (sizes[SEC_TEXT] + STUB_SIZE - 1) / STUB_SIZE * STUB_SIZE;
+  data_off = (stubs_off + stubs_num * STUB_SIZE + page) / page * page;
+  mem_size = (data_off + sizes[SEC_DATA] + page - 1) / page * page;
+  mem = mmap(NULL, mem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED)
+    {
+      perror("cannot allocate memory for the code");
+      as.failed = true;
+      goto done;
+    }
+  base[SEC_TEXT] = mem;
+  base[SEC_DATA] = mem + data_off;
+  for (i = 0; i < SECS_NUM; ++i)
+    {
+      memcpy(base[i], data[i], sizes[i]);
+    }
+
+  k = 0;
+  for (i = 0; i < as.syms_num; ++i)
+    {
+      sym_t *sym = &as.syms[i];
+      if (sym->section != SEC_UNDEF)
+        addrs[i] = base[sym->section] + final_pos(&as.secs[sym->section], sym->pos);
+      else if (sym->used)
+        {
+          void *target = resolve(sym->name);
+          unsigned char *stub = mem + stubs_off + STUB_SIZE * k++;
+          if (target == NULL)
+            asm_error(&as, "undefined symbol `%s'", sym->name);
+          stub[0] = 0xff;
+          stub[1] = 0x25;
+          put32(stub + 2, 0);
+          memcpy(stub + 6, &target, sizeof(target));
+          addrs[i] = stub;
+        }
+      else
+        addrs[i] = NULL;
+    }
+  relocate(&as, base, addrs);
+  if (as.failed)
+    goto done;
+  if (mprotect(mem, data_off, PROT_READ | PROT_EXEC) != 0)
+    {
+      perror("cannot make the code executable");
+      as.failed = true;
+      goto done;
+    }
+
+  image = xmalloc(sizeof(asm_image_t));
+  image->mem = mem;
+  image->mem_size = mem_size;
+  image->syms_num = 0;
+  for (i = 0; i < as.syms_num; ++i)
+    {
+      if (as.syms[i].global && as.syms[i].section == SEC_TEXT)
+        ++image->syms_num;
+    }
+  image->syms = xmalloc((image->syms_num + 1) * sizeof(image_sym_t));
+  k = 0;
+  for (i = 0; i < as.syms_num; ++i)
+    {
+      if (as.syms[i].global && as.syms[i].section == SEC_TEXT)
+        {
+          image->syms[k].name = xstrdup(as.syms[i].name);
+          image->syms[k].addr = addrs[i];
+          ++k;
+        }
+    }
+  qsort(image->syms, image->syms_num, sizeof(image_sym_t), compare_image_syms);
+  for (k = 0; k < image->syms_num; ++k)
+    {
+      unsigned char *end = k + 1 < image->syms_num ? image->syms[k + 1].addr :
+        mem + sizes[SEC_TEXT];
+      image->syms[k].size = end - (unsigned char*) image->syms[k].addr;
+    }
+
+ done:
+  if (image == NULL && mem != MAP_FAILED)
+    munmap(mem, mem_size);
+  for (i = 0; i < SECS_NUM; ++i)
+    {
+      free(data[i]);
+    }
+  free(addrs);
+  free_asm(&as);
+  return image;
+}
+
+void *image_symbol(asm_image_t *image, const char *name)
+{
+  int i;
+  for (i = 0; i < image->syms_num; ++i)
+    {
+      if (strcmp(image->syms[i].name, name) == 0)
+        return image->syms[i].addr;
+    }
+  return NULL;
+}
+
+const image_sym_t *image_code_syms(asm_image_t *image, int *num)
+{
+  *num = image->syms_num;
+  return image->syms;
+}
+
+void free_image(asm_image_t *image)
+{
+  int i;
+  munmap(image->mem, image->mem_size);
+  for (i = 0; i < image->syms_num; ++i)
+    {
+      free((char*) image->syms[i].name);
+    }
+  free(image->syms);
+  free(image);
+}
+
+//--------------------------------------------------------------------
+
+bool assemble_i386(const char *text, size_t len, FILE *fout)
+{
+  return assemble(text, len, fout, false);
+}
+
+bool assemble_x86_64(const char *text, size_t len, FILE *fout)
+{
+  return assemble(text, len, fout, true);
+}
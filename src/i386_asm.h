@@ -0,0 +1,39 @@
+/* i386_asm.h - in-process assembler for the i386 and x86-64 backends */
+
+#ifndef I386_ASM_H
+#define I386_ASM_H
+
+#include <stdio.h>
+#include "utils.h"
+
+/* Assembles the NASM code written by the i386 backend -- the runtime
+   routines followed by the functions -- into an ELF32 relocatable
+   object written to fout. Only the part of NASM's syntax which the
+   backend, the peephole rules and the runtime use is recognized.
+   Returns false after reporting an error if the text cannot be
+   assembled or the object cannot be written. */
+bool assemble_i386(const char *text, size_t len, FILE *fout);
+/* The same for the code of the x86-64 backend, into an ELF64 object. */
+bool assemble_x86_64(const char *text, size_t len, FILE *fout);
+
+/* x86-64 code assembled into executable memory */
+typedef struct Asm_image asm_image_t;
+
+typedef struct{
+  const char *name;
+  void *addr;
+  size_t size; // up to the next symbol or the end of the code
+} image_sym_t;
+
+/* Assembles the code of the x86-64 backend into executable memory.
+   The symbols which the code uses but does not define are bound to
+   the addresses returned by resolve(), which returns NULL for an
+   unknown symbol. Returns NULL after reporting an error. */
+asm_image_t *load_x86_64(const char *text, size_t len, void *(*resolve)(const char *name));
+/* Returns the address of a global symbol of the code, or NULL. */
+void *image_symbol(asm_image_t *image, const char *name);
+/* Returns the global symbols of the code in the order of addresses. */
+const image_sym_t *image_code_syms(asm_image_t *image, int *num);
+void free_image(asm_image_t *image);
+
+#endif
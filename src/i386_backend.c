@@ -1,119 +1,62 @@
 #include "outbuf.h"
+#include "peephole.h"
 #include "flags.h"
+#include "i386_ir.h"
 #include "i386_backend.h"
 
-static outbuf_t *outbuf;
-
-#define REG_EAX 0
-#define REG_EBX 1
-#define REG_ECX 2
-#define REG_EDX 3
-#define REG_EDI 4
-#define REG_ESI 5
-#define REG_EBP 6
+static __thread outbuf_t *outbuf;
+static __thread i386_code_t *code;
 
 //--------------------------------------------------------------------
 
 // this is a per-function limit
 #define MAX_DOUBLE_CONSTS 256
 
-static double double_consts[MAX_DOUBLE_CONSTS];
-static int dc_num = -1; // the number of double constants - 1
+static __thread double double_consts[MAX_DOUBLE_CONSTS];
+static __thread int dc_num = -1; // the number of double constants - 1
 
-static int cur_func_args_size;
-static const char *cur_func_name;
+static __thread int cur_func_args_size;
+static __thread const char *cur_func_name;
 
-static int stack_adjustment_off;
-static bool fpu_initialised;
-static int str_const_num = 0;
+static __thread int stack_adjustment_off;
+static __thread bool fpu_initialised;
+static __thread int str_const_num = 0; // per function, like the double constants
 
-static int disallowed_fpu_reg_for_freeing = -1;
+static __thread int disallowed_fpu_reg_for_freeing = -1;
 
-//--------------------------------------------------------------------
+#define RUNTIME_CHUNK_SIZE 4096
 
-inline static const char *size_str(int size)
-{
-  switch (size){
-  case 1:
-    return "byte";
-  case 2:
-    return "word";
-  case 4:
-    return "dword";
-  case 8:
-    return "qword";
-  default:
-    xabort("size_str()");
-    return NULL;
-  };
-}
+static char *runtime; // the text of the runtime routines
+static size_t runtime_size;
+
+//--------------------------------------------------------------------
 
-static const char *jmp_str(quadr_op_t op)
+static i386_opcode_t jmp_op(quadr_op_t op)
 {
   switch (op){
   case Q_IF_EQ:
-    return "je";
+    return I_JE;
   case Q_IF_NE:
-    return "jne";
+    return I_JNE;
   case Q_IF_LT:
-    return "jl";
+    return I_JL;
   case Q_IF_GT:
-    return "jg";
+    return I_JG;
   case Q_IF_LE:
-    return "jle";
+    return I_JLE;
   case Q_IF_GE:
-    return "jge";
+    return I_JGE;
   default:
-    xabort("jmp_str()");
-    return NULL;
+    xabort("jmp_op()");
+    return I_JMP;
   };
 }
 
-static const char *reg32_str(int reg32)
+static i386_operand_t loc_opd(loc_t *loc)
 {
-  switch (reg32){
-  case REG_EAX:
-    return "eax";
-  case REG_EBX:
-    return "ebx";
-  case REG_ECX:
-    return "ecx";
-  case REG_EDX:
-    return "edx";
-  case REG_EDI:
-    return "edi";
-  case REG_ESI:
-    return "esi";
-  case REG_EBP:
-    return "ebp";
-  default:
-    xabort("reg32_str()");
-    return "";
-  };
-}
-
-#define MAX_STR_LEN 256
-#define MAX_CTS 36
-
-static char tmp_str[MAX_CTS][MAX_STR_LEN + 1];
-static int cts = 0;
-
-static const char *loc_str(loc_t *loc)
-{
-  /* We merrily assume here that no function in this file will ever
-     use more than MAX_CTS results of loc_str() at once. Such
-     assumptions usually turn out to be wrong sooner or later, but I'm
-     too lazy to write dynamic allocation code and my preference for
-     awkwardly understood `simplicity' prevents me from switching to
-     C++. */
-  if (cts == MAX_CTS)
-    {
-      cts = 0;
-    }
   switch(loc->tag){
   case LOC_INT:
-    snprintf(tmp_str[cts], MAX_STR_LEN, "%d", loc->u.int_val);
-    return tmp_str[cts++];
+    return opd_imm(loc->u.int_val);
   case LOC_DOUBLE:
     {
       int i;
@@ -131,66 +74,146 @@ static const char *loc_str(loc_t *loc)
           double_consts[dc_num] = val;
           i = dc_num;
         }
-      snprintf(tmp_str[cts], MAX_STR_LEN, "qword [__dconst_%s_%d]", cur_func_name, i);
-      return tmp_str[cts++];
+      return opd_dconst(i);
     }
   case LOC_REG:
-    return reg32_str(loc->u.reg);
+    return opd_reg32(loc->u.reg);
   case LOC_FPU_REG:
-    snprintf(tmp_str[cts], MAX_STR_LEN, "st%zu", loc->u.fpu_reg);
-    return tmp_str[cts++];
+    return opd_fpu_reg(loc->u.fpu_reg);
   case LOC_STACK:
-    snprintf(tmp_str[cts], MAX_STR_LEN, "%s [@FP@%d@]",
-             size_str(loc->u.stack_elem->size),
-             loc->u.stack_elem->offset + loc->u.stack_elem->size - stack_adjustment_off);
-    return tmp_str[cts++];
+    return opd_stack(loc->u.stack_elem->size, loc->u.stack_elem->offset +
+                     loc->u.stack_elem->size - stack_adjustment_off);
   default:
-    xabort("programming error - loc_str()");
+    xabort("programming error - loc_opd()");
   };
-  return NULL;
+  return opd_imm(0);
 }
 
-static const char *array_loc_str(loc_t *loc)
+/* The address of a stack slot, without the size. */
+static i386_operand_t array_loc_opd(loc_t *loc)
 {
   assert (loc->tag == LOC_STACK);
-  if (cts == MAX_CTS)
-    {
-      cts = 0;
-    }
-  snprintf(tmp_str[cts], MAX_STR_LEN, "[@FP@%d@]",
-           loc->u.stack_elem->offset + loc->u.stack_elem->size - stack_adjustment_off);
-  return tmp_str[cts++];
+  return opd_stack(0, loc->u.stack_elem->offset + loc->u.stack_elem->size -
+                   stack_adjustment_off);
+}
+
+/* [base + index] where index is a register or a constant */
+static i386_operand_t lea_addr_opd(loc_t *base, loc_t *index)
+{
+  assert (base->tag == LOC_REG);
+  if (index->tag == LOC_REG)
+    return opd_mem_index(0, base->u.reg, index->u.reg, 0);
+  assert (index->tag == LOC_INT);
+  return opd_mem_disp(0, base->u.reg, '+', index->u.int_val);
+}
+
+/* [base + size * index] -- an array element */
+static i386_operand_t ptr_opd(int size, loc_t *base, loc_t *index)
+{
+  assert (base->tag == LOC_REG);
+  if (index->tag == LOC_REG)
+    return opd_mem_index(size, base->u.reg, index->u.reg, size);
+  assert (index->tag == LOC_INT);
+  return opd_mem_const_index(size, base->u.reg, index->u.int_val, size);
+}
+
+/* a jump target */
+inline static i386_operand_t opd_label(basic_block_t *block)
+{
+  return opd_block_label(code, cur_func_name, get_label_for_block(block));
+}
+
+/* Prevents the register holding var from being allocated until
+   release_reg() is called, so that loading another operand of the
+   current instruction does not evict var. Returns the register, or -1
+   if var is not in an allocatable register. */
+static reg_t keep_reg(var_t *var)
+{
+  loc_t *loc = std_find_best_src_loc(var);
+  if (loc->tag != LOC_REG || !loc_is_allowed(loc))
+    return -1;
+  deny_reg(loc->u.reg, LOC_REG);
+  return loc->u.reg;
+}
+
+static void release_reg(reg_t reg)
+{
+  if (reg != -1)
+    allow_reg(reg, LOC_REG);
 }
 
 static void gen_return(int args_size)
 {
-  writeln(outbuf, "@E@");
-  writeln(outbuf, "ret %d", args_size);
+  emit0(code, I_EPILOGUE);
+  emit1(code, I_RET, opd_imm(args_size));
 }
 
 //--------------------------------------------------------------------
 
-static void init()
+/* The runtime routines and the peephole rules are read once, when
+   the first program is initialized (so a missing data file is not
+   reported for programs that fail to compile), and shared by all the
+   programs compiled with the backend. */
+
+static const char *load_data()
 {
   FILE *fin = fopen(f_runtime_path, "r");
-  int c;
+  size_t n;
   if (fin == NULL)
     {
-      xabort("Cannot open data file with runtime routines. Check whether the data\n"
-             "directory (JL_DATA_DIR environment variable) is set correctly.\n");
+      return "Cannot open data file with runtime routines. Check whether the data\n"
+        "directory (JL_DATA_DIR environment variable) is set correctly.";
+    }
+  if (f_optimize_peephole && f_peephole_rules_file_path != NULL)
+    {
+      FILE *frules = fopen(f_peephole_rules_file_path, "r");
+      if (frules == NULL)
+        {
+          fclose(fin);
+          return "Cannot open peephole optimization rules file. Check whether the data\n"
+            "directory (JL_DATA_DIR environment variable) is set correctly.";
+        }
+      load_rules(frules);
+      fclose(frules);
     }
-  while ((c = fgetc(fin)) != EOF)
+
+  runtime_size = 0;
+  runtime = xmalloc(RUNTIME_CHUNK_SIZE);
+  while ((n = fread(runtime + runtime_size, 1, RUNTIME_CHUNK_SIZE, fin)) > 0)
     {
-      fputc(c, backend->fout);
+      runtime_size += n;
+      runtime = xrealloc(runtime, runtime_size + RUNTIME_CHUNK_SIZE);
     }
   fclose(fin);
+  return NULL;
+}
 
-  outbuf = new_outbuf();
+static const char *init()
+{
+  if (runtime == NULL)
+    {
+      const char *error = load_data();
+      if (error != NULL)
+        return error;
+    }
+  fwrite(runtime, 1, runtime_size, backend->fout);
+  return NULL;
 }
 
 static void final()
+{
+}
+
+static void init_thread()
+{
+  outbuf = new_outbuf();
+  code = new_i386_code(32);
+}
+
+static void final_thread()
 {
   free_outbuf(outbuf);
+  free_i386_code(code);
 }
 
 static void start_func(quadr_func_t *func)
@@ -199,11 +222,11 @@ static void start_func(quadr_func_t *func)
   size_t stack_off = 4;
   size_t reg32_num = 0;
 
-  clearbuf(outbuf);
+  clear_i386_code(code);
 
-  writeln(outbuf, "section .text");
-  writeln(outbuf, "%s:", func->name);
-  writeln(outbuf, "@P@");
+  emit0(code, I_SECTION_TEXT);
+  emit1(code, I_LABEL, opd_sym(code, func->name));
+  emit0(code, I_PROLOGUE);
   assert (func->vars_lst.head != NULL);
   assert (func->type->args_num <= func->vars_lst.head->vars_size);
   for (i = 0; i < func->type->args_num; ++i)
@@ -228,12 +251,11 @@ static void start_func(quadr_func_t *func)
   stack_adjustment_off = 0;
   fpu_initialised = false;
   dc_num = -1;
+  str_const_num = 0;
 }
 
 static void end_func(quadr_func_t *func, size_t stack_size)
 {
-  char prologue[256];
-  char epilogue[256];
   int i;
 
   // this is not strictly necessary, because tree.c should generate a
@@ -257,16 +279,11 @@ static void end_func(quadr_func_t *func, size_t stack_size)
       gen_return(cur_func_args_size);
     }
 
-  if (stack_size > 0)
-    {
-      snprintf(prologue, 256, "sub esp, %zu", stack_size);
-      snprintf(epilogue, 256, "add esp, %zu", stack_size);
-    }
-  else
+  render_i386_code(code, outbuf, cur_func_name, stack_size);
+  if (f_optimize_peephole)
     {
-      prologue[0] = epilogue[0] = '\0';
+      peephole(outbuf);
     }
-  fix_stack(outbuf, stack_size, prologue, epilogue, "esp + %d");
 
   writeln(outbuf, "section .data");
   for (i = 0; i <= dc_num; ++i)
@@ -274,7 +291,7 @@ static void end_func(quadr_func_t *func, size_t stack_size)
       writeln(outbuf, "__dconst_%s_%d dq %f", cur_func_name, i, double_consts[i]);
     }
 
-  writeout(outbuf, backend->fout);
+  writeout(outbuf, gencode_fout);
   clearbuf(outbuf);
 }
 
@@ -282,17 +299,17 @@ static void end_func(quadr_func_t *func, size_t stack_size)
 
 /* gen_code */
 
-static var_t *var0; // the result
-static var_t *var1; // first arg
-static var_t *var2; // second arg
-static loc_t *loc0;
-static loc_t *loc1;
-static loc_t *loc2;
-static bool live1; // liveness status of var1 _after_ the current quadruple
-static bool live2;
-static bool should_free_loc0;
-static bool should_free_loc1;
-static bool should_free_loc2;
+static __thread var_t *var0; // the result
+static __thread var_t *var1; // first arg
+static __thread var_t *var2; // second arg
+static __thread loc_t *loc0;
+static __thread loc_t *loc1;
+static __thread loc_t *loc2;
+static __thread bool live1; // liveness status of var1 _after_ the current quadruple
+static __thread bool live2;
+static __thread bool should_free_loc0;
+static __thread bool should_free_loc1;
+static __thread bool should_free_loc2;
 
 #define we_may_change_loc(v, l, lv) (!loc_is_const(l) && (loc_num(v) > 1 || !lv) && ref_num(l) == 1)
 #define swap_args()                              \
@@ -302,6 +319,26 @@ static bool should_free_loc2;
     swap(live1, live2, bool);                    \
   }
 
+/* Emits FINIT before the first use of the FPU after a call. The flag
+   follows the linear order of the code, so at the start of a block
+   the FPU stack may hold values loaded on the path to the block even
+   if the block emitted just before ended with a call; FINIT would
+   destroy them, and they show that the FPU is initialised anyway. */
+static void init_fpu()
+{
+  int i;
+  if (fpu_initialised)
+    return;
+  for (i = 0; i < backend->fpu_reg_num; ++i)
+    {
+      if (!is_free(i, LOC_FPU_REG))
+        break;
+    }
+  if (i == backend->fpu_reg_num)
+    emit0(code, I_FINIT);
+  fpu_initialised = true;
+}
+
 /* This function saves all variables present in `loc' (the location
    where we're going to save the result) and assigns it to loc0. It
    should be called immediately _before_ writing any code. The
@@ -343,7 +380,7 @@ static void update_locations(loc_t *aloc)
   if (var2 != NULL && !var2->live)
     discard_var(var2);
   disallowed_fpu_reg_for_freeing = -1;
-  flush_loc(loc0);
+  flush_loc_keeping(loc0, loc1, loc2);
   update_var_loc(var0, loc0);
   var0->live = true;
 }
@@ -355,28 +392,29 @@ static void write_reg32_op_3(quadr_op_t op)
     {
       if (loc1->tag == LOC_REG && loc2->tag == LOC_INT)
         {
-          writeln(outbuf, "lea %s, [%s - %s]", loc_str(loc0), loc_str(loc1), loc_str(loc2));
+          emit2(code, I_LEA, loc_opd(loc0),
+                opd_mem_disp(0, loc1->u.reg, '-', loc2->u.int_val));
         }
       else
         {
-          writeln(outbuf, "mov %s, %s", loc_str(loc0), loc_str(loc1));
-          writeln(outbuf, "sub %s, %s", loc_str(loc0), loc_str(loc2));
+          emit2(code, I_MOV, loc_opd(loc0), loc_opd(loc1));
+          emit2(code, I_SUB, loc_opd(loc0), loc_opd(loc2));
         }
     }
   else if (op == Q_ADD)
     {
       if (loc2->tag == LOC_REG && (loc1->tag == LOC_REG || loc1->tag == LOC_INT))
         {
-          writeln(outbuf, "lea %s, [%s + %s]", loc_str(loc0), loc_str(loc2), loc_str(loc1));
+          emit2(code, I_LEA, loc_opd(loc0), lea_addr_opd(loc2, loc1));
         }
       else if (loc1->tag == LOC_REG && (loc2->tag == LOC_REG || loc2->tag == LOC_INT))
         {
-          writeln(outbuf, "lea %s, [%s + %s]", loc_str(loc0), loc_str(loc1), loc_str(loc2));
+          emit2(code, I_LEA, loc_opd(loc0), lea_addr_opd(loc1, loc2));
         }
       else
         {
-          writeln(outbuf, "mov %s, %s", loc_str(loc0), loc_str(loc1));
-          writeln(outbuf, "add %s, %s", loc_str(loc0), loc_str(loc2));
+          emit2(code, I_MOV, loc_opd(loc0), loc_opd(loc1));
+          emit2(code, I_ADD, loc_opd(loc0), loc_opd(loc2));
         }
     }
   else
@@ -384,16 +422,16 @@ static void write_reg32_op_3(quadr_op_t op)
       assert (op == Q_MUL);
       if (loc1->tag == LOC_INT && loc2->tag == LOC_INT)
         {
-          writeln(outbuf, "mov %s, %d", loc_str(loc0), loc1->u.int_val * loc2->u.int_val);
+          emit2(code, I_MOV, loc_opd(loc0), opd_imm(loc1->u.int_val * loc2->u.int_val));
         }
       else if (loc1->tag == LOC_INT)
         {
-          writeln(outbuf, "imul %s, %s, %s", loc_str(loc0), loc_str(loc2), loc_str(loc1));
+          emit3(code, I_IMUL, loc_opd(loc0), loc_opd(loc2), loc_opd(loc1));
         }
       else
         {
-          writeln(outbuf, "mov %s, %s", loc_str(loc0), loc_str(loc1));
-          writeln(outbuf, "imul %s, %s", loc_str(loc0), loc_str(loc2));
+          emit2(code, I_MOV, loc_opd(loc0), loc_opd(loc1));
+          emit2(code, I_IMUL, loc_opd(loc0), loc_opd(loc2));
         }
     }
 }
@@ -403,16 +441,16 @@ static void write_reg32_op_2(quadr_op_t op)
   assert (loc0->tag == LOC_REG || (loc0->tag == LOC_STACK && loc2->tag != LOC_STACK));
   if (op == Q_SUB)
     {
-      writeln(outbuf, "sub %s, %s", loc_str(loc0), loc_str(loc2));
+      emit2(code, I_SUB, loc_opd(loc0), loc_opd(loc2));
     }
   else if (op == Q_ADD)
     {
-      writeln(outbuf, "add %s, %s", loc_str(loc0), loc_str(loc2));
+      emit2(code, I_ADD, loc_opd(loc0), loc_opd(loc2));
     }
   else
     {
       assert (op == Q_MUL);
-      writeln(outbuf, "imul %s, %s", loc_str(loc0), loc_str(loc2));
+      emit2(code, I_IMUL, loc_opd(loc0), loc_opd(loc2));
     }
 }
 
@@ -421,11 +459,11 @@ static void gen_div_mod_32(quadr_op_t op)
   loc_t *loc;
   if (loc2->tag == LOC_INT)
     {
-      int val = loc2->u.int_val;
+      unsigned val = loc2->u.int_val;
       bool sign = false;
       int cnt = 0;
       int lg = -1;
-      if (val < 0)
+      if (loc2->u.int_val < 0)
         {
           sign = true;
           val = -val;
@@ -458,29 +496,66 @@ static void gen_div_mod_32(quadr_op_t op)
                   loc0 = std_find_best_dest_loc(var1);
                 }
               update_locations(loc0);
-              if (op == Q_DIV)
+              if (lg > 0)
                 {
-                  if (lg > 0)
-                    writeln(outbuf, "sar %s, %d", loc_str(loc0), lg);
-                  if (sign)
-                    writeln(outbuf, "neg %s", loc_str(loc0));
+                  /* SAR rounds towards minus infinity, so 2^lg - 1 is
+                     added to a negative dividend first; the remainder
+                     is then taken from the biased dividend and the
+                     bias subtracted again */
+                  loc_t *tmp;
+                  i386_operand_t bias;
+                  bool deny = loc0->tag == LOC_REG && loc_is_allowed(loc0);
+                  if (deny)
+                    deny_reg(loc0->u.reg, LOC_REG);
+                  tmp = alloc_reg(LOC_REG);
+                  if (deny)
+                    allow_reg(loc0->u.reg, LOC_REG);
+                  bias = opd_reg32(tmp->u.reg);
+                  emit2(code, I_MOV, bias, loc_opd(loc0));
+                  emit2(code, I_SAR, bias, opd_imm(31));
+                  emit2(code, I_AND, bias, opd_imm((1u << lg) - 1));
+                  emit2(code, I_ADD, loc_opd(loc0), bias);
+                  if (op == Q_DIV)
+                    {
+                      emit2(code, I_SAR, loc_opd(loc0), opd_imm(lg));
+                    }
+                  else
+                    {
+                      assert (op == Q_MOD);
+                      emit2(code, I_AND, loc_opd(loc0), opd_imm((1u << lg) - 1));
+                      emit2(code, I_SUB, loc_opd(loc0), bias);
+                    }
+                  free_loc(tmp);
                 }
-              else
+              else if (op == Q_MOD)
+                { // x % -1 == 0
+                  emit2(code, I_AND, loc_opd(loc0), opd_imm(0));
+                }
+              if (op == Q_DIV && sign)
                 {
-                  assert (op == Q_MOD);
-                  writeln(outbuf, "and %s, %d", loc_str(loc0), (1 << lg) - 1);
+                  emit1(code, I_NEG, loc_opd(loc0));
                 }
             }
           else
-            {
+            { // x / 1 == x, x % 1 == 0
               quadr_arg_t arg;
-              arg.tag = QA_VAR;
-              arg.u.var = var1;
+              if (op == Q_DIV)
+                {
+                  arg.tag = QA_VAR;
+                  arg.u.var = var1;
+                }
+              else
+                {
+                  arg.tag = QA_INT;
+                  arg.u.int_val = 0;
+                }
               var1->live = live1;
               var2->live = live2;
               var0->live = true;
               loc0 = loc1;
-              copy_to_var(var0, arg);
+              // copy_to_var() discards the old locations of var0
+              if (arg.tag != QA_VAR || var0 != var1)
+                copy_to_var(var0, arg);
             }
           return;
         }
@@ -503,7 +578,7 @@ static void gen_div_mod_32(quadr_op_t op)
   if (loc == NULL)
     {
       loc1 = std_find_best_src_loc(var1);
-      writeln(outbuf, "mov eax, %s", loc_str(loc1));
+      emit2(code, I_MOV, opd_reg32(REG_EAX), loc_opd(loc1));
     }
   if (op == Q_DIV)
     {
@@ -517,23 +592,23 @@ static void gen_div_mod_32(quadr_op_t op)
   should_free_loc0 = true;
   update_locations(loc0);
 
-  writeln(outbuf, "xor edx, edx");
-  writeln(outbuf, "test eax, eax");
-  writeln(outbuf, "sets dl");
-  writeln(outbuf, "neg edx");
+  emit2(code, I_XOR, opd_reg32(REG_EDX), opd_reg32(REG_EDX));
+  emit2(code, I_TEST, opd_reg32(REG_EAX), opd_reg32(REG_EAX));
+  emit1(code, I_SETS, opd_reg(REG_EDX, 1));
+  emit1(code, I_NEG, opd_reg32(REG_EDX));
   if (loc2->tag == LOC_INT)
     {
       free_reg(REG_EBP);
-      writeln(outbuf, "mov ebp, %s", loc_str(loc2));
-      writeln(outbuf, "idiv ebp");
+      emit2(code, I_MOV, opd_reg32(REG_EBP), loc_opd(loc2));
+      emit1(code, I_IDIV, opd_reg32(REG_EBP));
     }
   else
-    writeln(outbuf, "idiv %s", loc_str(loc2));
+    emit1(code, I_IDIV, loc_opd(loc2));
   allow_reg(REG_EAX, LOC_REG);
   allow_reg(REG_EDX, LOC_REG);
 }
 
-static void gen_fpu_cmp(quadr_op_t op, const char *label)
+static void gen_fpu_cmp(quadr_op_t op, i386_operand_t label)
 {
   bool swapped = false;
   loc_t fpu_top;
@@ -543,19 +618,19 @@ static void gen_fpu_cmp(quadr_op_t op, const char *label)
       fpu_load(var1); // doesn't change loc1, loc2
       if (live1 || ref_num(&fpu_top) > 1)
         {
-          writeln(outbuf, "fcom %s", loc_str(loc2));
+          emit1(code, I_FCOM, loc_opd(loc2));
         }
       else
         {
-          writeln(outbuf, "fcom %s", loc_str(loc2));
+          emit1(code, I_FCOM, loc_opd(loc2));
           var1->live = live1;
           fpu_pop();
           discard_var(var1);
         }
       free_reg(REG_EAX);
-      writeln(outbuf, "fstsw ax");
-      writeln(outbuf, "fwait");
-      writeln(outbuf, "sahf");
+      emit1(code, I_FSTSW, opd_reg(REG_EAX, 2));
+      emit0(code, I_FWAIT);
+      emit0(code, I_SAHF);
     }
   else if (loc1->tag == LOC_FPU_REG && loc2->tag == LOC_FPU_REG && f_pentium_pro)
     {
@@ -570,16 +645,16 @@ static void gen_fpu_cmp(quadr_op_t op, const char *label)
         }
       if (live1 || ref_num(&fpu_top) > 1)
         {
-          writeln(outbuf, "fcomi %s", loc_str(loc2));
+          emit1(code, I_FCOMI, loc_opd(loc2));
         }
       else
         {
-          writeln(outbuf, "fcomi %s", loc_str(loc2));
+          emit1(code, I_FCOMI, loc_opd(loc2));
           var1->live = live1;
           fpu_pop();
           discard_var(var1);
         }
-      writeln(outbuf, "fwait");
+      emit0(code, I_FWAIT);
     }
   else
     {
@@ -594,47 +669,47 @@ static void gen_fpu_cmp(quadr_op_t op, const char *label)
         }
       if (live1 || ref_num(&fpu_top) > 1)
         {
-          writeln(outbuf, "fcom %s", loc_str(loc2));
+          emit1(code, I_FCOM, loc_opd(loc2));
         }
       else
         {
-          writeln(outbuf, "fcom %s", loc_str(loc2));
+          emit1(code, I_FCOM, loc_opd(loc2));
           var1->live = live1;
           fpu_pop();
           discard_var(var1);
         }
       free_reg(REG_EAX);
-      writeln(outbuf, "fstsw ax");
-      writeln(outbuf, "fwait");
-      writeln(outbuf, "sahf");
+      emit1(code, I_FSTSW, opd_reg(REG_EAX, 2));
+      emit0(code, I_FWAIT);
+      emit0(code, I_SAHF);
     }
-  //  writeln(outbuf, "pushf"); moves don't change flags
+  //  emit0(code, I_PUSHF); moves don't change flags
   save_live();
   if (var1 != NULL && !live1)
     discard_var(var1);
   if (var2 != NULL && !live2)
     discard_var(var2);
-  //writeln(outbuf, "popf");
+  //emit0(code, I_POPF);
   if (swapped)
     {
       switch (op){
       case Q_IF_EQ:
-        writeln(outbuf, "je %s", label);
+        emit1(code, I_JE, label);
         break;
       case Q_IF_NE:
-        writeln(outbuf, "jne %s", label);
+        emit1(code, I_JNE, label);
         break;
       case Q_IF_LT:
-        writeln(outbuf, "ja %s", label);
+        emit1(code, I_JA, label);
         break;
       case Q_IF_GT:
-        writeln(outbuf, "jb %s", label);
+        emit1(code, I_JB, label);
         break;
       case Q_IF_LE:
-        writeln(outbuf, "jae %s", label);
+        emit1(code, I_JAE, label);
         break;
       case Q_IF_GE:
-        writeln(outbuf, "jbe %s", label);
+        emit1(code, I_JBE, label);
         break;
       default:
         xabort("wrong if-op");
@@ -644,22 +719,22 @@ static void gen_fpu_cmp(quadr_op_t op, const char *label)
     {
       switch (op){
       case Q_IF_EQ:
-        writeln(outbuf, "je %s", label);
+        emit1(code, I_JE, label);
         break;
       case Q_IF_NE:
-        writeln(outbuf, "jne %s", label);
+        emit1(code, I_JNE, label);
         break;
       case Q_IF_LT:
-        writeln(outbuf, "jb %s", label);
+        emit1(code, I_JB, label);
         break;
       case Q_IF_GT:
-        writeln(outbuf, "ja %s", label);
+        emit1(code, I_JA, label);
         break;
       case Q_IF_LE:
-        writeln(outbuf, "jbe %s", label);
+        emit1(code, I_JBE, label);
         break;
       case Q_IF_GE:
-        writeln(outbuf, "jae %s", label);
+        emit1(code, I_JAE, label);
         break;
       default:
         xabort("wrong if-op");
@@ -667,7 +742,7 @@ static void gen_fpu_cmp(quadr_op_t op, const char *label)
     }
 }
 
-static void gen_cmp(quadr_op_t op, const char *label)
+static void gen_cmp(quadr_op_t op, i386_operand_t label)
 {
   if (loc1->tag != LOC_FPU_REG && loc2->tag != LOC_FPU_REG)
     { // it may be worthwile to move var2 instead...
@@ -675,50 +750,50 @@ static void gen_cmp(quadr_op_t op, const char *label)
       loc1 = std_find_best_src_loc(var1);
       assert (loc1->tag == LOC_REG);
     }
-  writeln(outbuf, "cmp %s, %s", loc_str(loc1), loc_str(loc2));
-  //  writeln(outbuf, "pushf");
+  emit2(code, I_CMP, loc_opd(loc1), loc_opd(loc2));
+  //  emit0(code, I_PUSHF);
   // only arithmetic instructions change flags -- moves don't
   save_live();
   if (var1 != NULL && !live1)
     discard_var(var1);
   if (var2 != NULL && !live2)
     discard_var(var2);
-  //writeln(outbuf, "popf");
-  writeln(outbuf, "%s %s", jmp_str(op), label);
+  //emit0(code, I_POPF);
+  emit1(code, jmp_op(op), label);
 }
 
-inline static const char *fpu_op_str(quadr_op_t op)
+inline static i386_opcode_t fpu_op(quadr_op_t op)
 {
   switch (op){
   case Q_ADD:
-    return "fadd";
+    return I_FADD;
   case Q_SUB:
-    return "fsub";
+    return I_FSUB;
   case Q_MUL:
-    return "fmul";
+    return I_FMUL;
   case Q_DIV:
-    return "fdiv";
+    return I_FDIV;
   case Q_MOD: // modulo unsupported for real numbers -- what would it mean, anyway?
   default:
-    xabort("fpu_op_str()");
-    return NULL;
+    xabort("fpu_op()");
+    return I_FADD;
   };
 }
 
-inline static const char *fpu_op_rev_str(quadr_op_t op)
+inline static i386_opcode_t fpu_op_rev(quadr_op_t op)
 {
   switch (op){
   case Q_ADD:
-    return "fadd";
+    return I_FADD;
   case Q_SUB:
-    return "fsubr";
+    return I_FSUBR;
   case Q_MUL:
-    return "fmul";
+    return I_FMUL;
   case Q_DIV:
-    return "fdivr";
+    return I_FDIVR;
   default:
-    xabort("fpu_op_rev_str()");
-    return NULL;
+    xabort("fpu_op_rev()");
+    return I_FADD;
   };
 }
 
@@ -737,7 +812,7 @@ static void gen_fpu_arithmetic_op(quadr_op_t op)
       loc0 = new_loc(LOC_FPU_REG, 0);
       should_free_loc0 = true;
       update_locations(loc0);
-      writeln(outbuf, "%s %s", fpu_op_str(op), loc_str(loc2));
+      emit1(code, fpu_op(op), loc_opd(loc2));
       return;
     }
 
@@ -760,7 +835,7 @@ static void gen_fpu_arithmetic_op(quadr_op_t op)
             }
           loc0 = loc1;
           update_locations(loc0);
-          writeln(outbuf, "%s st0", fpu_op_str(op));
+          emit1(code, fpu_op(op), opd_fpu_reg(0));
           return;
         }
       else
@@ -781,8 +856,8 @@ static void gen_fpu_arithmetic_op(quadr_op_t op)
         {
           loc0 = loc2;
           update_locations(loc0);
-          writeln(outbuf, "%s %s,st0", swapped ? fpu_op_str(op) : fpu_op_rev_str(op),
-                  loc_str(loc2));
+          emit2(code, swapped ? fpu_op(op) : fpu_op_rev(op), loc_opd(loc2),
+                opd_fpu_reg(0));
           fpu_pop();
         }
       else
@@ -790,8 +865,7 @@ static void gen_fpu_arithmetic_op(quadr_op_t op)
           loc0 = new_loc(LOC_FPU_REG, 0);
           should_free_loc0 = true;
           update_locations(loc0);
-          writeln(outbuf, "%s %s", swapped ? fpu_op_rev_str(op) : fpu_op_str(op),
-                  loc_str(loc2));
+          emit1(code, swapped ? fpu_op_rev(op) : fpu_op(op), loc_opd(loc2));
         }
       return;
     }
@@ -805,10 +879,9 @@ static void gen_fpu_arithmetic_op(quadr_op_t op)
       loc0 = new_loc(LOC_FPU_REG, 0);
       should_free_loc0 = true;
       update_locations(loc0);
-      writeln(outbuf, "%s %s", swapped ? fpu_op_rev_str(op) : fpu_op_str(op),
-              loc_str(loc2));
+      emit1(code, swapped ? fpu_op_rev(op) : fpu_op(op), loc_opd(loc2));
     }
-  else if (we_may_change_loc(var2, loc2, live2))
+  else if (!in_mem2 && we_may_change_loc(var2, loc2, live2))
     {
       if (loc2->u.reg != 0)
         {
@@ -818,8 +891,7 @@ static void gen_fpu_arithmetic_op(quadr_op_t op)
       should_free_loc0 = true;
       loc0 = new_loc(LOC_FPU_REG, 0);
       update_locations(loc0);
-      writeln(outbuf, "%s %s", swapped ? fpu_op_str(op) : fpu_op_rev_str(op),
-              loc_str(loc1));
+      emit1(code, swapped ? fpu_op(op) : fpu_op_rev(op), loc_opd(loc1));
     }
   else
     {
@@ -828,8 +900,7 @@ static void gen_fpu_arithmetic_op(quadr_op_t op)
       should_free_loc0 = true;
       loc0 = new_loc(LOC_FPU_REG, 0);
       update_locations(loc0);
-      writeln(outbuf, "%s %s", swapped ? fpu_op_rev_str(op) : fpu_op_str(op),
-              loc_str(loc2));
+      emit1(code, swapped ? fpu_op_rev(op) : fpu_op(op), loc_opd(loc2));
     }
 }
 
@@ -857,7 +928,8 @@ static void gen_arithmetic_op(quadr_op_t op)
     {
       assert (var0->loc != NULL);
       loc0 = std_find_best_dest_loc(var0);
-      if (loc0->tag == LOC_STACK && loc2->tag == LOC_STACK)
+      // there is no imul with a memory destination
+      if (loc0->tag == LOC_STACK && (loc2->tag == LOC_STACK || op == Q_MUL))
         {
           loc0 = alloc_reg(LOC_REG);
           should_free_loc0 = true;
@@ -901,14 +973,14 @@ static void gen_arithmetic_op(quadr_op_t op)
         {
           loc0 = loc1;
           update_locations(loc0);
-          writeln(outbuf, "sub %s, %s", loc_str(loc1), loc_str(loc2));
+          emit2(code, I_SUB, loc_opd(loc1), loc_opd(loc2));
         }
       else if (we_may_change_loc(var2, loc2, live2) && loc2->tag == LOC_REG)
         {
           loc0 = loc2;
           update_locations(loc0);
-          writeln(outbuf, "neg %s", loc_str(loc2));
-          writeln(outbuf, "add %s, %s", loc_str(loc2), loc_str(loc1));
+          emit1(code, I_NEG, loc_opd(loc2));
+          emit2(code, I_ADD, loc_opd(loc2), loc_opd(loc1));
         }
       else
         {
@@ -917,8 +989,8 @@ static void gen_arithmetic_op(quadr_op_t op)
           loc1 = std_find_best_src_loc(var1);
           loc2 = std_find_best_src_loc(var2);
           update_locations(loc0);
-          writeln(outbuf, "mov %s, %s", loc_str(loc0), loc_str(loc1));
-          writeln(outbuf, "sub %s, %s", loc_str(loc0), loc_str(loc2));
+          emit2(code, I_MOV, loc_opd(loc0), loc_opd(loc1));
+          emit2(code, I_SUB, loc_opd(loc0), loc_opd(loc2));
         }
     }
   else
@@ -952,6 +1024,7 @@ static void gen_arithmetic_op(quadr_op_t op)
 
 static void gen_ptr_op(quadr_op_t op)
 {
+  reg_t keep0, keep1, keep2;
   switch (op){
   case Q_READ_PTR:
     loc1 = std_find_best_src_loc(var1);
@@ -959,38 +1032,62 @@ static void gen_ptr_op(quadr_op_t op)
       {
         move_to_reg(var1);
       }
+    keep1 = keep_reg(var1);
     loc2 = std_find_best_src_loc(var2);
     if (loc2->tag == LOC_STACK)
       {
         move_to_reg(var2);
       }
+    keep2 = keep_reg(var2);
+    if (var0->qtype == VT_DOUBLE)
+      {
+        // loaded at the top of the FPU stack
+        release_reg(keep1);
+        release_reg(keep2);
+        free_fpu_reg(7, true);
+        init_fpu();
+        loc1 = std_find_best_src_loc(var1);
+        loc2 = std_find_best_src_loc(var2);
+        emit1(code, I_FLD, ptr_opd(var0->size, loc1, loc2));
+        ror_fpu_regs();
+        loc0 = new_loc(LOC_FPU_REG, 0);
+        should_free_loc0 = true;
+        update_locations(loc0);
+        break;
+      }
     loc0 = std_find_best_dest_loc(var0);
     if (loc0 == NULL || loc0->tag != LOC_REG)
       {
         loc0 = alloc_reg(LOC_REG);
         should_free_loc0 = true;
       }
+    release_reg(keep1);
+    release_reg(keep2);
     loc1 = std_find_best_src_loc(var1);
     loc2 = std_find_best_src_loc(var2);
     assert (loc0 != NULL && loc0->tag == LOC_REG);
     update_locations(loc0);
-    writeln(outbuf, "mov %s, %s [%s + %d * %s]", loc_str(loc0), size_str(var0->size),
-            loc_str(loc1), var0->size, loc_str(loc2));
+    emit2(code, I_MOV, loc_opd(loc0), ptr_opd(var0->size, loc1, loc2));
     break;
 
   case Q_WRITE_PTR:
     move_to_reg(var0);
+    keep0 = keep_reg(var0);
     loc1 = std_find_best_src_loc(var1);
     if (loc1->tag == LOC_STACK)
       {
         move_to_reg(var1);
       }
+    keep1 = keep_reg(var1);
     loc2 = std_find_best_src_loc(var2);
-    if (loc2->tag == LOC_STACK)
+    // there is no move of a 64-bit immediate to memory
+    if (loc2->tag == LOC_STACK || loc2->tag == LOC_DOUBLE)
       {
         move_to_reg(var2);
         loc2 = std_find_best_src_loc(var2);
       }
+    release_reg(keep0);
+    release_reg(keep1);
     loc1 = std_find_best_src_loc(var1);
     loc0 = std_find_best_src_loc(var0);
     //    update_locations(); -- we don't _write_ to loc0 itself here
@@ -1006,21 +1103,18 @@ static void gen_ptr_op(quadr_op_t op)
           }
         if (var2->live || ref_num(loc2) > 1)
           {
-            writeln(outbuf, "fst %s [%s + %d * %s]", size_str(var2->size), loc_str(loc0),
-                    var2->size, loc_str(loc1));
+            emit1(code, I_FST, ptr_opd(var2->size, loc0, loc1));
           }
         else
           {
-            writeln(outbuf, "fstp %s [%s + %d * %s]", size_str(var2->size), loc_str(loc0),
-                    var2->size, loc_str(loc1));
+            emit1(code, I_FSTP, ptr_opd(var2->size, loc0, loc1));
             flush_loc(loc2);
             rol_fpu_regs();
           }
       }
     else
       {
-        writeln(outbuf, "mov %s [%s + %d * %s], %s", size_str(var2->size), loc_str(loc0),
-                var2->size, loc_str(loc1), loc_str(loc2));
+        emit2(code, I_MOV, ptr_opd(var2->size, loc0, loc1), loc_opd(loc2));
       }
     break;
 
@@ -1030,7 +1124,7 @@ static void gen_ptr_op(quadr_op_t op)
     should_free_loc0 = true;
     loc1 = std_find_best_src_loc(var1);
     update_locations(loc0);
-    writeln(outbuf, "lea %s, %s", loc_str(loc0), array_loc_str(loc1));
+    emit2(code, I_LEA, loc_opd(loc0), array_loc_opd(loc1));
     break;
 
   default:
@@ -1075,11 +1169,7 @@ static void gen_code(quadr_t *quadr)
   if ((var1 != NULL && var1->qtype == VT_DOUBLE) || (var0 != NULL && var0->qtype == VT_DOUBLE) ||
       (var2 != NULL && var2->qtype == VT_DOUBLE))
     {
-      if (!fpu_initialised)
-        {
-          writeln(outbuf, "finit");
-          fpu_initialised = true;
-        }
+      init_fpu();
     }
 
   if (var1 != NULL)
@@ -1122,14 +1212,14 @@ static void gen_code(quadr_t *quadr)
             loc1 = std_find_best_src_loc(var1);
             if (loc1->tag != LOC_FPU_REG || loc1->u.fpu_reg != 0)
               fpu_load(var1);
-            writeln(outbuf, "fstp qword [@FP@%d@]", -cur_func_args_size - 4 - 8 + 8);
+            emit1(code, I_FSTP, opd_stack(8, -cur_func_args_size - 4 - 8 + 8));
           }
         else
           {
             assert (var1->qtype == VT_INT);
             if (loc1->tag != LOC_REG || loc1->u.reg != REG_EAX)
               {
-                writeln(outbuf, "mov eax, %s", loc_str(loc1));
+                emit2(code, I_MOV, opd_reg32(REG_EAX), loc_opd(loc1));
               }
           }
       }
@@ -1144,12 +1234,12 @@ static void gen_code(quadr_t *quadr)
   case Q_IF_GE:
     if (var1->qtype == VT_DOUBLE)
       {
-        gen_fpu_cmp(quadr->op, get_label_for_block(quadr->result.u.label));
+        gen_fpu_cmp(quadr->op, opd_label(quadr->result.u.label));
       }
     else
       {
         assert (var1->qtype == VT_INT);
-        gen_cmp(quadr->op, get_label_for_block(quadr->result.u.label));
+        gen_cmp(quadr->op, opd_label(quadr->result.u.label));
       }
     break;
 
@@ -1158,7 +1248,7 @@ static void gen_code(quadr_t *quadr)
     assert (quadr->arg1.tag == QA_NONE);
     assert (quadr->arg2.tag == QA_NONE);
     save_live();
-    writeln(outbuf, "jmp %s", get_label_for_block(quadr->result.u.label));
+    emit1(code, I_JMP, opd_label(quadr->result.u.label));
     break;
 
   case Q_READ_PTR:
@@ -1222,17 +1312,21 @@ static void gen_code(quadr_t *quadr)
                 {                                                       \
                   assert (disp <= 0);                                   \
                   disp = -disp;                                         \
-                  writeln(outbuf, "push dword [esp + %d]", disp + 4);   \
-                  writeln(outbuf, "push dword [esp + %d]", disp + 4);   \
+                  emit1(code, I_PUSH, opd_mem_disp(4, REG_ESP, '+', disp + 4)); \
+                  emit1(code, I_PUSH, opd_mem_disp(4, REG_ESP, '+', disp + 4)); \
                 }                                                       \
               else                                                      \
                 {                                                       \
                   assert (disp > 0);                                    \
                   free_reg(REG_EBP);                                    \
-                  writeln(outbuf, "mov ebp, dword [esp - %d]", disp);   \
-                  writeln(outbuf, "mov dword [esp - %d], ebp", off + 8); \
-                  writeln(outbuf, "mov ebp, dword [esp - %d]", disp - 4); \
-                  writeln(outbuf, "mov dword [esp - %d], ebp", off + 4); \
+                  emit2(code, I_MOV, opd_reg32(REG_EBP),                \
+                        opd_mem_disp(4, REG_ESP, '-', disp));           \
+                  emit2(code, I_MOV, opd_mem_disp(4, REG_ESP, '-', off + 8), \
+                        opd_reg32(REG_EBP));                            \
+                  emit2(code, I_MOV, opd_reg32(REG_EBP),                \
+                        opd_mem_disp(4, REG_ESP, '-', disp - 4));       \
+                  emit2(code, I_MOV, opd_mem_disp(4, REG_ESP, '-', off + 4), \
+                        opd_reg32(REG_EBP));                            \
                 }                                                       \
               flag = true;                                              \
               break;                                                    \
@@ -1252,13 +1346,16 @@ static void gen_code(quadr_t *quadr)
     if (find_loc(var->loc, &sloc) != NULL)                              \
       { /* this will be optimized to a single fstp by the */            \
         /* peephole optimizer */                                        \
-        writeln(outbuf, "fst qword [esp - %d]", off + 8);               \
+        emit1(code, I_FST, opd_mem_disp(8, REG_ESP, '-', off + 8));     \
         fpu_pop();                                                      \
       }                                                                 \
     else                                                                \
-      {                                                                 \
+      { /* a dead argument must not be evicted by its own load */       \
+        bool was_live = var->live;                                      \
+        var->live = true;                                               \
         fpu_load(var);                                                  \
-        writeln(outbuf, "fst qword [esp - %d]", off + 8);               \
+        var->live = was_live;                                           \
+        emit1(code, I_FST, opd_mem_disp(8, REG_ESP, '-', off + 8));     \
         fpu_pop();                                                      \
       }                                                                 \
   }
@@ -1326,7 +1423,7 @@ static void gen_call(quadr_func_t *func, var_list_t *args, var_t *retvar)
           ++i;
           args = args->next;
         }
-      writeln(outbuf, "sub esp, %d", off);
+      emit2(code, I_SUB, opd_reg32(REG_ESP), opd_imm(off));
       stack_adjustment_off = off;
       off = 0;
       while (args != NULL)
@@ -1335,7 +1432,7 @@ static void gen_call(quadr_func_t *func, var_list_t *args, var_t *retvar)
           var->live = live[i];
           if (var->qtype == VT_INT)
             {
-              writeln(outbuf, "push %s", loc_str(std_find_best_src_loc(var)));
+              emit1(code, I_PUSH, loc_opd(std_find_best_src_loc(var)));
               stack_adjustment_off += 4;
             }
           else
@@ -1343,7 +1440,7 @@ static void gen_call(quadr_func_t *func, var_list_t *args, var_t *retvar)
               assert (var->qtype == VT_DOUBLE);
               off = 0;
               PUSH_FPU_ARG();
-              writeln(outbuf, "sub esp, 8");
+              emit2(code, I_SUB, opd_reg32(REG_ESP), opd_imm(8));
               stack_adjustment_off += 8;
               rol_fpu_regs();
             }
@@ -1379,25 +1476,26 @@ static void gen_call(quadr_func_t *func, var_list_t *args, var_t *retvar)
         }
       free(live);
       free(offset);
-      discard_dead_vars(args);
+      discard_dead_vars(args0);
 
       free_all(LOC_REG);
       free_all(LOC_FPU_REG);
       fpu_initialised = false;
       stack_adjustment_off = 0;
 
-      writeln(outbuf, "call %s", func->name);
+      emit1(code, I_CALL, opd_sym(code, func->name));
       if (retvar != NULL)
         {
           loc_t sloc;
+          discard_var(retvar);
           switch (retvar->qtype){
           case VT_INT:
             init_loc(&sloc, LOC_REG, REG_EAX);
             update_var_loc(retvar, &sloc);
             break;
           case VT_DOUBLE:
-            writeln(outbuf, "finit");
-            writeln(outbuf, "fld qword [esp]");
+            emit0(code, I_FINIT);
+            emit1(code, I_FLD, opd_mem_index(8, REG_ESP, REG_NONE, 0));
             init_loc(&sloc, LOC_FPU_REG, 0);
             update_var_loc(retvar, &sloc);
             fpu_initialised = true;
@@ -1408,7 +1506,7 @@ static void gen_call(quadr_func_t *func, var_list_t *args, var_t *retvar)
         }
       if (func->type->return_type == type_double)
         {
-          writeln(outbuf, "add esp, 8");
+          emit2(code, I_ADD, opd_reg32(REG_ESP), opd_imm(8));
         }
 
     }
@@ -1426,11 +1524,11 @@ static void gen_print_string(const char *str)
   free_all(LOC_REG);
   free_all(LOC_FPU_REG);
 
-  writeln(outbuf, "section .data");
-  writeln(outbuf, "__str_const%d db '%s',10,0", str_const_num, str);
-  writeln(outbuf, "section .text");
-  writeln(outbuf, "push __str_const%d", str_const_num);
-  writeln(outbuf, "call printString");
+  emit0(code, I_SECTION_DATA);
+  emit2(code, I_STRING, opd_str_const(str_const_num), opd_sym(code, str));
+  emit0(code, I_SECTION_TEXT);
+  emit1(code, I_PUSH, opd_str_const(str_const_num));
+  emit1(code, I_CALL, opd_sym(code, "printString"));
   ++str_const_num;
 
   fpu_initialised = false;
@@ -1440,37 +1538,43 @@ static void gen_print_string(const char *str)
 
 static void gen_mov(loc_t *dest, var_t *src)
 {
-  if (src->qtype == VT_DOUBLE && !fpu_initialised)
-    {
-      writeln(outbuf, "finit");
-      fpu_initialised = true;
-    }
+  if (src->qtype == VT_DOUBLE)
+    init_fpu();
   switch (dest->tag){
   case LOC_STACK:
     {
       loc_t *loc = std_find_best_src_loc(src);
       switch (loc->tag){
       case LOC_STACK:
-        {
-          loc_t *tmp_loc = alloc_reg(LOC_REG);
-          const char *sreg = reg32_str(tmp_loc->u.reg);
-          writeln(outbuf, "mov %s, %s", sreg, loc_str(loc));
-          writeln(outbuf, "mov %s, %s", loc_str(dest), sreg);
-          update_var_loc(src, tmp_loc);
-          free_loc(tmp_loc);
-          break;
-        }
+        if (src->qtype == VT_DOUBLE)
+          {
+            i386_operand_t sopd = loc_opd(loc);
+            i386_operand_t dopd = loc_opd(dest);
+            free_fpu_reg(7, true);
+            emit1(code, I_FLD, sopd);
+            emit1(code, I_FSTP, dopd);
+          }
+        else
+          {
+            loc_t *tmp_loc = alloc_reg(LOC_REG);
+            i386_operand_t sreg = opd_reg32(tmp_loc->u.reg);
+            emit2(code, I_MOV, sreg, loc_opd(loc));
+            emit2(code, I_MOV, loc_opd(dest), sreg);
+            update_var_loc(src, tmp_loc);
+            free_loc(tmp_loc);
+          }
+        break;
       case LOC_REG: // fall through
       case LOC_INT:
-        writeln(outbuf, "mov %s, %s", loc_str(dest), loc_str(loc));
+        emit2(code, I_MOV, loc_opd(dest), loc_opd(loc));
         break;
       case LOC_DOUBLE:
         {
-          const char *sstr = loc_str(loc);
-          const char *dstr = loc_str(dest);
+          i386_operand_t sopd = loc_opd(loc);
+          i386_operand_t dopd = loc_opd(dest);
           free_fpu_reg(7, true);
-          writeln(outbuf, "fld %s", sstr);
-          writeln(outbuf, "fstp %s", dstr);
+          emit1(code, I_FLD, sopd);
+          emit1(code, I_FSTP, dopd);
           break;
         }
       case LOC_FPU_REG:
@@ -1479,12 +1583,12 @@ static void gen_mov(loc_t *dest, var_t *src)
           if (sreg != 0)
             {
               //              swap_fpu_regs(0, sreg); // this doesn't change dest - OK
-              writeln(outbuf, "fxch st%d", sreg);
+              emit1(code, I_FXCH, opd_fpu_reg(sreg));
             }
-          writeln(outbuf, "fst %s", loc_str(dest));
+          emit1(code, I_FST, loc_opd(dest));
           if (sreg != 0)
             {
-              writeln(outbuf, "fxch st%d", sreg);
+              emit1(code, I_FXCH, opd_fpu_reg(sreg));
             }
           break;
         }
@@ -1496,7 +1600,7 @@ static void gen_mov(loc_t *dest, var_t *src)
   case LOC_REG:
     {
       loc_t *loc = std_find_best_src_loc(src);
-      writeln(outbuf, "mov %s, %s", loc_str(dest), loc_str(loc));
+      emit2(code, I_MOV, loc_opd(dest), loc_opd(loc));
       break;
     }
   case LOC_FPU_REG:
@@ -1507,15 +1611,15 @@ static void gen_mov(loc_t *dest, var_t *src)
         {
           if (loc->u.fpu_reg == 7)
             {
-              writeln(outbuf, "fdecstp");
-              writeln(outbuf, "fst st1");
-              writeln(outbuf, "fincstp");
+              emit0(code, I_FDECSTP);
+              emit1(code, I_FST, opd_fpu_reg(1));
+              emit0(code, I_FINCSTP);
             }
           else
             {
               free_fpu_reg(7, true);
-              writeln(outbuf, "fld st%d", loc->u.fpu_reg);
-              writeln(outbuf, "fstp st1");
+              emit1(code, I_FLD, opd_fpu_reg(loc->u.fpu_reg));
+              emit1(code, I_FSTP, opd_fpu_reg(1));
             }
           break;
         }
@@ -1523,19 +1627,19 @@ static void gen_mov(loc_t *dest, var_t *src)
         {
           int reg = loc->u.fpu_reg;
           if (reg == 0)
-            writeln(outbuf, "fst st%d", dreg);
+            emit1(code, I_FST, opd_fpu_reg(dreg));
           else if (is_free(0, LOC_FPU_REG))
             {
-              writeln(outbuf, "fincstp");
-              writeln(outbuf, "fld st%d", reg - 1);
-              writeln(outbuf, "fstp st%d", dreg);
-              writeln(outbuf, "fdecstp");
+              emit0(code, I_FINCSTP);
+              emit1(code, I_FLD, opd_fpu_reg(reg - 1));
+              emit1(code, I_FSTP, opd_fpu_reg(dreg));
+              emit0(code, I_FDECSTP);
             }
           else
             {
-              writeln(outbuf, "fxch st%d", reg);
-              writeln(outbuf, "fst st%d", dreg);
-              writeln(outbuf, "fxch st%d", reg);
+              emit1(code, I_FXCH, opd_fpu_reg(reg));
+              emit1(code, I_FST, opd_fpu_reg(dreg));
+              emit1(code, I_FXCH, opd_fpu_reg(reg));
             }
           break;
         }
@@ -1544,19 +1648,19 @@ static void gen_mov(loc_t *dest, var_t *src)
       loc = std_find_best_src_loc(src);
       if (loc->tag == LOC_DOUBLE && loc->u.double_val == 0)
         {
-          writeln(outbuf, "fldz");
+          emit0(code, I_FLDZ);
         }
       else if (loc->tag == LOC_DOUBLE && loc->u.double_val == 1)
         {
-          writeln(outbuf, "fld1");
+          emit0(code, I_FLD1);
         }
       else
-        writeln(outbuf, "fld %s", loc_str(loc));
+        emit1(code, I_FLD, loc_opd(loc));
       if (dreg < 7)
-        writeln(outbuf, "fstp st%d", dreg + 1);
+        emit1(code, I_FSTP, opd_fpu_reg(dreg + 1));
       else
         {
-          writeln(outbuf, "fincstp");
+          emit0(code, I_FINCSTP);
         }
       break;
     }
@@ -1573,27 +1677,23 @@ static void gen_swap(loc_t *loc1, loc_t *loc2)
     }
   switch (loc1->tag){
   case LOC_REG:
-    writeln(outbuf, "xchg %s, %s", loc_str(loc1), loc_str(loc2));
+    emit2(code, I_XCHG, loc_opd(loc1), loc_opd(loc2));
     break;
   case LOC_FPU_REG:
-    if (!fpu_initialised)
-      {
-        writeln(outbuf, "finit");
-        fpu_initialised = true;
-      }
+    init_fpu();
     if (loc2->tag == LOC_FPU_REG)
       {
         if (loc1->u.fpu_reg == 0)
-          writeln(outbuf, "fxch st%d", loc2->u.fpu_reg);
+          emit1(code, I_FXCH, opd_fpu_reg(loc2->u.fpu_reg));
         else if (loc2->u.fpu_reg == 0)
-          writeln(outbuf, "fxch st%d", loc1->u.fpu_reg);
+          emit1(code, I_FXCH, opd_fpu_reg(loc1->u.fpu_reg));
         else
           {
             int reg1 = loc1->u.reg;
             int reg2 = loc2->u.reg;
-            writeln(outbuf, "fxch st%d", reg1);
-            writeln(outbuf, "fxch st%d", reg2);
-            writeln(outbuf, "fxch st%d", reg1);
+            emit1(code, I_FXCH, opd_fpu_reg(reg1));
+            emit1(code, I_FXCH, opd_fpu_reg(reg2));
+            emit1(code, I_FXCH, opd_fpu_reg(reg1));
           }
       }
     else
@@ -1601,9 +1701,9 @@ static void gen_swap(loc_t *loc1, loc_t *loc2)
         int reg = loc1->u.fpu_reg;
         assert (loc2->tag == LOC_STACK);
         free_fpu_reg(7, true); // TODO: this may cause problems - check it
-        writeln(outbuf, "fld %s", loc_str(loc2));
-        writeln(outbuf, "fxch st%d", reg);
-        writeln(outbuf, "fstp %s", loc_str(loc2));
+        emit1(code, I_FLD, loc_opd(loc2));
+        emit1(code, I_FXCH, opd_fpu_reg(reg));
+        emit1(code, I_FSTP, loc_opd(loc2));
       }
     break;
   case LOC_STACK:
@@ -1612,11 +1712,7 @@ static void gen_swap(loc_t *loc1, loc_t *loc2)
     if (loc1->u.stack_elem->size == 8)
       {
         bool flag7, flag6;
-        if (!fpu_initialised)
-          {
-            writeln(outbuf, "finit");
-            fpu_initialised = true;
-          }
+        init_fpu();
         flag7 = is_allowed(7, LOC_FPU_REG);
         flag6 = is_allowed(6, LOC_FPU_REG);
         if (flag7)
@@ -1625,10 +1721,10 @@ static void gen_swap(loc_t *loc1, loc_t *loc2)
           deny_reg(6, LOC_FPU_REG);
         free_fpu_reg(7, true);
         free_fpu_reg(6, true);
-        writeln(outbuf, "fld %s", loc_str(loc1));
-        writeln(outbuf, "fld %s", loc_str(loc2));
-        writeln(outbuf, "fstp %s", loc_str(loc1));
-        writeln(outbuf, "fstp %s", loc_str(loc2));
+        emit1(code, I_FLD, loc_opd(loc1));
+        emit1(code, I_FLD, loc_opd(loc2));
+        emit1(code, I_FSTP, loc_opd(loc1));
+        emit1(code, I_FSTP, loc_opd(loc2));
         if (flag6)
           allow_reg(6, LOC_FPU_REG);
         if (flag7)
@@ -1637,9 +1733,9 @@ static void gen_swap(loc_t *loc1, loc_t *loc2)
     else
       {
         loc_t *loc = alloc_reg(LOC_REG);
-        writeln(outbuf, "mov %s, %s", loc_str(loc), loc_str(loc1));
-        writeln(outbuf, "xchg %s, %s", loc_str(loc), loc_str(loc2));
-        writeln(outbuf, "xchg %s, %s", loc_str(loc), loc_str(loc1));
+        emit2(code, I_MOV, loc_opd(loc), loc_opd(loc1));
+        emit2(code, I_XCHG, loc_opd(loc), loc_opd(loc2));
+        emit2(code, I_XCHG, loc_opd(loc), loc_opd(loc1));
         update_var_loc(var1, loc);
         free_loc(loc);
       }
@@ -1652,47 +1748,43 @@ static void gen_swap(loc_t *loc1, loc_t *loc2)
 static void gen_fpu_load(var_t *var)
 {
   loc_t *loc = std_find_best_src_loc(var);
-  if (!fpu_initialised)
-    {
-      writeln(outbuf, "finit");
-      fpu_initialised = true;
-    }
+  init_fpu();
   if (loc->tag == LOC_DOUBLE && loc->u.double_val == 0.0)
     {
-      writeln(outbuf, "fldz");
+      emit0(code, I_FLDZ);
     }
   else if (loc->tag == LOC_DOUBLE && loc->u.double_val == 1.0)
     {
-      writeln(outbuf, "fld1");
+      emit0(code, I_FLD1);
     }
   else
-    writeln(outbuf, "fld %s", loc_str(loc));
+    emit1(code, I_FLD, loc_opd(loc));
 }
 
 static void gen_fpu_store(loc_t *loc)
 {
-  assert (fpu_initialised);
-  writeln(outbuf, "fst %s", loc_str(loc));
+  init_fpu();
+  emit1(code, I_FST, loc_opd(loc));
 }
 
 static void gen_fpu_pop(bool was_free)
 {
-  assert (fpu_initialised);
+  init_fpu();
   if (was_free)
-    writeln(outbuf, "fincstp");
+    emit0(code, I_FINCSTP);
   else
-    writeln(outbuf, "fstp st0");
+    emit1(code, I_FSTP, opd_fpu_reg(0));
 }
 
 static void gen_label(const char *label_str)
 {
-  writeln(outbuf, "%s:", label_str);
+  emit1(code, I_LABEL, opd_block_label(code, cur_func_name, label_str));
 }
 
 static void fpu_reg_free(reg_t fpu_reg)
 {
   if (fpu_reg != disallowed_fpu_reg_for_freeing)
-    writeln(outbuf, "ffree st%zu", fpu_reg);
+    emit1(code, I_FFREE, opd_fpu_reg(fpu_reg));
 }
 
 //--------------------------------------------------------------------
@@ -1702,6 +1794,8 @@ backend_t *new_i386_backend()
   backend_t *iback = xmalloc(sizeof(backend_t));
   iback->init = init;
   iback->final = final;
+  iback->init_thread = init_thread;
+  iback->final_thread = final_thread;
   iback->start_func = start_func;
   iback->end_func = end_func;
   iback->gen_code = gen_code;
@@ -1731,5 +1825,8 @@ backend_t *new_i386_backend()
 
 void free_i386_backend(backend_t *i386_backend)
 {
+  free(runtime);
+  runtime = NULL;
+  free_rules();
   free(i386_backend);
 }
@@ -0,0 +1,428 @@
+#include <stdio.h>
+#include "i386_ir.h"
+
+#define STRINGS_CHUNK_SIZE (16 * 1024)
+#define LINE_SIZE 256
+
+static const char *opcode_str[] = {
+  "", "", "", "", "", "", "",
+  "mov", "lea", "xchg", "add", "sub", "imul", "idiv", "neg", "sar", "and",
+  "xor", "test", "sets", "cmp", "sahf", "push", "call", "ret",
+  "jmp", "je", "jne", "jl", "jg", "jle", "jge", "ja", "jb", "jae", "jbe",
+  "finit", "fwait", "fstsw", "fld", "fldz", "fld1", "fst", "fstp", "fxch",
+  "ffree", "fincstp", "fdecstp", "fcom", "fcomi",
+  "fadd", "fsub", "fsubr", "fmul", "fdiv", "fdivr",
+  "movsd", "movapd", "addsd", "subsd", "mulsd", "divsd", "ucomisd", "xorpd"
+};
+
+static const char *reg_str[4][16] = {
+  { "al", "bl", "cl", "dl", "dil", "sil", "bpl", "spl",
+    "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b" },
+  { "ax", "bx", "cx", "dx", "di", "si", "bp", "sp",
+    "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w" },
+  { "eax", "ebx", "ecx", "edx", "edi", "esi", "ebp", "esp",
+    "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d" },
+  { "rax", "rbx", "rcx", "rdx", "rdi", "rsi", "rbp", "rsp",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15" }
+};
+
+i386_code_t *new_i386_code(int bits)
+{
+  i386_code_t *code = xmalloc(sizeof(i386_code_t));
+  code->bits = bits;
+  code->saved_regs = 0;
+  code->instrs_size = 256;
+  code->instrs_num = 0;
+  code->instrs = xmalloc(code->instrs_size * sizeof(i386_instr_t));
+  code->strings = new_alloc(STRINGS_CHUNK_SIZE);
+  code->strings->name = "i386 operand strings";
+  code->line_size = LINE_SIZE;
+  code->line = xmalloc(code->line_size);
+  return code;
+}
+
+void free_i386_code(i386_code_t *code)
+{
+  free(code->instrs);
+  free_alloc(code->strings);
+  free(code->line);
+  free(code);
+}
+
+void clear_i386_code(i386_code_t *code)
+{
+  code->instrs_num = 0;
+  reset_alloc(code->strings);
+}
+
+static i386_instr_t *new_instr(i386_code_t *code, i386_opcode_t op)
+{
+  i386_instr_t *instr;
+  if (code->instrs_num == code->instrs_size)
+    {
+      code->instrs_size <<= 1;
+      code->instrs = xrealloc(code->instrs, code->instrs_size * sizeof(i386_instr_t));
+    }
+  instr = &code->instrs[code->instrs_num++];
+  instr->op = op;
+  instr->opnd[0].tag = instr->opnd[1].tag = instr->opnd[2].tag = O_NONE;
+  return instr;
+}
+
+void emit0(i386_code_t *code, i386_opcode_t op)
+{
+  new_instr(code, op);
+}
+
+void emit1(i386_code_t *code, i386_opcode_t op, i386_operand_t a)
+{
+  i386_instr_t *instr = new_instr(code, op);
+  instr->opnd[0] = a;
+}
+
+void emit2(i386_code_t *code, i386_opcode_t op, i386_operand_t a, i386_operand_t b)
+{
+  i386_instr_t *instr = new_instr(code, op);
+  instr->opnd[0] = a;
+  instr->opnd[1] = b;
+}
+
+void emit3(i386_code_t *code, i386_opcode_t op, i386_operand_t a, i386_operand_t b,
+           i386_operand_t c)
+{
+  i386_instr_t *instr = new_instr(code, op);
+  instr->opnd[0] = a;
+  instr->opnd[1] = b;
+  instr->opnd[2] = c;
+}
+
+i386_operand_t opd_sym(i386_code_t *code, const char *sym)
+{
+  i386_operand_t opd;
+  size_t n = strlen(sym);
+  char *str = alloc(code->strings, n + 1);
+  memcpy(str, sym, n + 1);
+  opd.tag = O_SYMBOL;
+  opd.size = 0;
+  opd.u.sym = str;
+  return opd;
+}
+
+i386_operand_t opd_block_label(i386_code_t *code, const char *func_name,
+                               const char *label)
+{
+  i386_operand_t opd;
+  size_t n = strlen(func_name);
+  size_t m = strlen(label);
+  char *str = alloc(code->strings, n + m + 2);
+  memcpy(str, func_name, n);
+  str[n] = '.';
+  memcpy(str + n + 1, label, m + 1);
+  opd.tag = O_SYMBOL;
+  opd.size = 0;
+  opd.u.sym = str;
+  return opd;
+}
+
+//--------------------------------------------------------------------
+
+/* rendering */
+
+static __thread size_t line_len;
+
+static void put_str(i386_code_t *code, const char *str)
+{
+  size_t n = strlen(str);
+  if (line_len + n + 1 > code->line_size)
+    {
+      while (line_len + n + 1 > code->line_size)
+        code->line_size <<= 1;
+      code->line = xrealloc(code->line, code->line_size);
+    }
+  memcpy(code->line + line_len, str, n);
+  line_len += n;
+}
+
+static void put_int(i386_code_t *code, int val)
+{
+  char str[16];
+  char *s = str + sizeof(str) - 1;
+  unsigned uval = val < 0 ? -(unsigned) val : (unsigned) val;
+  *s = '\0';
+  do
+    {
+      *--s = '0' + uval % 10;
+      uval /= 10;
+    }
+  while (uval != 0);
+  if (val < 0)
+    *--s = '-';
+  put_str(code, s);
+}
+
+static const char *size_str(int size)
+{
+  switch (size){
+  case 1:
+    return "byte ";
+  case 2:
+    return "word ";
+  case 4:
+    return "dword ";
+  case 8:
+    return "qword ";
+  default:
+    xabort("size_str()");
+    return NULL;
+  };
+}
+
+static const char *reg_name(i386_code_t *code, int reg, int size)
+{
+  const char *str = NULL;
+  // only al, bl, cl and dl have 8-bit names in 32-bit code
+  if (reg >= 0 && reg <= (code->bits == 64 ? REG_R15 : REG_ESP) &&
+      (size != 1 || code->bits == 64 || reg <= REG_EDX))
+    {
+      switch (size){
+      case 1:
+        str = reg_str[0][reg];
+        break;
+      case 2:
+        str = reg_str[1][reg];
+        break;
+      case 4:
+        str = reg_str[2][reg];
+        break;
+      case 8:
+        if (code->bits == 64)
+          str = reg_str[3][reg];
+        break;
+      };
+    }
+  if (str == NULL)
+    xabort("reg_name()");
+  return str;
+}
+
+static void put_str_const_name(i386_code_t *code, const char *func_name, int index)
+{
+  put_str(code, "__str_const_");
+  put_str(code, func_name);
+  put_str(code, "_");
+  put_int(code, index);
+}
+
+static void put_operand(i386_code_t *code, i386_operand_t *opd, const char *func_name,
+                        int stack_size)
+{
+  switch (opd->tag){
+  case O_REG:
+    put_str(code, reg_name(code, opd->u.reg, opd->size));
+    break;
+  case O_FPU_REG:
+    put_str(code, "st");
+    put_int(code, opd->u.reg);
+    break;
+  case O_XMM_REG:
+    put_str(code, "xmm");
+    put_int(code, opd->u.reg);
+    break;
+  case O_IMM:
+    put_int(code, opd->u.imm);
+    break;
+  case O_MEM:
+    {
+      i386_addr_t *addr = &opd->u.addr;
+      int addr_size = code->bits / 8;
+      if (opd->size != 0)
+        put_str(code, size_str(opd->size));
+      put_str(code, "[");
+      put_str(code, reg_name(code, addr->base, addr_size));
+      if (addr->scale != 0)
+        {
+          put_str(code, " + ");
+          put_int(code, addr->scale);
+          put_str(code, " * ");
+          if (addr->index != REG_NONE)
+            put_str(code, reg_name(code, addr->index, addr_size));
+          else
+            put_int(code, addr->disp);
+        }
+      else if (addr->index != REG_NONE)
+        {
+          put_str(code, " + ");
+          put_str(code, reg_name(code, addr->index, addr_size));
+        }
+      if (addr->sign != 0 && (addr->scale == 0 || addr->index != REG_NONE))
+        {
+          put_str(code, addr->sign == '+' ? " + " : " - ");
+          put_int(code, addr->disp);
+        }
+      put_str(code, "]");
+      break;
+    }
+  case O_STACK:
+    if (opd->size != 0)
+      put_str(code, size_str(opd->size));
+    put_str(code, code->bits == 64 ? "[rsp + " : "[esp + ");
+    put_int(code, stack_size - opd->u.off);
+    put_str(code, "]");
+    break;
+  case O_DCONST:
+    put_str(code, code->bits == 64 ? "qword [rel __dconst_" : "qword [__dconst_");
+    put_str(code, func_name);
+    put_str(code, "_");
+    put_int(code, opd->u.index);
+    put_str(code, "]");
+    break;
+  case O_STR_CONST:
+    // an immediate in 32-bit code, the memory operand of lea in 64-bit
+    // code
+    if (code->bits == 64)
+      put_str(code, "[rel ");
+    put_str_const_name(code, func_name, opd->u.index);
+    if (code->bits == 64)
+      put_str(code, "]");
+    break;
+  case O_SYMBOL:
+    put_str(code, opd->u.sym);
+    break;
+  default:
+    xabort("put_operand()");
+  };
+}
+
+static void flush_line(i386_code_t *code, outbuf_t *buf)
+{
+  if (line_len > 0)
+    {
+      code->line[line_len] = '\0';
+      appendln(buf, code->line);
+    }
+  line_len = 0;
+}
+
+/* The prologue or the epilogue of a 64-bit function: the saved
+   registers are stored at the bottom of the frame. */
+static void render_frame_64(i386_code_t *code, outbuf_t *buf, bool prologue,
+                            int stack_size)
+{
+  int reg, n = 0;
+  if (prologue && stack_size > 0)
+    {
+      put_str(code, "sub rsp, ");
+      put_int(code, stack_size);
+      flush_line(code, buf);
+    }
+  for (reg = 0; reg <= REG_R15; ++reg)
+    {
+      if (code->saved_regs & (1 << reg))
+        {
+          if (prologue)
+            {
+              put_str(code, "mov [rsp + ");
+              put_int(code, 8 * n);
+              put_str(code, "], ");
+              put_str(code, reg_str[3][reg]);
+            }
+          else
+            {
+              put_str(code, "mov ");
+              put_str(code, reg_str[3][reg]);
+              put_str(code, ", [rsp + ");
+              put_int(code, 8 * n);
+              put_str(code, "]");
+            }
+          flush_line(code, buf);
+          ++n;
+        }
+    }
+  if (!prologue && stack_size > 0)
+    {
+      put_str(code, "add rsp, ");
+      put_int(code, stack_size);
+    }
+}
+
+void render_i386_code(i386_code_t *code, outbuf_t *buf, const char *func_name,
+                      int stack_size)
+{
+  size_t i;
+  for (i = 0; i < code->instrs_num; ++i)
+    {
+      i386_instr_t *instr = &code->instrs[i];
+      line_len = 0;
+      switch (instr->op){
+      case I_LABEL:
+        put_operand(code, &instr->opnd[0], func_name, stack_size);
+        put_str(code, ":");
+        break;
+      case I_SECTION_TEXT:
+        put_str(code, "section .text");
+        break;
+      case I_SECTION_DATA:
+        put_str(code, "section .data");
+        break;
+      case I_GLOBAL:
+        put_str(code, "global ");
+        put_operand(code, &instr->opnd[0], func_name, stack_size);
+        break;
+      case I_STRING:
+        put_str_const_name(code, func_name, instr->opnd[0].u.index);
+        put_str(code, " db '");
+        put_operand(code, &instr->opnd[1], func_name, stack_size);
+        put_str(code, "',10,0");
+        break;
+      case I_PROLOGUE:
+      case I_EPILOGUE:
+        if (code->bits == 64)
+          render_frame_64(code, buf, instr->op == I_PROLOGUE, stack_size);
+        else if (stack_size > 0)
+          {
+            put_str(code, instr->op == I_PROLOGUE ? "sub esp, " : "add esp, ");
+            put_int(code, stack_size);
+          }
+        break;
+      default:
+        {
+          int j;
+          /* two-operand FPU arithmetic is written without a space
+             after the comma */
+          const char *sep = (instr->op >= I_FADD && instr->op <= I_FDIVR) ? "," : ", ";
+          put_str(code, opcode_str[instr->op]);
+          for (j = 0; j < MAX_OPERANDS && instr->opnd[j].tag != O_NONE; ++j)
+            {
+              put_str(code, j == 0 ? " " : sep);
+              put_operand(code, &instr->opnd[j], func_name, stack_size);
+            }
+        }
+      };
+      flush_line(code, buf);
+    }
+}
+
+unsigned used_regs(i386_code_t *code)
+{
+  unsigned mask = 0;
+  size_t i;
+  int j;
+  for (i = 0; i < code->instrs_num; ++i)
+    {
+      i386_instr_t *instr = &code->instrs[i];
+      for (j = 0; j < MAX_OPERANDS; ++j)
+        {
+          i386_operand_t *opd = &instr->opnd[j];
+          if (opd->tag == O_REG)
+            mask |= 1 << opd->u.reg;
+          else if (opd->tag == O_MEM)
+            {
+              if (opd->u.addr.base != REG_NONE)
+                mask |= 1 << opd->u.addr.base;
+              if (opd->u.addr.index != REG_NONE)
+                mask |= 1 << opd->u.addr.index;
+            }
+        }
+    }
+  return mask;
+}
@@ -0,0 +1,226 @@
+/* i386_ir.h - in-memory representation of i386 and x86-64 machine
+   code */
+
+#ifndef I386_IR_H
+#define I386_IR_H
+
+#include "utils.h"
+#include "mem.h"
+#include "outbuf.h"
+
+#define REG_NONE -1
+#define REG_EAX 0
+#define REG_EBX 1
+#define REG_ECX 2
+#define REG_EDX 3
+#define REG_EDI 4
+#define REG_ESI 5
+#define REG_EBP 6
+#define REG_ESP 7
+// x86-64 only; the registers above are then the 64-bit ones (rax...)
+#define REG_R8 8
+#define REG_R9 9
+#define REG_R10 10
+#define REG_R11 11
+#define REG_R12 12
+#define REG_R13 13
+#define REG_R14 14
+#define REG_R15 15
+
+/* Keep in sync with opcode_str[] in i386_ir.c. */
+typedef enum {
+  /* pseudo-instructions */
+  I_LABEL, I_GLOBAL, I_SECTION_TEXT, I_SECTION_DATA, I_STRING, I_PROLOGUE, I_EPILOGUE,
+  /* integer instructions */
+  I_MOV, I_LEA, I_XCHG, I_ADD, I_SUB, I_IMUL, I_IDIV, I_NEG, I_SAR, I_AND,
+  I_XOR, I_TEST, I_SETS, I_CMP, I_SAHF, I_PUSH, I_CALL, I_RET,
+  I_JMP, I_JE, I_JNE, I_JL, I_JG, I_JLE, I_JGE, I_JA, I_JB, I_JAE, I_JBE,
+  /* FPU instructions */
+  I_FINIT, I_FWAIT, I_FSTSW, I_FLD, I_FLDZ, I_FLD1, I_FST, I_FSTP, I_FXCH,
+  I_FFREE, I_FINCSTP, I_FDECSTP, I_FCOM, I_FCOMI,
+  I_FADD, I_FSUB, I_FSUBR, I_FMUL, I_FDIV, I_FDIVR,
+  /* SSE2 instructions (x86-64) */
+  I_MOVSD, I_MOVAPD, I_ADDSD, I_SUBSD, I_MULSD, I_DIVSD, I_UCOMISD, I_XORPD
+} i386_opcode_t;
+
+typedef enum {
+  O_NONE, O_REG, O_FPU_REG, O_XMM_REG, O_IMM, O_MEM, O_STACK, O_DCONST, O_STR_CONST,
+  O_SYMBOL
+} i386_operand_tag_t;
+
+/* A memory address [base + scale * index + disp]. If scale is
+   non-zero but there is no index register, then the index is the
+   immediate disp (as in [eax + 4 * 3]). */
+typedef struct{
+  signed char base;
+  signed char index;
+  signed char scale; // 0 if the index is not scaled
+  char sign; // '+' or '-' before disp; 0 if there is no disp
+  int disp;
+} i386_addr_t;
+
+typedef struct{
+  unsigned char tag;
+  unsigned char size; // size in bytes; 0 if it is not written out
+  union{
+    int reg;
+    int imm;
+    int off; // frame offset of a stack slot, resolved when rendering
+    int index; // number of a double or string constant
+    const char *sym;
+    i386_addr_t addr;
+  } u;
+} i386_operand_t;
+
+#define MAX_OPERANDS 3
+
+typedef struct{
+  i386_opcode_t op;
+  i386_operand_t opnd[MAX_OPERANDS];
+} i386_instr_t;
+
+/* The code of one function. */
+typedef struct{
+  int bits; // 32 or 64
+  /* 64-bit code: the registers saved by the prologue at the bottom
+     of the frame, as a bit mask */
+  unsigned saved_regs;
+  i386_instr_t *instrs;
+  size_t instrs_num;
+  size_t instrs_size;
+  alloc_t *strings; // symbols and string constants
+  char *line; // rendering buffer
+  size_t line_size;
+} i386_code_t;
+
+i386_code_t *new_i386_code(int bits);
+void free_i386_code(i386_code_t *code);
+void clear_i386_code(i386_code_t *code);
+
+void emit0(i386_code_t *code, i386_opcode_t op);
+void emit1(i386_code_t *code, i386_opcode_t op, i386_operand_t a);
+void emit2(i386_code_t *code, i386_opcode_t op, i386_operand_t a, i386_operand_t b);
+void emit3(i386_code_t *code, i386_opcode_t op, i386_operand_t a, i386_operand_t b,
+           i386_operand_t c);
+
+/* Appends the textual (NASM) form of the code to buf. The stack slots
+   are resolved given the final stack size of the function, and the
+   double and string constants are named after func_name. In 64-bit
+   code the constants are addressed relative to rip. */
+void render_i386_code(i386_code_t *code, outbuf_t *buf, const char *func_name,
+                      int stack_size);
+/* Returns the set of the general-purpose registers written or read
+   in the code, as a bit mask. */
+unsigned used_regs(i386_code_t *code);
+
+/* operand constructors */
+
+inline static i386_operand_t opd_reg(int reg, int size)
+{
+  i386_operand_t opd;
+  opd.tag = O_REG;
+  opd.size = size;
+  opd.u.reg = reg;
+  return opd;
+}
+
+inline static i386_operand_t opd_reg32(int reg)
+{
+  return opd_reg(reg, 4);
+}
+
+inline static i386_operand_t opd_fpu_reg(int reg)
+{
+  i386_operand_t opd;
+  opd.tag = O_FPU_REG;
+  opd.size = 0;
+  opd.u.reg = reg;
+  return opd;
+}
+
+inline static i386_operand_t opd_xmm_reg(int reg)
+{
+  i386_operand_t opd;
+  opd.tag = O_XMM_REG;
+  opd.size = 0;
+  opd.u.reg = reg;
+  return opd;
+}
+
+inline static i386_operand_t opd_imm(int val)
+{
+  i386_operand_t opd;
+  opd.tag = O_IMM;
+  opd.size = 0;
+  opd.u.imm = val;
+  return opd;
+}
+
+/* [base + scale * index] or [base + index] if scale is 0 */
+inline static i386_operand_t opd_mem_index(int size, int base, int index, int scale)
+{
+  i386_operand_t opd;
+  opd.tag = O_MEM;
+  opd.size = size;
+  opd.u.addr.base = base;
+  opd.u.addr.index = index;
+  opd.u.addr.scale = scale;
+  opd.u.addr.sign = 0;
+  opd.u.addr.disp = 0;
+  return opd;
+}
+
+/* [base + disp] or [base - disp] */
+inline static i386_operand_t opd_mem_disp(int size, int base, char sign, int disp)
+{
+  i386_operand_t opd = opd_mem_index(size, base, REG_NONE, 0);
+  opd.u.addr.sign = sign;
+  opd.u.addr.disp = disp;
+  return opd;
+}
+
+/* [base + scale * disp] */
+inline static i386_operand_t opd_mem_const_index(int size, int base, int disp, int scale)
+{
+  i386_operand_t opd = opd_mem_index(size, base, REG_NONE, scale);
+  opd.u.addr.sign = '+';
+  opd.u.addr.disp = disp;
+  return opd;
+}
+
+inline static i386_operand_t opd_stack(int size, int off)
+{
+  i386_operand_t opd;
+  opd.tag = O_STACK;
+  opd.size = size;
+  opd.u.off = off;
+  return opd;
+}
+
+inline static i386_operand_t opd_dconst(int index)
+{
+  i386_operand_t opd;
+  opd.tag = O_DCONST;
+  opd.size = 8;
+  opd.u.index = index;
+  return opd;
+}
+
+inline static i386_operand_t opd_str_const(int index)
+{
+  i386_operand_t opd;
+  opd.tag = O_STR_CONST;
+  opd.size = 0;
+  opd.u.index = index;
+  return opd;
+}
+
+/* The symbol is copied. */
+i386_operand_t opd_sym(i386_code_t *code, const char *sym);
+/* The label of a block. Blocks are numbered in each function, so the
+   label is qualified with the name of the function (f.b3), like the
+   double and string constants. */
+i386_operand_t opd_block_label(i386_code_t *code, const char *func_name,
+                               const char *label);
+
+#endif
@@ -0,0 +1,1202 @@
+/* iquadr.c - interpreter for the quadruple code written by the quadr
+   backend
+
+   usage: iquadr [quiet] program.qua
+
+   The program is decoded once into an array of instructions, and then
+   run with direct-threaded dispatch: each instruction holds the
+   address of the code of its handler, and jumps and calls hold the
+   address of their target instruction. The handlers are specialised
+   by the kinds of the operands, so that no operand is decoded at run
+   time:
+
+   R - int register ($.iN)
+   K - int constant
+   D - double register ($.dN)
+   F - double constant
+   M - memory cell ({$.iN + K} or {$.iN - K})
+
+   The memory is an array of cells, each of which holds an int or a
+   double (the quadr backend uses 1 for the size of every type). The
+   stack pointer $.i0 is an index into it. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <signal.h>
+#include <ctype.h>
+#include <time.h>
+#include "utils.h"
+
+#define MEM_CELLS (1 << 24)
+#define CALL_DEPTH (1 << 20)
+#define MAX_LINE_LEN 1024
+
+typedef union{
+  int32_t i;
+  double d;
+} cell_t;
+
+/* The opcodes. The if opcodes are generated for each relation; a
+   constant on the left of a relation is moved to the right, so
+   there are no KR and FD variants. */
+
+#define REL_OPS(rel) OP(IF_##rel##_RR) OP(IF_##rel##_RK) OP(IF_##rel##_DD) OP(IF_##rel##_DF)
+
+#define OPS                                                             \
+  OP(MOV_RR) OP(MOV_RK) OP(MOV_RM) OP(MOV_MR) OP(MOV_MK)               \
+  OP(MOV_DD) OP(MOV_DF) OP(MOV_DM) OP(MOV_MD) OP(MOV_MF)               \
+  OP(ADD_RR) OP(ADD_RK) OP(SUB_RR) OP(SUB_RK) OP(SUB_KR)               \
+  OP(MUL_RR) OP(MUL_RK) OP(DIV_RR) OP(DIV_RK) OP(DIV_KR)               \
+  OP(MOD_RR) OP(MOD_RK) OP(MOD_KR)                                     \
+  OP(FADD_DD) OP(FADD_DF) OP(FSUB_DD) OP(FSUB_DF) OP(FSUB_FD)          \
+  OP(FMUL_DD) OP(FMUL_DF) OP(FDIV_DD) OP(FDIV_DF) OP(FDIV_FD)          \
+  REL_OPS(EQ) REL_OPS(NE) REL_OPS(LT) REL_OPS(GT) REL_OPS(LE) REL_OPS(GE) \
+  OP(GOTO) OP(CALL) OP(RETURN)                                         \
+  OP(PRINT_R) OP(PRINT_K) OP(PRINT_D) OP(PRINT_F) OP(PRINT_S)          \
+  OP(READ_INT) OP(READ_DOUBLE) OP(ERROR) OP(END)
+
+#define OP(x) x,
+typedef enum{ OPS OPS_NUM } opcode_t;
+#undef OP
+
+typedef enum{ REL_EQ, REL_NE, REL_LT, REL_GT, REL_LE, REL_GE } rel_t;
+
+/* Operands: a and b are register numbers or int constants, c is the
+   offset of a memory operand (whose base register is a) or the second
+   source register; x is a double constant. */
+typedef struct Instr{
+  union{
+    const void *handler;
+    opcode_t opcode; // before threading
+  } u;
+  struct Instr *target;
+  union{
+    double x;
+    const char *str;
+  } v;
+  int a, b, c;
+} instr_t;
+
+typedef struct{
+  char *name;
+  int entry; // index of the first instruction
+  int line;
+} func_t;
+
+/* A jump or a call whose target is not known yet. Labels are local to
+   their function, and calls are resolved at the end. */
+typedef struct{
+  int instr;
+  int label;
+  char *name;
+  int line;
+} fixup_t;
+
+static instr_t *code;
+static int code_num, code_size;
+
+static func_t *funcs;
+static int funcs_num, funcs_size;
+
+static fixup_t *fixups;
+static int fixups_num, fixups_size;
+// the first fixup of the current function
+static int func_fixups;
+
+// instruction index of each label of the current function, or -1
+static int *labels;
+static int labels_size;
+
+static int iregs_num, dregs_num;
+// the largest offset from the stack pointer used by a function
+static int max_frame;
+
+static int line_num;
+static const char *line_start;
+
+//--------------------------------------------------------------------
+// decoding
+
+static void decode_error(const char *p, const char *msg)
+{
+  error(line_num, (int)(p - line_start) + 1, "%s", msg);
+}
+
+static instr_t *new_instr(opcode_t opcode)
+{
+  instr_t *instr;
+  if (code_num == code_size)
+    {
+      code_size = code_size * 2 + 256;
+      code = xrealloc(code, code_size * sizeof(instr_t));
+    }
+  instr = &code[code_num++];
+  memset(instr, 0, sizeof(instr_t));
+  instr->u.opcode = opcode;
+  return instr;
+}
+
+static void add_fixup(int label, char *name)
+{
+  fixup_t *fixup;
+  if (fixups_num == fixups_size)
+    {
+      fixups_size = fixups_size * 2 + 64;
+      fixups = xrealloc(fixups, fixups_size * sizeof(fixup_t));
+    }
+  fixup = &fixups[fixups_num++];
+  fixup->instr = code_num - 1;
+  fixup->label = label;
+  fixup->name = name;
+  fixup->line = line_num;
+}
+
+static void set_label(int label)
+{
+  if (label >= labels_size)
+    {
+      int size = labels_size;
+      labels_size = label * 2 + 64;
+      labels = xrealloc(labels, labels_size * sizeof(int));
+      while (size < labels_size)
+        labels[size++] = -1;
+    }
+  labels[label] = code_num;
+}
+
+static const char *skip_space(const char *p)
+{
+  while (*p == ' ' || *p == '\t')
+    ++p;
+  return p;
+}
+
+/* Returns p advanced past the word w and the spaces after it, or NULL
+   if the text at p does not start with the word. */
+static const char *match(const char *p, const char *w)
+{
+  size_t len = strlen(w);
+  if (strncmp(p, w, len) != 0 || isalnum((unsigned char)p[len]) || p[len] == '_')
+    return NULL;
+  return skip_space(p + len);
+}
+
+/* A label: `b' followed by the block number. */
+static const char *parse_label(const char *p, int *label)
+{
+  char *end;
+  long n;
+  if (*p != 'b' || !isdigit((unsigned char)p[1]))
+    {
+      decode_error(p, "label expected");
+      return NULL;
+    }
+  n = strtol(p + 1, &end, 10);
+  if (n > INT32_MAX / 2)
+    {
+      decode_error(p, "label number too large");
+      return NULL;
+    }
+  *label = (int) n;
+  return skip_space(end);
+}
+
+static const char *parse_ident(const char *p, char **name)
+{
+  const char *q = p;
+  while (isalnum((unsigned char)*q) || *q == '_')
+    ++q;
+  if (q == p)
+    {
+      decode_error(p, "identifier expected");
+      return NULL;
+    }
+  *name = xstrndup(p, q - p);
+  return skip_space(q);
+}
+
+typedef enum{ OPD_R, OPD_K, OPD_D, OPD_F, OPD_M } opd_kind_t;
+
+typedef struct{
+  opd_kind_t kind;
+  int n; // register number, int constant or base register
+  int off; // memory offset
+  double x;
+} opd_t;
+
+static const char *parse_reg(const char *p, opd_t *opd)
+{
+  char *end;
+  long n;
+  if (p[0] != '$' || p[1] != '.' || (p[2] != 'i' && p[2] != 'd') || !isdigit((unsigned char)p[3]))
+    {
+      decode_error(p, "register expected");
+      return NULL;
+    }
+  n = strtol(p + 3, &end, 10);
+  if (n >= (1 << 20))
+    {
+      decode_error(p, "register number too large");
+      return NULL;
+    }
+  opd->n = (int) n;
+  if (p[2] == 'i')
+    {
+      opd->kind = OPD_R;
+      if (n >= iregs_num)
+        iregs_num = n + 1;
+    }
+  else
+    {
+      opd->kind = OPD_D;
+      if (n >= dregs_num)
+        dregs_num = n + 1;
+    }
+  return skip_space(end);
+}
+
+static const char *parse_number(const char *p, opd_t *opd)
+{
+  char *end_i, *end_d;
+  long n = strtol(p, &end_i, 10);
+  double x = strtod(p, &end_d);
+  if (end_d == p)
+    {
+      decode_error(p, "operand expected");
+      return NULL;
+    }
+  if (end_i == end_d)
+    {
+      if (n < INT32_MIN || n > INT32_MAX)
+        {
+          decode_error(p, "integer constant out of range");
+          return NULL;
+        }
+      opd->kind = OPD_K;
+      opd->n = (int) n;
+    }
+  else
+    {
+      opd->kind = OPD_F;
+      opd->x = x;
+    }
+  return skip_space(end_d);
+}
+
+static const char *parse_operand(const char *p, opd_t *opd)
+{
+  if (*p == '$')
+    return parse_reg(p, opd);
+  if (*p == '{')
+    {
+      const char *q = parse_reg(skip_space(p + 1), opd);
+      char *end;
+      long off;
+      if (q == NULL)
+        return NULL;
+      if (opd->kind != OPD_R)
+        {
+          decode_error(p, "the address must be in an int register");
+          return NULL;
+        }
+      if (*q != '+' && *q != '-')
+        {
+          decode_error(q, "`+' or `-' expected");
+          return NULL;
+        }
+      off = strtol(skip_space(q + 1), &end, 10);
+      if (*q == '-')
+        off = -off;
+      q = skip_space(end);
+      if (*q != '}')
+        {
+          decode_error(q, "`}' expected");
+          return NULL;
+        }
+      opd->kind = OPD_M;
+      opd->off = (int) off;
+      if (opd->n == 0 && off > max_frame)
+        max_frame = off;
+      return skip_space(q + 1);
+    }
+  return parse_number(p, opd);
+}
+
+static bool is_int(opd_t *opd)
+{
+  return opd->kind == OPD_R || opd->kind == OPD_K;
+}
+
+static bool is_double(opd_t *opd)
+{
+  return opd->kind == OPD_D || opd->kind == OPD_F;
+}
+
+static void check_end(const char *p)
+{
+  if (*p != '\0')
+    decode_error(p, "end of line expected");
+}
+
+/* The string is written by the backend with C escapes. The newline
+   printed after it is included. */
+static const char *parse_string(const char *p, char **str)
+{
+  char *s = xmalloc(strlen(p) + 1);
+  char *q = s;
+  ++p;
+  while (*p != '"')
+    {
+      if (*p == '\0')
+        {
+          decode_error(p, "unterminated string");
+          free(s);
+          return NULL;
+        }
+      if (*p == '\\')
+        {
+          ++p;
+          switch (*p){
+          case 'n':
+            *q++ = '\n';
+            ++p;
+            break;
+          case 't':
+            *q++ = '\t';
+            ++p;
+            break;
+          case '0': case '1': case '2': case '3':
+          case '4': case '5': case '6': case '7':
+            {
+              int val = 0, i;
+              for (i = 0; i < 3 && *p >= '0' && *p <= '7'; ++i)
+                val = val * 8 + (*p++ - '0');
+              *q++ = (char) val;
+              break;
+            }
+          case '\0':
+            decode_error(p, "unterminated string");
+            free(s);
+            return NULL;
+          default:
+            *q++ = *p++;
+            break;
+          };
+        }
+      else
+        {
+          *q++ = *p++;
+        }
+    }
+  *q++ = '\n';
+  *q = '\0';
+  *str = s;
+  return skip_space(p + 1);
+}
+
+static opcode_t if_opcode(rel_t rel, opd_kind_t k1, opd_kind_t k2)
+{
+  // the opcodes of a relation come in the order RR, RK, DD, DF
+  int base = IF_EQ_RR + rel * (IF_NE_RR - IF_EQ_RR);
+  if (k1 == OPD_R)
+    return base + (k2 == OPD_R ? 0 : 1);
+  else
+    return base + (k2 == OPD_D ? 2 : 3);
+}
+
+static rel_t mirror(rel_t rel)
+{
+  switch (rel){
+  case REL_LT:
+    return REL_GT;
+  case REL_GT:
+    return REL_LT;
+  case REL_LE:
+    return REL_GE;
+  case REL_GE:
+    return REL_LE;
+  default:
+    return rel;
+  };
+}
+
+static bool compare(rel_t rel, double x, double y)
+{
+  switch (rel){
+  case REL_EQ:
+    return x == y;
+  case REL_NE:
+    return x != y;
+  case REL_LT:
+    return x < y;
+  case REL_GT:
+    return x > y;
+  case REL_LE:
+    return x <= y;
+  case REL_GE:
+    return x >= y;
+  default:
+    xabort("compare()");
+    return false;
+  };
+}
+
+static void decode_if(const char *p)
+{
+  static const char *rel_strs[] = {"==", "/=", "<", ">", "<=", ">="};
+  opd_t opd1, opd2;
+  rel_t rel;
+  int label;
+  instr_t *instr;
+  if ((p = parse_operand(p, &opd1)) == NULL)
+    return;
+  for (rel = REL_GE; ; --rel)
+    {
+      size_t len = strlen(rel_strs[rel]);
+      if (strncmp(p, rel_strs[rel], len) == 0 && (p[len] == ' ' || p[len] == '\t'))
+        {
+          p = skip_space(p + len);
+          break;
+        }
+      if (rel == REL_EQ)
+        {
+          decode_error(p, "relation expected");
+          return;
+        }
+    }
+  if ((p = parse_operand(p, &opd2)) == NULL)
+    return;
+  if ((p = match(p, "goto")) == NULL)
+    {
+      decode_error(p, "`goto' expected");
+      return;
+    }
+  if ((p = parse_label(p, &label)) == NULL)
+    return;
+  check_end(p);
+  if (opd1.kind == OPD_M || opd2.kind == OPD_M ||
+      (is_int(&opd1) != is_int(&opd2)))
+    {
+      decode_error(line_start, "bad operands of a comparison");
+      return;
+    }
+  if (opd1.kind == OPD_K || opd1.kind == OPD_F)
+    {
+      if (opd2.kind == OPD_K || opd2.kind == OPD_F)
+        {
+          bool jump;
+          if (opd1.kind == OPD_K)
+            jump = compare(rel, opd1.n, opd2.n);
+          else
+            jump = compare(rel, opd1.x, opd2.x);
+          if (jump)
+            {
+              new_instr(GOTO);
+              add_fixup(label, NULL);
+            }
+          return;
+        }
+      swap(opd1, opd2, opd_t);
+      rel = mirror(rel);
+    }
+  instr = new_instr(if_opcode(rel, opd1.kind, opd2.kind));
+  instr->a = opd1.n;
+  instr->b = opd2.n;
+  instr->v.x = opd2.x;
+  add_fixup(label, NULL);
+}
+
+static void decode_print(const char *p)
+{
+  opd_t opd;
+  instr_t *instr;
+  if (*p == '"')
+    {
+      char *str;
+      if ((p = parse_string(p, &str)) == NULL)
+        return;
+      check_end(p);
+      instr = new_instr(PRINT_S);
+      instr->v.str = str;
+      return;
+    }
+  if ((p = parse_operand(p, &opd)) == NULL)
+    return;
+  check_end(p);
+  switch (opd.kind){
+  case OPD_R:
+    new_instr(PRINT_R)->a = opd.n;
+    break;
+  case OPD_K:
+    new_instr(PRINT_K)->a = opd.n;
+    break;
+  case OPD_D:
+    new_instr(PRINT_D)->a = opd.n;
+    break;
+  case OPD_F:
+    new_instr(PRINT_F)->v.x = opd.x;
+    break;
+  default:
+    decode_error(line_start, "bad operand of print");
+  };
+}
+
+static void decode_move(opd_t *dst, opd_t *src)
+{
+  instr_t *instr;
+  int kinds = dst->kind * 8 + src->kind;
+  switch (kinds){
+  case OPD_R * 8 + OPD_R:
+    instr = new_instr(MOV_RR);
+    break;
+  case OPD_R * 8 + OPD_K:
+    instr = new_instr(MOV_RK);
+    break;
+  case OPD_R * 8 + OPD_M:
+    instr = new_instr(MOV_RM);
+    break;
+  case OPD_D * 8 + OPD_D:
+    instr = new_instr(MOV_DD);
+    break;
+  case OPD_D * 8 + OPD_F:
+    instr = new_instr(MOV_DF);
+    break;
+  case OPD_D * 8 + OPD_M:
+    instr = new_instr(MOV_DM);
+    break;
+  case OPD_M * 8 + OPD_R:
+    instr = new_instr(MOV_MR);
+    break;
+  case OPD_M * 8 + OPD_K:
+    instr = new_instr(MOV_MK);
+    break;
+  case OPD_M * 8 + OPD_D:
+    instr = new_instr(MOV_MD);
+    break;
+  case OPD_M * 8 + OPD_F:
+    instr = new_instr(MOV_MF);
+    break;
+  default:
+    decode_error(line_start, "bad operands of an assignment");
+    return;
+  };
+  if (dst->kind == OPD_M)
+    {
+      instr->a = dst->n;
+      instr->c = dst->off;
+      instr->b = src->n;
+    }
+  else
+    {
+      instr->a = dst->n;
+      instr->b = src->n;
+      instr->c = src->off;
+    }
+  instr->v.x = src->x;
+}
+
+static void decode_arith(opd_t *dst, opd_t *opd1, char op, opd_t *opd2)
+{
+  // the first opcode of each operation, and whether it has a KR
+  // (FD) variant
+  opcode_t base;
+  bool commutative;
+  instr_t *instr;
+  if (dst->kind == OPD_R && is_int(opd1) && is_int(opd2))
+    {
+      switch (op){
+      case '+': base = ADD_RR; commutative = true; break;
+      case '-': base = SUB_RR; commutative = false; break;
+      case '*': base = MUL_RR; commutative = true; break;
+      case '/': base = DIV_RR; commutative = false; break;
+      case '%': base = MOD_RR; commutative = false; break;
+      default:
+        decode_error(line_start, "bad operator");
+        return;
+      };
+    }
+  else if (dst->kind == OPD_D && is_double(opd1) && is_double(opd2))
+    {
+      switch (op){
+      case '+': base = FADD_DD; commutative = true; break;
+      case '-': base = FSUB_DD; commutative = false; break;
+      case '*': base = FMUL_DD; commutative = true; break;
+      case '/': base = FDIV_DD; commutative = false; break;
+      default:
+        decode_error(line_start, "bad operator");
+        return;
+      };
+    }
+  else
+    {
+      decode_error(line_start, "bad operands of an arithmetic operation");
+      return;
+    }
+  if (opd1->kind == OPD_K || opd1->kind == OPD_F)
+    {
+      if (opd2->kind == OPD_K || opd2->kind == OPD_F)
+        {
+          /* Both are constants: the first one is loaded into the
+             destination. */
+          decode_move(dst, opd1);
+          *opd1 = *dst;
+        }
+      else if (commutative)
+        {
+          swap(*opd1, *opd2, opd_t);
+        }
+    }
+  if (opd1->kind == OPD_R || opd1->kind == OPD_D)
+    {
+      instr = new_instr(base + (opd2->kind == OPD_R || opd2->kind == OPD_D ? 0 : 1));
+      instr->b = opd1->n;
+      instr->c = opd2->n;
+      instr->v.x = opd2->x;
+    }
+  else
+    {
+      instr = new_instr(base + 2);
+      instr->b = opd1->n;
+      instr->v.x = opd1->x;
+      instr->c = opd2->n;
+    }
+  instr->a = dst->n;
+  if (base == ADD_RR && dst->n == 0 && opd1->n == 0 && opd2->kind == OPD_K && opd2->n > max_frame)
+    max_frame = opd2->n;
+}
+
+static void decode_assign(const char *p)
+{
+  opd_t dst, opd1, opd2;
+  char op;
+  if ((p = parse_operand(p, &dst)) == NULL)
+    return;
+  if (strncmp(p, ":=", 2) != 0)
+    {
+      decode_error(p, "`:=' expected");
+      return;
+    }
+  p = skip_space(p + 2);
+  if (match(p, "readInt") != NULL || match(p, "readDouble") != NULL)
+    {
+      bool read_int = match(p, "readInt") != NULL;
+      check_end(match(p, read_int ? "readInt" : "readDouble"));
+      if (dst.kind != (read_int ? OPD_R : OPD_D))
+        {
+          decode_error(line_start, "bad destination of a read");
+          return;
+        }
+      new_instr(read_int ? READ_INT : READ_DOUBLE)->a = dst.n;
+      return;
+    }
+  if ((p = parse_operand(p, &opd1)) == NULL)
+    return;
+  if (*p == '\0')
+    {
+      decode_move(&dst, &opd1);
+      return;
+    }
+  op = *p;
+  if ((p = parse_operand(skip_space(p + 1), &opd2)) == NULL)
+    return;
+  check_end(p);
+  decode_arith(&dst, &opd1, op, &opd2);
+}
+
+static void end_function()
+{
+  int i;
+  for (i = func_fixups; i < fixups_num; ++i)
+    {
+      fixup_t *fixup = &fixups[i];
+      if (fixup->name == NULL)
+        {
+          if (fixup->label >= labels_size || labels[fixup->label] < 0)
+            {
+              error(fixup->line, 1, "undefined label b%d", fixup->label);
+              continue;
+            }
+          code[fixup->instr].target = (instr_t*)(intptr_t) labels[fixup->label];
+        }
+    }
+  for (i = 0; i < labels_size; ++i)
+    labels[i] = -1;
+  func_fixups = fixups_num;
+}
+
+static void decode_line(char *line)
+{
+  const char *p = skip_space(line);
+  const char *q;
+  line_start = line;
+  if (*p == '\0')
+    return;
+  if ((q = match(p, "function")) != NULL)
+    {
+      char *name;
+      if (match(q, "end") != NULL && *match(q, "end") == '\0')
+        {
+          // reached only if the function does not return
+          new_instr(END);
+          end_function();
+          return;
+        }
+      if (parse_ident(q, &name) == NULL)
+        return;
+      if (funcs_num == funcs_size)
+        {
+          funcs_size = funcs_size * 2 + 16;
+          funcs = xrealloc(funcs, funcs_size * sizeof(func_t));
+        }
+      funcs[funcs_num].name = name;
+      funcs[funcs_num].entry = code_num;
+      funcs[funcs_num].line = line_num;
+      ++funcs_num;
+      return;
+    }
+  if ((q = match(p, "goto")) != NULL)
+    {
+      int label;
+      if ((q = parse_label(q, &label)) == NULL)
+        return;
+      check_end(q);
+      new_instr(GOTO);
+      add_fixup(label, NULL);
+      return;
+    }
+  if ((q = match(p, "if")) != NULL)
+    {
+      decode_if(q);
+      return;
+    }
+  if ((q = match(p, "call")) != NULL)
+    {
+      char *name;
+      if ((q = parse_ident(q, &name)) == NULL)
+        return;
+      check_end(q);
+      new_instr(CALL);
+      add_fixup(-1, name);
+      return;
+    }
+  if ((q = match(p, "return")) != NULL)
+    {
+      check_end(q);
+      new_instr(RETURN);
+      return;
+    }
+  if ((q = match(p, "error")) != NULL)
+    {
+      check_end(q);
+      new_instr(ERROR);
+      return;
+    }
+  if ((q = match(p, "print")) != NULL)
+    {
+      decode_print(q);
+      return;
+    }
+  if (*p == 'b' && isdigit((unsigned char)p[1]))
+    {
+      int label;
+      q = parse_label(p, &label);
+      if (q != NULL && *q == ':')
+        {
+          check_end(skip_space(q + 1));
+          set_label(label);
+          return;
+        }
+    }
+  decode_assign(p);
+}
+
+static int compare_funcs(const void *x, const void *y)
+{
+  return strcmp(((const func_t*)x)->name, ((const func_t*)y)->name);
+}
+
+static func_t *find_func(const char *name)
+{
+  func_t key;
+  key.name = (char*) name;
+  return bsearch(&key, funcs, funcs_num, sizeof(func_t), compare_funcs);
+}
+
+/* Decodes the program in the file at path. Returns the entry point,
+   or NULL after reporting errors. */
+static instr_t *decode(const char *path)
+{
+  FILE *fin = fopen(path, "r");
+  char line[MAX_LINE_LEN + 1];
+  func_t *main_func;
+  int i;
+  if (fin == NULL)
+    {
+      perror("cannot open input file");
+      return NULL;
+    }
+  cur_filename = path;
+  // $.i0 - $.i3 and $.d0 - $.d3 are always there
+  iregs_num = dregs_num = 4;
+  line_num = 0;
+  while (fgets(line, MAX_LINE_LEN + 1, fin) != NULL)
+    {
+      size_t len = strlen(line);
+      ++line_num;
+      if (len > 0 && line[len - 1] == '\n')
+        line[--len] = '\0';
+      else if (!feof(fin))
+        {
+          error(line_num, MAX_LINE_LEN, "line too long");
+          break;
+        }
+      decode_line(line);
+    }
+  fclose(fin);
+  if (func_fixups != fixups_num)
+    error(line_num, 1, "the last function has no end");
+  qsort(funcs, funcs_num, sizeof(func_t), compare_funcs);
+  for (i = 1; i < funcs_num; ++i)
+    {
+      if (strcmp(funcs[i - 1].name, funcs[i].name) == 0)
+        error(funcs[i].line, 1, "function %s defined twice", funcs[i].name);
+    }
+  for (i = 0; i < fixups_num; ++i)
+    {
+      fixup_t *fixup = &fixups[i];
+      instr_t *instr = &code[fixup->instr];
+      if (fixup->name != NULL)
+        {
+          func_t *func = find_func(fixup->name);
+          if (func == NULL)
+            error(fixup->line, 1, "undefined function %s", fixup->name);
+          else
+            instr->target = &code[func->entry];
+        }
+      else
+        {
+          instr->target = &code[(intptr_t) instr->target];
+        }
+    }
+  main_func = find_func("main");
+  if (main_func == NULL)
+    error(line_num, 1, "no main function");
+  if (errors_num > 0)
+    return NULL;
+  return &code[main_func->entry];
+}
+
+static void free_code()
+{
+  int i;
+  for (i = 0; i < code_num; ++i)
+    {
+      if (code[i].u.opcode == PRINT_S)
+        free((char*) code[i].v.str);
+    }
+  for (i = 0; i < funcs_num; ++i)
+    free(funcs[i].name);
+  for (i = 0; i < fixups_num; ++i)
+    free(fixups[i].name);
+  free(code);
+  free(funcs);
+  free(fixups);
+  free(labels);
+}
+
+//--------------------------------------------------------------------
+// execution
+
+static void runtime_error(const char *msg)
+{
+  fflush(stdout);
+  fprintf(stderr, "iquadr: %s\n", msg);
+  exit(3);
+}
+
+/* The division traps like idiv does. */
+static void division_trap()
+{
+  fflush(stdout);
+  raise(SIGFPE);
+  runtime_error("division error");
+}
+
+/* Doubles are printed as in the .output files of the tests: with the fewest digits which read back as the same
+   number, in fixed notation for 0.1 <= |x| < 10^7 and as 1.5e-3
+   otherwise. */
+static void print_double(double x)
+{
+  char buf[32];
+  char digits[20];
+  int prec, exp, len, i;
+  const char *p;
+  if (isnan(x))
+    {
+      puts("NaN");
+      return;
+    }
+  if (isinf(x))
+    {
+      puts(x < 0 ? "-Infinity" : "Infinity");
+      return;
+    }
+  if (x == 0)
+    {
+      puts(signbit(x) ? "-0.0" : "0.0");
+      return;
+    }
+  for (prec = 1; prec < 17; ++prec)
+    {
+      snprintf(buf, sizeof(buf), "%.*e", prec - 1, x);
+      if (strtod(buf, NULL) == x)
+        break;
+    }
+  snprintf(buf, sizeof(buf), "%.*e", prec - 1, x);
+  // buf is [-]d.ddde[+-]xx
+  p = buf;
+  if (*p == '-')
+    {
+      putchar('-');
+      ++p;
+    }
+  len = 0;
+  for (; *p != 'e'; ++p)
+    {
+      if (*p != '.')
+        digits[len++] = *p;
+    }
+  exp = atoi(p + 1);
+  while (len > 1 && digits[len - 1] == '0')
+    --len;
+  if (exp >= -1 && exp < 7)
+    {
+      if (exp == -1)
+        putchar('0');
+      for (i = 0; i <= exp; ++i)
+        putchar(i < len ? digits[i] : '0');
+      putchar('.');
+      if (exp + 1 >= len)
+        putchar('0');
+      for (i = exp + 1; i < len; ++i)
+        putchar(digits[i]);
+    }
+  else
+    {
+      putchar(digits[0]);
+      putchar('.');
+      if (len == 1)
+        putchar('0');
+      for (i = 1; i < len; ++i)
+        putchar(digits[i]);
+      printf("e%d", exp);
+    }
+  putchar('\n');
+}
+
+#define DIVIDE(x, y, result)                                            \
+  {                                                                     \
+    int32_t d = (y);                                                    \
+    if (d == 0 || (d == -1 && (x) == INT32_MIN))                        \
+      division_trap();                                                  \
+    result;                                                             \
+  }
+
+#define INT_OP(x, op, y) ((int32_t)((uint32_t)(x) op (uint32_t)(y)))
+
+/* Runs the program from entry, the beginning of main, and returns the
+   value returned by main. Called with entry NULL, it only replaces
+   the opcodes in the code with the addresses of their handlers. */
+static int run(instr_t *entry)
+{
+#define OP(x) &&L_##x,
+  static const void *handlers[] = { OPS };
+#undef OP
+  int32_t *ri;
+  double *rd;
+  cell_t *mem;
+  instr_t **ret_stack, **rsp, **rsp_limit;
+  int mem_limit;
+  instr_t *ip;
+  int result;
+
+  if (entry == NULL)
+    {
+      int i;
+      for (i = 0; i < code_num; ++i)
+        code[i].u.handler = handlers[code[i].u.opcode];
+      return 0;
+    }
+
+  ri = xmalloc(iregs_num * sizeof(int32_t));
+  rd = xmalloc(dregs_num * sizeof(double));
+  memset(ri, 0, iregs_num * sizeof(int32_t));
+  memset(rd, 0, dregs_num * sizeof(double));
+  // calloc gets the pages only when they are used
+  mem = calloc(MEM_CELLS, sizeof(cell_t));
+  ret_stack = xmalloc(CALL_DEPTH * sizeof(instr_t*));
+  if (mem == NULL)
+    xabort("out of memory");
+  // the largest frame fits above any stack pointer up to mem_limit
+  mem_limit = MEM_CELLS - max_frame - 1;
+  if (mem_limit < 0)
+    runtime_error("stack overflow");
+  rsp = ret_stack;
+  rsp_limit = ret_stack + CALL_DEPTH;
+
+#define DISPATCH goto *ip->u.handler
+#define NEXT { ++ip; DISPATCH; }
+#define JUMP { ip = ip->target; DISPATCH; }
+#define MEM(base, off) mem[ri[base] + (off)]
+
+  ip = entry;
+  DISPATCH;
+
+ L_MOV_RR: ri[ip->a] = ri[ip->b]; NEXT;
+ L_MOV_RK: ri[ip->a] = ip->b; NEXT;
+ L_MOV_RM: ri[ip->a] = MEM(ip->b, ip->c).i; NEXT;
+ L_MOV_MR: MEM(ip->a, ip->c).i = ri[ip->b]; NEXT;
+ L_MOV_MK: MEM(ip->a, ip->c).i = ip->b; NEXT;
+ L_MOV_DD: rd[ip->a] = rd[ip->b]; NEXT;
+ L_MOV_DF: rd[ip->a] = ip->v.x; NEXT;
+ L_MOV_DM: rd[ip->a] = MEM(ip->b, ip->c).d; NEXT;
+ L_MOV_MD: MEM(ip->a, ip->c).d = rd[ip->b]; NEXT;
+ L_MOV_MF: MEM(ip->a, ip->c).d = ip->v.x; NEXT;
+
+ L_ADD_RR: ri[ip->a] = INT_OP(ri[ip->b], +, ri[ip->c]); NEXT;
+ L_ADD_RK: ri[ip->a] = INT_OP(ri[ip->b], +, ip->c); NEXT;
+ L_SUB_RR: ri[ip->a] = INT_OP(ri[ip->b], -, ri[ip->c]); NEXT;
+ L_SUB_RK: ri[ip->a] = INT_OP(ri[ip->b], -, ip->c); NEXT;
+ L_SUB_KR: ri[ip->a] = INT_OP(ip->b, -, ri[ip->c]); NEXT;
+ L_MUL_RR: ri[ip->a] = INT_OP(ri[ip->b], *, ri[ip->c]); NEXT;
+ L_MUL_RK: ri[ip->a] = INT_OP(ri[ip->b], *, ip->c); NEXT;
+ L_DIV_RR: DIVIDE(ri[ip->b], ri[ip->c], ri[ip->a] = ri[ip->b] / d); NEXT;
+ L_DIV_RK: DIVIDE(ri[ip->b], ip->c, ri[ip->a] = ri[ip->b] / d); NEXT;
+ L_DIV_KR: DIVIDE(ip->b, ri[ip->c], ri[ip->a] = ip->b / d); NEXT;
+ L_MOD_RR: DIVIDE(ri[ip->b], ri[ip->c], ri[ip->a] = ri[ip->b] % d); NEXT;
+ L_MOD_RK: DIVIDE(ri[ip->b], ip->c, ri[ip->a] = ri[ip->b] % d); NEXT;
+ L_MOD_KR: DIVIDE(ip->b, ri[ip->c], ri[ip->a] = ip->b % d); NEXT;
+
+ L_FADD_DD: rd[ip->a] = rd[ip->b] + rd[ip->c]; NEXT;
+ L_FADD_DF: rd[ip->a] = rd[ip->b] + ip->v.x; NEXT;
+ L_FSUB_DD: rd[ip->a] = rd[ip->b] - rd[ip->c]; NEXT;
+ L_FSUB_DF: rd[ip->a] = rd[ip->b] - ip->v.x; NEXT;
+ L_FSUB_FD: rd[ip->a] = ip->v.x - rd[ip->c]; NEXT;
+ L_FMUL_DD: rd[ip->a] = rd[ip->b] * rd[ip->c]; NEXT;
+ L_FMUL_DF: rd[ip->a] = rd[ip->b] * ip->v.x; NEXT;
+ L_FDIV_DD: rd[ip->a] = rd[ip->b] / rd[ip->c]; NEXT;
+ L_FDIV_DF: rd[ip->a] = rd[ip->b] / ip->v.x; NEXT;
+ L_FDIV_FD: rd[ip->a] = ip->v.x / rd[ip->c]; NEXT;
+
+#define REL_HANDLERS(rel, cmp)                                          \
+ L_IF_##rel##_RR: if (ri[ip->a] cmp ri[ip->b]) JUMP; NEXT;              \
+ L_IF_##rel##_RK: if (ri[ip->a] cmp ip->b) JUMP; NEXT;                  \
+ L_IF_##rel##_DD: if (rd[ip->a] cmp rd[ip->b]) JUMP; NEXT;              \
+ L_IF_##rel##_DF: if (rd[ip->a] cmp ip->v.x) JUMP; NEXT;
+
+  REL_HANDLERS(EQ, ==)
+  REL_HANDLERS(NE, !=)
+  REL_HANDLERS(LT, <)
+  REL_HANDLERS(GT, >)
+  REL_HANDLERS(LE, <=)
+  REL_HANDLERS(GE, >=)
+
+ L_GOTO: JUMP;
+ L_CALL:
+  if (rsp == rsp_limit || ri[0] > mem_limit)
+    runtime_error("stack overflow");
+  *rsp++ = ip + 1;
+  JUMP;
+ L_RETURN:
+  if (rsp == ret_stack)
+    goto finish;
+  ip = *--rsp;
+  DISPATCH;
+
+ L_PRINT_R: printf("%d\n", ri[ip->a]); NEXT;
+ L_PRINT_K: printf("%d\n", ip->a); NEXT;
+ L_PRINT_D: print_double(rd[ip->a]); NEXT;
+ L_PRINT_F: print_double(ip->v.x); NEXT;
+ L_PRINT_S: fputs(ip->v.str, stdout); NEXT;
+ L_READ_INT:
+  {
+    int x = 0;
+    if (scanf("%d\n", &x) != 1)
+      x = 0;
+    ri[ip->a] = x;
+    NEXT;
+  }
+ L_READ_DOUBLE:
+  {
+    double x = 0;
+    if (scanf("%lf\n", &x) != 1)
+      x = 0;
+    rd[ip->a] = x;
+    NEXT;
+  }
+ L_ERROR:
+  printf("runtime error\n");
+  exit(1);
+ L_END:
+  runtime_error("end of function reached without return");
+
+#undef REL_HANDLERS
+#undef MEM
+#undef JUMP
+#undef NEXT
+#undef DISPATCH
+
+ finish:
+  result = ri[3];
+  free(ri);
+  free(rd);
+  free(mem);
+  free(ret_stack);
+  return result;
+}
+
+//--------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+  bool quiet = false;
+  const char *path;
+  instr_t *entry;
+  int status;
+  struct timespec start, end;
+
+  if (argc == 3 && strcmp(argv[1], "quiet") == 0)
+    {
+      quiet = true;
+      path = argv[2];
+    }
+  else if (argc == 2)
+    {
+      path = argv[1];
+    }
+  else
+    {
+      fprintf(stderr, "usage: %s [quiet] program.qua\n", argv[0]);
+      return 2;
+    }
+
+  entry = decode(path);
+  if (entry == NULL)
+    {
+      free_code();
+      return 2;
+    }
+  run(NULL);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  status = run(entry);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  fflush(stdout);
+  if (!quiet)
+    {
+      fprintf(stderr, "%d instructions, main returned %d after %.3f s\n", code_num, status,
+              (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    }
+  free_code();
+  return status;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "utils.h"
+#include "flags.h"
+#include "timer.h"
+#include "i386_asm.h"
+#include "jit.h"
+
+/* The builtins; they behave like the routines in
+   data/x86_64_linux.asm. */
+
+static void jit_print_int(int x)
+{
+  printf("%d\n", x);
+}
+
+static void jit_print_double(double x)
+{
+  printf("%f\n", x);
+}
+
+static void jit_print_string(const char *str)
+{
+  fputs(str, stdout);
+}
+
+static int jit_read_int()
+{
+  int x = 0;
+  if (scanf("%d\n", &x) != 1)
+    return 0;
+  return x;
+}
+
+static double jit_read_double()
+{
+  double x = 0;
+  if (scanf("%lf\n", &x) != 1)
+    return 0;
+  return x;
+}
+
+static void jit_error()
+{
+  printf("runtime error\n");
+  exit(1);
+}
+
+static struct{
+  const char *name;
+  void *addr;
+} builtins[] = {
+  {"printInt", jit_print_int},
+  {"printDouble", jit_print_double},
+  {"printString", jit_print_string},
+  {"readInt", jit_read_int},
+  {"readDouble", jit_read_double},
+  {"error", jit_error}
+};
+
+static void *resolve(const char *name)
+{
+  size_t i;
+  for (i = 0; i < sizeof(builtins) / sizeof(builtins[0]); ++i)
+    {
+      if (strcmp(builtins[i].name, name) == 0)
+        return builtins[i].addr;
+    }
+  return NULL;
+}
+
+/* Writes /tmp/perf-<pid>.map, from which perf takes the names of the
+   functions in code it has no symbol table for. */
+static void write_perf_map(asm_image_t *image)
+{
+  char path[64];
+  const image_sym_t *syms;
+  int i, num;
+  FILE *fout;
+  sprintf(path, "/tmp/perf-%d.map", (int) getpid());
+  fout = fopen(path, "w");
+  if (fout == NULL)
+    {
+      perror("cannot write the perf map");
+      return;
+    }
+  syms = image_code_syms(image, &num);
+  for (i = 0; i < num; ++i)
+    {
+      fprintf(fout, "%lx %lx %s\n", (unsigned long) syms[i].addr,
+              (unsigned long) syms[i].size, syms[i].name);
+    }
+  fclose(fout);
+}
+
+bool jit_run(const char *text, size_t len, int *status)
+{
+  asm_image_t *image;
+  int (*main_func)();
+  timer_push(PHASE_ASSEMBLE);
+  image = load_x86_64(text, len, resolve);
+  timer_pop();
+  if (image == NULL)
+    return false;
+  main_func = (int (*)()) image_symbol(image, "main");
+  if (main_func == NULL)
+    {
+      fprintf(stderr, "no main function\n");
+      free_image(image);
+      return false;
+    }
+  if (f_perf_map)
+    write_perf_map(image);
+  // the program shares stdout with the compiler
+  fflush(stdout);
+  *status = main_func();
+  fflush(stdout);
+  free_image(image);
+  return true;
+}
@@ -0,0 +1,14 @@
+/* jit.h - running the compiled program in memory (--run) */
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "utils.h"
+
+/* Loads the code generated by the x86-64 backend into memory, with
+   the builtins bound to C functions, and calls its main function.
+   Stores the value returned by main in *status. Returns false if the
+   code cannot be loaded. */
+bool jit_run(const char *text, size_t len, int *status);
+
+#endif
@@ -1,6 +1,8 @@
 /* jl.c - the main program */
 
 #include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
 #include "utils.h"
 #include "mem.h"
 #include "symtab.h"
@@ -10,12 +12,22 @@
 #include "opt.h"
 #include "gencode.h"
 #include "flags.h"
+#include "stats.h"
+#include "timer.h"
 #include "i386_backend.h"
+#include "i386_asm.h"
+#include "x86_64_backend.h"
 #include "quadr_backend.h"
+#include "qbin.h"
+#include "jit.h"
 
 extern FILE *yyout;
-extern FILE *yyin;
 extern int yyparse (node_t **);
+extern bool scan_open(const char *);
+extern void scan_rewind();
+extern void scan_close();
+extern void declare_functions();
+extern void (*func_handler)(func_t *);
 
 static void declare_builtins()
 {
@@ -71,6 +83,11 @@ static void declare_builtins()
 
 // current output file
 static char outfile[MAX_PATH_LEN+1];
+// the assembly code of the current program when it is assembled
+static char *asm_text;
+static size_t asm_size;
+// the exit status of the program run by --run
+static int run_status;
 
 static void change_outfile_extension(const char *ext)
 {
@@ -91,68 +108,182 @@ static void change_outfile_extension(const char *ext)
     }
 }
 
-static void prepare_backend()
+static void create_backend()
 {
-  outfile[MAX_PATH_LEN] = '\0';
   switch(f_backend_type){
   case BACK_I386:
     backend = new_i386_backend();
-    if (f_output_file == NULL)
-      {
-        strncpy(outfile, cur_filename, MAX_PATH_LEN);
-      }
-    else
-      {
-        strncpy(outfile, f_output_file, MAX_PATH_LEN);
-      }
-    change_outfile_extension(".asm");
+    break;
+  case BACK_X86_64:
+    backend = new_x86_64_backend();
     break;
   case BACK_QUADR:
     backend = new_quadr_backend();
-    if (f_output_file == NULL)
-      {
-        strncpy(outfile, cur_filename, MAX_PATH_LEN);
-        change_outfile_extension(".qua");
-      }
-    else
-      {
-        strncpy(outfile, f_output_file, MAX_PATH_LEN);
-      }
     break;
   default:
     xabort("unsupported backend");
   };
+}
+
+static void free_backend()
+{
+  switch(f_backend_type){
+  case BACK_I386:
+    free_i386_backend(backend);
+    break;
+  case BACK_X86_64:
+    free_x86_64_backend(backend);
+    break;
+  case BACK_QUADR:
+    free_quadr_backend(backend);
+    break;
+  default:
+    xabort("unsupported backend");
+  };
+}
+
+/* Whether the backend generates machine code (NASM assembly). */
+static bool native_backend()
+{
+  return f_backend_type == BACK_I386 || f_backend_type == BACK_X86_64;
+}
+
+/* Closes and removes the output file of a program that failed to
+   compile. */
+static void discard_output()
+{
+  fclose(backend->fout);
+  free(asm_text);
+  asm_text = NULL;
+  remove(outfile);
+}
+
+static char output_error[MAX_PATH_LEN + 64];
+
+/* Opens the output file for the current program and initializes the
+   backend. Returns NULL on success, and otherwise an error message,
+   which is left to the caller to report. */
+static const char *start_backend()
+{
+  const char *error;
+  outfile[MAX_PATH_LEN] = '\0';
+  if (f_output_file == NULL)
+    {
+      strncpy(outfile, cur_filename, MAX_PATH_LEN);
+      change_outfile_extension(native_backend() ? ".asm" : ".qua");
+    }
+  else
+    {
+      strncpy(outfile, f_output_file, MAX_PATH_LEN);
+      if (native_backend())
+        {
+          change_outfile_extension(".asm");
+        }
+    }
   LOG2("output file: %s\n", outfile);
-  backend->fout = fopen(outfile, "w");
+  if (native_backend() && (f_assemble || f_run))
+    {
+      // the code is assembled in memory
+      backend->fout = open_memstream(&asm_text, &asm_size);
+    }
+  else
+    {
+      backend->fout = fopen(outfile, "w");
+    }
   if (backend->fout == NULL)
     {
-      perror("cannot open output file for writing");
-      exit(2);
+      snprintf(output_error, sizeof(output_error),
+               "cannot open output file for writing: %s", strerror(errno));
+      return output_error;
+    }
+  error = backend->init();
+  if (error != NULL)
+    {
+      discard_output();
+      return error;
+    }
+  return NULL;
+}
+
+/* Like start_backend(), but reports the error. Returns false if the
+   backend cannot be started. */
+static bool prepare_backend()
+{
+  const char *error = start_backend();
+  if (error != NULL)
+    {
+      fprintf(stderr, "%s\n", error);
+      return false;
+    }
+  return true;
+}
+
+/* Writes the assembly code in asm_text to outfile, which becomes the
+   object file. Returns false on error. */
+static bool assemble()
+{
+  FILE *fout;
+  bool success;
+  if (f_preserve_files)
+    {
+      fout = fopen(outfile, "w");
+      if (fout == NULL || fwrite(asm_text, 1, asm_size, fout) != asm_size)
+        {
+          perror("cannot write the assembly file");
+          if (fout != NULL)
+            fclose(fout);
+          return false;
+        }
+      fclose(fout);
+    }
+  change_outfile_extension(".o");
+  fout = fopen(outfile, "wb");
+  if (fout == NULL)
+    {
+      perror("cannot open the object file for writing");
+      return false;
     }
-  backend->init();
+  timer_push(PHASE_ASSEMBLE);
+  if (f_backend_type == BACK_X86_64)
+    success = assemble_x86_64(asm_text, asm_size, fout);
+  else
+    success = assemble_i386(asm_text, asm_size, fout);
+  timer_pop();
+  if (fclose(fout) != 0)
+    success = false;
+  if (!success)
+    remove(outfile);
+  return success;
 }
 
-static void finish_up()
+/* Returns false if the assembler or the linker failed. */
+static bool finish_up()
 {
+  timer_push(PHASE_OUTPUT);
   backend->final();
   fclose(backend->fout);
-  if (f_backend_type == BACK_I386)
+  timer_pop();
+  if (f_run)
+    {
+      bool success = jit_run(asm_text, asm_size, &run_status);
+      free(asm_text);
+      asm_text = NULL;
+      return success;
+    }
+  if (native_backend())
     {
       if (f_assemble)
         {
-          char infile[MAX_PATH_LEN];
-          char asmfile[MAX_PATH_LEN];
+          char objfile[MAX_PATH_LEN+1];
           char cmd[MAX_PATH_LEN*3];
-          int success;
-          asmfile[0] = '\0';
-          strcpy(infile, outfile);
-          change_outfile_extension(".o");
-          sprintf(cmd, "nasm -f elf -o %s %s", outfile, infile);
-          success = system(cmd);
-          strcpy(asmfile, infile);
-          strcpy(infile, outfile);
-          if (f_link && success == 0)
+          bool success = assemble();
+          free(asm_text);
+          asm_text = NULL;
+          if (!success)
+            return false;
+          if (f_link)
             {
+              strcpy(objfile, outfile);
               if (f_output_file != NULL)
                 {
                   strncpy(outfile, f_output_file, MAX_PATH_LEN);
@@ -161,106 +292,441 @@ static void finish_up()
                 {
                   change_outfile_extension("");
                 }
-              sprintf(cmd, "ld -o %s %s -lc -dynamic-linker /lib/ld-linux.so.2",
-                      outfile, infile);
-              success = system(cmd);
-            }
-          if (!f_preserve_files)
-            {
-              sprintf(cmd, "rm %s %s", infile, asmfile);
+              if (f_backend_type == BACK_X86_64)
+                sprintf(cmd, "ld -o %s %s -lc -dynamic-linker /lib64/ld-linux-x86-64.so.2",
+                        outfile, objfile);
+              else
+                sprintf(cmd, "ld -m elf_i386 -o %s %s -lc -dynamic-linker /lib/ld-linux.so.2",
+                        outfile, objfile);
+              timer_push(PHASE_LINK);
+              success = system(cmd) == 0;
+              timer_pop();
+              if (!success)
+                {
+                  fprintf(stderr, "%s: error invoking the linker\n", cur_filename);
+                  return false;
+                }
+              if (!f_preserve_files)
+                remove(objfile);
             }
-          if (success != 0)
+        }
+    }
+  return true;
+}
+
+static void compile_function(quadr_func_t *func, FILE *ficode, qbin_writer_t *fqbin)
+{
+  timer_mark_t mark;
+  timer_start_func(&mark);
+  if (f_optimize_local)
+    {
+      timer_push(PHASE_LOCAL_OPT);
+      perform_local_optimizations(func);
+      timer_pop();
+    }
+  timer_push(PHASE_FLOW);
+  create_block_graph(func);
+  analyze_flow(func);
+  timer_pop();
+  if (ficode != NULL)
+    {
+      write_quadr_func(ficode, func);
+    }
+  if (fqbin != NULL)
+    {
+      qbin_write_func(fqbin, func);
+    }
+  timer_push(PHASE_GENCODE);
+  gencode(func);
+  timer_pop();
+  timer_end_func(func->name, &mark);
+}
+
+/* Parallel compilation. The workers take the functions in order, and
+   the code of each function is written to its own buffer. The buffers
+   are written out in source order afterwards, so the output does not
+   depend on the number of threads. */
+
+typedef struct{
+  char *code;
+  size_t size;
+} func_code_t;
+
+static func_code_t *func_codes;
+static int next_func;
+
+static void *compile_worker(void *arg)
+{
+  int i;
+  quadr_thread_init();
+  gencode_init();
+  while ((i = __atomic_fetch_add(&next_func, 1, __ATOMIC_RELAXED)) < func_num)
+    {
+      quadr_func_t *func = &quadr_func[i];
+      if (func->tag == QF_USER_DEFINED)
+        {
+          gencode_fout = open_memstream(&func_codes[i].code, &func_codes[i].size);
+          if (gencode_fout == NULL)
             {
-              xabort("error invoking child process");
+              xabort("out of memory");
             }
+          compile_function(func, NULL, NULL);
+          fclose(gencode_fout);
         }
     }
+  gencode_cleanup();
+  optimizer_thread_cleanup();
+  quadr_thread_cleanup();
+  return NULL;
 }
 
-int main(int argc, char **argv)
+static void generate_code_in_parallel(int jobs)
 {
-  node_t *program;
+  pthread_t *threads = xmalloc(jobs * sizeof(pthread_t));
+  int i;
+  func_codes = xmalloc(func_num * sizeof(func_code_t));
+  memset(func_codes, 0, func_num * sizeof(func_code_t));
+  next_func = 0;
+  for (i = 0; i < jobs; ++i)
+    {
+      if (pthread_create(&threads[i], NULL, compile_worker, NULL) != 0)
+        {
+          xabort("cannot create a thread");
+        }
+    }
+  for (i = 0; i < jobs; ++i)
+    {
+      pthread_join(threads[i], NULL);
+    }
+  timer_push(PHASE_OUTPUT);
+  for (i = 0; i < func_num; ++i)
+    {
+      fwrite(func_codes[i].code, 1, func_codes[i].size, backend->fout);
+      free(func_codes[i].code);
+    }
+  timer_pop();
+  free(func_codes);
+  free(threads);
+}
 
-  parse_flags(argc, argv);
+// the icode output files, or NULL
+static FILE *ficode;
+static FILE *fqbin_file;
+static qbin_writer_t *fqbin;
 
-  if (f_input_files_num != 1)
+static void open_icode_file()
+{
+  ficode = NULL;
+  fqbin_file = NULL;
+  fqbin = NULL;
+  if (f_icode_output_file != NULL)
     {
-      fprintf(stderr, "usage: %s [options] program.jl\n", argv[0]);
-      exit(1);
+      ficode = fopen(f_icode_output_file, "w");
+      if (ficode == NULL)
+        perror("cannot open icode file for writing");
+    }
+  if (f_icode_bin_file != NULL)
+    {
+      fqbin_file = fopen(f_icode_bin_file, "wb");
+      if (fqbin_file == NULL)
+        perror("cannot open binary icode file for writing");
+      else
+        fqbin = new_qbin_writer(fqbin_file);
     }
-  cur_filename = f_input_files[0];
+}
 
-  symtab_init();
-  types_init();
-  tree_init();
-  quadr_init();
+static void close_icode_file()
+{
+  if (ficode != NULL)
+    fclose(ficode);
+  if (fqbin != NULL)
+    {
+      bool ok = qbin_finish(fqbin);
+      if (fclose(fqbin_file) != 0 || !ok)
+        fprintf(stderr, "cannot write %s\n", f_icode_bin_file);
+    }
+}
 
-  yyout = stderr;
-  yyin = fopen(cur_filename, "r");
-  if (yyin == NULL)
+static void generate_code()
+{
+  int i;
+  open_icode_file();
+  if (f_jobs > 1 && func_num > 1 && ficode == NULL && fqbin == NULL)
     {
-      perror("cannot open input file");
-      exit(2);
+      generate_code_in_parallel(f_jobs < func_num ? f_jobs : func_num);
+      return;
+    }
+  gencode_fout = backend->fout;
+  gencode_init();
+  for (i = 0; i < func_num; ++i)
+    {
+      quadr_func_t *func = &quadr_func[i];
+      if (func->tag == QF_USER_DEFINED)
+        {
+          compile_function(func, ficode, fqbin);
+        }
     }
+  gencode_cleanup();
+  optimizer_thread_cleanup();
+  close_icode_file();
+}
 
-  declare_builtins();
+/* Parses and checks the whole program, and then generates code for
+   all its functions, possibly in parallel. */
+static int compile_program()
+{
+  node_t *program;
+  int status = 0;
 
+  timer_push(PHASE_PARSE);
   yyparse(&program);
-  fclose(yyin);
+  timer_pop();
   if (errors_num != 0)
     {
-      xabort("syntax errors - aborting");
+      fprintf(stderr, "%s: syntax errors - aborting\n", cur_filename);
+      return 1;
     }
   LOG("parsed OK\n");
 
-  suppress_code_generation = f_no_gencode;
+  timer_push(PHASE_SEMANTIC_CHECK);
   semantic_check(program);
+  timer_pop();
   if (errors_num == 0)
     {
       LOG("semantic check OK\n");
     }
-
-  tree_cleanup();
+  else
+    {
+      status = 1;
+    }
+  tree_reset();
 
   if (errors_num == 0 && !f_no_gencode)
     {
-      int i;
-      FILE *ficode = NULL;
-      if (f_icode_output_file != NULL)
+      if (prepare_backend())
         {
-          ficode = fopen(f_icode_output_file, "w");
-          if (ficode == NULL)
-            perror("cannot open icode file for writing");
+          generate_code();
+          if (!finish_up())
+            status = 1;
         }
-      prepare_backend();
-      gencode_init();
-      for (i = 0; i < func_num; ++i)
+      else
         {
-          quadr_func_t *func = &quadr_func[i];
-          if (func->tag == QF_USER_DEFINED)
+          status = 2;
+        }
+    }
+  return status;
+}
+
+/* Streaming compilation. The functions are declared by a pre-scan of
+   the input, and then each function is checked, translated and
+   emitted as soon as it has been parsed. Its syntax tree and code are
+   freed before the next function is parsed, so the memory used
+   depends on the size of the largest function rather than on the size
+   of the whole program. */
+
+// the number of errors found by the semantic check; any other errors
+// are syntax errors
+static int check_errors_num;
+
+// whether the code generation for the current program has started
+static bool gencode_started;
+// the error which prevented it from starting, or NULL; it is reported
+// only if the program has no errors of its own
+static const char *gencode_error;
+
+/* Starts the code generation for the current program, unless it has
+   already been started or has failed to start. It is started when
+   the first function is ready for code generation, so that programs
+   with errors in front of it are reported without any backend I/O.
+   Returns whether code may be generated. */
+static bool start_gencode()
+{
+  if (!gencode_started && gencode_error == NULL)
+    {
+      gencode_error = start_backend();
+      if (gencode_error == NULL)
+        {
+          gencode_started = true;
+          open_icode_file();
+          gencode_fout = backend->fout;
+          gencode_init();
+        }
+    }
+  return gencode_started;
+}
+
+static void compile_parsed_function(func_t *node)
+{
+  if (errors_num == check_errors_num)
+    {
+      int errors = errors_num;
+      timer_push(PHASE_SEMANTIC_CHECK);
+      semantic_check_function(node);
+      timer_pop();
+      check_errors_num += errors_num - errors;
+      if (errors_num == 0 && !f_no_gencode && start_gencode())
+        {
+          quadr_func_t *func = node->ident->decl->u.func;
+          compile_function(func, ficode, fqbin);
+          free_func(func);
+        }
+    }
+  strings_cleanup();
+  tree_reset();
+}
+
+static int compile_functions()
+{
+  node_t *program;
+  int status = 0;
+
+  gencode_started = false;
+  gencode_error = NULL;
+
+  timer_push(PHASE_PARSE);
+  declare_functions();
+  scan_rewind();
+
+  check_errors_num = 0;
+  begin_semantic_check();
+  func_handler = compile_parsed_function;
+  yyparse(&program);
+  func_handler = NULL;
+  timer_pop();
+  if (errors_num != check_errors_num)
+    {
+      fprintf(stderr, "%s: syntax errors - aborting\n", cur_filename);
+      status = 1;
+    }
+  else
+    {
+      LOG("parsed OK\n");
+      timer_push(PHASE_SEMANTIC_CHECK);
+      end_semantic_check();
+      timer_pop();
+      if (errors_num == 0)
+        {
+          LOG("semantic check OK\n");
+        }
+      else
+        {
+          status = 1;
+        }
+    }
+
+  if (!f_no_gencode)
+    {
+      if (status == 0 && !start_gencode())
+        {
+          fprintf(stderr, "%s\n", gencode_error);
+          status = 2;
+        }
+      if (gencode_started)
+        {
+          gencode_cleanup();
+          optimizer_thread_cleanup();
+          close_icode_file();
+          if (status == 0)
             {
-              if (f_optimize_local)
-                {
-                  perform_local_optimizations(func);
-                }
-              create_block_graph(func);
-              analyze_flow(func);
-              if (ficode != NULL)
-                {
-                  write_quadr_func(ficode, func);
-                }
-              gencode(func);
+              if (!finish_up())
+                status = 1;
+            }
+          else
+            {
+              discard_output();
             }
         }
-      gencode_cleanup();
-      finish_up();
-      if (ficode != NULL)
-        fclose(ficode);
+    }
+  return status;
+}
+
+/* Compiles one program. All the per-program state is initialized
+   here and freed before returning. Returns the exit status for the
+   program: 0 on success, 1 on compilation errors and 2 on I/O
+   errors. */
+static int compile(const char *path)
+{
+  int status;
+
+  cur_filename = path;
+  errors_num = 0;
+
+  symtab_init();
+  types_init();
+  tree_init();
+  quadr_init();
+
+  if (!scan_open(cur_filename))
+    {
+      perror("cannot open input file");
+      status = 2;
+    }
+  else
+    {
+      declare_builtins();
+      suppress_code_generation = f_no_gencode;
+      if (f_jobs > 1)
+        status = compile_program();
+      else
+        status = compile_functions();
+      scan_close();
     }
 
+  tree_cleanup();
   quadr_cleanup();
   types_cleanup();
   symtab_cleanup();
   strings_cleanup();
-  return 0;
+  return status;
+}
+
+int main(int argc, char **argv)
+{
+  int i, status = 0, failed = 0;
+
+  parse_flags(argc, argv);
+  timer_init();
+
+  if (f_input_files_num == 0 ||
+      (f_input_files_num > 1 && (f_output_file != NULL || f_run)))
+    {
+      fprintf(stderr, "usage: %s [options] program.jl...\n", argv[0]);
+      exit(1);
+    }
+
+  yyout = stderr;
+  if (!f_no_gencode)
+    {
+      create_backend();
+    }
+
+  for (i = 0; i < f_input_files_num; ++i)
+    {
+      int file_status = compile(f_input_files[i]);
+      if (file_status != 0)
+        {
+          ++failed;
+          if (file_status > status)
+            status = file_status;
+        }
+    }
+
+  if (f_input_files_num > 1 && failed > 0)
+    {
+      fprintf(stderr, "%d of %d programs failed to compile\n", failed, f_input_files_num);
+    }
+  if (f_stats)
+    print_stats(stderr);
+
+  if (!f_no_gencode)
+    {
+      free_backend();
+    }
+  // after the backend is freed, so that its memory usage is recorded
+  if (f_time_report != TIME_REPORT_NONE)
+    print_time_report(stderr);
+  if (f_run && status == 0)
+    status = run_status;
+  cleanup_flags();
+  return status;
 }
@@ -1,36 +1,94 @@
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include "utils.h"
 #include "mem.h"
 
+/* Memory usage */
+
+static mem_usage_t *mem_usage = NULL;
+static mem_usage_t **mem_usage_end = &mem_usage;
+static pthread_mutex_t mem_usage_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void record_peak(const char *name, size_t peak_bytes)
+{
+  mem_usage_t *u;
+  if (name == NULL)
+    return;
+  pthread_mutex_lock(&mem_usage_lock);
+  for (u = mem_usage; u != NULL; u = u->next)
+    {
+      if (strcmp(u->name, name) == 0)
+        break;
+    }
+  if (u == NULL)
+    {
+      u = xmalloc(sizeof(mem_usage_t));
+      u->name = name;
+      u->peak_bytes = 0;
+      u->next = NULL;
+      *mem_usage_end = u;
+      mem_usage_end = &u->next;
+    }
+  if (peak_bytes > u->peak_bytes)
+    u->peak_bytes = peak_bytes;
+  pthread_mutex_unlock(&mem_usage_lock);
+}
+
+const mem_usage_t *get_mem_usage()
+{
+  return mem_usage;
+}
+
+void free_mem_usage()
+{
+  while (mem_usage != NULL)
+    {
+      mem_usage_t *next = mem_usage->next;
+      free(mem_usage);
+      mem_usage = next;
+    }
+  mem_usage_end = &mem_usage;
+}
+
+/* Adds n to the size of a pool or an allocator. */
+#define add_bytes(x, n) do {                                    \
+    (x)->bytes += (n);                                          \
+    if ((x)->bytes > (x)->peak_bytes)                           \
+      (x)->peak_bytes = (x)->bytes;                             \
+  } while (0)
+
 /* pool_t */
 
 #define ALIGN sizeof(void*)
 #define PNEXT(x) *((void**)(x))
+#define MIN_SLAB_SIZE 4096
+#define SLAB_HEADER_SIZE ((sizeof(pool_node_t) + 2 * ALIGN - 1) & ~(2 * ALIGN - 1))
+#define SLAB_OF(pool, ptr) ((pool_node_t*)((uintptr_t)(ptr) & ~((uintptr_t)(pool)->slab_size - 1)))
 
-static void make_free_list(void **ptr, void **end, int elem_size)
+static pool_node_t *new_pool_node(pool_t *pool)
 {
-  while (ptr != end)
+  pool_node_t *ret;
+  void **ptr, **next;
+  size_t i;
+  if (posix_memalign((void**)&ret, pool->slab_size, pool->slab_size) != 0)
+    xabort("out of memory");
+  add_bytes(pool, pool->slab_size);
+  ret->first_free = (char*)ret + SLAB_HEADER_SIZE;
+  ret->free_num = pool->slab_elems;
+  ptr = (void**)ret->first_free;
+  for (i = 1; i < pool->slab_elems; ++i)
     {
-      void **next = (void**)(((char*)ptr) + elem_size);
+      next = (void**)(((char*)ptr) + pool->elem_size);
       PNEXT(ptr) = next;
       ptr = next;
     }
-  ptr = (void**)(((char*)end) - elem_size);
-  *ptr = NULL;
-}
-
-// size - number of bytes
-static pool_node_t *new_pool_node(size_t size, size_t elem_size)
-{
-  pool_node_t *ret = xmalloc(sizeof(pool_node_t));
-  ret->size = size * elem_size;
-  ret->data = ret->first_free = xmalloc(ret->size);
-  make_free_list((void**)ret->data, (void**)(ret->data + ret->size),
-                 elem_size);
-  ret->next = NULL;
-  ret->next_free = NULL;
+  PNEXT(ptr) = NULL;
+  ret->next = pool->nodes;
+  pool->nodes = ret;
+  ret->next_free = pool->first_free;
+  pool->first_free = ret;
   return ret;
 }
 
@@ -38,12 +96,24 @@ static pool_node_t *new_pool_node(size_t size, size_t elem_size)
 pool_t *new_pool(size_t size, size_t elem_size)
 {
   pool_t *pool = xmalloc(sizeof(pool_t));
+  size_t bytes;
   if (elem_size < sizeof(void*))
     elem_size = sizeof(void*);
   elem_size += ALIGN - 1;
   elem_size -= elem_size & (ALIGN - 1);
   pool->elem_size = elem_size;
-  pool->first_free = pool->nodes = new_pool_node(size, elem_size);
+  /* the initial number of elements fits in one slab */
+  bytes = SLAB_HEADER_SIZE + (size > 0 ? size : 1) * elem_size;
+  pool->slab_size = MIN_SLAB_SIZE;
+  while (pool->slab_size < bytes)
+    pool->slab_size <<= 1;
+  pool->slab_elems = (pool->slab_size - SLAB_HEADER_SIZE) / elem_size;
+  pool->first_free = pool->nodes = NULL;
+  pool->shared = 0;
+  pthread_mutex_init(&pool->lock, NULL);
+  pool->name = NULL;
+  pool->bytes = pool->peak_bytes = 0;
+  new_pool_node(pool);
   return pool;
 }
 
@@ -53,52 +123,50 @@ void free_pool(pool_t *pool)
   while (node != NULL)
     {
       pool_node_t* next = node->next;
-      free(node->data);
       free(node);
       node = next;
     }
+  record_peak(pool->name, pool->peak_bytes);
+  pthread_mutex_destroy(&pool->lock);
   free(pool);
 }
 
+void reset_pool(pool_t *pool)
+{
+  pool_node_t* node = pool->nodes;
+  while (node != NULL)
+    {
+      pool_node_t* next = node->next;
+      free(node);
+      node = next;
+    }
+  pool->first_free = pool->nodes = NULL;
+  pool->bytes = 0;
+  new_pool_node(pool);
+}
+
 void *palloc(pool_t *pool)
 {
   pool_node_t *pn = pool->first_free;
   void *ret;
-  void *next;
+  if (pn == NULL)
+    pn = new_pool_node(pool);
   ret = pn->first_free;
-  pn->first_free = next = PNEXT(ret);
-  if (pn->first_free == NULL)
-    {
+  pn->first_free = PNEXT(ret);
+  if (--pn->free_num == 0)
+    { // full - remove from the list of nodes with free space
       pool->first_free = pn->next_free;
-      if (pool->first_free == NULL)
-        {
-          while (pn->next != NULL)
-            {
-              pn = pn->next;
-            }
-          pn->next = new_pool_node(pn->size << 1, pool->elem_size);
-          pool->first_free = pn->next;
-        }
     }
   return ret;
 }
 
 void pfree(pool_t *pool, void *ptr)
 {
-  pool_node_t *pn = pool->nodes;
-  while (pn != NULL)
-    {
-      if ((char*)ptr >= (char*)pn->data && (char*)ptr < (char*)pn->data + pn->size)
-        {
-          break;
-        }
-      pn = pn->next;
-    }
-  assert (pn != NULL);
-  void *next = pn->first_free;
-  PNEXT(ptr) = next;
+  pool_node_t *pn = SLAB_OF(pool, ptr);
+  assert ((char*)ptr >= (char*)pn + SLAB_HEADER_SIZE);
+  PNEXT(ptr) = pn->first_free;
   pn->first_free = ptr;
-  if (next == NULL)
+  if (pn->free_num++ == 0)
     { // was full before - insert at the head of the free pool node
       // list
       pn->next_free = pool->first_free;
@@ -106,11 +174,72 @@ void pfree(pool_t *pool, void *ptr)
     }
 }
 
+/* pool_cache_t */
+
+void init_pool_cache(pool_cache_t *cache, pool_t *pool)
+{
+  cache->pool = pool;
+  cache->first_free = NULL;
+  cache->free_num = 0;
+}
+
+/* Returns n objects from the cache to the pool. */
+static void drain_pool_cache(pool_cache_t *cache, size_t n)
+{
+  pool_t *pool = cache->pool;
+  pthread_mutex_lock(&pool->lock);
+  while (n-- > 0)
+    {
+      void *ptr = cache->first_free;
+      cache->first_free = PNEXT(ptr);
+      --cache->free_num;
+      pfree(pool, ptr);
+    }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void flush_pool_cache(pool_cache_t *cache)
+{
+  drain_pool_cache(cache, cache->free_num);
+}
+
+void *pcalloc_shared(pool_cache_t *cache)
+{
+  void *ret;
+  if (cache->first_free == NULL)
+    {
+      pool_t *pool = cache->pool;
+      int i;
+      pthread_mutex_lock(&pool->lock);
+      for (i = 0; i < POOL_CACHE_BATCH; ++i)
+        {
+          void *ptr = palloc(pool);
+          PNEXT(ptr) = cache->first_free;
+          cache->first_free = ptr;
+        }
+      pthread_mutex_unlock(&pool->lock);
+      cache->free_num = POOL_CACHE_BATCH;
+    }
+  ret = cache->first_free;
+  cache->first_free = PNEXT(ret);
+  --cache->free_num;
+  return ret;
+}
+
+void pcfree_shared(pool_cache_t *cache, void *ptr)
+{
+  PNEXT(ptr) = cache->first_free;
+  cache->first_free = ptr;
+  if (++cache->free_num >= 2 * POOL_CACHE_BATCH)
+    drain_pool_cache(cache, POOL_CACHE_BATCH);
+}
+
 /* alloc_t */
 
-static alloc_node_t *new_alloc_node(int pool_size)
+static alloc_node_t *new_alloc_node(alloc_t *alc, int pool_size)
 {
   alloc_node_t *ret = xmalloc(sizeof(alloc_node_t));
+  add_bytes(alc, pool_size);
   ret->pool_size = pool_size;
   ret->pool_free = 0;
   ret->pool = xmalloc(pool_size);
@@ -132,7 +261,9 @@ static void free_alloc_node_lst(alloc_node_t *node)
 alloc_t *new_alloc(int pool_size)
 {
   alloc_t *ret = xmalloc(sizeof(alloc_t));
-  ret->nodes = new_alloc_node(pool_size);
+  ret->name = NULL;
+  ret->bytes = ret->peak_bytes = 0;
+  ret->nodes = new_alloc_node(ret, pool_size);
   ret->first_free = ret->nodes;
   return ret;
 }
@@ -140,6 +271,7 @@ alloc_t *new_alloc(int pool_size)
 void free_alloc(alloc_t *alc)
 {
   free_alloc_node_lst(alc->nodes);
+  record_peak(alc->name, alc->peak_bytes);
   free(alc);
 }
 
@@ -153,7 +285,7 @@ void *alloc(alloc_t* alc, size_t size)
   if (node->pool_free + size > node->pool_size)
     {
       assert (node->next == NULL);
-      node->next = new_alloc_node(max(size, node->pool_size << 1));
+      node->next = new_alloc_node(alc, max(size, node->pool_size << 1));
       node = alc->first_free = node->next;
     }
   ret = node->pool + node->pool_free;
@@ -161,58 +293,66 @@ void *alloc(alloc_t* alc, size_t size)
   return ret;
 }
 
-
-/* strtab_t */
-
-/* Fowler/Noll/Vo- hash */
-static unsigned fnv_hash(const char *str)
+void reset_alloc(alloc_t *alc)
 {
-    register unsigned char *s = (unsigned char *)str;
-    register unsigned hval = 0x811c9dc5;
+  alloc_node_t *node = alc->nodes;
+  // the last node is the largest one
+  while (node->next != NULL)
+    {
+      alloc_node_t *next = node->next;
+      free(node->pool);
+      free(node);
+      node = next;
+    }
+  node->pool_free = 0;
+  alc->nodes = alc->first_free = node;
+  alc->bytes = node->pool_size;
+}
 
-    /*
-     * FNV-1 hash each octet in the buffer
-     */
-    while (*s) {
 
-        /* multiply by the 32 bit FNV magic prime mod 2^32 */
-        hval += (hval<<1) + (hval<<4) + (hval<<7) + (hval<<8) + (hval<<24);
+/* strtab_t */
 
-        /* xor the bottom with the current octet */
-        hval ^= (unsigned)*s++;
-    }
+#define HASH_PRIME 0x100000001b3ULL
 
-    return hval;
+/* A word-at-a-time variant of the Fowler/Noll/Vo hash, with a final
+   mix so that the low bits, used for indexing, depend on all the
+   input. */
+static unsigned str_hash(const char *str, size_t len)
+{
+  uint64_t hval = 0xcbf29ce484222325ULL ^ len;
+  uint64_t word;
+  while (len >= sizeof(word))
+    {
+      memcpy(&word, str, sizeof(word));
+      hval = (hval ^ word) * HASH_PRIME;
+      str += sizeof(word);
+      len -= sizeof(word);
+    }
+  if (len > 0)
+    {
+      word = 0;
+      memcpy(&word, str, len);
+      hval = (hval ^ word) * HASH_PRIME;
+    }
+  hval ^= hval >> 32;
+  hval *= HASH_PRIME;
+  hval ^= hval >> 29;
+  return (unsigned) hval;
 }
 
-
 strtab_t *new_strtab(size_t strings_size, size_t data_size, size_t data_elem_size)
 {
-  size_t hash_size;
-  size_t hash_size_log;
-  int carry = 0;
+  size_t hash_size = 16;
   strtab_t *strtab = xmalloc(sizeof(strtab_t));
   strtab->strbuf = new_alloc(strings_size);
   strtab->elem_size = data_elem_size;
   strtab->databuf = new_alloc(data_size);
-  hash_size = data_size / data_elem_size;
-  hash_size_log = 0;
-  while (hash_size > 0)
-    {
-      if (hash_size & 1)
-        {
-          carry = 1;
-        }
-      ++hash_size_log;
-      hash_size >>= 1;
-    }
-  hash_size_log += carry;
-  hash_size = 1 << hash_size_log;
+  // keep the load factor at most 1/2
+  while (hash_size < 2 * (data_size / data_elem_size))
+    hash_size <<= 1;
   strtab->hash_size = hash_size;
-  strtab->hash_log = hash_size_log - 1;
-  strtab->hash_nodes_size = hash_size + (hash_size >> 1);
-  strtab->hash_nodes_free = hash_size;
-  strtab->hashtab = xmalloc(strtab->hash_nodes_size * sizeof(hash_node_t));
+  strtab->hash_num = 0;
+  strtab->hashtab = xmalloc(hash_size * sizeof(hash_node_t));
   memset(strtab->hashtab, 0, hash_size * sizeof(hash_node_t));
   return strtab;
 }
@@ -225,54 +365,61 @@ void free_strtab(strtab_t *strtab)
   free(strtab);
 }
 
-static inline hash_node_t *new_hash_node(strtab_t *strtab)
+static void grow_strtab(strtab_t *strtab)
 {
-  if (strtab->hash_nodes_free == strtab->hash_nodes_size)
+  hash_node_t *old = strtab->hashtab;
+  size_t old_size = strtab->hash_size;
+  size_t mask, i;
+  strtab->hash_size <<= 1;
+  mask = strtab->hash_size - 1;
+  strtab->hashtab = xmalloc(strtab->hash_size * sizeof(hash_node_t));
+  memset(strtab->hashtab, 0, strtab->hash_size * sizeof(hash_node_t));
+  for (i = 0; i < old_size; ++i)
     {
-      strtab->hash_nodes_size <<= 1;
-      strtab->hashtab = xrealloc(strtab->hashtab, strtab->hash_nodes_size * sizeof(hash_node_t));
+      if (old[i].str != NULL)
+        {
+          size_t index = old[i].hash & mask;
+          while (strtab->hashtab[index].str != NULL)
+            index = (index + 1) & mask;
+          strtab->hashtab[index] = old[i];
+        }
     }
-  return &strtab->hashtab[strtab->hash_nodes_free++];
+  free(old);
 }
 
 int add_str(strtab_t *strtab, const char* str, char **pstr, void **pdata)
 {
-  unsigned hash;
-  int index;
+  return add_strn(strtab, str, strlen(str), pstr, pdata);
+}
+
+int add_strn(strtab_t *strtab, const char* str, size_t len, char **pstr, void **pdata)
+{
+  unsigned hash = str_hash(str, len);
+  size_t mask = strtab->hash_size - 1;
+  size_t index = hash & mask;
   hash_node_t *node;
 
-  hash = fnv_hash(str);
-  index = hash & (strtab->hash_size - 1);
-  node = &strtab->hashtab[index];
-  if (node->hash != 0)
+  while ((node = &strtab->hashtab[index])->str != NULL)
     {
-      hash_node_t *prev;
-      while (node != NULL)
+      if (node->hash == hash && memcmp(node->str, str, len) == 0 && node->str[len] == '\0')
         {
-          if (node->hash == hash && strcmp(node->str, str) == 0)
+          if (pstr != NULL)
             {
-              if (pstr != NULL)
-                {
-                  *pstr = node->str;
-                }
-              if (pdata != NULL)
-                {
-                  *pdata = node->data;
-                }
-              return 0;
+              *pstr = node->str;
             }
-          prev = node;
-          node = node->next;
+          if (pdata != NULL)
+            {
+              *pdata = node->data;
+            }
+          return 0;
         }
-      node = new_hash_node(strtab);
-      prev->next = node;
+      index = (index + 1) & mask;
     }
-  node->hash = hash;
-  node->next = NULL;
 
-  // 1
-  node->str = alloc(strtab->strbuf, strlen(str) + 1);
-  strcpy(node->str, str);
+  node->hash = hash;
+  node->str = alloc(strtab->strbuf, len + 1);
+  memcpy(node->str, str, len);
+  node->str[len] = '\0';
   node->data = alloc(strtab->databuf, strtab->elem_size);
 
   if (pstr != NULL)
@@ -283,5 +430,9 @@ int add_str(strtab_t *strtab, const char* str, char **pstr, void **pdata)
     {
       *pdata = node->data;
     }
+  if (++strtab->hash_num * 2 > strtab->hash_size)
+    {
+      grow_strtab(strtab);
+    }
   return 1;
 }
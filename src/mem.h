@@ -4,22 +4,34 @@
 #define MEM_H
 
 #include <stdlib.h>
+#include <pthread.h>
 
 /***********************************************************/
 /* pool_t - memory pool for fixed size objects             */
 
+/* The objects are carved out of slabs whose size is a power of two
+   and which are aligned to their size. The header of a slab is at
+   its beginning, so the slab owning an object is found by masking
+   the address of the object, and pfree() takes constant time. */
+
 typedef struct Pool_node{
-  size_t size;
-  char *data;
   char *first_free;
+  size_t free_num; // the number of free objects in the slab
   struct Pool_node *next;
   struct Pool_node *next_free;
 } pool_node_t;
 
 typedef struct{
   size_t elem_size;
+  size_t slab_size;
+  size_t slab_elems; // the number of objects in one slab
   pool_node_t *first_free;
   pool_node_t *nodes;
+  int shared; // set when the pool is used by caches of many threads
+  pthread_mutex_t lock; // used by the pool caches only
+  const char *name; // for the memory usage report; may be NULL
+  size_t bytes; // the size of all slabs
+  size_t peak_bytes;
 } pool_t;
 
 // size is the number of elements; elem_size is the size of one
@@ -29,6 +41,45 @@ void free_pool(pool_t *pool);
 
 void *palloc(pool_t *pool);
 void pfree(pool_t *pool, void *ptr);
+/* Frees all objects allocated from the pool at once. One slab is
+   kept for subsequent allocations. */
+void reset_pool(pool_t *pool);
+
+/* pool_cache_t - a cache of free objects in front of a pool, meant
+   to be declared thread-local. The objects are moved between the
+   cache and the pool in batches under the lock of the pool, so a
+   pool may be shared by many threads as long as each of them uses
+   only its own cache. The cache is bypassed unless pool->shared is
+   set, since a pool used by one thread needs no lock. */
+
+#define POOL_CACHE_BATCH 32
+
+typedef struct{
+  pool_t *pool;
+  void *first_free;
+  size_t free_num;
+} pool_cache_t;
+
+void init_pool_cache(pool_cache_t *cache, pool_t *pool);
+/* Returns all cached objects to the pool. */
+void flush_pool_cache(pool_cache_t *cache);
+void *pcalloc_shared(pool_cache_t *cache);
+void pcfree_shared(pool_cache_t *cache, void *ptr);
+
+inline static void *pcalloc(pool_cache_t *cache)
+{
+  if (!cache->pool->shared)
+    return palloc(cache->pool);
+  return pcalloc_shared(cache);
+}
+
+inline static void pcfree(pool_cache_t *cache, void *ptr)
+{
+  if (!cache->pool->shared)
+    pfree(cache->pool, ptr);
+  else
+    pcfree_shared(cache, ptr);
+}
 
 
 /**********************************************************************/
@@ -45,37 +96,61 @@ typedef struct Alloc_node{
 typedef struct{
   alloc_node_t *first_free;
   alloc_node_t *nodes;
+  const char *name; // for the memory usage report; may be NULL
+  size_t bytes; // the size of all chunks
+  size_t peak_bytes;
 } alloc_t;
 
 alloc_t *new_alloc(int pool_size);
 void free_alloc(alloc_t *alc);
 void *alloc(alloc_t *alc, size_t size);
+/* Frees all objects allocated with alc at once. The largest chunk is
+   kept for subsequent allocations. */
+void reset_alloc(alloc_t *alc);
+
+
+/**********************************************************************/
+/* Memory usage. When a pool or an allocator which has a name is freed,
+   its peak size is recorded under that name. For several pools with
+   the same name (e.g. one per thread, or one per program) the largest
+   peak is kept. */
+
+typedef struct Mem_usage{
+  const char *name;
+  size_t peak_bytes;
+  struct Mem_usage *next;
+} mem_usage_t;
+
+/* Returns the records in the order in which they were first made. */
+const mem_usage_t *get_mem_usage();
+void free_mem_usage();
 
 
 /***********************************************************/
 /* strtab_t - a string table; associates strings with data */
 
-typedef struct Hash_node{
+/* The table uses open addressing with linear probing. It is doubled
+   and rehashed whenever it becomes half full, so an insertion takes
+   amortized constant time. */
+
+typedef struct{
   unsigned hash;
-  char *str;
+  char *str; // NULL if the slot is empty
   void *data;
-  struct Hash_node *next;
 } hash_node_t;
 
 typedef struct{
   alloc_t *strbuf;
   alloc_t *databuf;
   size_t elem_size;
-  size_t hash_size;
-  size_t hash_log;
-  size_t hash_nodes_size;
-  size_t hash_nodes_free;
+  size_t hash_size; // a power of two
+  size_t hash_num; // the number of strings in the table
   hash_node_t *hashtab;
 } strtab_t;
 
-/* Allocates new table for string storage. The table can hold up to
-   strings_size characters, and data_size/data_elem_size data elements
-   associated with strings. */
+/* Allocates new table for string storage. The table initially has
+   room for strings_size characters, and data_size/data_elem_size data
+   elements associated with strings; it grows as needed. */
 strtab_t *new_strtab(size_t strings_size, size_t data_size, size_t data_elem_size);
 void free_strtab(strtab_t *strtab);
 /* Returns nonzero if the string was actually inserted and data points
@@ -84,5 +159,8 @@ void free_strtab(strtab_t *strtab);
    initialized. In both cases pstr is assigned a pointer into internal
    character buffer pointing to storage allocated for str.  */
 int add_str(strtab_t *strtab, const char* str, char **pstr, void **pdata);
+/* Same as add_str(), but for the first len characters of str, which
+   need not be null-terminated. */
+int add_strn(strtab_t *strtab, const char* str, size_t len, char **pstr, void **pdata);
 
 #endif
@@ -1,8 +1,16 @@
 #include <map>
 #include <list>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <climits>
+#include <cstring>
 extern "C"{
 #include "mem.h"
 #include "opt.h"
+#include "flow.h"
+#include "ssa.h"
+#include "stats.h"
 }
 
 using namespace std;
@@ -77,7 +85,7 @@ typedef struct Graph_node{
 
 // -----------------------------------------------------------------------------
 
-static pool_t *graph_node_pool = NULL;
+static __thread pool_t *graph_node_pool = NULL;
 
 #define var_node(x) ((graph_node_t*)(x)->loc)
 #define set_var_node(x,y) { (x)->loc = (struct Location*)y; }
@@ -86,20 +94,22 @@ static pool_t *graph_node_pool = NULL;
 #define make_key(op, left, right) \
   ((void*) (unsigned long) ((get_id(left) << (13+6)) | (get_id(right) << 6) | (op)))
 
-static map<int,graph_node_t*> int_leaves;
-static map<double,graph_node_t*> double_leaves;
-static list<graph_node_t*> var_leaves;
-static rbtree_t *graph = NULL; // internal nodes and roots - no leaves here
-static rbnode_t *nil;
-static unsigned short next_id;
-static quadr_func_t *opt_cur_func = NULL;
+/* The state is per thread, since functions may be optimized in
+   parallel. */
+static thread_local map<int,graph_node_t*> int_leaves;
+static thread_local map<double,graph_node_t*> double_leaves;
+static thread_local list<graph_node_t*> var_leaves;
+static __thread rbtree_t *graph = NULL; // internal nodes and roots - no leaves here
+static __thread rbnode_t *nil;
+static __thread unsigned short next_id;
+static __thread quadr_func_t *opt_cur_func = NULL;
 
 typedef struct Graph_node_list{
   graph_node_t *node;
   struct Graph_node_list *next;
 } graph_node_list_t;
 
-static graph_node_list_t *roots = NULL;
+static __thread graph_node_list_t *roots = NULL;
 
 static void reset_graph()
 {
@@ -110,6 +120,7 @@ static void reset_graph()
   var_leaves.clear();
   next_id = 0;
   graph_node_pool = new_pool(512, sizeof(graph_node_t));
+  graph_node_pool->name = "expression graph";
   if (graph != NULL)
     rb_clear(graph);
   else
@@ -847,7 +858,1570 @@ extern "C" void perform_local_optimizations_2(quadr_func_t *func)
     }
 }
 
-extern "C" void perform_global_optimizations(quadr_func_t *func)
+// -----------------------------------------------------------------------------
+
+/* Conditional constant propagation over the block graph (Wegman and
+   Zadeck). The values of the variables are propagated from the root
+   along the edges which may be taken: an edge is taken only once the
+   block it leaves is, and not at all if it leaves a conditional jump
+   decided by constants. A block keeps the values of the variables
+   live at its beginning only, so the memory used is that of the live
+   sets. */
+
+typedef enum { CV_UNDEF, CV_INT, CV_DOUBLE, CV_VARYING } const_tag_t;
+
+typedef struct{
+  union{
+    int int_val;
+    double double_val;
+  } u;
+  const_tag_t tag;
+} const_val_t;
+
+typedef struct{
+  basic_block_t *block;
+  // the ids of the variables live at the beginning, in increasing order
+  vector<int> in_vars;
+  vector<const_val_t> in_vals; // parallel to in_vars
+  bool executable;
+  bool queued;
+  // whether the block ends with a jump whose operands are undefined
+  bool undef_jump;
+  // whether both edges out of such a jump should be taken
+  bool forced;
+} cp_block_t;
+
+static thread_local vector<cp_block_t> cp_blocks;
+static thread_local map<basic_block_t*,int> cp_index;
+static thread_local deque<int> cp_queue;
+/* The values of the variables at the current point of the block
+   being visited, indexed by ids; cp_vals[id] is valid only if
+   cp_stamps[id] == cp_stamp. */
+static thread_local vector<const_val_t> cp_vals;
+static thread_local vector<unsigned> cp_stamps;
+// cp_defs[id] == cp_stamp if the variable is assigned in the block earlier
+static thread_local vector<unsigned> cp_defs;
+static __thread unsigned cp_stamp;
+static __thread vector<int> *cp_cur_vars;
+
+inline static const_val_t cv_make(const_tag_t tag)
+{
+  const_val_t val;
+  val.tag = tag;
+  val.u.double_val = 0.0;
+  return val;
+}
+
+inline static bool cv_is_const(const_val_t val)
+{
+  return val.tag == CV_INT || val.tag == CV_DOUBLE;
+}
+
+inline static bool cv_same(const_val_t x, const_val_t y)
+{
+  if (x.tag != y.tag)
+    return false;
+  if (x.tag == CV_INT)
+    return x.u.int_val == y.u.int_val;
+  if (x.tag == CV_DOUBLE) // compare the bits, so that NaN == NaN and 0.0 != -0.0
+    return memcmp(&x.u.double_val, &y.u.double_val, sizeof(double)) == 0;
+  return true;
+}
+
+static const_val_t cv_meet(const_val_t x, const_val_t y)
+{
+  if (x.tag == CV_UNDEF)
+    return y;
+  if (y.tag == CV_UNDEF || cv_same(x, y))
+    return x;
+  return cv_make(CV_VARYING);
+}
+
+inline static const_val_t cp_get(int id)
+{
+  if (cp_stamps[id] == cp_stamp)
+    return cp_vals[id];
+  return cv_make(CV_VARYING);
+}
+
+inline static void cp_set(int id, const_val_t val)
+{
+  cp_vals[id] = val;
+  cp_stamps[id] = cp_stamp;
+}
+
+static const_val_t arg_val(quadr_arg_t *arg)
+{
+  const_val_t val;
+  switch (arg->tag){
+  case QA_INT:
+    val.tag = CV_INT;
+    val.u.int_val = arg->u.int_val;
+    return val;
+  case QA_DOUBLE:
+    val.tag = CV_DOUBLE;
+    val.u.double_val = arg->u.double_val;
+    return val;
+  case QA_VAR:
+    return cp_get(arg->u.var->id);
+  default:
+    return cv_make(CV_VARYING);
+  };
+}
+
+inline static quadr_arg_t const_arg(const_val_t val)
+{
+  quadr_arg_t arg;
+  if (val.tag == CV_INT)
+    {
+      arg.tag = QA_INT;
+      arg.u.int_val = val.u.int_val;
+    }
+  else
+    {
+      assert (val.tag == CV_DOUBLE);
+      arg.tag = QA_DOUBLE;
+      arg.u.double_val = val.u.double_val;
+    }
+  return arg;
+}
+
+/* Returns val if it may be assigned to var, i.e. if it is not a
+   constant of a different type. */
+inline static const_val_t typed_val(var_t *var, const_val_t val)
+{
+  if ((val.tag == CV_INT && var->qtype != VT_INT) ||
+      (val.tag == CV_DOUBLE && var->qtype != VT_DOUBLE))
+    {
+      return cv_make(CV_VARYING);
+    }
+  return val;
+}
+
+/* Folds an arithmetic operation. Operations which trap at run time
+   (division by zero, INT_MIN / -1) are not folded. */
+static const_val_t fold_op(quadr_op_t op, const_val_t x, const_val_t y)
+{
+  const_val_t val = cv_make(CV_VARYING);
+  if (x.tag == CV_VARYING || y.tag == CV_VARYING)
+    return val;
+  if (x.tag == CV_UNDEF || y.tag == CV_UNDEF)
+    return cv_make(CV_UNDEF);
+  if (x.tag != y.tag)
+    return val;
+  if (x.tag == CV_INT)
+    {
+      // the arithmetic wraps around, as on the target
+      unsigned a = x.u.int_val, b = y.u.int_val;
+      switch (op){
+      case Q_ADD:
+        val.u.int_val = (int) (a + b);
+        break;
+      case Q_SUB:
+        val.u.int_val = (int) (a - b);
+        break;
+      case Q_MUL:
+        val.u.int_val = (int) (a * b);
+        break;
+      case Q_DIV:
+      case Q_MOD:
+        if (y.u.int_val == 0 || (x.u.int_val == INT_MIN && y.u.int_val == -1))
+          return val;
+        if (op == Q_DIV)
+          val.u.int_val = x.u.int_val / y.u.int_val;
+        else
+          val.u.int_val = x.u.int_val % y.u.int_val;
+        break;
+      default:
+        return val;
+      };
+    }
+  else
+    {
+      double a = x.u.double_val, b = y.u.double_val;
+      switch (op){
+      case Q_ADD:
+        val.u.double_val = a + b;
+        break;
+      case Q_SUB:
+        val.u.double_val = a - b;
+        break;
+      case Q_MUL:
+        val.u.double_val = a * b;
+        break;
+      case Q_DIV:
+        if (b == 0.0)
+          return val;
+        val.u.double_val = a / b;
+        break;
+      default:
+        return val;
+      };
+    }
+  val.tag = x.tag;
+  return val;
+}
+
+#define JUMP_UNKNOWN -1
+#define JUMP_UNDEF -2
+
+/* Returns 1 if the conditional jump is taken, 0 if it is not,
+   JUMP_UNKNOWN if that is not known at compile time and JUMP_UNDEF
+   if an operand is undefined yet. */
+static int jump_taken(quadr_t *quadr)
+{
+  const_val_t x = arg_val(&quadr->arg1);
+  const_val_t y = arg_val(&quadr->arg2);
+  int cmp;
+  if (x.tag == CV_VARYING || y.tag == CV_VARYING)
+    return JUMP_UNKNOWN;
+  if (x.tag == CV_UNDEF || y.tag == CV_UNDEF)
+    return JUMP_UNDEF;
+  if (x.tag != y.tag)
+    return JUMP_UNKNOWN;
+  if (x.tag == CV_INT)
+    {
+      cmp = x.u.int_val < y.u.int_val ? -1 : (x.u.int_val > y.u.int_val ? 1 : 0);
+    }
+  else
+    {
+      double a = x.u.double_val, b = y.u.double_val;
+      if (a != a || b != b) // NaN: only != holds
+        return quadr->op == Q_IF_NE;
+      cmp = a < b ? -1 : (a > b ? 1 : 0);
+    }
+  switch (quadr->op){
+  case Q_IF_EQ:
+    return cmp == 0;
+  case Q_IF_NE:
+    return cmp != 0;
+  case Q_IF_LT:
+    return cmp < 0;
+  case Q_IF_GT:
+    return cmp > 0;
+  case Q_IF_LE:
+    return cmp <= 0;
+  case Q_IF_GE:
+    return cmp >= 0;
+  default:
+    xabort("programming error - jump_taken()");
+  };
+  return JUMP_UNKNOWN;
+}
+
+static void cp_transfer(quadr_t *quadr)
+{
+  var_t *var;
+  if (quadr->result.tag != QA_VAR || !assigned_in_quadr(quadr, quadr->result.u.var))
+    return;
+  var = quadr->result.u.var;
+  switch (quadr->op){
+  case Q_COPY:
+    cp_set(var->id, typed_val(var, arg_val(&quadr->arg1)));
+    break;
+  case Q_ADD:
+  case Q_SUB:
+  case Q_MUL:
+  case Q_DIV:
+  case Q_MOD:
+    cp_set(var->id, typed_val(var, fold_op(quadr->op, arg_val(&quadr->arg1),
+                                           arg_val(&quadr->arg2))));
+    break;
+  default:
+    cp_set(var->id, cv_make(CV_VARYING));
+    break;
+  };
+}
+
+static void cp_enter(cp_block_t *cb)
+{
+  size_t i;
+  ++cp_stamp;
+  for (i = 0; i < cb->in_vars.size(); ++i)
+    {
+      cp_set(cb->in_vars[i], cb->in_vals[i]);
+    }
+}
+
+/* Takes the edge to child with the current values. */
+static void cp_take_edge(basic_block_t *child)
+{
+  cp_block_t *cb = &cp_blocks[cp_index[child]];
+  bool changed = !cb->executable;
+  size_t i;
+  cb->executable = true;
+  for (i = 0; i < cb->in_vars.size(); ++i)
+    {
+      const_val_t val = cv_meet(cb->in_vals[i], cp_get(cb->in_vars[i]));
+      if (!cv_same(val, cb->in_vals[i]))
+        {
+          cb->in_vals[i] = val;
+          changed = true;
+        }
+    }
+  if (changed && !cb->queued)
+    {
+      cb->queued = true;
+      cp_queue.push_back(cb - &cp_blocks[0]);
+    }
+}
+
+static void cp_visit(cp_block_t *cb)
+{
+  basic_block_t *block = cb->block;
+  quadr_t *quadr;
+  int taken = JUMP_UNKNOWN;
+  cp_enter(cb);
+  for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+    {
+      cp_transfer(quadr);
+    }
+  quadr = block->lst.tail;
+  if (quadr != NULL && is_if_op(quadr->op))
+    taken = jump_taken(quadr);
+  cb->undef_jump = (taken == JUMP_UNDEF);
+  if (taken == JUMP_UNDEF)
+    {
+      if (!cb->forced)
+        return;
+      taken = JUMP_UNKNOWN;
+    }
+  // child1 is the target of the jump, child2 the next block
+  if (block->child1 != NULL && taken != 0)
+    cp_take_edge(block->child1);
+  if (block->child2 != NULL && taken != 1)
+    cp_take_edge(block->child2);
+}
+
+static void collect_in_var(rb_key_t key)
+{
+  cp_cur_vars->push_back(((var_descr_t*) key)->var->id);
+}
+
+static void cp_init(quadr_func_t *func)
+{
+  basic_block_t *block;
+  int i = 0;
+  cp_blocks.clear();
+  cp_index.clear();
+  for (block = func->blocks; block != NULL; block = block->next, ++i)
+    {
+      cp_blocks.push_back(cp_block_t());
+      cp_block_t *pcb = &cp_blocks.back();
+      pcb->block = block;
+      cp_cur_vars = &pcb->in_vars;
+      rb_for_each(block->vars_at_start, collect_in_var);
+      sort(pcb->in_vars.begin(), pcb->in_vars.end());
+      // nothing is known about the values at the entry to the function
+      pcb->in_vals.assign(pcb->in_vars.size(), cv_make(i == 0 ? CV_VARYING : CV_UNDEF));
+      pcb->executable = (i == 0);
+      pcb->queued = false;
+      pcb->undef_jump = false;
+      pcb->forced = false;
+      cp_index[block] = i;
+    }
+  cp_vals.resize(func->vars_num);
+  cp_stamps.assign(func->vars_num, 0);
+  cp_defs.assign(func->vars_num, 0);
+  cp_stamp = 0;
+}
+
+static void cp_solve()
+{
+  bool again = true;
+  size_t i;
+  cp_blocks[0].queued = true;
+  cp_queue.push_back(0);
+  while (again)
+    {
+      while (!cp_queue.empty())
+        {
+          cp_block_t *cb = &cp_blocks[cp_queue.front()];
+          cp_queue.pop_front();
+          cb->queued = false;
+          cp_visit(cb);
+        }
+      /* The operands of a jump are undefined only if they are not
+         assigned on any path taken so far. If this is still so at the
+         end, the program reads uninitialized variables and both edges
+         are taken. */
+      again = false;
+      for (i = 0; i < cp_blocks.size(); ++i)
+        {
+          cp_block_t *cb = &cp_blocks[i];
+          if (cb->executable && cb->undef_jump && !cb->forced)
+            {
+              cb->forced = true;
+              if (!cb->queued)
+                {
+                  cb->queued = true;
+                  cp_queue.push_back(i);
+                }
+              again = true;
+            }
+        }
+    }
+}
+
+typedef struct{
+  var_t *var;
+  const_val_t val;
+} remat_t;
+
+/* Records the use of a constant variable not assigned in the block
+   before, whose value is then that at the beginning of the block. */
+inline static bool remat_use(quadr_arg_t *arg, vector<remat_t> &remat)
+{
+  remat_t r;
+  if (arg->tag != QA_VAR)
+    return false;
+  r.var = arg->u.var;
+  r.val = cp_get(r.var->id);
+  if (cp_defs[r.var->id] != cp_stamp && cv_is_const(r.val))
+    {
+      cp_defs[r.var->id] = cp_stamp;
+      remat.push_back(r);
+      return true;
+    }
+  return false;
+}
+
+static void remove_last_quadr(basic_block_t *block)
+{
+  quadr_t *quadr = block->lst.head, *prev = NULL;
+  while (quadr != block->lst.tail)
+    {
+      prev = quadr;
+      quadr = quadr->next;
+    }
+  if (prev != NULL)
+    prev->next = NULL;
+  else
+    block->lst.head = NULL;
+  block->lst.tail = prev;
+  free_quadr(quadr);
+}
+
+/* Rewrites an executable block with the values found. Assignments of
+   constant values become copies of constants, decided jumps become
+   gotos or disappear, and the constants live at the beginning of the
+   block which it uses are assigned again at its start, so that the
+   code generator knows them. Returns true if anything has changed. */
+static bool cp_rewrite(cp_block_t *cb)
+{
+  basic_block_t *block = cb->block;
+  quadr_t *quadr;
+  vector<remat_t> remat;
+  bool changed = false;
+  size_t i;
+  cp_enter(cb);
+  for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+    {
+      if (is_if_op(quadr->op))
+        {
+          int taken = jump_taken(quadr);
+          if (taken == 1)
+            {
+              quadr->op = Q_GOTO;
+              quadr->arg1.tag = quadr->arg2.tag = QA_NONE;
+              stats_add(jumps_folded, 1);
+              changed = true;
+              break;
+            }
+          else if (taken == 0)
+            {
+              remove_last_quadr(block);
+              stats_add(jumps_folded, 1);
+              changed = true;
+              break;
+            }
+        }
+      if (quadr->op != Q_COPY)
+        {
+          if (remat_use(&quadr->arg1, remat) | remat_use(&quadr->arg2, remat))
+            changed = true;
+        }
+      cp_transfer(quadr);
+      if (quadr->result.tag == QA_VAR && assigned_in_quadr(quadr, quadr->result.u.var))
+        {
+          var_t *var = quadr->result.u.var;
+          const_val_t val = cp_get(var->id);
+          cp_defs[var->id] = cp_stamp;
+          // only copies and arithmetic may have constant values
+          if (cv_is_const(val) && (quadr->op != Q_COPY || quadr->arg1.tag == QA_VAR))
+            {
+              quadr->op = Q_COPY;
+              quadr->arg1 = const_arg(val);
+              quadr->arg2.tag = QA_NONE;
+              stats_add(consts_propagated, 1);
+              changed = true;
+            }
+        }
+    }
+  for (i = 0; i < remat.size(); ++i)
+    {
+      quadr = new_copy_quadr(remat[i].var, const_arg(remat[i].val));
+      quadr->next = block->lst.head;
+      block->lst.head = quadr;
+      if (block->lst.tail == NULL)
+        block->lst.tail = quadr;
+    }
+  return changed;
+}
+
+static bool propagate_constants(quadr_func_t *func)
+{
+  basic_block_t *block, *prev = NULL, *next;
+  bool changed = false;
+  int i = 0;
+  cp_init(func);
+  cp_solve();
+  for (block = func->blocks; block != NULL; block = next, ++i)
+    {
+      next = block->next;
+      if (!cp_blocks[i].executable)
+        {
+          // unreachable; the root always is reachable
+          assert (prev != NULL);
+          prev->next = next;
+          free_basic_block(block);
+          stats_add(blocks_removed, 1);
+          changed = true;
+        }
+      else
+        {
+          if (cp_rewrite(&cp_blocks[i]))
+            changed = true;
+          prev = block;
+        }
+    }
+  // the blocks removed may leave jumps to the next block
+  for (block = func->blocks; block != NULL; block = block->next)
+    {
+      quadr_t *last = block->lst.tail;
+      if (last != NULL && last->op == Q_GOTO && last->result.u.label == block->next)
+        {
+          remove_last_quadr(block);
+          changed = true;
+        }
+    }
+  cp_blocks.clear();
+  cp_index.clear();
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+
+/* Whether the quadruple may be removed when the variable it assigns
+   is not used. Integer divisions may trap and calls have side
+   effects. */
+inline static bool is_removable(quadr_t *quadr)
+{
+  switch (quadr->op){
+  case Q_DIV:
+    return quadr->result.u.var->qtype == VT_DOUBLE;
+  case Q_ADD:
+  case Q_SUB:
+  case Q_MUL:
+  case Q_COPY:
+  case Q_READ_PTR:
+  case Q_GET_ADDR:
+    return true;
+  default:
+    return false;
+  };
+}
+
+inline static void mark_needed(var_t *var, vector<bool> &needed, vector<int> &work)
+{
+  if (!needed[var->id])
+    {
+      needed[var->id] = true;
+      work.push_back(var->id);
+    }
+}
+
+/* Dead code elimination in SSA form, where every variable has at most
+   one definition. A variable is needed if it is used by a quadruple
+   which cannot be removed, or by the definition of a needed variable;
+   the definitions of the others are removed. */
+static void remove_dead_code(ssa_t *ssa)
+{
+  quadr_func_t *func = ssa->func;
+  vector<quadr_t*> def_quadr(func->vars_num, (quadr_t*) NULL);
+  vector<phi_t*> def_phi(func->vars_num, (phi_t*) NULL);
+  vector<int> phi_args_num(func->vars_num, 0);
+  vector<bool> needed(func->vars_num, false);
+  vector<int> work;
+  basic_block_t *block;
+  quadr_arg_t *uses[3];
+  quadr_t *quadr, *prev, *next;
+  phi_t *phi, **pphi;
+  int i, n;
+  unsigned long removed = 0;
+
+  for (block = func->blocks; block != NULL; block = block->next)
+    {
+      for (phi = block->ssa_data->phis; phi != NULL; phi = phi->next)
+        {
+          def_phi[phi->result->id] = phi;
+          phi_args_num[phi->result->id] = block->ssa_data->preds_num;
+        }
+      for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+        {
+          var_t *var = quadr_def(quadr);
+          if (var != NULL && is_removable(quadr))
+            {
+              def_quadr[var->id] = quadr;
+              continue;
+            }
+          n = quadr_uses(quadr, uses);
+          for (i = 0; i < n; ++i)
+            {
+              mark_needed(uses[i]->u.var, needed, work);
+            }
+        }
+    }
+  while (!work.empty())
+    {
+      int id = work.back();
+      work.pop_back();
+      if (def_quadr[id] != NULL)
+        {
+          n = quadr_uses(def_quadr[id], uses);
+          for (i = 0; i < n; ++i)
+            {
+              mark_needed(uses[i]->u.var, needed, work);
+            }
+        }
+      else if (def_phi[id] != NULL)
+        {
+          for (i = 0; i < phi_args_num[id]; ++i)
+            {
+              mark_needed(def_phi[id]->args[i], needed, work);
+            }
+        }
+    }
+
+  for (block = func->blocks; block != NULL; block = block->next)
+    {
+      pphi = &block->ssa_data->phis;
+      while (*pphi != NULL)
+        {
+          phi = *pphi;
+          if (!needed[phi->result->id])
+            {
+              *pphi = phi->next;
+              free(phi->args);
+              free(phi);
+            }
+          else
+            pphi = &phi->next;
+        }
+      prev = NULL;
+      for (quadr = block->lst.head; quadr != NULL; quadr = next)
+        {
+          var_t *var = quadr_def(quadr);
+          next = quadr->next;
+          if (var != NULL && def_quadr[var->id] == quadr && !needed[var->id])
+            {
+              if (prev != NULL)
+                prev->next = next;
+              else
+                block->lst.head = next;
+              if (block->lst.tail == quadr)
+                block->lst.tail = prev;
+              free_quadr(quadr);
+              ++removed;
+            }
+          else
+            prev = quadr;
+        }
+    }
+  stats_add(dead_removed, removed);
+}
+
+// -----------------------------------------------------------------------------
+
+/* Global value numbering in SSA form. The blocks are visited in a
+   depth-first walk of the dominator tree, keeping a table of the
+   computations done in the dominators of the current block. A
+   computation found in the table becomes a copy of the variable which
+   holds its value, and the uses of the variable it assigns are
+   replaced by uses of that one. Operands are compared by value: a
+   variable assigned a constant stands for the constant, and a copy
+   for the variable copied.
+
+   A read of an array is available only while the array is not
+   written. Every write gives the array a new generation, which is a
+   part of the key of a read, and so do the writes on the paths from
+   the immediate dominator of a block to the block. Arrays are local,
+   so calls do not write them. */
+
+typedef struct{
+  quadr_arg_type_t tag; // QA_VAR, QA_INT or QA_DOUBLE
+  long long val; // the id of the variable, or the bits of the constant
+} gvn_operand_t;
+
+typedef struct{
+  quadr_op_t op;
+  var_type_t qtype;
+  unsigned gen; // for reads, the generation of the array
+  gvn_operand_t x, y;
+} gvn_key_t;
+
+inline static bool operator==(const gvn_operand_t &a, const gvn_operand_t &b)
+{
+  return a.tag == b.tag && a.val == b.val;
+}
+
+inline static bool operator<(const gvn_operand_t &a, const gvn_operand_t &b)
+{
+  return a.tag < b.tag || (a.tag == b.tag && a.val < b.val);
+}
+
+static bool operator<(const gvn_key_t &a, const gvn_key_t &b)
+{
+  if (a.op != b.op)
+    return a.op < b.op;
+  if (a.qtype != b.qtype)
+    return a.qtype < b.qtype;
+  if (a.gen != b.gen)
+    return a.gen < b.gen;
+  if (!(a.x == b.x))
+    return a.x < b.x;
+  return a.y < b.y;
+}
+
+typedef struct{
+  ssa_t *ssa;
+  // leader[id] is the variable whose value the variable id holds
+  vector<var_t*> leader;
+  // consts[id] is the constant assigned to the variable id, or QA_NONE
+  vector<quadr_arg_t> consts;
+  // array[id] is the array the pointer id points to, if known
+  vector<var_t*> array;
+  vector<var_t*> arrays; // the arrays whose address is taken
+  vector<unsigned> gen; // the generations of the arrays, by ids
+  unsigned gen_any; // changes with every write
+  unsigned next_gen;
+  /* the arrays written between the immediate dominator of a block
+     and the block, by block indices; NULL stands for an unknown
+     array */
+  vector< vector<var_t*> > kills;
+  map<gvn_key_t,var_t*> avail;
+  vector<gvn_key_t> avail_log; // the keys added, to be removed in order
+  vector< pair<int,unsigned> > gen_log; // (array id or -1, old generation)
+} gvn_t;
+
+inline static var_t *gvn_leader(gvn_t *g, var_t *var)
+{
+  while (g->leader[var->id] != NULL)
+    var = g->leader[var->id];
+  return var;
+}
+
+static gvn_operand_t gvn_operand(gvn_t *g, quadr_arg_t *arg)
+{
+  gvn_operand_t x;
+  if (arg->tag == QA_VAR && g->consts[arg->u.var->id].tag != QA_NONE)
+    arg = &g->consts[arg->u.var->id];
+  x.tag = arg->tag;
+  x.val = 0;
+  switch (arg->tag){
+  case QA_VAR:
+    x.val = arg->u.var->id;
+    break;
+  case QA_INT:
+    x.val = arg->u.int_val;
+    break;
+  case QA_DOUBLE:
+    memcpy(&x.val, &arg->u.double_val, sizeof(double));
+    break;
+  default:
+    xabort("programming error - gvn_operand()");
+  };
+  return x;
+}
+
+inline static void gvn_new_gen(gvn_t *g, int id)
+{
+  unsigned *pgen = (id < 0 ? &g->gen_any : &g->gen[id]);
+  g->gen_log.push_back(make_pair(id, *pgen));
+  *pgen = g->next_gen++;
+}
+
+/* Gives new generations to the array, or to all arrays if it is
+   NULL. */
+static void gvn_write(gvn_t *g, var_t *arr)
+{
+  size_t i;
+  if (arr == NULL)
+    {
+      for (i = 0; i < g->arrays.size(); ++i)
+        {
+          gvn_new_gen(g, g->arrays[i]->id);
+        }
+    }
+  else
+    gvn_new_gen(g, arr->id);
+  gvn_new_gen(g, -1);
+}
+
+/* The key of a read of [base + offset]. A read through a pointer to a
+   known array is keyed by the array, so that the pointer need not be
+   the same. */
+static gvn_key_t gvn_read_key(gvn_t *g, var_t *base, quadr_arg_t *offset, var_type_t qtype)
+{
+  gvn_key_t key;
+  var_t *arr = g->array[base->id];
+  key.op = Q_READ_PTR;
+  key.qtype = qtype;
+  key.x.tag = QA_VAR;
+  if (arr != NULL)
+    {
+      key.x.val = arr->id;
+      key.gen = g->gen[arr->id];
+    }
+  else
+    {
+      key.x.val = base->id;
+      key.gen = g->gen_any;
+    }
+  key.y = gvn_operand(g, offset);
+  return key;
+}
+
+/* Finds the arrays the pointers point to, and the arrays written
+   between the immediate dominator of each block and the block. */
+static void gvn_find_writes(gvn_t *g)
+{
+  ssa_t *ssa = g->ssa;
+  vector< vector<var_t*> > writes(ssa->blocks_num);
+  vector<bool> is_array(ssa->func->vars_num, false);
+  vector<int> seen(ssa->blocks_num, -1);
+  vector<int> kstamp(ssa->func->vars_num + 1, -1);
+  vector<basic_block_t*> stack;
+  bool any = false;
+  quadr_t *quadr;
+  int i, j;
+
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      for (quadr = ssa->blocks[i]->lst.head; quadr != NULL; quadr = quadr->next)
+        {
+          if (quadr->op == Q_GET_ADDR)
+            {
+              var_t *arr = quadr->arg1.u.var;
+              g->array[quadr->result.u.var->id] = arr;
+              if (!is_array[arr->id])
+                {
+                  is_array[arr->id] = true;
+                  g->arrays.push_back(arr);
+                }
+            }
+          else if (quadr->op == Q_COPY && quadr->arg1.tag == QA_VAR &&
+                   quadr->result.u.var->qtype == VT_PTR)
+            {
+              g->array[quadr->result.u.var->id] = g->array[quadr->arg1.u.var->id];
+            }
+          else if (quadr->op == Q_WRITE_PTR)
+            {
+              writes[i].push_back(g->array[quadr->result.u.var->id]);
+              any = true;
+            }
+        }
+    }
+  if (!any)
+    return;
+  for (i = 1; i < ssa->blocks_num; ++i)
+    {
+      ssa_data_t *sd = ssa->blocks[i]->ssa_data;
+      // all the paths from the root pass through the immediate dominator
+      seen[sd->idom->ssa_data->index] = i;
+      stack.assign(sd->preds, sd->preds + sd->preds_num);
+      while (!stack.empty())
+        {
+          ssa_data_t *pd = stack.back()->ssa_data;
+          stack.pop_back();
+          if (seen[pd->index] == i)
+            continue;
+          seen[pd->index] = i;
+          for (j = 0; j < (int) writes[pd->index].size(); ++j)
+            {
+              var_t *arr = writes[pd->index][j];
+              int k = (arr != NULL ? arr->id + 1 : 0);
+              if (kstamp[k] != i)
+                {
+                  kstamp[k] = i;
+                  g->kills[i].push_back(arr);
+                }
+            }
+          stack.insert(stack.end(), pd->preds, pd->preds + pd->preds_num);
+        }
+    }
+}
+
+/* Finds the value of the phi function if all its arguments other than
+   the result itself have the same value. */
+static void gvn_phi(gvn_t *g, phi_t *phi, int args_num)
+{
+  var_t *same = NULL, *var;
+  int i;
+  for (i = 0; i < args_num; ++i)
+    {
+      var = gvn_leader(g, phi->args[i]);
+      if (var == phi->result)
+        continue;
+      if (same != NULL && same != var)
+        return;
+      same = var;
+    }
+  if (same != NULL)
+    g->leader[phi->result->id] = same;
+}
+
+static void gvn_quadr(gvn_t *g, quadr_t *quadr)
+{
+  quadr_arg_t *uses[3];
+  map<gvn_key_t,var_t*>::iterator it;
+  gvn_key_t key;
+  var_t *var;
+  int i, n;
+
+  n = quadr_uses(quadr, uses);
+  for (i = 0; i < n; ++i)
+    {
+      uses[i]->u.var = gvn_leader(g, uses[i]->u.var);
+    }
+  switch (quadr->op){
+  case Q_COPY:
+    var = quadr->result.u.var;
+    if (quadr->arg1.tag != QA_VAR)
+      g->consts[var->id] = quadr->arg1;
+    else if (quadr->arg1.u.var->qtype == var->qtype)
+      {
+        if (g->consts[quadr->arg1.u.var->id].tag != QA_NONE)
+          {
+            quadr->arg1 = g->consts[quadr->arg1.u.var->id];
+            g->consts[var->id] = quadr->arg1;
+          }
+        else
+          g->leader[var->id] = quadr->arg1.u.var;
+      }
+    return;
+  case Q_ADD:
+  case Q_SUB:
+  case Q_MUL:
+  case Q_DIV:
+  case Q_MOD:
+    var = quadr->result.u.var;
+    key.op = quadr->op;
+    key.qtype = var->qtype;
+    key.gen = 0;
+    key.x = gvn_operand(g, &quadr->arg1);
+    key.y = gvn_operand(g, &quadr->arg2);
+    if ((quadr->op == Q_ADD || quadr->op == Q_MUL) && key.y < key.x)
+      swap(key.x, key.y, gvn_operand_t);
+    break;
+  case Q_READ_PTR:
+    var = quadr->result.u.var;
+    key = gvn_read_key(g, quadr->arg1.u.var, &quadr->arg2, var->qtype);
+    break;
+  case Q_WRITE_PTR:
+    gvn_write(g, g->array[quadr->result.u.var->id]);
+    // a read of what was just written gives the value written
+    if (quadr->arg2.tag == QA_VAR && g->consts[quadr->arg2.u.var->id].tag == QA_NONE)
+      {
+        var = quadr->arg2.u.var;
+        key = gvn_read_key(g, quadr->result.u.var, &quadr->arg1, var->qtype);
+        g->avail[key] = var;
+        g->avail_log.push_back(key);
+      }
+    return;
+  default:
+    return;
+  };
+  it = g->avail.find(key);
+  if (it != g->avail.end())
+    {
+      // a division which did not trap will not trap again
+      quadr->op = Q_COPY;
+      quadr->arg1.tag = QA_VAR;
+      quadr->arg1.u.var = it->second;
+      quadr->arg2.tag = QA_NONE;
+      g->leader[var->id] = it->second;
+      stats_add(values_reused, 1);
+    }
+  else
+    {
+      g->avail[key] = var;
+      g->avail_log.push_back(key);
+    }
+}
+
+static void number_values(ssa_t *ssa)
+{
+  quadr_func_t *func = ssa->func;
+  gvn_t g;
+  quadr_arg_t none;
+  vector<basic_block_t*> stack;
+  vector< pair<size_t,size_t> > marks;
+  basic_block_t *block;
+  quadr_t *quadr;
+  phi_t *phi;
+  int i;
+
+  none.tag = QA_NONE;
+  g.ssa = ssa;
+  g.leader.assign(func->vars_num, (var_t*) NULL);
+  g.consts.assign(func->vars_num, none);
+  g.array.assign(func->vars_num, (var_t*) NULL);
+  g.gen.assign(func->vars_num, 0);
+  g.gen_any = 0;
+  g.next_gen = 1;
+  g.kills.resize(ssa->blocks_num);
+  gvn_find_writes(&g);
+
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      ssa->blocks[i]->ssa_data->dfs_child = -1;
+    }
+  stack.push_back(ssa->blocks[0]);
+  while (!stack.empty())
+    {
+      block = stack.back();
+      ssa_data_t *sd = block->ssa_data;
+      if (sd->dfs_child == -1)
+        {
+          // entering the block
+          vector<var_t*> &kills = g.kills[sd->index];
+          marks.push_back(make_pair(g.avail_log.size(), g.gen_log.size()));
+          for (i = 0; i < (int) kills.size(); ++i)
+            {
+              gvn_write(&g, kills[i]);
+            }
+          for (phi = sd->phis; phi != NULL; phi = phi->next)
+            {
+              gvn_phi(&g, phi, sd->preds_num);
+            }
+          for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+            {
+              gvn_quadr(&g, quadr);
+            }
+          sd->dfs_child = 0;
+        }
+      if (sd->dfs_child < sd->dom_children_num)
+        {
+          stack.push_back(sd->dom_children[sd->dfs_child++]);
+        }
+      else
+        {
+          // leaving the block
+          stack.pop_back();
+          while (g.avail_log.size() > marks.back().first)
+            {
+              g.avail.erase(g.avail_log.back());
+              g.avail_log.pop_back();
+            }
+          while (g.gen_log.size() > marks.back().second)
+            {
+              pair<int,unsigned> &p = g.gen_log.back();
+              if (p.first < 0)
+                g.gen_any = p.second;
+              else
+                g.gen[p.first] = p.second;
+              g.gen_log.pop_back();
+            }
+          marks.pop_back();
+        }
+    }
+  /* The arguments of phi functions may come from blocks visited later.
+     An argument is replaced only by a version of the same variable, as
+     another variable, live together with the versions, would keep the
+     phi function from being coalesced when leaving SSA. */
+  for (block = func->blocks; block != NULL; block = block->next)
+    {
+      for (phi = block->ssa_data->phis; phi != NULL; phi = phi->next)
+        {
+          for (i = 0; i < block->ssa_data->preds_num; ++i)
+            {
+              var_t *var = gvn_leader(&g, phi->args[i]);
+              if (ssa_orig(ssa, var) == phi->var)
+                phi->args[i] = var;
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+/* Loop-invariant code motion in SSA form. A back edge is an edge to a
+   block which dominates its source, the header of a loop; the blocks
+   of the loop are those from which a back edge is reached without
+   passing the header. Loops are processed from the innermost, so that
+   what is hoisted out of a loop may be hoisted out of the enclosing
+   ones too. A quadruple is invariant if its operands are assigned
+   outside the loop, by invariant quadruples or by copies of
+   constants. The invariant quadruples without side effects are moved,
+   in the order of the dominator tree, to a preheader inserted before
+   the header, where they are executed even if the loop would not
+   execute them. So an integer division is moved only if its divisor
+   is a constant which cannot make it trap, and a read of an array
+   only if the loop does not write the array and the read is executed
+   before the loop is left. Calls do not write arrays, as those are
+   local.
+
+   Moving a value out of a loop makes it live across the whole loop,
+   and across the calls in it, which do not preserve registers. So the
+   copies of constants, which cost no more than reloading, are left in
+   the loop, and a quadruple moved out which uses one gets a copy of
+   its own in the preheader. For the same reason an address is moved
+   out of one loop only; of the addresses of an array taken in that
+   loop only the first is kept. */
+
+typedef struct{
+  ssa_t *ssa;
+  // the blocks and quadruples assigning the variables, by ids
+  vector<basic_block_t*> def_block;
+  vector<quadr_t*> def_quadr;
+  // array[id] is the array the pointer id points to, if known
+  vector<var_t*> array;
+  // same[id] is the address replacing the address id, or NULL
+  vector<var_t*> same;
+  bool replaced;
+  int preheaders; // the index of the first preheader inserted
+  int stamp; // the number of the current loop
+  vector<int> loop_stamp; // by block indices
+  vector<int> inv_stamp; // by variable ids, for the invariant ones
+  // by array ids, the first address of the array moved out of the loop
+  vector<int> addr_stamp;
+  vector<var_t*> addr;
+  // by variable ids, the copies of constants made in the preheader
+  vector<int> copy_stamp;
+  vector<var_t*> copy;
+  vector<basic_block_t*> blocks; // the blocks of the current loop
+  vector<var_t*> writes; // the arrays written in it; NULL for unknown
+  vector<basic_block_t*> exits; // its blocks with edges leaving it
+} licm_t;
+
+inline static bool licm_in_loop(licm_t *l, basic_block_t *block)
+{
+  return l->loop_stamp[block->ssa_data->index] == l->stamp;
+}
+
+inline static var_t *licm_same(licm_t *l, var_t *var)
+{
+  while (l->same[var->id] != NULL)
+    var = l->same[var->id];
+  return var;
+}
+
+/* Returns the constant the argument is a copy of, if it is assigned
+   in the loop, or NULL. */
+static quadr_arg_t *licm_const(licm_t *l, quadr_arg_t *arg)
+{
+  quadr_t *def;
+  basic_block_t *block;
+  if (arg->tag != QA_VAR)
+    return NULL;
+  def = l->def_quadr[arg->u.var->id];
+  block = l->def_block[arg->u.var->id];
+  if (def == NULL || def->op != Q_COPY || def->arg1.tag == QA_VAR ||
+      !licm_in_loop(l, block))
+    return NULL;
+  return &def->arg1;
+}
+
+inline static bool licm_operand(licm_t *l, quadr_arg_t *arg)
+{
+  basic_block_t *block;
+  int id;
+  if (arg->tag != QA_VAR)
+    return true;
+  id = licm_same(l, arg->u.var)->id;
+  block = l->def_block[id];
+  return block == NULL || !licm_in_loop(l, block) ||
+    l->inv_stamp[id] == l->stamp || licm_const(l, arg) != NULL;
+}
+
+/* Whether an integer division by arg cannot trap, whatever the
+   dividend. */
+static bool licm_safe_divisor(licm_t *l, quadr_arg_t *arg)
+{
+  quadr_t *def;
+  if (arg->tag == QA_VAR && (def = l->def_quadr[arg->u.var->id]) != NULL &&
+      def->op == Q_COPY)
+    arg = &def->arg1;
+  return arg->tag == QA_INT && arg->u.int_val != 0 && arg->u.int_val != -1;
+}
+
+static bool licm_invariant(licm_t *l, basic_block_t *block, quadr_t *quadr)
+{
+  var_t *arr;
+  size_t i;
+  switch (quadr->op){
+  case Q_GET_ADDR:
+    return block->ssa_data->index < l->preheaders;
+  case Q_DIV:
+  case Q_MOD:
+    if (quadr->result.u.var->qtype != VT_DOUBLE && !licm_safe_divisor(l, &quadr->arg2))
+      return false;
+    // fall through
+  case Q_ADD:
+  case Q_SUB:
+  case Q_MUL:
+    return licm_operand(l, &quadr->arg1) && licm_operand(l, &quadr->arg2);
+  case Q_READ_PTR:
+    if (!licm_operand(l, &quadr->arg1) || !licm_operand(l, &quadr->arg2))
+      return false;
+    arr = l->array[quadr->arg1.u.var->id];
+    for (i = 0; i < l->writes.size(); ++i)
+      {
+        if (arr == NULL || l->writes[i] == NULL || l->writes[i] == arr)
+          return false;
+      }
+    for (i = 0; i < l->exits.size(); ++i)
+      {
+        if (!dominates(block, l->exits[i]))
+          return false;
+      }
+    return true;
+  default:
+    return false;
+  };
+}
+
+/* Finds the blocks of the loop, the arrays written in it and its
+   exits. */
+static void licm_find_loop(licm_t *l, basic_block_t *header)
+{
+  vector<basic_block_t*> stack;
+  basic_block_t *block;
+  quadr_t *quadr;
+  size_t k;
+  int i;
+
+  ++l->stamp;
+  l->loop_stamp.resize(l->ssa->blocks_num, -1);
+  l->blocks.clear();
+  l->writes.clear();
+  l->exits.clear();
+  l->loop_stamp[header->ssa_data->index] = l->stamp;
+  stack.push_back(header);
+  while (!stack.empty())
+    {
+      ssa_data_t *sd;
+      block = stack.back();
+      stack.pop_back();
+      l->blocks.push_back(block);
+      sd = block->ssa_data;
+      for (i = 0; i < sd->preds_num; ++i)
+        {
+          basic_block_t *pred = sd->preds[i];
+          if (!licm_in_loop(l, pred) && (block != header || dominates(header, pred)))
+            {
+              l->loop_stamp[pred->ssa_data->index] = l->stamp;
+              stack.push_back(pred);
+            }
+        }
+    }
+  for (k = 0; k < l->blocks.size(); ++k)
+    {
+      block = l->blocks[k];
+      for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+        {
+          if (quadr->op == Q_WRITE_PTR)
+            l->writes.push_back(l->array[licm_same(l, quadr->result.u.var)->id]);
+        }
+      if ((block->child1 == NULL && block->child2 == NULL) ||
+          (block->child1 != NULL && !licm_in_loop(l, block->child1)) ||
+          (block->child2 != NULL && !licm_in_loop(l, block->child2)))
+        l->exits.push_back(block);
+    }
+}
+
+/* Appends to the preheader a quadruple moved out of the loop, making
+   its operands refer to what is available there. */
+static void licm_move(licm_t *l, basic_block_t *pre, quadr_t *quadr)
+{
+  quadr_arg_t *args[2];
+  quadr_arg_t *c;
+  int i, id;
+  args[0] = &quadr->arg1;
+  args[1] = &quadr->arg2;
+  for (i = 0; i < 2; ++i)
+    {
+      if (args[i]->tag != QA_VAR || quadr->op == Q_GET_ADDR)
+        continue;
+      if ((c = licm_const(l, args[i])) != NULL)
+        {
+          id = args[i]->u.var->id;
+          if (l->copy_stamp[id] != l->stamp)
+            {
+              var_t *var = ssa_new_var(l->ssa, args[i]->u.var);
+              lst_append_quadr(&pre->lst, new_copy_quadr(var, *c));
+              l->copy_stamp[id] = l->stamp;
+              l->copy[id] = var;
+            }
+          args[i]->u.var = l->copy[id];
+        }
+      else
+        args[i]->u.var = licm_same(l, args[i]->u.var);
+    }
+  quadr->next = NULL;
+  lst_append_quadr(&pre->lst, quadr);
+}
+
+static void licm_loop(licm_t *l, basic_block_t *header)
+{
+  vector<quadr_t*> hoisted;
+  vector<quadr_t*> dups;
+  vector<basic_block_t*> stack;
+  basic_block_t *block, *pre;
+  quadr_t *quadr, *prev, *next, *jump;
+  phi_t *phi;
+  size_t k;
+  int i;
+
+  licm_find_loop(l, header);
+  // the dominators of a block of the loop within the loop come first
+  stack.push_back(header);
+  while (!stack.empty())
+    {
+      ssa_data_t *sd;
+      block = stack.back();
+      stack.pop_back();
+      for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+        {
+          var_t *var = quadr_def(quadr);
+          if (var == NULL || !licm_invariant(l, block, quadr))
+            continue;
+          l->inv_stamp[var->id] = l->stamp;
+          if (quadr->op == Q_GET_ADDR)
+            {
+              var_t *arr = quadr->arg1.u.var;
+              if (l->addr_stamp[arr->id] == l->stamp)
+                {
+                  dups.push_back(quadr);
+                  continue;
+                }
+              l->addr_stamp[arr->id] = l->stamp;
+              l->addr[arr->id] = var;
+            }
+          hoisted.push_back(quadr);
+        }
+      sd = block->ssa_data;
+      for (i = 0; i < sd->dom_children_num; ++i)
+        {
+          if (licm_in_loop(l, sd->dom_children[i]))
+            stack.push_back(sd->dom_children[i]);
+        }
+    }
+  if (hoisted.empty() || (pre = insert_preheader(l->ssa, header)) == NULL)
+    return;
+
+  for (k = 0; k < dups.size(); ++k)
+    {
+      l->same[dups[k]->result.u.var->id] = l->addr[dups[k]->arg1.u.var->id];
+      l->replaced = true;
+    }
+  for (k = 0; k < l->blocks.size(); ++k)
+    {
+      block = l->blocks[k];
+      prev = NULL;
+      for (quadr = block->lst.head; quadr != NULL; quadr = next)
+        {
+          var_t *var = quadr_def(quadr);
+          next = quadr->next;
+          if (var != NULL && l->inv_stamp[var->id] == l->stamp)
+            {
+              if (prev != NULL)
+                prev->next = next;
+              else
+                block->lst.head = next;
+              if (block->lst.tail == quadr)
+                block->lst.tail = prev;
+            }
+          else
+            prev = quadr;
+        }
+    }
+  for (k = 0; k < dups.size(); ++k)
+    {
+      l->def_block[dups[k]->result.u.var->id] = NULL;
+      l->def_quadr[dups[k]->result.u.var->id] = NULL;
+      free_quadr(dups[k]);
+    }
+  // the preheader is empty, or holds the jump to the header
+  jump = pre->lst.head;
+  pre->lst.head = pre->lst.tail = NULL;
+  l->copy_stamp.resize(l->ssa->func->vars_num, -1);
+  l->copy.resize(l->ssa->func->vars_num, (var_t*) NULL);
+  for (k = 0; k < hoisted.size(); ++k)
+    {
+      licm_move(l, pre, hoisted[k]);
+    }
+  if (jump != NULL)
+    lst_append_quadr(&pre->lst, jump);
+
+  l->def_block.resize(l->ssa->func->vars_num, (basic_block_t*) NULL);
+  l->def_quadr.resize(l->ssa->func->vars_num, (quadr_t*) NULL);
+  l->array.resize(l->ssa->func->vars_num, (var_t*) NULL);
+  l->same.resize(l->ssa->func->vars_num, (var_t*) NULL);
+  l->inv_stamp.resize(l->ssa->func->vars_num, -1);
+  l->addr_stamp.resize(l->ssa->func->vars_num, -1);
+  l->addr.resize(l->ssa->func->vars_num, (var_t*) NULL);
+  for (quadr = pre->lst.head; quadr != NULL; quadr = quadr->next)
+    {
+      var_t *var = quadr_def(quadr);
+      if (var != NULL)
+        {
+          l->def_block[var->id] = pre;
+          l->def_quadr[var->id] = quadr;
+        }
+    }
+  for (phi = pre->ssa_data->phis; phi != NULL; phi = phi->next)
+    {
+      l->def_block[phi->result->id] = pre;
+    }
+  stats_add(invariants_hoisted, hoisted.size());
+}
+
+static void hoist_invariants(ssa_t *ssa)
+{
+  quadr_func_t *func = ssa->func;
+  licm_t l;
+  vector<bool> is_header(ssa->blocks_num, false);
+  vector<basic_block_t*> headers;
+  basic_block_t *block;
+  quadr_arg_t *uses[3];
+  quadr_t *quadr;
+  phi_t *phi;
+  int i, n;
+
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      block = ssa->blocks[i];
+      if (block->child1 != NULL && dominates(block->child1, block))
+        is_header[block->child1->ssa_data->index] = true;
+      if (block->child2 != NULL && dominates(block->child2, block))
+        is_header[block->child2->ssa_data->index] = true;
+    }
+  // an inner loop comes after the enclosing ones in reverse postorder
+  for (i = ssa->blocks_num - 1; i >= 0; --i)
+    {
+      if (is_header[i])
+        headers.push_back(ssa->blocks[i]);
+    }
+  if (headers.empty())
+    return;
+
+  l.ssa = ssa;
+  l.def_block.assign(func->vars_num, (basic_block_t*) NULL);
+  l.def_quadr.assign(func->vars_num, (quadr_t*) NULL);
+  l.array.assign(func->vars_num, (var_t*) NULL);
+  l.same.assign(func->vars_num, (var_t*) NULL);
+  l.replaced = false;
+  l.inv_stamp.assign(func->vars_num, -1);
+  l.addr_stamp.assign(func->vars_num, -1);
+  l.addr.assign(func->vars_num, (var_t*) NULL);
+  l.copy_stamp.assign(func->vars_num, -1);
+  l.copy.assign(func->vars_num, (var_t*) NULL);
+  l.preheaders = ssa->blocks_num;
+  l.stamp = 0;
+  // in reverse postorder, pointers are assigned before they are copied
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      block = ssa->blocks[i];
+      for (phi = block->ssa_data->phis; phi != NULL; phi = phi->next)
+        {
+          l.def_block[phi->result->id] = block;
+        }
+      for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+        {
+          var_t *var = quadr_def(quadr);
+          if (var == NULL)
+            continue;
+          l.def_block[var->id] = block;
+          l.def_quadr[var->id] = quadr;
+          if (quadr->op == Q_GET_ADDR)
+            l.array[var->id] = quadr->arg1.u.var;
+          else if (quadr->op == Q_COPY && quadr->arg1.tag == QA_VAR && var->qtype == VT_PTR)
+            l.array[var->id] = l.array[quadr->arg1.u.var->id];
+        }
+    }
+  for (i = 0; i < (int) headers.size(); ++i)
+    {
+      licm_loop(&l, headers[i]);
+    }
+  if (!l.replaced)
+    return;
+  // the uses of the addresses removed
+  for (block = func->blocks; block != NULL; block = block->next)
+    {
+      for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+        {
+          n = quadr_uses(quadr, uses);
+          for (i = 0; i < n; ++i)
+            {
+              uses[i]->u.var = licm_same(&l, uses[i]->u.var);
+            }
+        }
+      for (phi = block->ssa_data->phis; phi != NULL; phi = phi->next)
+        {
+          for (i = 0; i < block->ssa_data->preds_num; ++i)
+            {
+              phi->args[i] = licm_same(&l, phi->args[i]);
+            }
+        }
+    }
+}
+
+extern "C" bool perform_global_optimizations(quadr_func_t *func)
+{
+  bool changed = propagate_constants(func);
+  ssa_t *ssa;
+  if (changed)
+    create_block_graph(func);
+  ssa = build_ssa(func);
+  if (ssa == NULL)
+    return changed;
+  number_values(ssa);
+  // the copies of constants used by what is hoisted may be left dead
+  hoist_invariants(ssa);
+  remove_dead_code(ssa);
+  destroy_ssa(ssa);
+  return true;
+}
+
+extern "C" void optimizer_thread_cleanup()
 {
-  // empty
+  while (roots != NULL)
+    {
+      graph_node_list_t *next = roots->next;
+      free(roots);
+      roots = next;
+    }
+  if (graph_node_pool != NULL)
+    {
+      free_pool(graph_node_pool);
+      graph_node_pool = NULL;
+    }
+  if (graph != NULL)
+    {
+      rb_free(graph);
+      graph = NULL;
+    }
+  int_leaves.clear();
+  double_leaves.clear();
+  var_leaves.clear();
+  cp_blocks.clear();
+  cp_blocks.shrink_to_fit();
+  cp_vals.clear();
+  cp_vals.shrink_to_fit();
+  cp_stamps.clear();
+  cp_stamps.shrink_to_fit();
+  cp_defs.clear();
+  cp_defs.shrink_to_fit();
 }
@@ -7,8 +7,12 @@
 
 void perform_local_optimizations(quadr_func_t *func);
 void perform_local_optimizations_2(quadr_func_t *func);
-/* Global optimizations should be performed with `flow_data' already
-   computed in every basic block. */
-void perform_global_optimizations(quadr_func_t *func);
+/* Global optimizations should be performed with the block graph and
+   the live sets (vars_at_start, live_at_end) already computed. Return
+   true if the code has changed, in which case both must be computed
+   again. */
+bool perform_global_optimizations(quadr_func_t *func);
+/* Frees the optimizer state of the calling thread. */
+void optimizer_thread_cleanup();
 
 #endif
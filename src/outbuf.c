@@ -1,106 +1,87 @@
 
 #include <stdarg.h>
+#include <stddef.h>
 #include "utils.h"
 #include "outbuf.h"
 
+/* size of the arena chunks */
+#define CHUNK_SIZE (64 * 1024)
+/* size of the batches written by writeout() */
+#define WRITE_BATCH_SIZE (64 * 1024)
+
+/* a stack reference placeholder is STACK_REF_MARK followed by
+   STACK_REF_ID + (index into buf->stack_refs) */
+#define STACK_REF_MARK '\001'
+#define STACK_REF_ID 0x80
+
+#define ALIGN sizeof(void*)
+#define LINE_SIZE(len) ((offsetof(line_t, str) + (len) + 1 + ALIGN - 1) & ~(ALIGN - 1))
+
 outbuf_t *new_outbuf()
 {
   outbuf_t *buf = xmalloc(sizeof(outbuf_t));
   buf->tmpbuf_ind = 0;
   buf->head = buf->tail = NULL;
+  buf->arena = new_alloc(CHUNK_SIZE);
+  buf->arena->name = "output buffer";
+  buf->relocs = NULL;
+  buf->relocs_num = buf->relocs_size = 0;
+  buf->stack_ref_ind = 0;
+  buf->stack_refs_pending = 0;
   return buf;
 }
 
 void free_outbuf(outbuf_t *buf)
 {
-  clearbuf(buf);
+  free_alloc(buf->arena);
+  free(buf->relocs);
   free(buf);
 }
 
-void write(outbuf_t *buf, const char *format, ...)
+static void add_reloc(outbuf_t *buf, reloc_type_t type, line_t *line, size_t pos, int off)
 {
-  va_list ap;
-  int v;
-  va_start(ap, format);
-  v = vsnprintf(buf->tmpbuf + buf->tmpbuf_ind, TMPBUF_SIZE - buf->tmpbuf_ind, format, ap);
-  buf->tmpbuf_ind += v;
-  if (buf->tmpbuf_ind >= TMPBUF_SIZE)
+  reloc_t *reloc;
+  if (buf->relocs_num == buf->relocs_size)
     {
-      xabort("programming error - buffer overflow");
+      buf->relocs_size = buf->relocs_size * 2 + 64;
+      buf->relocs = xrealloc(buf->relocs, buf->relocs_size * sizeof(reloc_t));
     }
-  va_end(ap);
+  reloc = &buf->relocs[buf->relocs_num++];
+  reloc->type = type;
+  reloc->line = line;
+  reloc->pos = pos;
+  reloc->off = off;
 }
 
-void writeln(outbuf_t *buf, const char *format, ...)
+/* Turns the stack reference placeholders in a new line into
+   relocations. */
+static void add_stack_relocs(outbuf_t *buf, line_t *line)
 {
-  va_list ap;
-  int v;
-  va_start(ap, format);
-  v = vsnprintf(buf->tmpbuf + buf->tmpbuf_ind, TMPBUF_SIZE - buf->tmpbuf_ind, format, ap);
-  buf->tmpbuf_ind += v;
-  if (buf->tmpbuf_ind >= TMPBUF_SIZE)
+  const char *s = line->str;
+  const char *end = line->str + line->len;
+  while ((s = memchr(s, STACK_REF_MARK, end - s)) != NULL)
     {
-      xabort("programming error - buffer overflow");
+      int i = (unsigned char) s[1] - STACK_REF_ID;
+      assert (i >= 0 && i < STACK_REFS_NUM);
+      add_reloc(buf, RELOC_STACK, line, s - line->str, buf->stack_refs[i]);
+      if (buf->stack_refs_pending > 0)
+        --buf->stack_refs_pending;
+      s += 2;
     }
-  flushbuf(buf);
-  va_end(ap);
 }
 
-#define MAX_LINE_LEN 512
-
-static char line_buf[MAX_LINE_LEN + 1];
-
-static void do_appendln(outbuf_t *buf, line_t *dummy, const char *str)
+static line_t *new_line(outbuf_t *buf, const char *str, size_t len)
 {
-  line_t *tail = buf->tail;
-  line_t *nl = xmalloc(sizeof(line_t) + strlen(str));
-  nl->prev = tail;
-  nl->next = NULL;
-  strcpy(nl->str, str);
-  if (tail != NULL)
-    tail->next = nl;
-  else
-    buf->head = nl;
-  buf->tail = nl;
-}
-
-#define FOR_ALL_LINES(func, line)                               \
-  int i = 0;                                                    \
-  while (*str != 0)                                             \
-    {                                                           \
-      i = 0;                                                    \
-      while (*str != '\n' && *str != 0)                         \
-        {                                                       \
-          if (i == MAX_LINE_LEN)                                \
-            xabort("programming error - buffer overflow");      \
-          line_buf[i++] = *str;                                 \
-          ++str;                                                \
-        }                                                       \
-      line_buf[i] = '\0';                                       \
-      func(buf, line, line_buf);                                \
-      if (line != NULL)                                         \
-        {                                                       \
-          line = line->next;                                    \
-        }                                                       \
-      else                                                      \
-        {                                                       \
-          line = buf->head;                                     \
-        }                                                       \
-      if (*str == '\n')                                         \
-        ++str;                                                  \
-    }
-  
-
-void appendln(outbuf_t *buf, const char *str)
-{
-  line_t *dummy = NULL;
-  FOR_ALL_LINES(do_appendln, dummy);
+  line_t *nl = alloc(buf->arena, LINE_SIZE(len));
+  nl->len = len;
+  memcpy(nl->str, str, len);
+  nl->str[len] = '\0';
+  return nl;
 }
 
-static void do_insertln(outbuf_t *buf, line_t *line, const char *str)
+/* Links nl after line (at the head if line is NULL). */
+static void link_line(outbuf_t *buf, line_t *line, line_t *nl)
 {
-  line_t *nl = xmalloc(sizeof(line_t) + strlen(str));
-  strcpy(nl->str, str);
   nl->prev = line;
   if (line != NULL)
     {
@@ -120,9 +101,83 @@ static void do_insertln(outbuf_t *buf, line_t *line, const char *str)
     nl->next->prev = nl;
 }
 
+/* Inserts the lines of str (of length len) after line. */
+static void insert_lines(outbuf_t *buf, line_t *line, const char *str, size_t len)
+{
+  const char *end = str + len;
+  while (str < end)
+    {
+      const char *eol = memchr(str, '\n', end - str);
+      line_t *nl;
+      if (eol == NULL)
+        eol = end;
+      nl = new_line(buf, str, eol - str);
+      link_line(buf, line, nl);
+      if (buf->stack_refs_pending > 0)
+        add_stack_relocs(buf, nl);
+      line = nl;
+      str = eol + 1;
+    }
+}
+
+void write(outbuf_t *buf, const char *format, ...)
+{
+  va_list ap;
+  int v;
+  va_start(ap, format);
+  v = vsnprintf(buf->tmpbuf + buf->tmpbuf_ind, TMPBUF_SIZE - buf->tmpbuf_ind, format, ap);
+  buf->tmpbuf_ind += v;
+  if (buf->tmpbuf_ind >= TMPBUF_SIZE)
+    {
+      xabort("programming error - buffer overflow");
+    }
+  va_end(ap);
+}
+
+void writeln(outbuf_t *buf, const char *format, ...)
+{
+  va_list ap;
+  int v;
+  va_start(ap, format);
+  if (buf->tmpbuf_ind > 0)
+    {
+      v = vsnprintf(buf->tmpbuf + buf->tmpbuf_ind, TMPBUF_SIZE - buf->tmpbuf_ind, format, ap);
+      buf->tmpbuf_ind += v;
+      if (buf->tmpbuf_ind >= TMPBUF_SIZE)
+        {
+          xabort("programming error - buffer overflow");
+        }
+      flushbuf(buf);
+    }
+  else
+    {
+      va_list ap2;
+      va_copy(ap2, ap);
+      v = vsnprintf(buf->tmpbuf, TMPBUF_SIZE, format, ap);
+      if (v < TMPBUF_SIZE)
+        {
+          insert_lines(buf, buf->tail, buf->tmpbuf, v);
+        }
+      else
+        { // long line (e.g. a string constant)
+          char *str = xmalloc(v + 1);
+          vsnprintf(str, v + 1, format, ap2);
+          insert_lines(buf, buf->tail, str, v);
+          free(str);
+        }
+      va_end(ap2);
+    }
+  va_end(ap);
+}
+
+void appendln(outbuf_t *buf, const char *str)
+{
+  insert_lines(buf, buf->tail, str, strlen(str));
+}
+
 void insertln(outbuf_t *buf, line_t *line, const char *str)
 {
-  FOR_ALL_LINES(do_insertln, line);
+  insert_lines(buf, line, str, strlen(str));
 }
 
 void removeln(outbuf_t *buf, line_t *line)
@@ -135,7 +190,6 @@ void removeln(outbuf_t *buf, line_t *line)
     buf->head = line->next;
   if (buf->tail == line)
     buf->tail = line->prev;
-  free(line);
 }
 
 void changeln(outbuf_t *buf, line_t *line, const char *str)
@@ -147,25 +201,38 @@ void changeln(outbuf_t *buf, line_t *line, const char *str)
 
 void writeout(outbuf_t *buf, FILE *fout)
 {
+  char batch[WRITE_BATCH_SIZE];
+  size_t n = 0;
   line_t *line = buf->head;
   while (line != NULL)
     {
-      fprintf(fout, "%s\n", line->str);
+      if (n + line->len + 1 > WRITE_BATCH_SIZE)
+        {
+          fwrite(batch, 1, n, fout);
+          n = 0;
+          if (line->len + 1 > WRITE_BATCH_SIZE)
+            {
+              fwrite(line->str, 1, line->len, fout);
+              fputc('\n', fout);
+              line = line->next;
+              continue;
+            }
+        }
+      memcpy(batch + n, line->str, line->len);
+      n += line->len;
+      batch[n++] = '\n';
       line = line->next;
     }
+  fwrite(batch, 1, n, fout);
 }
 
 void clearbuf(outbuf_t *buf)
 {
-  line_t *line = buf->head;
-  while (line != NULL)
-    {
-      line_t *next = line->next;
-      free(line);
-      line = next;
-    }
   buf->head = buf->tail = NULL;
   buf->tmpbuf_ind = 0;
+  buf->relocs_num = 0;
+  buf->stack_refs_pending = 0;
+  reset_alloc(buf->arena);
 }
 
 void flushbuf(outbuf_t *buf)
@@ -177,47 +244,96 @@ void flushbuf(outbuf_t *buf)
     }
 }
 
-void fix_stack(outbuf_t *buf, int stack_size, 
+const char *stack_ref(outbuf_t *buf, int off)
+{
+  int i = buf->stack_ref_ind;
+  char *str = buf->stack_ref_strs[i];
+  buf->stack_ref_ind = (i + 1) % STACK_REFS_NUM;
+  buf->stack_refs[i] = off;
+  ++buf->stack_refs_pending;
+  str[0] = STACK_REF_MARK;
+  str[1] = STACK_REF_ID + i;
+  str[2] = '\0';
+  return str;
+}
+
+static void write_marker_line(outbuf_t *buf, reloc_type_t type)
+{
+  line_t *nl = new_line(buf, "", 0);
+  flushbuf(buf);
+  link_line(buf, buf->tail, nl);
+  add_reloc(buf, type, nl, 0, 0);
+}
+
+void write_prologue(outbuf_t *buf)
+{
+  write_marker_line(buf, RELOC_PROLOGUE);
+}
+
+void write_epilogue(outbuf_t *buf)
+{
+  write_marker_line(buf, RELOC_EPILOGUE);
+}
+
+/* the maximal length of a formatted stack reference */
+#define MAX_STACK_REF_LEN 64
+
+void fix_stack(outbuf_t *buf, int stack_size,
                const char *prologue,
                const char *epilogue,
                const char *sp_format)
 {
-  line_t *line = buf->head;
-  char line_buf2[MAX_LINE_LEN + 1];
-  while (line != NULL)
+  size_t i = 0;
+  buf->stack_refs_pending = 0;
+  while (i < buf->relocs_num)
     {
-      line_t *next = line->next;
-      if (strcmp(line->str, "@P@") == 0)
+      reloc_t *reloc = &buf->relocs[i];
+      line_t *line = reloc->line;
+      switch (reloc->type){
+      case RELOC_PROLOGUE:
+        changeln(buf, line, prologue);
+        ++i;
+        break;
+      case RELOC_EPILOGUE:
+        changeln(buf, line, epilogue);
+        ++i;
+        break;
+      case RELOC_STACK:
         {
-          changeln(buf, line, prologue);
-        }
-      else if (strcmp(line->str, "@E@") == 0)
-        {
-          changeln(buf, line, epilogue);
-        }
-      else
-        {
-          char *s;
-          assert (strlen(line->str) < MAX_LINE_LEN);
-          s = strstr(line->str, "@FP@");
-          if (s != NULL)
+          // all stack references in a line are consecutive
+          char local_str[TMPBUF_SIZE];
+          char *str = local_str;
+          size_t j = i;
+          size_t n = 0;
+          size_t pos = 0;
+          while (j < buf->relocs_num && buf->relocs[j].line == line)
+            {
+              ++j;
+            }
+          if (line->len + (j - i) * MAX_STACK_REF_LEN + 1 > TMPBUF_SIZE)
+            {
+              str = xmalloc(line->len + (j - i) * MAX_STACK_REF_LEN + 1);
+            }
+          for (; i < j; ++i)
             {
-              int i = s - line->str;
-              char *s2 = s + 4;
-              int off0;
-              sscanf(s2, "%d@", &off0);
-              while (*s2 != '@')
-                {
-                  assert (*s2 != '\0');
-                  ++s2;
-                }
-              ++s2;
-              strncpy(line_buf2, line->str, i);
-              i += snprintf(line_buf2 + i, MAX_LINE_LEN - i, sp_format, stack_size - off0);
-              strncpy(line_buf2 + i, s2, MAX_LINE_LEN - i);
-              changeln(buf, line, line_buf2);
+              reloc = &buf->relocs[i];
+              assert (reloc->type == RELOC_STACK);
+              memcpy(str + n, line->str + pos, reloc->pos - pos);
+              n += reloc->pos - pos;
+              n += snprintf(str + n, MAX_STACK_REF_LEN, sp_format, stack_size - reloc->off);
+              pos = reloc->pos + 2;
             }
+          memcpy(str + n, line->str + pos, line->len - pos);
+          n += line->len - pos;
+          str[n] = '\0';
+          changeln(buf, line, str);
+          if (str != local_str)
+            free(str);
+          break;
         }
-      line = next;
+      default:
+        xabort("fix_stack()");
+      };
     }
+  buf->relocs_num = 0;
 }
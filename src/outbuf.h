@@ -4,18 +4,44 @@
 #define OUTBUF_H
 
 #include <stdio.h>
+#include "mem.h"
 
+/* Lines are carved out of the buffer's arena. They are never freed
+   individually -- removed lines are only unlinked and the memory is
+   reclaimed by clearbuf(). */
 typedef struct Line{
   struct Line *prev;
   struct Line *next;
+  size_t len;
   char str[1];
 } line_t;
 
+/* Relocations record the places which depend on the stack size of
+   the function, and are resolved by fix_stack(). */
+typedef enum { RELOC_STACK, RELOC_PROLOGUE, RELOC_EPILOGUE } reloc_type_t;
+
+typedef struct{
+  reloc_type_t type;
+  line_t *line;
+  size_t pos; // position of the stack reference in the line
+  int off; // frame offset of the stack reference
+} reloc_t;
+
 #define TMPBUF_SIZE 512
+#define STACK_REFS_NUM 64
 
 typedef struct{
   line_t *head;
   line_t *tail;
+  alloc_t *arena;
+  reloc_t *relocs;
+  size_t relocs_num;
+  size_t relocs_size;
+  /* stack references handed out by stack_ref() */
+  int stack_refs[STACK_REFS_NUM];
+  char stack_ref_strs[STACK_REFS_NUM][3];
+  int stack_ref_ind;
+  int stack_refs_pending;
   char tmpbuf[TMPBUF_SIZE];
   int tmpbuf_ind;
 } outbuf_t;
@@ -42,8 +68,21 @@ void clearbuf(outbuf_t *buf);
    line has not yet been created. */
 void flushbuf(outbuf_t *buf);
 
-/* Fixes stack refences given the maximal size of the stack. */
-void fix_stack(outbuf_t *buf, int stack_size, 
+/* Returns a placeholder for the stack slot at frame offset `off',
+   to be embedded in the text written to the buffer. The placeholder
+   becomes a relocation when its line is created, and is valid for
+   the next STACK_REFS_NUM calls. */
+const char *stack_ref(outbuf_t *buf, int off);
+/* Write lines to be replaced with the function's prologue or
+   epilogue. */
+void write_prologue(outbuf_t *buf);
+void write_epilogue(outbuf_t *buf);
+
+/* Resolves the relocations given the maximal size of the stack. A
+   stack reference at offset off becomes sp_format applied to
+   stack_size - off. Lines carrying relocations must not be removed
+   or changed before. */
+void fix_stack(outbuf_t *buf, int stack_size,
                const char *prologue,
                const char *epilogue,
                const char *sp_format);
@@ -10,6 +10,7 @@
 #include "utils.h"
 #include "tree.h"
 #include "utils.h"
+#include "quadr.h"
 #include "parsedef.h"
 
 #define YY_DECL int yylex (YYSTYPE *lvalp, YYLTYPE *llocp)
@@ -82,6 +83,27 @@
     ret.len = (l2.last_line == l1.first_line) ? (l2.last_column - l1.first_column) : (1);
     return ret;
   }
+
+  void (*func_handler)(func_t *) = NULL;
+
+  /* Appends a function to the list, unless func_handler is set, in
+     which case the function is passed to it instead. */
+  static void add_func(func_lst_t *lst, func_t *func)
+  {
+    if (func_handler != NULL)
+      {
+        func_handler(func);
+      }
+    else if (lst->first == NULL)
+      {
+        lst->first = lst->last = func;
+      }
+    else
+      {
+        lst->last->next = func;
+        lst->last = func;
+      }
+  }
 %}
 
 %%
@@ -91,8 +113,8 @@ program:  /* empty */ { *pnode = NULL; }
         | error { *pnode = NULL; }
         ;
 
-func_list:  func { $$.first = $$.last = (func_t*) $1; }
-          | func_list func { $$ = $1; $$.last->next = (func_t*) $2; $$.last = (func_t*) $2; }
+func_list:  func { $$.first = $$.last = NULL; add_func(&$$, (func_t*) $1); }
+          | func_list func { $$ = $1; add_func(&$$, (func_t*) $2); }
           | func_list ';'
           ;
 
@@ -207,3 +229,94 @@ void yyerror(YYLTYPE *locp, node_t **dummy, const char *msg)
 {
   error(locp->first_line, locp->first_column, msg);
 }
+
+/* Reads a token for declare_functions(). */
+static int prescan_token(YYSTYPE *val, YYLTYPE *loc)
+{
+  int tok;
+  suppress_errors = true;
+  tok = yylex(val, loc);
+  suppress_errors = false;
+  if (tok == STRING)
+    {
+      free(val->str);
+    }
+  return tok;
+}
+
+/* Declares all the functions of the program by scanning its tokens,
+   so that each function may be checked as soon as it is parsed even
+   if it calls functions defined further on. Only the function headers
+   outside of any braces are looked at. The input is read to the end;
+   the scanner must be restarted afterwards. Lexical errors are left
+   to the parser to report. */
+void declare_functions()
+{
+  YYSTYPE val;
+  YYLTYPE loc = { 1, 1, 1, 1 };
+  int depth = 0;
+  int tok = prescan_token(&val, &loc);
+  while (tok != 0)
+    {
+      if (tok == TYPE && depth == 0)
+        {
+          src_pos_t pos;
+          type_t *ret_type = cons_type(val.type);
+          sym_t *ident;
+          type_list_t *args = NULL;
+          type_list_t *last = NULL;
+          int args_num = 0;
+          bool bad = false;
+          pos.line = loc.first_line;
+          pos.col = loc.first_column;
+          pos.len = 1;
+          if ((tok = prescan_token(&val, &loc)) != ID)
+            continue;
+          ident = val.symbol;
+          if ((tok = prescan_token(&val, &loc)) != '(')
+            continue;
+          tok = prescan_token(&val, &loc);
+          while (tok != ')')
+            {
+              type_list_t *tl;
+              if (tok != TYPE)
+                {
+                  bad = true;
+                  break;
+                }
+              tl = alloc_type(sizeof(type_list_t));
+              tl->type = cons_type(val.type);
+              tl->next = NULL;
+              if (last == NULL)
+                args = tl;
+              else
+                last->next = tl;
+              last = tl;
+              ++args_num;
+              if ((tok = prescan_token(&val, &loc)) != ID)
+                {
+                  bad = true;
+                  break;
+                }
+              if ((tok = prescan_token(&val, &loc)) == ',')
+                tok = prescan_token(&val, &loc);
+              else if (tok != ')')
+                {
+                  bad = true;
+                  break;
+                }
+            }
+          if (bad)
+            continue;
+          if ((tok = prescan_token(&val, &loc)) != '{')
+            continue;
+          declare_user_function(ident, (func_type_t*) cons_type(TYPE_FUNC, ret_type, args_num, args), pos);
+        }
+      if (tok == '{')
+        ++depth;
+      else if (tok == '}')
+        --depth;
+      tok = prescan_token(&val, &loc);
+    }
+  functions_declared = true;
+}
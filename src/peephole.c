@@ -1,10 +1,1023 @@
 
+#include <stdio.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <regex.h>
+#include "utils.h"
 #include "peephole.h"
 
+/* The rules file consists of an optional %%definitions section
+   followed by phases separated by %%newphase. Each rule is a
+   %%-delimited pattern followed by a %%-terminated replacement:
+
+   %%
+   <pattern lines>
+   %%
+   <replacement lines>
+   %%
+
+   In patterns %N% captures an operand (any text without a comma),
+   %N:name% captures text matching the definition `name', %N:regex%
+   captures text matching `regex' and %:regex% is an anonymous
+   capture. A capture number occurring more than once must bind the
+   same text each time, and distinct capture numbers must bind
+   distinct texts. Whitespace in patterns matches any (possibly empty)
+   amount of whitespace. In replacements %N% (or %N:anything%) is
+   substituted by the text bound to N. */
+
+#define MAX_RULE_LINE_LEN 1024
+#define MAX_LINE_LEN 512
+#define MAX_CAPTURES 32
+/* bound on the number of rewrites in a phase per line of input; only
+   a cyclic rule set may reach it */
+#define MAX_REWRITES_PER_LINE 16
+/* rules are indexed by the exact number of operands up to this
+   number */
+#define MAX_OPERANDS 3
+
+typedef struct Def{
+  char *name;
+  char *value;
+  regex_t *regex;
+  struct Def *next;
+} def_t;
+
+typedef enum { ITEM_TEXT, ITEM_CAPTURE } item_type_t;
+
+typedef struct Item{
+  item_type_t type;
+  char *text; // for ITEM_TEXT
+  int capture; // capture number, -1 for anonymous captures
+  regex_t *regex; // NULL for an operand capture
+  char *regex_src;
+  bool own_regex;
+  bool words; // the regex is an alternative of plain words
+  struct Item *next;
+} item_t;
+
+typedef struct Rule{
+  item_t **pattern;
+  int pattern_len;
+  item_t **replacement;
+  int replacement_len;
+  int index; // position in the phase
+  struct Rule *next;
+} rule_t;
+
+/* Rules in the order of their indices. */
+typedef struct{
+  rule_t **rules;
+  int size;
+} rule_vec_t;
+
+/* The rules of a phase are kept in a trie keyed by the opcode (the
+   first word of the first pattern line) and then by the number of
+   operands. Only the rules stored under the opcode and operand count
+   of a line, together with the rules whose first line does not start
+   with a fixed opcode, need to be tried at that line. */
+typedef struct Trie_node{
+  char c;
+  struct Trie_node *child;
+  struct Trie_node *sibling;
+  rule_vec_t by_operands[MAX_OPERANDS + 1];
+  rule_vec_t any_operands;
+} trie_node_t;
+
+typedef struct Phase{
+  rule_t *rules;
+  rule_t *last_rule;
+  int rules_num;
+  int max_pattern_len;
+  trie_node_t *trie;
+  rule_vec_t wildcard; // rules not keyed by an opcode
+  struct Phase *next;
+} phase_t;
+
+static def_t *defs = NULL;
+static phase_t *phases = NULL;
+static phase_t *last_phase = NULL;
+static bool ignorecase = false;
+static int rules_line_num;
+
+static __thread const char *bound[MAX_CAPTURES];
+static __thread int bound_len[MAX_CAPTURES];
+
+/*****************************************************************************/
+/* Loading rules */
+
+static void rules_error(const char *format, ...)
+{
+  char buf[MAX_RULE_LINE_LEN];
+  int n;
+  va_list ap;
+  n = snprintf(buf, MAX_RULE_LINE_LEN, "peephole rules, line %d: ", rules_line_num);
+  va_start(ap, format);
+  vsnprintf(buf + n, MAX_RULE_LINE_LEN - n, format, ap);
+  va_end(ap);
+  xabort(buf);
+}
+
+static def_t *find_def(const char *name, size_t len)
+{
+  def_t *def = defs;
+  while (def != NULL)
+    {
+      if (strlen(def->name) == len && strncmp(def->name, name, len) == 0)
+        return def;
+      def = def->next;
+    }
+  return NULL;
+}
+
+static regex_t *compile_regex(const char *str)
+{
+  regex_t *regex = xmalloc(sizeof(regex_t));
+  size_t len = strlen(str);
+  char *anchored = xmalloc(len + 5);
+  int flags = REG_EXTENDED | REG_NOSUB;
+  if (ignorecase)
+    flags |= REG_ICASE;
+  sprintf(anchored, "^(%s)$", str);
+  if (regcomp(regex, anchored, flags) != 0)
+    {
+      rules_error("bad regular expression `%s'", str);
+    }
+  free(anchored);
+  return regex;
+}
+
+static regex_t *def_regex(def_t *def)
+{
+  if (def->regex == NULL)
+    {
+      def->regex = compile_regex(def->value);
+    }
+  return def->regex;
+}
+
+/* Expands $(name) macros. */
+static char *expand_macros(const char *str)
+{
+  size_t size = strlen(str) + 1;
+  size_t len = 0;
+  char *result = xmalloc(size);
+  while (*str != '\0')
+    {
+      const char *val = NULL;
+      size_t val_len;
+      if (str[0] == '$' && str[1] == '(')
+        {
+          const char *end = strchr(str, ')');
+          def_t *def;
+          if (end == NULL)
+            rules_error("unterminated macro");
+          def = find_def(str + 2, end - str - 2);
+          if (def == NULL)
+            rules_error("undefined macro `%.*s'", (int) (end - str - 2), str + 2);
+          val = def->value;
+          val_len = strlen(val);
+          str = end + 1;
+        }
+      else
+        {
+          val = str;
+          val_len = 1;
+          ++str;
+        }
+      if (len + val_len + 1 > size)
+        {
+          size = 2 * size + val_len;
+          result = xrealloc(result, size);
+        }
+      memcpy(result + len, val, val_len);
+      len += val_len;
+    }
+  result[len] = '\0';
+  return result;
+}
+
+static inline const char *skip_space(const char *s)
+{
+  while (isspace((unsigned char) *s))
+    ++s;
+  return s;
+}
+
+static char *trim(char *str)
+{
+  char *end;
+  while (isspace((unsigned char) *str))
+    ++str;
+  end = str + strlen(str);
+  while (end > str && isspace((unsigned char) end[-1]))
+    --end;
+  *end = '\0';
+  return str;
+}
+
+static void add_def(char *line)
+{
+  char *eq = strchr(line, '=');
+  char *name;
+  char *value;
+  def_t *def;
+  if (eq == NULL)
+    rules_error("`=' expected");
+  *eq = '\0';
+  name = trim(line);
+  value = trim(eq + 1);
+  if (*value == '\'')
+    {
+      size_t len = strlen(value);
+      if (len < 2 || value[len - 1] != '\'')
+        rules_error("unterminated quote");
+      value[len - 1] = '\0';
+      ++value;
+    }
+  if (strcmp(name, "ignorecase") == 0)
+    {
+      ignorecase = atoi(value) != 0;
+      return;
+    }
+  if (find_def(name, strlen(name)) != NULL)
+    rules_error("`%s' redefined", name);
+  def = xmalloc(sizeof(def_t));
+  def->name = xstrdup(name);
+  def->value = expand_macros(value);
+  def->regex = NULL;
+  def->next = defs;
+  defs = def;
+}
+
+static item_t *new_item(item_type_t type)
+{
+  item_t *item = xmalloc(sizeof(item_t));
+  item->type = type;
+  item->text = NULL;
+  item->capture = -1;
+  item->regex = NULL;
+  item->regex_src = NULL;
+  item->own_regex = false;
+  item->words = false;
+  item->next = NULL;
+  return item;
+}
+
+static inline bool is_opcode_chr(char c)
+{
+  return isalnum((unsigned char) c) || c == '_';
+}
+
+/* Returns true if `regex' is of the form word1|word2|...|wordN. */
+static bool is_word_alternation(const char *regex)
+{
+  const char *s = regex;
+  while (is_opcode_chr(*s) || (*s == '|' && s > regex && is_opcode_chr(s[1])))
+    ++s;
+  return *s == '\0' && s > regex;
+}
+
+/* Parses a pattern or replacement line into a list of items. */
+static item_t *parse_line(const char *str, bool is_pattern)
+{
+  item_t *head = NULL;
+  item_t **pnext = &head;
+  while (*str != '\0')
+    {
+      item_t *item;
+      if (*str == '%')
+        {
+          const char *end;
+          item = new_item(ITEM_CAPTURE);
+          ++str;
+          if (isdigit((unsigned char) *str))
+            {
+              item->capture = atoi(str);
+              if (item->capture >= MAX_CAPTURES)
+                rules_error("capture number too large");
+              while (isdigit((unsigned char) *str))
+                ++str;
+            }
+          if (*str == ':')
+            {
+              def_t *def;
+              ++str;
+              end = strchr(str, '%');
+              if (end == NULL)
+                rules_error("unterminated capture");
+              if (is_pattern)
+                {
+                  def = find_def(str, end - str);
+                  if (def != NULL)
+                    {
+                      item->regex = def_regex(def);
+                      item->regex_src = xstrdup(def->value);
+                    }
+                  else
+                    {
+                      item->regex_src = xstrndup(str, end - str);
+                      item->regex = compile_regex(item->regex_src);
+                      item->own_regex = true;
+                    }
+                  item->words = is_word_alternation(item->regex_src);
+                }
+              str = end;
+            }
+          if (*str != '%')
+            rules_error("unterminated capture");
+          ++str;
+          if (item->capture == -1 && (!is_pattern || item->regex == NULL))
+            rules_error("capture number expected");
+        }
+      else
+        {
+          const char *end = strchr(str, '%');
+          if (end == NULL)
+            end = str + strlen(str);
+          item = new_item(ITEM_TEXT);
+          item->text = xstrndup(str, end - str);
+          str = end;
+        }
+      *pnext = item;
+      pnext = &item->next;
+    }
+  return head;
+}
+
+static void add_rule_line(item_t ***plines, int *plen, const char *str, bool is_pattern)
+{
+  *plines = xrealloc(*plines, (*plen + 1) * sizeof(item_t*));
+  (*plines)[(*plen)++] = parse_line(str, is_pattern);
+}
+
+static phase_t *new_phase()
+{
+  phase_t *phase = xmalloc(sizeof(phase_t));
+  phase->rules = phase->last_rule = NULL;
+  phase->rules_num = 0;
+  phase->max_pattern_len = 0;
+  phase->trie = NULL;
+  phase->wildcard.rules = NULL;
+  phase->wildcard.size = 0;
+  phase->next = NULL;
+  if (last_phase != NULL)
+    last_phase->next = phase;
+  else
+    phases = phase;
+  last_phase = phase;
+  return phase;
+}
+
+static trie_node_t *new_trie_node(char c)
+{
+  trie_node_t *node = xmalloc(sizeof(trie_node_t));
+  int i;
+  node->c = c;
+  node->child = node->sibling = NULL;
+  for (i = 0; i <= MAX_OPERANDS; ++i)
+    {
+      node->by_operands[i].rules = NULL;
+      node->by_operands[i].size = 0;
+    }
+  node->any_operands.rules = NULL;
+  node->any_operands.size = 0;
+  return node;
+}
+
+static void free_trie(trie_node_t *node)
+{
+  while (node != NULL)
+    {
+      trie_node_t *sibling = node->sibling;
+      int i;
+      free_trie(node->child);
+      for (i = 0; i <= MAX_OPERANDS; ++i)
+        {
+          free(node->by_operands[i].rules);
+        }
+      free(node->any_operands.rules);
+      free(node);
+      node = sibling;
+    }
+}
+
+static inline char key_chr(char c)
+{
+  return ignorecase ? tolower((unsigned char) c) : c;
+}
+
+static trie_node_t *trie_find(trie_node_t **proot, const char *key, int len, bool create)
+{
+  trie_node_t **pnode = proot;
+  trie_node_t *node = NULL;
+  int i;
+  for (i = 0; i < len; ++i)
+    {
+      char c = key_chr(key[i]);
+      node = *pnode;
+      while (node != NULL && node->c != c)
+        {
+          node = node->sibling;
+        }
+      if (node == NULL)
+        {
+          if (!create)
+            return NULL;
+          node = new_trie_node(c);
+          node->sibling = *pnode;
+          *pnode = node;
+        }
+      pnode = &node->child;
+    }
+  return node;
+}
+
+static void rule_vec_add(rule_vec_t *vec, rule_t *rule)
+{
+  vec->rules = xrealloc(vec->rules, (vec->size + 1) * sizeof(rule_t*));
+  vec->rules[vec->size++] = rule;
+}
+
+/* Returns true if a text matching `regex' may contain a comma. This
+   is conservative. */
+static bool may_match_comma(const char *regex)
+{
+  for (; *regex != '\0'; ++regex)
+    {
+      if (*regex == ',' || *regex == '.' || (regex[0] == '[' && regex[1] == '^'))
+        return true;
+      if (*regex == '\\' && isalpha((unsigned char) regex[1]))
+        return true;
+    }
+  return false;
+}
+
+/* Counts the operands in a line of text. Returns -1 if the line has
+   no operands part that could be counted. */
+static int count_operands(const char *str)
+{
+  int n;
+  bool in_quote = false;
+  str = skip_space(str);
+  if (*str == '\0')
+    return 0;
+  n = 1;
+  for (; *str != '\0'; ++str)
+    {
+      if (*str == '\'')
+        in_quote = !in_quote;
+      else if (*str == ',' && !in_quote)
+        ++n;
+    }
+  return n;
+}
+
+/* Adds `rule' to the index of `phase' under each of the opcodes its
+   first pattern line may start with. */
+static void index_rule(phase_t *phase, rule_t *rule)
+{
+  item_t *first = rule->pattern[0];
+  item_t *item;
+  const char *opcodes = NULL; // alternatives separated by '|'
+  int opcodes_len = 0;
+  const char *rest = NULL;
+  int operands = -1;
+  bool exact = true;
+
+  if (first->type == ITEM_TEXT)
+    {
+      const char *s = skip_space(first->text);
+      const char *e = s;
+      while (is_opcode_chr(*e))
+        ++e;
+      if (e > s && (isspace((unsigned char) *e) || (*e == '\0' && first->next == NULL)))
+        {
+          opcodes = s;
+          opcodes_len = e - s;
+          rest = e;
+        }
+    }
+  else if (first->regex != NULL && first->next != NULL &&
+           first->next->type == ITEM_TEXT && isspace((unsigned char) first->next->text[0]))
+    {
+      // a capture of one of several fixed opcodes, e.g. `fadd|fsub'
+      if (first->words)
+        {
+          opcodes = first->regex_src;
+          opcodes_len = strlen(opcodes);
+          rest = first->next->text;
+        }
+    }
+
+  if (opcodes == NULL)
+    {
+      rule_vec_add(&phase->wildcard, rule);
+      return;
+    }
+
+  // count the operands in the first line
+  item = (first->type == ITEM_TEXT) ? first->next : first->next->next;
+  operands = count_operands(rest);
+  if (operands == 0 && item != NULL)
+    operands = 1;
+  for (; item != NULL; item = item->next)
+    {
+      if (item->type == ITEM_TEXT)
+        {
+          const char *c;
+          for (c = item->text; *c != '\0'; ++c)
+            {
+              if (*c == ',')
+                ++operands;
+              else if (*c == '\'')
+                exact = false;
+            }
+        }
+      else if (item->regex_src != NULL && may_match_comma(item->regex_src))
+        {
+          exact = false;
+        }
+    }
+  if (operands > MAX_OPERANDS)
+    exact = false;
+
+  while (opcodes_len > 0)
+    {
+      int len = 0;
+      trie_node_t *node;
+      while (len < opcodes_len && opcodes[len] != '|')
+        ++len;
+      node = trie_find(&phase->trie, opcodes, len, true);
+      if (exact)
+        rule_vec_add(&node->by_operands[operands], rule);
+      else
+        rule_vec_add(&node->any_operands, rule);
+      if (len < opcodes_len)
+        ++len;
+      opcodes += len;
+      opcodes_len -= len;
+    }
+}
+
+static rule_t *new_rule()
+{
+  rule_t *rule = xmalloc(sizeof(rule_t));
+  rule->pattern = rule->replacement = NULL;
+  rule->pattern_len = rule->replacement_len = 0;
+  rule->next = NULL;
+  return rule;
+}
+
+static void add_rule(rule_t *rule)
+{
+  phase_t *phase = last_phase;
+  if (rule->pattern_len == 0)
+    rules_error("empty pattern");
+  if (phase == NULL)
+    phase = new_phase();
+  if (phase->last_rule != NULL)
+    phase->last_rule->next = rule;
+  else
+    phase->rules = rule;
+  phase->last_rule = rule;
+  rule->index = phase->rules_num++;
+  index_rule(phase, rule);
+  if (rule->pattern_len > phase->max_pattern_len)
+    phase->max_pattern_len = rule->pattern_len;
+}
+
+typedef enum { ST_TOP, ST_DEFS, ST_PATTERN, ST_REPLACEMENT } rules_state_t;
+
 void load_rules(FILE *fin)
 {
+  char line_buf[MAX_RULE_LINE_LEN];
+  rules_state_t state = ST_TOP;
+  rule_t *rule = NULL;
+  rules_line_num = 0;
+  while (fgets(line_buf, MAX_RULE_LINE_LEN, fin) != NULL)
+    {
+      char *line = trim(line_buf);
+      ++rules_line_num;
+      if (*line == '\0' || *line == '#')
+        continue;
+      switch (state){
+      case ST_TOP:
+      case ST_DEFS:
+        if (strcmp(line, "%%definitions") == 0)
+          {
+            state = ST_DEFS;
+          }
+        else if (strcmp(line, "%%newphase") == 0)
+          {
+            new_phase();
+            state = ST_TOP;
+          }
+        else if (strcmp(line, "%%") == 0)
+          {
+            rule = new_rule();
+            state = ST_PATTERN;
+          }
+        else if (state == ST_DEFS)
+          {
+            add_def(line);
+          }
+        else
+          {
+            rules_error("`%%%%' expected");
+          }
+        break;
+      case ST_PATTERN:
+        if (strcmp(line, "%%") == 0)
+          state = ST_REPLACEMENT;
+        else
+          add_rule_line(&rule->pattern, &rule->pattern_len, line, true);
+        break;
+      case ST_REPLACEMENT:
+        if (strcmp(line, "%%") == 0)
+          {
+            add_rule(rule);
+            rule = NULL;
+            state = ST_TOP;
+          }
+        else
+          add_rule_line(&rule->replacement, &rule->replacement_len, line, false);
+        break;
+      default:
+        xabort("load_rules()");
+      };
+    }
+  if (state == ST_PATTERN || state == ST_REPLACEMENT)
+    {
+      rules_error("unterminated rule");
+    }
+}
+
+static void free_items(item_t *item)
+{
+  while (item != NULL)
+    {
+      item_t *next = item->next;
+      free(item->text);
+      free(item->regex_src);
+      if (item->own_regex)
+        {
+          regfree(item->regex);
+          free(item->regex);
+        }
+      free(item);
+      item = next;
+    }
+}
+
+static void free_item_lines(item_t **lines, int len)
+{
+  int i;
+  for (i = 0; i < len; ++i)
+    {
+      free_items(lines[i]);
+    }
+  free(lines);
+}
+
+void free_rules()
+{
+  while (phases != NULL)
+    {
+      phase_t *next_phase = phases->next;
+      rule_t *rule = phases->rules;
+      while (rule != NULL)
+        {
+          rule_t *next = rule->next;
+          free_item_lines(rule->pattern, rule->pattern_len);
+          free_item_lines(rule->replacement, rule->replacement_len);
+          free(rule);
+          rule = next;
+        }
+      free_trie(phases->trie);
+      free(phases->wildcard.rules);
+      free(phases);
+      phases = next_phase;
+    }
+  last_phase = NULL;
+  while (defs != NULL)
+    {
+      def_t *next = defs->next;
+      if (defs->regex != NULL)
+        {
+          regfree(defs->regex);
+          free(defs->regex);
+        }
+      free(defs->name);
+      free(defs->value);
+      free(defs);
+      defs = next;
+    }
+  ignorecase = false;
+}
+
+/*****************************************************************************/
+/* Matching */
+
+static inline bool chr_eq(char c1, char c2)
+{
+  if (ignorecase)
+    return tolower((unsigned char) c1) == tolower((unsigned char) c2);
+  else
+    return c1 == c2;
+}
+
+static bool str_eq(const char *s1, const char *s2, int len)
+{
+  int i;
+  for (i = 0; i < len; ++i)
+    {
+      if (!chr_eq(s1[i], s2[i]))
+        return false;
+    }
+  return true;
+}
+
+/* Matches a text item at `s'. Returns the position after the match or
+   NULL. */
+static const char *match_text(const char *text, const char *s)
+{
+  while (*text != '\0')
+    {
+      if (isspace((unsigned char) *text))
+        {
+          text = skip_space(text);
+          s = skip_space(s);
+        }
+      else
+        {
+          if (!isalnum((unsigned char) *text))
+            s = skip_space(s);
+          if (!chr_eq(*text, *s))
+            return NULL;
+          ++text;
+          ++s;
+        }
+    }
+  return s;
+}
+
+static bool capture_ok(item_t *item, const char *s, int len)
+{
+  int i;
+  if (item->capture >= 0)
+    {
+      if (bound[item->capture] != NULL)
+        {
+          return bound_len[item->capture] == len &&
+            str_eq(bound[item->capture], s, len);
+        }
+      for (i = 0; i < MAX_CAPTURES; ++i)
+        {
+          if (bound[i] != NULL && bound_len[i] == len && str_eq(bound[i], s, len))
+            return false;
+        }
+    }
+  if (item->words)
+    {
+      // faster than the regex matcher
+      const char *w = item->regex_src;
+      while (*w != '\0')
+        {
+          const char *e = w;
+          while (*e != '|' && *e != '\0')
+            ++e;
+          if (e - w == len && str_eq(w, s, len))
+            return true;
+          w = (*e == '|') ? e + 1 : e;
+        }
+      return false;
+    }
+  else if (item->regex != NULL)
+    {
+      char buf[MAX_LINE_LEN + 1];
+      if (len > MAX_LINE_LEN)
+        return false;
+      memcpy(buf, s, len);
+      buf[len] = '\0';
+      return regexec(item->regex, buf, 0, NULL, 0) == 0;
+    }
+  return len > 0;
+}
+
+/* Tries to match the pattern lines of `rule' starting with line `k'
+   (from item `item' at position `s' of `line'). */
+static bool match(rule_t *rule, int k, item_t *item, const char *s, line_t *line)
+{
+  if (item == NULL)
+    {
+      if (*skip_space(s) != '\0')
+        return false;
+      if (k + 1 == rule->pattern_len)
+        return true;
+      line = line->next;
+      if (line == NULL)
+        return false;
+      return match(rule, k + 1, rule->pattern[k + 1], line->str, line);
+    }
+  else if (item->type == ITEM_TEXT)
+    {
+      s = match_text(item->text, s);
+      return s != NULL && match(rule, k, item->next, s, line);
+    }
+  else
+    {
+      const char *end;
+      char next_c = '\0'; // the character that must follow the capture
+      s = skip_space(s);
+      if (item->next != NULL && item->next->type == ITEM_TEXT)
+        next_c = *skip_space(item->next->text);
+      if (item->regex == NULL)
+        {
+          // operands do not contain commas
+          end = s;
+          while (*end != '\0' && *end != ',')
+            ++end;
+        }
+      else
+        {
+          end = s + strlen(s);
+        }
+      for (; end >= s; --end)
+        {
+          int len = end - s;
+          if (len > 0 && isspace((unsigned char) end[-1]))
+            continue;
+          // avoid running the regex matcher where the rest cannot match
+          if (item->next == NULL ? *skip_space(end) != '\0' :
+              next_c != '\0' && !chr_eq(*skip_space(end), next_c))
+            continue;
+          if (capture_ok(item, s, len))
+            {
+              bool was_bound = item->capture >= 0 && bound[item->capture] != NULL;
+              if (item->capture >= 0)
+                {
+                  bound[item->capture] = s;
+                  bound_len[item->capture] = len;
+                }
+              if (match(rule, k, item->next, end, line))
+                return true;
+              if (item->capture >= 0 && !was_bound)
+                bound[item->capture] = NULL;
+            }
+        }
+      return false;
+    }
+}
+
+/* Writes the replacement of a matched rule into `out' (lines
+   separated by newlines). Returns false if it does not fit. */
+static bool expand_replacement(rule_t *rule, char *out, int size)
+{
+  int i;
+  int n = 0;
+  for (i = 0; i < rule->replacement_len; ++i)
+    {
+      item_t *item = rule->replacement[i];
+      if (i > 0)
+        out[n++] = '\n';
+      while (item != NULL)
+        {
+          const char *str;
+          int len;
+          if (item->type == ITEM_TEXT)
+            {
+              str = item->text;
+              len = strlen(str);
+            }
+          else
+            {
+              str = bound[item->capture];
+              len = bound_len[item->capture];
+              if (str == NULL)
+                xabort("peephole rules: unbound capture in replacement");
+            }
+          if (n + len + 2 > size)
+            return false;
+          memcpy(out + n, str, len);
+          n += len;
+          item = item->next;
+        }
+    }
+  out[n] = '\0';
+  return true;
+}
+
+/* Tries the rules of `phase' at `line'. On success replaces the
+   matched lines, stores the line preceding the replacement (NULL if
+   the replacement is at the head) in `*pprev' and returns true. */
+static bool apply_rules(outbuf_t *buf, phase_t *phase, line_t *line, line_t **pprev)
+{
+  rule_vec_t *vecs[3];
+  int pos[3] = {0, 0, 0};
+  int vecs_num = 0;
+  const char *s = skip_space(line->str);
+  const char *e = s;
+  trie_node_t *node;
+
+  // find the candidate rules
+  vecs[vecs_num++] = &phase->wildcard;
+  while (is_opcode_chr(*e))
+    ++e;
+  if (e > s && (isspace((unsigned char) *e) || *e == '\0') &&
+      (node = trie_find(&phase->trie, s, e - s, false)) != NULL)
+    {
+      int operands = count_operands(e);
+      vecs[vecs_num++] = &node->any_operands;
+      if (operands <= MAX_OPERANDS)
+        vecs[vecs_num++] = &node->by_operands[operands];
+    }
+
+  // try them in the order of their indices
+  for (;;)
+    {
+      rule_t *rule = NULL;
+      int i;
+      int k = -1;
+      for (i = 0; i < vecs_num; ++i)
+        {
+          if (pos[i] < vecs[i]->size &&
+              (rule == NULL || vecs[i]->rules[pos[i]]->index < rule->index))
+            {
+              rule = vecs[i]->rules[pos[i]];
+              k = i;
+            }
+        }
+      if (rule == NULL)
+        break;
+      ++pos[k];
+      memset(bound, 0, sizeof(bound));
+      if (match(rule, 0, rule->pattern[0], line->str, line))
+        {
+          // the replacement may be longer than the pattern
+          char out[MAX_LINE_LEN * 8];
+          line_t *prev = line->prev;
+          int i;
+          // the captures point into the matched lines, so expand
+          // before removing them
+          if (!expand_replacement(rule, out, sizeof(out)))
+            continue;
+          for (i = 0; i < rule->pattern_len; ++i)
+            {
+              line_t *next = line->next;
+              removeln(buf, line);
+              line = next;
+            }
+          insertln(buf, prev, out);
+          *pprev = prev;
+          return true;
+        }
+    }
+  return false;
+}
+
+static void apply_phase(outbuf_t *buf, phase_t *phase)
+{
+  int lines_num = 0;
+  int rewrites_limit;
+  line_t *line = buf->head;
+  while (line != NULL)
+    {
+      ++lines_num;
+      line = line->next;
+    }
+  rewrites_limit = MAX_REWRITES_PER_LINE * (lines_num + 1);
+
+  line = buf->head;
+  while (line != NULL)
+    {
+      line_t *prev;
+      if (apply_rules(buf, phase, line, &prev))
+        {
+          int i;
+          if (--rewrites_limit == 0)
+            break;
+          // back up so that patterns overlapping the replacement are
+          // tried again
+          for (i = 1; i < phase->max_pattern_len && prev != NULL; ++i)
+            {
+              prev = prev->prev;
+            }
+          line = (prev == NULL) ? buf->head : prev;
+        }
+      else
+        {
+          line = line->next;
+        }
+    }
 }
 
 void peephole(outbuf_t *buf)
 {
+  phase_t *phase = phases;
+  flushbuf(buf);
+  while (phase != NULL)
+    {
+      apply_phase(buf, phase);
+      phase = phase->next;
+    }
 }
@@ -8,5 +8,6 @@
 
 void load_rules(FILE *fin);
 void peephole(outbuf_t *buf);
+void free_rules();
 
 #endif
@@ -0,0 +1,480 @@
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "utils.h"
+#include "quadr.h"
+#include "qbin.h"
+
+struct Qbin_writer{
+  FILE *fout;
+  uint64_t off; // the size of the file written so far
+  bool failed;
+  // the records of the functions written, indexed like quadr_func
+  qbin_func_t *funcs;
+  int funcs_size;
+  char *strs;
+  uint32_t strs_size;
+  uint32_t strs_cap;
+};
+
+static void put(qbin_writer_t *writer, const void *data, size_t size)
+{
+  if (size > 0 && fwrite(data, 1, size, writer->fout) != size)
+    writer->failed = true;
+  writer->off += size;
+}
+
+static void put_align(qbin_writer_t *writer)
+{
+  static const char zeros[8];
+  put(writer, zeros, (8 - writer->off % 8) % 8);
+}
+
+/* Returns the offset of an array of size bytes placed at *off, and
+   advances *off past it. */
+static uint64_t reserve(uint64_t *off, size_t size)
+{
+  uint64_t start = (*off + 7) & ~(uint64_t) 7;
+  *off = start + size;
+  return start;
+}
+
+static uint32_t add_pool_str(qbin_writer_t *writer, const char *str)
+{
+  size_t len = strlen(str) + 1;
+  uint32_t off = writer->strs_size;
+  if (writer->strs_size + len > writer->strs_cap)
+    {
+      writer->strs_cap = (writer->strs_size + len) * 2;
+      writer->strs = xrealloc(writer->strs, writer->strs_cap);
+    }
+  memcpy(writer->strs + off, str, len);
+  writer->strs_size += len;
+  return off;
+}
+
+qbin_writer_t *new_qbin_writer(FILE *fout)
+{
+  qbin_writer_t *writer = xmalloc(sizeof(qbin_writer_t));
+  qbin_header_t header;
+  writer->fout = fout;
+  writer->off = 0;
+  writer->failed = false;
+  writer->funcs = NULL;
+  writer->funcs_size = 0;
+  writer->strs = NULL;
+  writer->strs_size = 0;
+  writer->strs_cap = 0;
+  // filled in by qbin_finish()
+  memset(&header, 0, sizeof(header));
+  put(writer, &header, sizeof(header));
+  return writer;
+}
+
+// -------------------------------------------------------------------
+
+typedef struct{
+  unsigned id;
+  int index;
+} block_index_t;
+
+static int compare_block_ids(const void *x, const void *y)
+{
+  unsigned id1 = ((const block_index_t*) x)->id;
+  unsigned id2 = ((const block_index_t*) y)->id;
+  return id1 < id2 ? -1 : (id1 > id2 ? 1 : 0);
+}
+
+static int32_t find_block(block_index_t *index, int blocks_num, basic_block_t *block)
+{
+  block_index_t key, *found;
+  if (block == NULL)
+    return -1;
+  key.id = block->id;
+  found = bsearch(&key, index, blocks_num, sizeof(block_index_t), compare_block_ids);
+  assert (found != NULL);
+  return found->index;
+}
+
+static void convert_arg(qbin_writer_t *writer, quadr_arg_t *arg, qbin_arg_t *out,
+                        uint8_t *tag, block_index_t *index, int blocks_num)
+{
+  *tag = arg->tag;
+  memset(out, 0, sizeof(qbin_arg_t));
+  switch (arg->tag){
+  case QA_NONE:
+    break;
+  case QA_VAR:
+    out->index = arg->u.var->id;
+    break;
+  case QA_INT:
+    out->int_val = arg->u.int_val;
+    break;
+  case QA_DOUBLE:
+    out->double_val = arg->u.double_val;
+    break;
+  case QA_LABEL:
+    out->index = find_block(index, blocks_num, arg->u.label);
+    break;
+  case QA_FUNC:
+    out->index = arg->u.func - quadr_func;
+    break;
+  case QA_STR:
+    out->index = add_pool_str(writer, arg->u.str_val);
+    break;
+  default:
+    xabort("convert_arg()");
+  };
+}
+
+// vars_at_start of the block being written, collected by rb_for_each()
+static qbin_var_descr_t *cur_descrs;
+static int cur_descrs_num;
+
+static void collect_var_descr(rb_key_t key)
+{
+  var_descr_t *vd = (var_descr_t*) key;
+  cur_descrs[cur_descrs_num].var = vd->var->id;
+  cur_descrs[cur_descrs_num].nearest_use_dist = vd->nearest_use_dist;
+  ++cur_descrs_num;
+}
+
+static int compare_var_descrs(const void *x, const void *y)
+{
+  uint32_t id1 = ((const qbin_var_descr_t*) x)->var;
+  uint32_t id2 = ((const qbin_var_descr_t*) y)->var;
+  return id1 < id2 ? -1 : (id1 > id2 ? 1 : 0);
+}
+
+static void write_vars(qbin_writer_t *writer, quadr_func_t *func)
+{
+  qbin_var_t *vars = xmalloc(func->vars_num * sizeof(qbin_var_t) + 1);
+  vars_node_t *node;
+  int i;
+  memset(vars, 0, func->vars_num * sizeof(qbin_var_t));
+  for (node = func->vars_lst.head; node != NULL; node = node->next)
+    {
+      for (i = 0; i <= node->last_var; ++i)
+        {
+          var_t *var = &node->vars[i];
+          qbin_var_t *v = &vars[var->id];
+          assert (var->id < func->vars_num);
+          v->size = var->size;
+          v->qtype = var->qtype;
+          v->type = var->type->cons;
+          if (var->type->cons == TYPE_ARRAY)
+            {
+              array_type_t *type = (array_type_t*) var->type;
+              v->elem_type = type->basic_type->cons;
+              v->array_size = type->array_size;
+            }
+        }
+    }
+  put_align(writer);
+  put(writer, vars, func->vars_num * sizeof(qbin_var_t));
+  free(vars);
+}
+
+static void write_block_data(qbin_writer_t *writer, basic_block_t *block, qbin_block_t *rec,
+                             block_index_t *index, int blocks_num)
+{
+  quadr_t *quadr;
+  int i;
+  put_align(writer);
+  assert (writer->failed || writer->off == rec->quadrs);
+  for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+    {
+      qbin_quadr_t q;
+      memset(&q, 0, sizeof(q));
+      q.op = quadr->op;
+      convert_arg(writer, &quadr->result, &q.result, &q.result_tag, index, blocks_num);
+      convert_arg(writer, &quadr->arg1, &q.arg1, &q.arg1_tag, index, blocks_num);
+      convert_arg(writer, &quadr->arg2, &q.arg2, &q.arg2_tag, index, blocks_num);
+      put(writer, &q, sizeof(q));
+    }
+  put_align(writer);
+  for (i = 0; i < block->lsize; ++i)
+    {
+      uint32_t id = block->live_at_end[i]->id;
+      put(writer, &id, sizeof(id));
+    }
+  if (rec->start_num > 0)
+    {
+      cur_descrs = xmalloc(rec->start_num * sizeof(qbin_var_descr_t));
+      cur_descrs_num = 0;
+      rb_for_each(block->vars_at_start, collect_var_descr);
+      // the tree is ordered by addresses, which differ from run to run
+      qsort(cur_descrs, cur_descrs_num, sizeof(qbin_var_descr_t), compare_var_descrs);
+      put_align(writer);
+      put(writer, cur_descrs, rec->start_num * sizeof(qbin_var_descr_t));
+      free(cur_descrs);
+    }
+}
+
+void qbin_write_func(qbin_writer_t *writer, quadr_func_t *func)
+{
+  int func_index = func - quadr_func;
+  qbin_func_t *frec;
+  basic_block_t *block;
+  block_index_t *index;
+  qbin_block_t *recs;
+  int blocks_num, i;
+  uint64_t off;
+
+  if (func_index >= writer->funcs_size)
+    {
+      int size = writer->funcs_size;
+      writer->funcs_size = func_num;
+      writer->funcs = xrealloc(writer->funcs, writer->funcs_size * sizeof(qbin_func_t));
+      memset(writer->funcs + size, 0, (writer->funcs_size - size) * sizeof(qbin_func_t));
+    }
+  frec = &writer->funcs[func_index];
+
+  blocks_num = 0;
+  for (block = func->blocks; block != NULL; block = block->next)
+    ++blocks_num;
+  index = xmalloc(blocks_num * sizeof(block_index_t) + 1);
+  for (block = func->blocks, i = 0; block != NULL; block = block->next, ++i)
+    {
+      index[i].id = block->id;
+      index[i].index = i;
+    }
+  qsort(index, blocks_num, sizeof(block_index_t), compare_block_ids);
+
+  /* The layout: the variables, the block records, and then the
+     quadruples and the variable lists of each block. */
+  off = writer->off;
+  frec->vars_num = func->vars_num;
+  frec->vars = reserve(&off, func->vars_num * sizeof(qbin_var_t));
+  frec->blocks_num = blocks_num;
+  frec->blocks = reserve(&off, blocks_num * sizeof(qbin_block_t));
+  recs = xmalloc(blocks_num * sizeof(qbin_block_t) + 1);
+  memset(recs, 0, blocks_num * sizeof(qbin_block_t));
+  for (block = func->blocks, i = 0; block != NULL; block = block->next, ++i)
+    {
+      qbin_block_t *rec = &recs[i];
+      quadr_t *quadr;
+      rec->id = block->id;
+      rec->child1 = find_block(index, blocks_num, block->child1);
+      rec->child2 = find_block(index, blocks_num, block->child2);
+      for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+        ++rec->quadrs_num;
+      rec->quadrs = reserve(&off, rec->quadrs_num * sizeof(qbin_quadr_t));
+      rec->live_num = block->lsize;
+      rec->live = reserve(&off, block->lsize * sizeof(uint32_t));
+      rec->start_num = block->vars_at_start != NULL ? rb_size(block->vars_at_start) : 0;
+      rec->start = rec->start_num > 0 ?
+        reserve(&off, rec->start_num * sizeof(qbin_var_descr_t)) : 0;
+    }
+
+  write_vars(writer, func);
+  put_align(writer);
+  assert (writer->failed || writer->off == frec->blocks);
+  put(writer, recs, blocks_num * sizeof(qbin_block_t));
+  for (block = func->blocks, i = 0; block != NULL; block = block->next, ++i)
+    write_block_data(writer, block, &recs[i], index, blocks_num);
+  assert (writer->failed || writer->off == off);
+
+  free(recs);
+  free(index);
+}
+
+bool qbin_finish(qbin_writer_t *writer)
+{
+  qbin_header_t header;
+  bool success;
+  int i;
+  if (writer->funcs_size < func_num)
+    {
+      writer->funcs = xrealloc(writer->funcs, func_num * sizeof(qbin_func_t) + 1);
+      memset(writer->funcs + writer->funcs_size, 0,
+             (func_num - writer->funcs_size) * sizeof(qbin_func_t));
+      writer->funcs_size = func_num;
+    }
+  for (i = 0; i < func_num; ++i)
+    {
+      qbin_func_t *rec = &writer->funcs[i];
+      quadr_func_t *func = &quadr_func[i];
+      rec->name = add_pool_str(writer, func->name);
+      rec->tag = func->tag;
+      rec->return_type = func->type->return_type->cons;
+      rec->params_num = func->type->args_num;
+    }
+  memcpy(header.magic, QBIN_MAGIC, 4);
+  header.version = QBIN_VERSION;
+  header.funcs_num = func_num;
+  put_align(writer);
+  header.funcs = writer->off;
+  put(writer, writer->funcs, func_num * sizeof(qbin_func_t));
+  put_align(writer);
+  header.strs = writer->off;
+  header.strs_size = writer->strs_size;
+  put(writer, writer->strs, writer->strs_size);
+  put_align(writer);
+  header.size = writer->off;
+  header.pad = 0;
+  success = !writer->failed;
+  if (writer->off > UINT32_MAX)
+    {
+      fprintf(stderr, "the intermediate code file is too large\n");
+      success = false;
+    }
+  if (fseek(writer->fout, 0, SEEK_SET) != 0 ||
+      fwrite(&header, sizeof(header), 1, writer->fout) != 1)
+    {
+      success = false;
+    }
+  free(writer->funcs);
+  free(writer->strs);
+  free(writer);
+  return success;
+}
+
+// -------------------------------------------------------------------
+
+/* Whether an array of num elements of the given size at off lies in
+   the file and is aligned. */
+static bool in_file(const qbin_t *qbin, uint32_t off, uint64_t num, size_t size)
+{
+  return off % 8 == 0 && (uint64_t) off + num * size <= qbin->size;
+}
+
+static bool check_arg(const qbin_t *qbin, const qbin_func_t *func, uint8_t tag,
+                      const qbin_arg_t *arg)
+{
+  switch (tag){
+  case QA_NONE:
+  case QA_INT:
+  case QA_DOUBLE:
+    return true;
+  case QA_VAR:
+    return arg->index < func->vars_num;
+  case QA_LABEL:
+    return arg->index < func->blocks_num;
+  case QA_FUNC:
+    return arg->index < qbin->header->funcs_num;
+  case QA_STR:
+    return arg->index < qbin->header->strs_size;
+  default:
+    return false;
+  };
+}
+
+static bool check_func(const qbin_t *qbin, const qbin_func_t *func)
+{
+  const qbin_block_t *blocks;
+  uint32_t i, j;
+  if (func->name >= qbin->header->strs_size || func->tag > QF_ERROR)
+    return false;
+  if (func->blocks_num == 0)
+    return true;
+  if (!in_file(qbin, func->vars, func->vars_num, sizeof(qbin_var_t)) ||
+      !in_file(qbin, func->blocks, func->blocks_num, sizeof(qbin_block_t)))
+    return false;
+  blocks = qbin_blocks(qbin, func);
+  for (i = 0; i < func->blocks_num; ++i)
+    {
+      const qbin_block_t *block = &blocks[i];
+      const qbin_quadr_t *quadrs;
+      const uint32_t *live;
+      const qbin_var_descr_t *start;
+      if ((block->child1 != -1 && (block->child1 < 0 || block->child1 >= func->blocks_num)) ||
+          (block->child2 != -1 && (block->child2 < 0 || block->child2 >= func->blocks_num)) ||
+          !in_file(qbin, block->quadrs, block->quadrs_num, sizeof(qbin_quadr_t)) ||
+          (block->live_num > 0 &&
+           !in_file(qbin, block->live, block->live_num, sizeof(uint32_t))) ||
+          (block->start_num > 0 &&
+           !in_file(qbin, block->start, block->start_num, sizeof(qbin_var_descr_t))))
+        return false;
+      quadrs = qbin_quadrs(qbin, block);
+      for (j = 0; j < block->quadrs_num; ++j)
+        {
+          const qbin_quadr_t *q = &quadrs[j];
+          if (q->op >= Q_NONE ||
+              !check_arg(qbin, func, q->result_tag, &q->result) ||
+              !check_arg(qbin, func, q->arg1_tag, &q->arg1) ||
+              !check_arg(qbin, func, q->arg2_tag, &q->arg2))
+            return false;
+        }
+      live = qbin_live(qbin, block);
+      for (j = 0; j < block->live_num; ++j)
+        {
+          if (live[j] >= func->vars_num)
+            return false;
+        }
+      start = qbin_start(qbin, block);
+      for (j = 0; j < block->start_num; ++j)
+        {
+          if (start[j].var >= func->vars_num)
+            return false;
+        }
+    }
+  return true;
+}
+
+static bool check(const qbin_t *qbin)
+{
+  const qbin_header_t *header = qbin->header;
+  uint32_t i;
+  if (qbin->size < sizeof(qbin_header_t) ||
+      memcmp(header->magic, QBIN_MAGIC, 4) != 0 ||
+      header->version != QBIN_VERSION ||
+      header->size != qbin->size ||
+      !in_file(qbin, header->funcs, header->funcs_num, sizeof(qbin_func_t)) ||
+      !in_file(qbin, header->strs, header->strs_size, 1) ||
+      (header->strs_size > 0 && qbin->base[header->strs + header->strs_size - 1] != '\0'))
+    return false;
+  for (i = 0; i < header->funcs_num; ++i)
+    {
+      if (!check_func(qbin, &qbin_funcs(qbin)[i]))
+        return false;
+    }
+  return true;
+}
+
+qbin_t *qbin_open(const char *path)
+{
+  qbin_t *qbin;
+  struct stat st;
+  void *base;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) != 0)
+    {
+      perror(path);
+      if (fd >= 0)
+        close(fd);
+      return NULL;
+    }
+  if (st.st_size < (off_t) sizeof(qbin_header_t))
+    {
+      fprintf(stderr, "%s: not an intermediate code file\n", path);
+      close(fd);
+      return NULL;
+    }
+  base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    {
+      perror(path);
+      return NULL;
+    }
+  qbin = xmalloc(sizeof(qbin_t));
+  qbin->base = base;
+  qbin->size = st.st_size;
+  qbin->header = base;
+  if (!check(qbin))
+    {
+      fprintf(stderr, "%s: not a valid intermediate code file\n", path);
+      qbin_close(qbin);
+      return NULL;
+    }
+  return qbin;
+}
+
+void qbin_close(qbin_t *qbin)
+{
+  munmap((void*) qbin->base, qbin->size);
+  free(qbin);
+}
@@ -0,0 +1,153 @@
+/* qbin.h - binary format of the intermediate code (--icode-bin)
+
+   The file is meant to be mapped into memory and read in place: the
+   records have fixed sizes, start at offsets aligned to 8 bytes, and
+   refer to one another by file offsets and indices. Numbers are in
+   the byte order of the machine which wrote the file.
+
+   The file starts with the header, and contains:
+   - a function record for each declared function, builtins included,
+     in the order of declaration (QA_FUNC arguments are indices into
+     this array);
+   - for each function with code: its variables, indexed by their
+     ids; its blocks, in the order of the function's block list
+     (QA_LABEL arguments and the children of blocks are indices into
+     this array); and for each block, its quadruples, the ids of the
+     variables live at its end and its vars_at_start;
+   - the string pool: the names of the functions and the string
+     constants, each terminated by a zero byte. */
+
+#ifndef QBIN_H
+#define QBIN_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "quadr.h"
+
+#define QBIN_MAGIC "JLQB"
+#define QBIN_VERSION 1
+
+typedef struct{
+  char magic[4];
+  uint32_t version;
+  uint32_t size; // of the whole file
+  uint32_t funcs_num;
+  uint32_t funcs;
+  uint32_t strs;
+  uint32_t strs_size;
+  uint32_t pad;
+} qbin_header_t;
+
+typedef struct{
+  uint32_t name; // offset in the string pool
+  uint8_t tag; // quadr_func_tag_t
+  uint8_t return_type; // type_cons_t
+  uint16_t params_num;
+  uint32_t vars_num;
+  uint32_t vars;
+  uint32_t blocks_num; // 0 if the function has no code in the file
+  uint32_t blocks;
+} qbin_func_t;
+
+typedef struct{
+  int32_t size;
+  int32_t array_size;
+  uint8_t qtype; // var_type_t
+  uint8_t type; // type_cons_t
+  uint8_t elem_type; // type_cons_t of the elements of an array
+  uint8_t pad;
+} qbin_var_t;
+
+typedef struct{
+  uint32_t id;
+  int32_t child1, child2; // block indices, or -1
+  uint32_t quadrs_num;
+  uint32_t quadrs;
+  uint32_t live_num;
+  uint32_t live; // variable ids
+  uint32_t start_num;
+  uint32_t start; // qbin_var_descr_t records
+  uint32_t pad;
+} qbin_block_t;
+
+typedef struct{
+  uint32_t var;
+  uint32_t nearest_use_dist;
+} qbin_var_descr_t;
+
+typedef union{
+  int32_t int_val;
+  double double_val;
+  // variable id, block index, function index or string offset
+  uint32_t index;
+} qbin_arg_t;
+
+typedef struct{
+  uint8_t op; // quadr_op_t
+  uint8_t result_tag, arg1_tag, arg2_tag; // quadr_arg_type_t
+  uint32_t pad;
+  qbin_arg_t result, arg1, arg2;
+} qbin_quadr_t;
+
+/* Writing. The functions are written one at a time, as they are
+   compiled; the function records and the string pool go at the end
+   of the file, and the header is filled in last. */
+
+typedef struct Qbin_writer qbin_writer_t;
+
+qbin_writer_t *new_qbin_writer(FILE *fout);
+void qbin_write_func(qbin_writer_t *writer, quadr_func_t *func);
+/* Completes the file and frees the writer; the file is not closed.
+   Returns false on a write error. */
+bool qbin_finish(qbin_writer_t *writer);
+
+/* Reading */
+
+typedef struct{
+  const char *base;
+  size_t size;
+  const qbin_header_t *header;
+} qbin_t;
+
+/* Maps the file at path and checks it, so that all the offsets and
+   indices in it may be followed without further checks. Returns NULL
+   after printing a message if the file is not a valid qbin file. */
+qbin_t *qbin_open(const char *path);
+void qbin_close(qbin_t *qbin);
+
+inline static const qbin_func_t *qbin_funcs(const qbin_t *qbin)
+{
+  return (const qbin_func_t*) (qbin->base + qbin->header->funcs);
+}
+
+inline static const char *qbin_str(const qbin_t *qbin, uint32_t off)
+{
+  return qbin->base + qbin->header->strs + off;
+}
+
+inline static const qbin_var_t *qbin_vars(const qbin_t *qbin, const qbin_func_t *func)
+{
+  return (const qbin_var_t*) (qbin->base + func->vars);
+}
+
+inline static const qbin_block_t *qbin_blocks(const qbin_t *qbin, const qbin_func_t *func)
+{
+  return (const qbin_block_t*) (qbin->base + func->blocks);
+}
+
+inline static const qbin_quadr_t *qbin_quadrs(const qbin_t *qbin, const qbin_block_t *block)
+{
+  return (const qbin_quadr_t*) (qbin->base + block->quadrs);
+}
+
+inline static const uint32_t *qbin_live(const qbin_t *qbin, const qbin_block_t *block)
+{
+  return (const uint32_t*) (qbin->base + block->live);
+}
+
+inline static const qbin_var_descr_t *qbin_start(const qbin_t *qbin, const qbin_block_t *block)
+{
+  return (const qbin_var_descr_t*) (qbin->base + block->start);
+}
+
+#endif
@@ -0,0 +1,198 @@
+/* qbindump.c - prints a binary intermediate code file as text
+
+   usage: qbindump program.qbin
+
+   The text is that of --icode: compiling a program with both --icode
+   and --icode-bin and printing the binary file gives the same text
+   as the --icode file, which tests/test_qbin.sh checks. Every block
+   written to a binary file has its vars_at_start set, so "NULL" is
+   never printed for it. */
+
+#include <stdio.h>
+#include "utils.h"
+#include "quadr.h"
+#include "qbin.h"
+
+static const char *qtype_name(uint8_t qtype)
+{
+  static const char *names[] = { "byte", "int", "double", "array", "ptr", "str", "invalid" };
+  return qtype <= VT_INVALID ? names[qtype] : "?";
+}
+
+static const char *type_cons_name(uint8_t cons)
+{
+  static const char *names[] = { "void", "int", "double", "string", "boolean", "func", "array" };
+  return cons <= TYPE_ARRAY ? names[cons] : "?";
+}
+
+static void print_arg(const qbin_t *qbin, const qbin_func_t *func, uint8_t tag,
+                      const qbin_arg_t *arg)
+{
+  switch (tag){
+  case QA_INT:
+    printf("%d", arg->int_val);
+    break;
+  case QA_DOUBLE:
+    printf("%f", arg->double_val);
+    break;
+  case QA_VAR:
+    printf("v%u", arg->index);
+    break;
+  case QA_LABEL:
+    printf("b%u", qbin_blocks(qbin, func)[arg->index].id);
+    break;
+  case QA_FUNC:
+    printf("call %s", qbin_str(qbin, qbin_funcs(qbin)[arg->index].name));
+    break;
+  case QA_STR:
+    printf("\"%s\"", qbin_str(qbin, arg->index));
+    break;
+  default:
+    break;
+  };
+}
+
+static const char *if_op_str(uint8_t op)
+{
+  switch (op){
+  case Q_IF_EQ:
+    return " == ";
+  case Q_IF_NE:
+    return " != ";
+  case Q_IF_LT:
+    return " < ";
+  case Q_IF_GT:
+    return " > ";
+  case Q_IF_LE:
+    return " <= ";
+  case Q_IF_GE:
+    return " >= ";
+  default:
+    return NULL;
+  };
+}
+
+/* Prints a quadruple the way write_quadr() in quadr.c does. */
+static void print_quadr(const qbin_t *qbin, const qbin_func_t *func, const qbin_quadr_t *q)
+{
+  const char *if_op = if_op_str(q->op);
+  if (if_op != NULL)
+    {
+      printf("if ");
+      print_arg(qbin, func, q->arg1_tag, &q->arg1);
+      printf("%s", if_op);
+      print_arg(qbin, func, q->arg2_tag, &q->arg2);
+      printf(" goto ");
+      print_arg(qbin, func, q->result_tag, &q->result);
+      printf("\n");
+      return;
+    }
+  if (q->op == Q_WRITE_PTR)
+    printf("[");
+  else if (q->op == Q_GOTO)
+    printf("goto ");
+  print_arg(qbin, func, q->result_tag, &q->result);
+  if (q->op == Q_GET_ADDR)
+    printf(" := &");
+  else if (q->op == Q_WRITE_PTR)
+    printf(" + ");
+  else if (q->op == Q_READ_PTR)
+    printf(" := [");
+  else if (q->op == Q_RETURN)
+    printf("return ");
+  else if (q->op == Q_PARAM)
+    printf("param ");
+  else if (q->result_tag != QA_NONE && q->result_tag != QA_LABEL)
+    printf(" := ");
+  print_arg(qbin, func, q->arg1_tag, &q->arg1);
+  switch (q->op){
+  case Q_ADD:
+    printf(" + ");
+    break;
+  case Q_SUB:
+    printf(" - ");
+    break;
+  case Q_DIV:
+    printf(" / ");
+    break;
+  case Q_MUL:
+    printf(" * ");
+    break;
+  case Q_MOD:
+    printf(" %% ");
+    break;
+  case Q_READ_PTR:
+    printf(" + ");
+    break;
+  case Q_WRITE_PTR:
+    printf("] := ");
+    break;
+  default:
+    break;
+  };
+  print_arg(qbin, func, q->arg2_tag, &q->arg2);
+  if (q->op == Q_READ_PTR)
+    printf("]");
+  printf("\n");
+}
+
+static void print_func(const qbin_t *qbin, const qbin_func_t *func)
+{
+  const qbin_var_t *vars = qbin_vars(qbin, func);
+  const qbin_block_t *blocks = qbin_blocks(qbin, func);
+  uint32_t i, j;
+  printf("function %s\n", qbin_str(qbin, func->name));
+  printf("# vars:\n");
+  for (i = 0; i < func->vars_num; ++i)
+    {
+      printf("# v%u: %s, size %d, type %s", i, qtype_name(vars[i].qtype), vars[i].size,
+             type_cons_name(vars[i].type));
+      if (vars[i].type == TYPE_ARRAY)
+        printf(" of %s[%d]", type_cons_name(vars[i].elem_type), vars[i].array_size);
+      printf("\n");
+    }
+  for (i = 0; i < func->blocks_num; ++i)
+    {
+      const qbin_block_t *block = &blocks[i];
+      const qbin_quadr_t *quadrs = qbin_quadrs(qbin, block);
+      const uint32_t *live = qbin_live(qbin, block);
+      const qbin_var_descr_t *start = qbin_start(qbin, block);
+      printf("\nb%u:\n", block->id);
+      printf("# vars_at_start:\n");
+      for (j = 0; j < block->start_num; ++j)
+        printf("# var = v%u, nud = %d\n", start[j].var, (int) start[j].nearest_use_dist);
+      if (block->live_num > 0)
+        {
+          printf("#\n# live_at_end:\n");
+          for (j = 0; j < block->live_num; ++j)
+            printf("# v%u\n", live[j]);
+        }
+      else
+        printf("#\n# live_at_end: NULL\n");
+      for (j = 0; j < block->quadrs_num; ++j)
+        print_quadr(qbin, func, &quadrs[j]);
+    }
+  printf("function end\n\n");
+}
+
+int main(int argc, char **argv)
+{
+  qbin_t *qbin;
+  uint32_t i;
+  if (argc != 2)
+    {
+      fprintf(stderr, "usage: %s program.qbin\n", argv[0]);
+      return 2;
+    }
+  qbin = qbin_open(argv[1]);
+  if (qbin == NULL)
+    return 2;
+  for (i = 0; i < qbin->header->funcs_num; ++i)
+    {
+      const qbin_func_t *func = &qbin_funcs(qbin)[i];
+      if (func->blocks_num > 0)
+        print_func(qbin, func);
+    }
+  qbin_close(qbin);
+  return 0;
+}
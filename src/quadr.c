@@ -4,9 +4,7 @@
 #include "utils.h"
 #include "quadr.h"
 #include "tree.h"
-
-void free_func(quadr_func_t *func);
-void free_basic_block(basic_block_t *block);
+#include "flags.h"
 
 static void gen_copy(var_t *var, quadr_arg_t arg);
 static quadr_arg_t gen_quadr_expr(expr_t *node);
@@ -23,10 +21,12 @@ static pool_t *basic_block_pool = NULL;
 static basic_block_t *prev_block = NULL;
 static basic_block_t *cur_block = NULL;
 static quadr_func_t *cur_func = NULL;
-pool_t *var_descr_pool = NULL;
-pool_t *var_list_pool = NULL;
-
-static unsigned next_block_id = 0;
+static pool_t *var_descr_pool = NULL;
+static pool_t *var_list_pool = NULL;
+static __thread pool_cache_t quadr_cache;
+static __thread pool_cache_t basic_block_cache;
+__thread pool_cache_t var_descr_cache;
+__thread pool_cache_t var_list_cache;
 
 #define INIT_QUADRS 1024 * 32
 #define INIT_BASIC_BLOCKS 1024
@@ -39,8 +39,34 @@ void quadr_init()
   basic_block_pool = new_pool(INIT_BASIC_BLOCKS, sizeof(basic_block_t));
   var_descr_pool = new_pool(INIT_VAR_DESCR, sizeof(var_descr_t));
   var_list_pool = new_pool(INIT_VAR_LIST, sizeof(var_list_t));
+  quadr_pool->name = "quadruples";
+  basic_block_pool->name = "basic blocks";
+  var_descr_pool->name = "variable descriptors";
+  var_list_pool->name = "variable lists";
+  // the caches lock the pools only when functions are compiled in
+  // parallel
+  quadr_pool->shared = basic_block_pool->shared = f_jobs > 1;
+  var_descr_pool->shared = var_list_pool->shared = f_jobs > 1;
   func_cap = 512;
+  func_num = 0;
   quadr_func = xmalloc(sizeof(quadr_func_t) * func_cap);
+  quadr_thread_init();
+}
+
+void quadr_thread_init()
+{
+  init_pool_cache(&quadr_cache, quadr_pool);
+  init_pool_cache(&basic_block_cache, basic_block_pool);
+  init_pool_cache(&var_descr_cache, var_descr_pool);
+  init_pool_cache(&var_list_cache, var_list_pool);
+}
+
+void quadr_thread_cleanup()
+{
+  flush_pool_cache(&quadr_cache);
+  flush_pool_cache(&basic_block_cache);
+  flush_pool_cache(&var_descr_cache);
+  flush_pool_cache(&var_list_cache);
 }
 
 void quadr_cleanup()
@@ -51,6 +77,7 @@ void quadr_cleanup()
       free_func(&quadr_func[i]);
     }
   free(quadr_func);
+  quadr_thread_cleanup();
   free_pool(quadr_pool);
   free_pool(basic_block_pool);
   free_pool(var_descr_pool);
@@ -75,16 +102,18 @@ void free_func(quadr_func_t *func)
       free_basic_block(block);
       block = next;
     }
+  func->vars_lst.head = func->vars_lst.tail = NULL;
+  func->blocks = NULL;
 }
 
 inline quadr_t *alloc_quadr()
 {
-  return palloc(quadr_pool);
+  return pcalloc(&quadr_cache);
 }
 
 inline void free_quadr(quadr_t *quadr)
 {
-  pfree(quadr_pool, quadr);
+  pcfree(&quadr_cache, quadr);
 }
 
 quadr_t *new_quadr(quadr_op_t op, var_t *result, var_t *left, var_t *right)
@@ -146,7 +175,7 @@ quadr_t *new_copy_var_quadr(var_t *result, var_t *arg)
 
 inline static basic_block_t *alloc_basic_block()
 {
-  return palloc(basic_block_pool);
+  return pcalloc(&basic_block_cache);
 }
 
 inline static quadr_arg_t new_var(type_t *type)
@@ -494,7 +523,11 @@ static quadr_arg_t gen_quadr_expr(expr_t *node)
       quadr_t *quadr = alloc_quadr();
       quadr->op = Q_SUB;
       quadr->result = new_var(node->type);
-      quadr->arg1 = quadr_arg(node->type->cons, (node->type == type_double ? 0.0 : 0));
+      // the zero must be passed with the type quadr_arg() reads
+      if (node->type == type_double)
+        quadr->arg1 = quadr_arg(TYPE_DOUBLE, 0.0);
+      else
+        quadr->arg1 = quadr_arg(node->type->cons, 0);
       quadr->arg2 = gen_quadr_expr(((unary_t*) node)->arg);
       add_quadr(cur_block, quadr);
       return quadr->result;
@@ -788,6 +821,8 @@ quadr_func_t *declare_function(func_type_t *type, quadr_func_tag_t tag, const ch
   ++func_num;
   qf->type = type;
   qf->blocks = NULL;
+  qf->vars_num = 0;
+  qf->blocks_num = 0;
   qf->tag = tag;
   qf->name = name;
   if (tag == QF_USER_DEFINED)
@@ -829,6 +864,7 @@ var_t *declare_var(quadr_func_t *func, type_t *type)
   var = &node->vars[node->last_var];
   var->type = type;
   var->size = -1;
+  var->id = func->vars_num++;
   var->loc = NULL;
   var->live = false;
   switch (type->cons){
@@ -894,6 +930,12 @@ void add_basic_blocks(basic_block_t *blocks)
 }
 
 basic_block_t *new_basic_block()
+{
+  assert (cur_func != NULL);
+  return new_func_basic_block(cur_func);
+}
+
+basic_block_t *new_func_basic_block(quadr_func_t *func)
 {
   basic_block_t *block = alloc_basic_block();
   block->next = NULL;
@@ -905,19 +947,29 @@ basic_block_t *new_basic_block()
   block->lsize = 0;
   block->vars_at_start = NULL;
   block->flow_data = NULL;
-  block->id = next_block_id++;
+  block->ssa_data = NULL;
+  // the blocks of a function are numbered the same whichever thread
+  // creates them, so the output does not depend on the scheduling
+  block->id = func->blocks_num++;
   return block;
 }
 
 void free_basic_block(basic_block_t *block)
 {
+  quadr_t *quadr = block->lst.head;
+  while (quadr != NULL)
+    {
+      quadr_t *next = quadr->next;
+      free_quadr(quadr);
+      quadr = next;
+    }
   if (block->vars_at_start != NULL)
     {
       rb_for_each(block->vars_at_start, free_var_descr);
       rb_free(block->vars_at_start);
     }
   free(block->live_at_end);
-  pfree(basic_block_pool, block);
+  pcfree(&basic_block_cache, block);
 }
 
 void start_function(quadr_func_t *func)
@@ -998,7 +1050,7 @@ void free_var_list(var_list_t *x)
   while (x != NULL)
     {
       var_list_t *y = x->next;
-      pfree(var_list_pool, x);
+      pcfree(&var_list_cache, x);
       x = y;
     }
 }
@@ -1092,8 +1144,8 @@ var_list_t *vl_copy(var_list_t *vl)
 
 // ---------------------------------------------------------------
 
-short cur_visited_mark;
-basic_block_t *cur_root;
+__thread short cur_visited_mark;
+__thread basic_block_t *cur_root;
 
 void block_graph_zero_mark(basic_block_t *root)
 {
@@ -1121,7 +1173,12 @@ int nearest_use_distance_from_quadr(basic_block_t *block, quadr_t *quadr, var_t
         {
           return dist;
         }
-      assert (!(var->live && assigned_in_quadr(quadr, var)));
+      if (assigned_in_quadr(quadr, var))
+        {
+          // the variable may still be marked live if it dies in the
+          // current quadruple, but its value is never used again
+          return dist + INT_MAX / 64;
+        }
       ++dist;
       quadr = quadr->next;
     }
@@ -1156,7 +1213,7 @@ int nearest_use_distance_from_quadr(basic_block_t *block, quadr_t *quadr, var_t
 
 // ---------------------------------------------------------------
 
-static void write_arg(FILE *fout, quadr_arg_t *arg, var_t *var_base)
+static void write_arg(FILE *fout, quadr_arg_t *arg)
 {
   switch (arg->tag){
   case QA_INT:
@@ -1166,7 +1223,7 @@ static void write_arg(FILE *fout, quadr_arg_t *arg, var_t *var_base)
     fprintf(fout, "%f", arg->u.double_val);
     break;
   case QA_VAR:
-    fprintf(fout, "v%zu", arg->u.var - var_base);
+    fprintf(fout, "v%d", arg->u.var->id);
     break;
   case QA_LABEL:
     fprintf(fout, "b%u", arg->u.label->id);
@@ -1184,7 +1241,7 @@ static void write_arg(FILE *fout, quadr_arg_t *arg, var_t *var_base)
   };
 }
 
-static void write_quadr(FILE *fout, quadr_t *quadr, var_t *var_base)
+static void write_quadr(FILE *fout, quadr_t *quadr)
 {
   switch (quadr->op){
   case Q_WRITE_PTR:
@@ -1195,62 +1252,62 @@ static void write_quadr(FILE *fout, quadr_t *quadr, var_t *var_base)
     break;
   case Q_IF_EQ:
     fprintf(fout, "if ");
-    write_arg(fout, &quadr->arg1, var_base);
+    write_arg(fout, &quadr->arg1);
     fprintf(fout, " == ");
-    write_arg(fout, &quadr->arg2, var_base);
+    write_arg(fout, &quadr->arg2);
     fprintf(fout, " goto ");
-    write_arg(fout, &quadr->result, var_base);
+    write_arg(fout, &quadr->result);
     fprintf(fout, "\n");
     return;
   case Q_IF_NE:
     fprintf(fout, "if ");
-    write_arg(fout, &quadr->arg1, var_base);
+    write_arg(fout, &quadr->arg1);
     fprintf(fout, " != ");
-    write_arg(fout, &quadr->arg2, var_base);
+    write_arg(fout, &quadr->arg2);
     fprintf(fout, " goto ");
-    write_arg(fout, &quadr->result, var_base);
+    write_arg(fout, &quadr->result);
     fprintf(fout, "\n");
     return;
   case Q_IF_LT:
     fprintf(fout, "if ");
-    write_arg(fout, &quadr->arg1, var_base);
+    write_arg(fout, &quadr->arg1);
     fprintf(fout, " < ");
-    write_arg(fout, &quadr->arg2, var_base);
+    write_arg(fout, &quadr->arg2);
     fprintf(fout, " goto ");
-    write_arg(fout, &quadr->result, var_base);
+    write_arg(fout, &quadr->result);
     fprintf(fout, "\n");
     return;
   case Q_IF_GT:
     fprintf(fout, "if ");
-    write_arg(fout, &quadr->arg1, var_base);
+    write_arg(fout, &quadr->arg1);
     fprintf(fout, " > ");
-    write_arg(fout, &quadr->arg2, var_base);
+    write_arg(fout, &quadr->arg2);
     fprintf(fout, " goto ");
-    write_arg(fout, &quadr->result, var_base);
+    write_arg(fout, &quadr->result);
     fprintf(fout, "\n");
     return;
   case Q_IF_LE:
     fprintf(fout, "if ");
-    write_arg(fout, &quadr->arg1, var_base);
+    write_arg(fout, &quadr->arg1);
     fprintf(fout, " <= ");
-    write_arg(fout, &quadr->arg2, var_base);
+    write_arg(fout, &quadr->arg2);
     fprintf(fout, " goto ");
-    write_arg(fout, &quadr->result, var_base);
+    write_arg(fout, &quadr->result);
     fprintf(fout, "\n");
     return;
   case Q_IF_GE:
     fprintf(fout, "if ");
-    write_arg(fout, &quadr->arg1, var_base);
+    write_arg(fout, &quadr->arg1);
     fprintf(fout, " >= ");
-    write_arg(fout, &quadr->arg2, var_base);
+    write_arg(fout, &quadr->arg2);
     fprintf(fout, " goto ");
-    write_arg(fout, &quadr->result, var_base);
+    write_arg(fout, &quadr->result);
     fprintf(fout, "\n");
     return;
   default:
     break;
   };
-  write_arg(fout, &quadr->result, var_base);
+  write_arg(fout, &quadr->result);
   if (quadr->op == Q_GET_ADDR)
     fprintf(fout, " := &");
   else if (quadr->op == Q_WRITE_PTR)
@@ -1263,7 +1320,7 @@ static void write_quadr(FILE *fout, quadr_t *quadr, var_t *var_base)
     fprintf(fout, "param ");
   else if (quadr->result.tag != QA_NONE && quadr->result.tag != QA_LABEL)
     fprintf(fout, " := ");
-  write_arg(fout, &quadr->arg1, var_base);
+  write_arg(fout, &quadr->arg1);
   switch (quadr->op){
   case Q_ADD:
     fprintf(fout, " + ");
@@ -1289,31 +1346,47 @@ static void write_quadr(FILE *fout, quadr_t *quadr, var_t *var_base)
   default:
     break;
   };
-  write_arg(fout, &quadr->arg2, var_base);
+  write_arg(fout, &quadr->arg2);
   if (quadr->op == Q_READ_PTR)
     fprintf(fout, "]");
   fprintf(fout, "\n");
 }
 
-static FILE *cfout;
-static var_t *cvb;
+// vars_at_start of the block being written, collected by rb_for_each()
+static var_descr_t **cur_descrs;
+static int cur_descrs_num;
+
+static void collect_var_descr(rb_key_t key)
+{
+  cur_descrs[cur_descrs_num++] = (var_descr_t*) key;
+}
 
-static void write_var_descr(var_descr_t *vd)
+static int compare_var_descrs(const void *x, const void *y)
 {
-  fprintf(cfout, "# var = v%zu, nud = %d\n", vd->var - cvb, vd->nearest_use_dist);
+  int id1 = (*(var_descr_t *const *) x)->var->id;
+  int id2 = (*(var_descr_t *const *) y)->var->id;
+  return id1 < id2 ? -1 : (id1 > id2 ? 1 : 0);
 }
 
-static void write_block(FILE *fout, basic_block_t *block, var_t *var_base)
+static void write_block(FILE *fout, basic_block_t *block)
 {
   int i;
   quadr_t *quadr;
   fprintf(fout, "\nb%u:\n", block->id);
   if (block->vars_at_start != NULL)
     {
-      cvb = var_base;
-      cfout = fout;
       fprintf(fout, "# vars_at_start:\n");
-      rb_for_each(block->vars_at_start, write_var_descr);
+      cur_descrs = xmalloc(rb_size(block->vars_at_start) * sizeof(var_descr_t*) + 1);
+      cur_descrs_num = 0;
+      rb_for_each(block->vars_at_start, collect_var_descr);
+      // the tree is ordered by addresses, which differ from run to run
+      qsort(cur_descrs, cur_descrs_num, sizeof(var_descr_t*), compare_var_descrs);
+      for (i = 0; i < cur_descrs_num; ++i)
+        {
+          fprintf(fout, "# var = v%d, nud = %d\n", cur_descrs[i]->var->id,
+                  cur_descrs[i]->nearest_use_dist);
+        }
+      free(cur_descrs);
     }
   else
     fprintf(fout, "# vars_at_start: NULL\n");
@@ -1322,7 +1395,7 @@ static void write_block(FILE *fout, basic_block_t *block, var_t *var_base)
       fprintf(fout, "#\n# live_at_end:\n");
       for (i = 0; i < block->lsize; ++i)
         {
-          fprintf(fout, "# v%zu\n", block->live_at_end[i] - var_base);
+          fprintf(fout, "# v%d\n", block->live_at_end[i]->id);
         }
     }
   else
@@ -1330,19 +1403,64 @@ static void write_block(FILE *fout, basic_block_t *block, var_t *var_base)
   quadr = block->lst.head;
   while (quadr != NULL)
     {
-      write_quadr(fout, quadr, var_base);
+      write_quadr(fout, quadr);
       quadr = quadr->next;
     }
 }
 
+static const char *qtype_name(var_type_t qtype)
+{
+  static const char *names[] = { "byte", "int", "double", "array", "ptr", "str", "invalid" };
+  return names[qtype];
+}
+
+static const char *type_cons_name(type_cons_t cons)
+{
+  static const char *names[] = { "void", "int", "double", "string", "boolean", "func", "array" };
+  return names[cons];
+}
+
+static void write_vars(FILE *fout, quadr_func_t *func)
+{
+  var_t **vars = xmalloc(func->vars_num * sizeof(var_t*) + 1);
+  vars_node_t *node;
+  int i;
+  memset(vars, 0, func->vars_num * sizeof(var_t*));
+  for (node = func->vars_lst.head; node != NULL; node = node->next)
+    {
+      for (i = 0; i <= node->last_var; ++i)
+        {
+          assert (node->vars[i].id < func->vars_num);
+          vars[node->vars[i].id] = &node->vars[i];
+        }
+    }
+  fprintf(fout, "# vars:\n");
+  for (i = 0; i < func->vars_num; ++i)
+    {
+      var_t *var = vars[i];
+      if (var == NULL)
+        continue;
+      fprintf(fout, "# v%d: %s, size %d, type %s", i, qtype_name(var->qtype), var->size,
+              type_cons_name(var->type->cons));
+      if (var->type->cons == TYPE_ARRAY)
+        {
+          array_type_t *type = (array_type_t*) var->type;
+          fprintf(fout, " of %s[%d]", type_cons_name(type->basic_type->cons), type->array_size);
+        }
+      fprintf(fout, "\n");
+    }
+  free(vars);
+}
+
 void write_quadr_func(FILE *fout, quadr_func_t *func)
 {
   basic_block_t *block;
   fprintf(fout, "function %s\n", func->name);
+  write_vars(fout, func);
   block = func->blocks;
   while (block != NULL)
     {
-      write_block(fout, block, func->vars_lst.head->vars);
+      write_block(fout, block);
       block = block->next;
     }
   fprintf(fout, "function end\n\n");
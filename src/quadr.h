@@ -22,6 +22,7 @@ typedef struct Quadr_var{
   type_t *type;
   struct Location *loc; // current locations of the variable
   int size; // size in bytes
+  int id; // the number of the variable in its function
   bool live;
   var_type_t qtype;
   // the type of the variable in quadruple code; may be different from
@@ -120,6 +121,7 @@ typedef struct{
 } var_descr_t;
 
 struct Flow_data;
+struct Ssa_data;
 
 // whether code has been generated for the block
 #define MARK_GENERATED   0x01
@@ -133,8 +135,8 @@ typedef struct Basic_block{
                        // basic block
   int lsize; // size of the above array
   unsigned id; 
-  // a unique block id; not strictly necessary, but the output looks
-  // nicer with it (labels are shorter)
+  // the number of the block in its function; not strictly necessary,
+  // but the output looks nicer with it (labels are shorter)
   rbtree_t *vars_at_start;
   /* vars_at_start - information about live variable at the entrance
      to the block; all variables that are live at the start of the
@@ -145,6 +147,8 @@ typedef struct Basic_block{
   // flow_data - data used only by the data flow analysis and related
   // global optimisations
   struct Flow_data *flow_data;
+  // ssa_data - dominators and phi functions while in SSA form (ssa.h)
+  struct Ssa_data *ssa_data;
   unsigned short visited_mark;
   char mark;
 } basic_block_t;
@@ -168,6 +172,8 @@ typedef struct Quadr_func{
   func_type_t *type;
   basic_block_t *blocks;
   vars_list_t vars_lst;
+  int vars_num; // the number of variables declared in the function
+  unsigned blocks_num; // the number of block ids given out in the function
   const char *name;
   quadr_func_tag_t tag;
 } quadr_func_t;
@@ -177,6 +183,12 @@ typedef struct Quadr_func{
 
 void quadr_init();
 void quadr_cleanup();
+/* The quadruples, blocks and variable lists are allocated from pools
+   shared by all threads, through per-thread caches. Every thread
+   other than the main one that allocates or frees them must call
+   quadr_thread_init() first and quadr_thread_cleanup() when done. */
+void quadr_thread_init();
+void quadr_thread_cleanup();
 
 quadr_t *alloc_quadr();
 void free_quadr(quadr_t *quadr);
@@ -211,6 +223,9 @@ extern quadr_func_t *quadr_func;
 extern int func_num; // the number of functions declared - 1
 
 quadr_func_t *declare_function(func_type_t *type, quadr_func_tag_t tag, const char *name);
+/* Frees the code and the variables of a function. The function itself
+   stays declared. */
+void free_func(quadr_func_t *func);
 /* Declares a new variable of type `type' in `func'. */
 var_t *declare_var(quadr_func_t *func, type_t *type);
 /* Same as above, but declares in the current function. */
@@ -220,7 +235,12 @@ var_t *declare_var0(type_t *type);
    of blocks of the current function, and the last of these blocks
    becomes the current block. */
 void add_basic_blocks(basic_block_t *blocks);
+/* new_basic_block() creates a block of the current function,
+   new_func_basic_block() one of func, which need not be current. */
 basic_block_t *new_basic_block();
+basic_block_t *new_func_basic_block(quadr_func_t *func);
+/* Frees a block together with its quadruples and live sets. */
+void free_basic_block(basic_block_t *block);
 /* Starts function func. func should be declared earlier with
    declare_function(); Starts a new basic block as well. */
 void start_function(quadr_func_t *func);
@@ -265,17 +285,17 @@ type_t *arg_type(quadr_arg_t *arg);
 /* var_descr_t allocation */
 
 // variables needed only for inlining to work
-extern pool_t *var_descr_pool;
-extern pool_t *var_list_pool;
+extern __thread pool_cache_t var_descr_cache;
+extern __thread pool_cache_t var_list_cache;
 
 inline static var_descr_t *new_var_descr()
 {
-  return (var_descr_t*) palloc(var_descr_pool);
+  return (var_descr_t*) pcalloc(&var_descr_cache);
 }
 
 inline static void free_var_descr(var_descr_t *vd)
 {
-  pfree(var_descr_pool, vd);
+  pcfree(&var_descr_cache, vd);
 }
 
 // -------------------------------------------------
@@ -284,7 +304,7 @@ inline static void free_var_descr(var_descr_t *vd)
 
 inline static var_list_t *new_var_list()
 {
-  return (var_list_t*) palloc(var_list_pool);
+  return (var_list_t*) pcalloc(&var_list_cache);
 }
 
 void free_var_list(var_list_t *x);
@@ -298,8 +318,8 @@ var_list_t *vl_copy(var_list_t *vl);
 
 /* Basic-block graph traversal. */
 
-extern short cur_visited_mark;
-extern basic_block_t *cur_root;
+extern __thread short cur_visited_mark;
+extern __thread basic_block_t *cur_root;
 
 #define set_root(root) { cur_visited_mark = 0; cur_root = root; }
 #define begin_traversal() { if (++cur_visited_mark == 0) { block_graph_zero_mark(cur_root); } }
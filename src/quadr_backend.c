@@ -10,15 +10,15 @@
  * swaps - their values are not tracked
  */
 
-static outbuf_t *outbuf;
+static __thread outbuf_t *outbuf;
 
 // -------------------------------------------------------------------
 
 #define MAX_STR_LEN 256
 #define MAX_CTS 36
 
-static char tmp_str[MAX_CTS][MAX_STR_LEN + 1];
-static int cts = 0;
+static __thread char tmp_str[MAX_CTS][MAX_STR_LEN + 1];
+static __thread int cts = 0;
 
 static const char *loc_str(loc_t *loc)
 {
@@ -39,7 +39,8 @@ static const char *loc_str(loc_t *loc)
     snprintf(tmp_str[cts], MAX_STR_LEN, "%d", loc->u.int_val);
     return tmp_str[cts++];
   case LOC_DOUBLE:
-    snprintf(tmp_str[cts], MAX_STR_LEN, "%f", loc->u.double_val);
+    // exact, and always with a point, which tells it from an int
+    snprintf(tmp_str[cts], MAX_STR_LEN, "%#.17g", loc->u.double_val);
     return tmp_str[cts++];
   case LOC_REG:
     snprintf(tmp_str[cts], MAX_STR_LEN, "$.i%d", (int)loc->u.reg + 3);
@@ -48,7 +49,7 @@ static const char *loc_str(loc_t *loc)
     snprintf(tmp_str[cts], MAX_STR_LEN, "$.d%d", (int)loc->u.fpu_reg + 3);
     return tmp_str[cts++];
   case LOC_STACK:
-    snprintf(tmp_str[cts], MAX_STR_LEN, "{@FP@%d@}", loc->u.stack_elem->offset);
+    snprintf(tmp_str[cts], MAX_STR_LEN, "{%s}", stack_ref(outbuf, loc->u.stack_elem->offset));
     return tmp_str[cts++];
   default:
     xabort("programming error - loc_str()");
@@ -81,7 +82,7 @@ static const char *if_op_str(quadr_op_t op)
 
 inline static void gen_return()
 {
-  writeln(outbuf, "@E@");
+  write_epilogue(outbuf);
   writeln(outbuf, "return");
 }
 
@@ -105,12 +106,21 @@ static const char *type_to_str(type_cons_t cons)
 
 // -------------------------------------------------------------------
 
-static void init()
+static const char *init()
 {
-  outbuf = new_outbuf();
+  return NULL;
 }
 
 static void final()
+{
+}
+
+static void init_thread()
+{
+  outbuf = new_outbuf();
+}
+
+static void final_thread()
 {
   free_outbuf(outbuf);
 }
@@ -135,7 +145,7 @@ static void start_func(quadr_func_t *func)
     {
       writeln(outbuf, "$.i0 := 0");
     }
-  writeln(outbuf, "@P@");
+  write_prologue(outbuf);
 
   assert (func->vars_lst.head != NULL);
   assert (params_num <= func->vars_lst.head->last_var + 1);
@@ -162,8 +172,8 @@ static void end_func(quadr_func_t *func, size_t stack_size)
       prologue[0] = '\0';
       epilogue[0] = '\0';
     }
-  fix_stack(outbuf, stack_size, prologue, epilogue, "$.i0 - %zu");
-  writeout(outbuf, backend->fout);
+  fix_stack(outbuf, stack_size, prologue, epilogue, "$.i0 - %d");
+  writeout(outbuf, gencode_fout);
   clearbuf(outbuf);
 }
 
@@ -206,7 +216,7 @@ static void end_func(quadr_func_t *func, size_t stack_size)
       discard_var(var1);                                                \
     if (var2 != NULL && !var2->live)                                    \
       discard_var(var2);                                                \
-    flush_loc(loc0);                                                    \
+    flush_loc_keeping(loc0, loc1, loc2);                                \
     update_var_loc(var0, loc0);                                         \
     var0->live = true;                                                  \
     assert (loc0 == NULL || loc0->next == NULL);                        \
@@ -288,31 +298,25 @@ static void gen_code(quadr_t *quadr)
       if (var0->loc == NULL)
         {
           loc0 = NULL;
+          // the result may be of a different type than the arguments
+          // (Q_READ_PTR), so only a register of its own kind is reused
           if (var1 != NULL && !live1)
             {
               loc0 = std_find_best_dest_loc(var1);
-              if (loc0 != NULL && !loc_is_reg(loc0))
+              if (loc0 != NULL && loc0->tag != reg_type(var0))
                 loc0 = NULL;
             }
 
           if (var2 != NULL && !live2)
             {
               loc0 = std_find_best_dest_loc(var2);
-              if (loc0 != NULL && !loc_is_reg(loc0))
+              if (loc0 != NULL && loc0->tag != reg_type(var0))
                 loc0 = NULL;
             }
 
           if (loc0 == NULL)
             {
-              if (qtype == VT_INT || qtype == VT_PTR || qtype == VT_ARRAY)
-                {
-                  loc0 = alloc_reg(LOC_REG);
-                }
-              else
-                {
-                  assert (qtype == VT_DOUBLE);
-                  loc0 = alloc_reg(LOC_FPU_REG);
-                }
+              loc0 = alloc_reg(reg_type(var0));
               should_free_loc0 = true;
             }
         }
@@ -462,6 +466,12 @@ static void gen_code(quadr_t *quadr)
   case Q_WRITE_PTR:
     {
       assert (var0 != NULL);
+      // a pointer live across blocks may have been saved to the stack
+      loc0 = std_find_best_src_loc(var0);
+      if (!loc_is_reg(loc0))
+        {
+          move_to_reg(var0);
+        }
       if (loc1->tag != LOC_INT)
         { // non-const offset
           loc_t *loc = alloc_reg(LOC_REG);
@@ -484,9 +494,9 @@ static void gen_code(quadr_t *quadr)
           loc0 = std_find_best_src_loc(var0);
           int off = loc1->u.int_val * var2->size;
           if (off >= 0)
-            writeln(outbuf, "{%s + %d} := %s", loc_str(loc0), off);
+            writeln(outbuf, "{%s + %d} := %s", loc_str(loc0), off, loc_str(loc2));
           else
-            writeln(outbuf, "{%s - %d} := %s", loc_str(loc0), -off);
+            writeln(outbuf, "{%s - %d} := %s", loc_str(loc0), -off, loc_str(loc2));
         }
       break;
     }
@@ -501,7 +511,7 @@ static void gen_code(quadr_t *quadr)
       assert (loc0->tag == LOC_REG);
       assert (loc1->tag == LOC_STACK);
       update_locations(loc0);
-      writeln(outbuf, "%s := @FP@%d@", loc_str(loc0), loc1->u.stack_elem->offset);
+      writeln(outbuf, "%s := %s", loc_str(loc0), stack_ref(outbuf, loc1->u.stack_elem->offset));
       break;
     }
   default:
@@ -590,10 +600,11 @@ static void gen_call(quadr_func_t *func, var_list_t *args, var_t *retvar)
   case QF_USER_DEFINED:
     {
       int count = 0;
+      var_list_t *lst;
       reverse_list(args);
-      while (args != NULL)
+      for (lst = args; lst != NULL; lst = lst->next)
         {
-          var_t *var = args->var;
+          var_t *var = lst->var;
           loc_t *loc = std_find_best_src_loc(var);
           if (loc->tag == LOC_STACK)
             {
@@ -602,7 +613,6 @@ static void gen_call(quadr_func_t *func, var_list_t *args, var_t *retvar)
             }
           writeln(outbuf, "{$.i0 + %d} := %s", count, loc_str(loc));
           ++count;
-          args = args->next;
         }
       discard_dead_vars(args);
       free_all(LOC_REG);
@@ -613,6 +623,7 @@ static void gen_call(quadr_func_t *func, var_list_t *args, var_t *retvar)
       if (retvar != NULL)
         {
           loc_t sloc;
+          discard_var(retvar);
           init_loc(&sloc, reg_type(retvar), 0);
           update_var_loc(retvar, &sloc);
         }
@@ -623,9 +634,23 @@ static void gen_call(quadr_func_t *func, var_list_t *args, var_t *retvar)
   };
 }
 
+/* The string is written with C escapes, so that it stays on one
+   line. */
 static void gen_print_string(const char *str)
 {
-  writeln(outbuf, "print \"%s\"", str);
+  write(outbuf, "print \"");
+  for (; *str != '\0'; ++str)
+    {
+      if (*str == '"' || *str == '\\')
+        write(outbuf, "\\%c", *str);
+      else if (*str == '\n')
+        write(outbuf, "\\n");
+      else if ((unsigned char) *str < ' ')
+        write(outbuf, "\\%03o", *str);
+      else
+        write(outbuf, "%c", *str);
+    }
+  writeln(outbuf, "\"");
 }
 
 static void gen_mov(loc_t *dest, var_t *src)
@@ -688,6 +713,8 @@ backend_t *new_quadr_backend()
   backend_t *qback = xmalloc(sizeof(backend_t));
   qback->init = init;
   qback->final = final;
+  qback->init_thread = init_thread;
+  qback->final_thread = final_thread;
   qback->start_func = start_func;
   qback->end_func = end_func;
   qback->gen_code = gen_code;
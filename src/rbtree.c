@@ -23,6 +23,8 @@ static void rb_do_insert(rbtree_t* tree, rb_key_t x, size_t depth);
 
 /* ------------- private ------------------ */
 
+/* The sentinel is shared by all trees and never modified, so trees
+   may be used by different threads at the same time. */
 static rbnode_t the_nil = { 0, 0, 0, rb_black };
 
 static void 
@@ -79,20 +81,19 @@ rb_left_rotate(rbtree_t* tree, rbnode_t* node, rbnode_t* parent)
   rbnode_t* b = r->left;
   r->left = node;
   node->right = b;
-  if (parent->left == node)
+  if (node == tree->root)
+    {
+      tree->root = r;
+    }
+  else if (parent->left == node)
     {
       parent->left = r;
     }
   else
     {
-      /* assert (parent->right == node); this may be false if node is
-	 the root */
+      assert (parent->right == node);
       parent->right = r;
     }
-  if (node == tree->root)
-    {
-      tree->root = r;
-    }
 }
 
 static void
@@ -102,20 +103,19 @@ rb_right_rotate(rbtree_t* tree, rbnode_t* node, rbnode_t* parent)
   rbnode_t* b = l->right;
   l->right = node;
   node->left = b;
-  if (parent->left == node)
+  if (node == tree->root)
+    {
+      tree->root = l;
+    }
+  else if (parent->left == node)
     {
       parent->left = l;
     }
   else
     {
-      /* assert (parent->right == node); this may be false if node is
-	 the root */
+      assert (parent->right == node);
       parent->right = l;
     }
-  if (node == tree->root)
-    {
-      tree->root = l;
-    }
 }
 
 static void 
@@ -332,7 +332,8 @@ rb_delete_fixup(rbtree_t* tree, rbnode_t* node, size_t depth)
 	    }
 	}
     }
-  node->color = rb_black;
+  if (node != tree->nil)
+    node->color = rb_black;
 }
 
 static void 
@@ -470,9 +471,8 @@ rbnode_t*
 rb_search(rbtree_t* tree, rb_key_t x)
 {
   rbnode_t* node;
-  tree->nil->key = x;
   node = tree->root;
-  while (!rb_cmp_eq(x, node->key))
+  while (node != tree->nil && !rb_cmp_eq(x, node->key))
     {
       if (rb_cmp_less(x, node->key))
 	{
@@ -536,9 +536,8 @@ rb_insert_if_absent(rbtree_t* tree, rb_key_t x)
     }
   stack = tree->stack;
   stack[0] = nil;
-  nil->key = x;
   node = tree->root;
-  while (!rb_cmp_eq(x, node->key))
+  while (node != nil && !rb_cmp_eq(x, node->key))
     {
       assert(depth + 1 <= tree->bh << 1);
       stack[++depth] = node;
@@ -574,9 +573,8 @@ rb_delete(rbtree_t* tree, rb_key_t x)
     }
   stack = tree->stack;
   stack[0] = tree->nil;
-  tree->nil->key = x;
   node = tree->root;
-  while (!rb_cmp_eq(x, node->key))
+  while (node != tree->nil && !rb_cmp_eq(x, node->key))
     {
       assert(depth + 1 <= tree->bh << 1);
       stack[++depth] = node;
@@ -0,0 +1,1217 @@
+/* ssa.c - construction and destruction of the SSA form */
+
+#include "utils.h"
+#include "bitset.h"
+#include "ssa.h"
+#include "stats.h"
+
+inline static ssa_data_t *new_ssa_data()
+{
+  ssa_data_t *sd = xmalloc(sizeof(ssa_data_t));
+  sd->index = -1;
+  sd->preds = NULL;
+  sd->preds_num = 0;
+  sd->idom = NULL;
+  sd->dom_children = NULL;
+  sd->dom_children_num = 0;
+  sd->dom_pre = sd->dom_post = 0;
+  sd->df = NULL;
+  sd->df_num = sd->df_cap = 0;
+  sd->phis = NULL;
+  sd->dfs_child = 0;
+  return sd;
+}
+
+static void free_ssa_data(ssa_data_t *sd)
+{
+  phi_t *phi = sd->phis;
+  while (phi != NULL)
+    {
+      phi_t *next = phi->next;
+      free(phi->args);
+      free(phi);
+      phi = next;
+    }
+  free(sd->preds);
+  free(sd->dom_children);
+  free(sd->df);
+  free(sd);
+}
+
+/* Returns the position of pred on the predecessor list of block. */
+static int pred_index(basic_block_t *block, basic_block_t *pred)
+{
+  ssa_data_t *sd = block->ssa_data;
+  int i;
+  for (i = 0; i < sd->preds_num; ++i)
+    {
+      if (sd->preds[i] == pred)
+        return i;
+    }
+  xabort("programming error - pred_index");
+  return -1;
+}
+
+// -------------------------------------------------------------------
+
+/* Computes the blocks reachable from root in postorder, without
+   recursion. Returns the number of the blocks stored in order. */
+static int compute_postorder(basic_block_t *root, basic_block_t **order)
+{
+  basic_block_t **stack;
+  int sp = 0, n = 0, size = 64;
+  stack = xmalloc(size * sizeof(basic_block_t*));
+  begin_traversal();
+  visit(root);
+  stack[sp++] = root;
+  while (sp > 0)
+    {
+      basic_block_t *block = stack[sp - 1];
+      ssa_data_t *sd = block->ssa_data;
+      basic_block_t *child = NULL;
+      while (child == NULL && sd->dfs_child < 2)
+        {
+          child = (sd->dfs_child == 0 ? block->child1 : block->child2);
+          ++sd->dfs_child;
+          if (child != NULL && visited(child))
+            child = NULL;
+        }
+      if (child != NULL)
+        {
+          visit(child);
+          if (sp == size)
+            {
+              size <<= 1;
+              stack = xrealloc(stack, size * sizeof(basic_block_t*));
+            }
+          stack[sp++] = child;
+        }
+      else
+        {
+          order[n++] = block;
+          --sp;
+        }
+    }
+  free(stack);
+  return n;
+}
+
+static void add_pred(basic_block_t *block, basic_block_t *pred)
+{
+  ssa_data_t *sd = block->ssa_data;
+  sd->preds = xrealloc(sd->preds, (sd->preds_num + 1) * sizeof(basic_block_t*));
+  sd->preds[sd->preds_num++] = pred;
+}
+
+static basic_block_t *intersect(basic_block_t *a, basic_block_t *b)
+{
+  while (a != b)
+    {
+      while (a->ssa_data->index > b->ssa_data->index)
+        a = a->ssa_data->idom;
+      while (b->ssa_data->index > a->ssa_data->index)
+        b = b->ssa_data->idom;
+    }
+  return a;
+}
+
+/* Computes the immediate dominators with the iterative algorithm of
+   Cooper, Harvey and Kennedy: in reverse postorder, the dominator of
+   a block is the nearest common dominator of its processed
+   predecessors. */
+static void compute_dominators(ssa_t *ssa)
+{
+  basic_block_t *root = ssa->blocks[0];
+  bool changed = true;
+  int i, j;
+  root->ssa_data->idom = root;
+  while (changed)
+    {
+      changed = false;
+      for (i = 1; i < ssa->blocks_num; ++i)
+        {
+          basic_block_t *block = ssa->blocks[i];
+          ssa_data_t *sd = block->ssa_data;
+          basic_block_t *idom = NULL;
+          for (j = 0; j < sd->preds_num; ++j)
+            {
+              basic_block_t *pred = sd->preds[j];
+              if (pred->ssa_data->idom != NULL)
+                idom = (idom == NULL ? pred : intersect(pred, idom));
+            }
+          if (sd->idom != idom)
+            {
+              sd->idom = idom;
+              changed = true;
+            }
+        }
+    }
+  root->ssa_data->idom = NULL;
+}
+
+/* Numbers the nodes of the dominator tree in a depth-first walk, for
+   dominates(). */
+static void number_dom_tree(ssa_t *ssa)
+{
+  basic_block_t **stack;
+  int sp = 0, num = 0, i;
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      ssa->blocks[i]->ssa_data->dfs_child = 0;
+    }
+  stack = xmalloc(ssa->blocks_num * sizeof(basic_block_t*));
+  stack[sp++] = ssa->blocks[0];
+  ssa->blocks[0]->ssa_data->dom_pre = num++;
+  while (sp > 0)
+    {
+      ssa_data_t *sd = stack[sp - 1]->ssa_data;
+      if (sd->dfs_child < sd->dom_children_num)
+        {
+          basic_block_t *child = sd->dom_children[sd->dfs_child++];
+          child->ssa_data->dom_pre = num++;
+          stack[sp++] = child;
+        }
+      else
+        {
+          sd->dom_post = num++;
+          --sp;
+        }
+    }
+  free(stack);
+}
+
+/* Builds the children lists of the dominator tree and numbers its
+   nodes. */
+static void compute_dom_tree(ssa_t *ssa)
+{
+  int i;
+  for (i = 1; i < ssa->blocks_num; ++i)
+    {
+      ssa_data_t *sd = ssa->blocks[i]->ssa_data->idom->ssa_data;
+      ++sd->dom_children_num;
+    }
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      ssa_data_t *sd = ssa->blocks[i]->ssa_data;
+      sd->dom_children = xmalloc(sd->dom_children_num * sizeof(basic_block_t*) + 1);
+      sd->dom_children_num = 0;
+    }
+  for (i = 1; i < ssa->blocks_num; ++i)
+    {
+      basic_block_t *block = ssa->blocks[i];
+      ssa_data_t *sd = block->ssa_data->idom->ssa_data;
+      sd->dom_children[sd->dom_children_num++] = block;
+    }
+  number_dom_tree(ssa);
+}
+
+static void add_to_df(basic_block_t *block, basic_block_t *x)
+{
+  ssa_data_t *sd = block->ssa_data;
+  // x is added for all its predecessors in turn
+  if (sd->df_num > 0 && sd->df[sd->df_num - 1] == x)
+    return;
+  if (sd->df_num == sd->df_cap)
+    {
+      sd->df_cap = sd->df_cap == 0 ? 4 : sd->df_cap << 1;
+      sd->df = xrealloc(sd->df, sd->df_cap * sizeof(basic_block_t*));
+    }
+  sd->df[sd->df_num++] = x;
+}
+
+/* A join point is in the dominance frontier of every block on the
+   paths up the dominator tree from its predecessors to its immediate
+   dominator. */
+static void compute_dom_frontiers(ssa_t *ssa)
+{
+  int i, j;
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      basic_block_t *block = ssa->blocks[i];
+      ssa_data_t *sd = block->ssa_data;
+      if (sd->preds_num < 2)
+        continue;
+      for (j = 0; j < sd->preds_num; ++j)
+        {
+          basic_block_t *runner = sd->preds[j];
+          while (runner != sd->idom)
+            {
+              add_to_df(runner, block);
+              runner = runner->ssa_data->idom;
+            }
+        }
+    }
+}
+
+// -------------------------------------------------------------------
+
+/* Decides which variables need versions. A variable assigned once,
+   before all its uses, is in SSA form already; the others get
+   versions. Sets nonlocal for the renamed variables which may need
+   phi functions (those used in a block before being assigned in it),
+   and stores in defs their defining blocks, grouped by variable: the
+   blocks of the variable numbered id are at defs[def_start[id]] to
+   defs[def_start[id + 1]]. */
+static void find_renamed(ssa_t *ssa, bool *nonlocal, int **pdef_start, int **pdefs)
+{
+  int vars_num = ssa->vars_num;
+  int *ndefs = xmalloc(vars_num * sizeof(int) + 1);
+  basic_block_t **def_block = xmalloc(vars_num * sizeof(basic_block_t*) + 1);
+  int *stamp = xmalloc(vars_num * sizeof(int) + 1);
+  int *def_start = xmalloc((vars_num + 1) * sizeof(int));
+  int *defs;
+  quadr_arg_t *uses[3];
+  int i, j, k, n;
+
+  for (i = 0; i < vars_num; ++i)
+    {
+      ndefs[i] = 0;
+      def_block[i] = NULL;
+      stamp[i] = -1;
+      nonlocal[i] = false;
+      ssa->renamed[i] = false;
+    }
+  // count the definitions and find the uses not preceded by a local one
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      basic_block_t *block = ssa->blocks[i];
+      quadr_t *quadr;
+      for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+        {
+          var_t *var;
+          n = quadr_uses(quadr, uses);
+          for (j = 0; j < n; ++j)
+            {
+              if (stamp[uses[j]->u.var->id] != i)
+                nonlocal[uses[j]->u.var->id] = true;
+            }
+          if ((var = quadr_def(quadr)) != NULL)
+            {
+              stamp[var->id] = i;
+              ++ndefs[var->id];
+              def_block[var->id] = block;
+            }
+        }
+    }
+  /* A variable assigned once keeps its name if the assignment
+     dominates every use; a use in the same block comes after it
+     unless the variable is nonlocal there. */
+  for (i = 0; i < vars_num; ++i)
+    {
+      ssa->renamed[i] = ndefs[i] > 1;
+      stamp[i] = -1;
+    }
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      basic_block_t *block = ssa->blocks[i];
+      quadr_t *quadr;
+      for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+        {
+          var_t *var;
+          n = quadr_uses(quadr, uses);
+          for (j = 0; j < n; ++j)
+            {
+              int id = uses[j]->u.var->id;
+              if (ndefs[id] == 1 && stamp[id] != i &&
+                  (def_block[id] == block || !dominates(def_block[id], block)))
+                {
+                  ssa->renamed[id] = true;
+                }
+            }
+          if ((var = quadr_def(quadr)) != NULL)
+            stamp[var->id] = i;
+        }
+    }
+  // collect the defining blocks of the variables which may need phis
+  for (i = 0; i < vars_num; ++i)
+    {
+      if (!ssa->renamed[i])
+        nonlocal[i] = false;
+      ndefs[i] = 0;
+      stamp[i] = -1;
+    }
+  for (k = 0; k < 2; ++k)
+    {
+      if (k == 1)
+        {
+          n = 0;
+          for (i = 0; i < vars_num; ++i)
+            {
+              def_start[i] = n;
+              n += ndefs[i];
+              ndefs[i] = 0;
+              stamp[i] = -1;
+            }
+          def_start[vars_num] = n;
+          defs = xmalloc(n * sizeof(int) + 1);
+        }
+      for (i = 0; i < ssa->blocks_num; ++i)
+        {
+          quadr_t *quadr;
+          for (quadr = ssa->blocks[i]->lst.head; quadr != NULL; quadr = quadr->next)
+            {
+              var_t *var = quadr_def(quadr);
+              if (var != NULL && nonlocal[var->id] && stamp[var->id] != i)
+                {
+                  stamp[var->id] = i;
+                  if (k == 1)
+                    defs[def_start[var->id] + ndefs[var->id]] = i;
+                  ++ndefs[var->id];
+                }
+            }
+        }
+    }
+  free(ndefs);
+  free(def_block);
+  free(stamp);
+  *pdef_start = def_start;
+  *pdefs = defs;
+}
+
+/* Places the phi functions for the variables which may need them, at
+   the iterated dominance frontiers of their assignments. */
+static void insert_phis(ssa_t *ssa, bool *nonlocal, int *def_start, int *defs)
+{
+  int n = ssa->blocks_num;
+  int *has_phi = xmalloc(n * sizeof(int));
+  int *queued = xmalloc(n * sizeof(int));
+  int *work = xmalloc(n * sizeof(int));
+  var_t **vars = ssa->orig;
+  int i, j, id, len;
+  for (i = 0; i < n; ++i)
+    {
+      has_phi[i] = queued[i] = -1;
+    }
+  for (id = 0; id < ssa->vars_num; ++id)
+    {
+      if (!nonlocal[id])
+        continue;
+      len = 0;
+      for (i = def_start[id]; i < def_start[id + 1]; ++i)
+        {
+          work[len++] = defs[i];
+          queued[defs[i]] = id;
+        }
+      while (len > 0)
+        {
+          ssa_data_t *sd = ssa->blocks[work[--len]]->ssa_data;
+          for (j = 0; j < sd->df_num; ++j)
+            {
+              ssa_data_t *sd2 = sd->df[j]->ssa_data;
+              int k = sd2->index;
+              if (has_phi[k] != id)
+                {
+                  phi_t *phi = xmalloc(sizeof(phi_t));
+                  phi->var = phi->result = vars[id];
+                  phi->args = xmalloc(sd2->preds_num * sizeof(var_t*));
+                  for (i = 0; i < sd2->preds_num; ++i)
+                    {
+                      phi->args[i] = vars[id];
+                    }
+                  phi->next = sd2->phis;
+                  sd2->phis = phi;
+                  has_phi[k] = id;
+                  stats_add(phis_inserted, 1);
+                  if (queued[k] != id)
+                    {
+                      queued[k] = id;
+                      work[len++] = k;
+                    }
+                }
+            }
+        }
+    }
+  free(has_phi);
+  free(queued);
+  free(work);
+}
+
+/* Declares a variable of the type of var, and records orig as its
+   original. */
+static var_t *declare_version(ssa_t *ssa, var_t *var, var_t *orig)
+{
+  var_t *version = declare_var(ssa->func, var->type);
+  version->qtype = var->qtype;
+  assert (version->id == ssa->orig_num);
+  if (ssa->orig_num == ssa->orig_cap)
+    {
+      ssa->orig_cap <<= 1;
+      ssa->orig = xrealloc(ssa->orig, ssa->orig_cap * sizeof(var_t*));
+    }
+  ssa->orig[ssa->orig_num++] = (orig != NULL ? orig : version);
+  return version;
+}
+
+inline static var_t *new_version(ssa_t *ssa, var_t *var)
+{
+  return declare_version(ssa, var, var);
+}
+
+var_t *ssa_new_var(ssa_t *ssa, var_t *var)
+{
+  return declare_version(ssa, var, NULL);
+}
+
+typedef struct{
+  int id;
+  var_t *prev;
+} rename_log_t;
+
+/* Gives every assignment of a renamed variable a new version, and
+   every use the version reaching it, walking the dominator tree. cur
+   holds the current versions; the changes made in a subtree are
+   logged, and undone on the way back. */
+static void rename_vars(ssa_t *ssa)
+{
+  var_t **cur = xmalloc(ssa->vars_num * sizeof(var_t*) + 1);
+  rename_log_t *log;
+  int log_size = 0, log_cap = 64;
+  basic_block_t **stack = xmalloc(ssa->blocks_num * sizeof(basic_block_t*));
+  int *marks = xmalloc(ssa->blocks_num * sizeof(int));
+  int sp = 0, i, j, n;
+  quadr_arg_t *uses[3];
+
+  for (i = 0; i < ssa->vars_num; ++i)
+    {
+      cur[i] = ssa->orig[i];
+    }
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      ssa->blocks[i]->ssa_data->dfs_child = -1;
+    }
+  log = xmalloc(log_cap * sizeof(rename_log_t));
+
+#define PUSH_VERSION(vid, version)                                      \
+  {                                                                     \
+    if (log_size == log_cap)                                            \
+      {                                                                 \
+        log_cap <<= 1;                                                  \
+        log = xrealloc(log, log_cap * sizeof(rename_log_t));            \
+      }                                                                 \
+    log[log_size].id = (vid);                                           \
+    log[log_size++].prev = cur[vid];                                    \
+    cur[vid] = (version);                                               \
+  }
+
+  stack[sp++] = ssa->blocks[0];
+  while (sp > 0)
+    {
+      basic_block_t *block = stack[sp - 1];
+      ssa_data_t *sd = block->ssa_data;
+      if (sd->dfs_child == -1)
+        {
+          // entering the block
+          phi_t *phi;
+          quadr_t *quadr;
+          basic_block_t *succ;
+          marks[sp - 1] = log_size;
+          for (phi = sd->phis; phi != NULL; phi = phi->next)
+            {
+              phi->result = new_version(ssa, phi->var);
+              PUSH_VERSION(phi->var->id, phi->result);
+            }
+          for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+            {
+              var_t *var;
+              n = quadr_uses(quadr, uses);
+              for (j = 0; j < n; ++j)
+                {
+                  var = uses[j]->u.var;
+                  if (var->id < ssa->vars_num)
+                    uses[j]->u.var = cur[var->id];
+                }
+              if ((var = quadr_def(quadr)) != NULL && ssa->renamed[var->id])
+                {
+                  var_t *version = new_version(ssa, var);
+                  quadr->result.u.var = version;
+                  PUSH_VERSION(var->id, version);
+                }
+            }
+          for (i = 0; i < 2; ++i)
+            {
+              succ = (i == 0 ? block->child1 : block->child2);
+              if (succ == NULL || (i == 1 && succ == block->child1))
+                continue;
+              j = pred_index(succ, block);
+              for (phi = succ->ssa_data->phis; phi != NULL; phi = phi->next)
+                {
+                  phi->args[j] = cur[phi->var->id];
+                }
+            }
+          sd->dfs_child = 0;
+        }
+      if (sd->dfs_child < sd->dom_children_num)
+        {
+          stack[sp++] = sd->dom_children[sd->dfs_child++];
+        }
+      else
+        {
+          // leaving the block
+          --sp;
+          while (log_size > marks[sp])
+            {
+              --log_size;
+              cur[log[log_size].id] = log[log_size].prev;
+            }
+        }
+    }
+#undef PUSH_VERSION
+  free(cur);
+  free(log);
+  free(stack);
+  free(marks);
+}
+
+ssa_t *build_ssa(quadr_func_t *func)
+{
+  basic_block_t *root = func->blocks;
+  basic_block_t *block, *prev;
+  basic_block_t **order;
+  ssa_t *ssa;
+  bool *nonlocal;
+  int *def_start, *defs;
+  int blocks_num = 0, i;
+  vars_node_t *node;
+
+  assert (root != NULL);
+  for (block = root; block != NULL; block = block->next)
+    {
+      block->ssa_data = new_ssa_data();
+      ++blocks_num;
+    }
+  ssa = xmalloc(sizeof(ssa_t));
+  ssa->func = func;
+  ssa->blocks = xmalloc(blocks_num * sizeof(basic_block_t*));
+  order = xmalloc(blocks_num * sizeof(basic_block_t*));
+  ssa->blocks_num = compute_postorder(root, order);
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      block = order[ssa->blocks_num - 1 - i];
+      ssa->blocks[i] = block;
+      block->ssa_data->index = i;
+    }
+  free(order);
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      block = ssa->blocks[i];
+      if (block->child1 != NULL)
+        add_pred(block->child1, block);
+      if (block->child2 != NULL && block->child2 != block->child1)
+        add_pred(block->child2, block);
+    }
+  if (root->ssa_data->preds_num > 0)
+    {
+      // the entry values would need phi functions of their own
+      for (block = root; block != NULL; block = block->next)
+        {
+          free_ssa_data(block->ssa_data);
+          block->ssa_data = NULL;
+        }
+      free(ssa->blocks);
+      free(ssa);
+      return NULL;
+    }
+  prev = root;
+  for (block = root->next; block != NULL; block = prev->next)
+    {
+      if (block->ssa_data->index == -1)
+        {
+          prev->next = block->next;
+          free_ssa_data(block->ssa_data);
+          free_basic_block(block);
+          stats_add(blocks_removed, 1);
+        }
+      else
+        prev = block;
+    }
+
+  compute_dominators(ssa);
+  compute_dom_tree(ssa);
+  compute_dom_frontiers(ssa);
+
+  ssa->vars_num = func->vars_num;
+  ssa->orig_num = func->vars_num;
+  ssa->orig_cap = func->vars_num + 16;
+  ssa->orig = xmalloc(ssa->orig_cap * sizeof(var_t*));
+  ssa->renamed = xmalloc(func->vars_num * sizeof(bool) + 1);
+  node = func->vars_lst.head;
+  while (node != NULL)
+    {
+      for (i = 0; i <= node->last_var; ++i)
+        {
+          var_t *var = &node->vars[i];
+          ssa->orig[var->id] = var;
+        }
+      node = node->next;
+    }
+  nonlocal = xmalloc(func->vars_num * sizeof(bool) + 1);
+  find_renamed(ssa, nonlocal, &def_start, &defs);
+  insert_phis(ssa, nonlocal, def_start, defs);
+  free(nonlocal);
+  free(def_start);
+  free(defs);
+  for (i = 0; i < ssa->blocks_num; ++i)
+    {
+      ssa_data_t *sd = ssa->blocks[i]->ssa_data;
+      free(sd->df);
+      sd->df = NULL;
+      sd->df_num = sd->df_cap = 0;
+    }
+  rename_vars(ssa);
+  return ssa;
+}
+
+// -------------------------------------------------------------------
+
+/* Whether control passes from the end of the block to the next block
+   in the list. */
+inline static bool falls_through(basic_block_t *block)
+{
+  quadr_t *last = block->lst.tail;
+  return last == NULL || (last->op != Q_GOTO && last->op != Q_RETURN);
+}
+
+inline static void replace_child(basic_block_t *block, basic_block_t *from, basic_block_t *to)
+{
+  quadr_t *last = block->lst.tail;
+  if (last != NULL && (last->op == Q_GOTO || is_if_op(last->op)) &&
+      last->result.u.label == from)
+    last->result.u.label = to;
+  if (block->child1 == from)
+    block->child1 = to;
+  if (block->child2 == from)
+    block->child2 = to;
+}
+
+basic_block_t *insert_preheader(ssa_t *ssa, basic_block_t *header)
+{
+  ssa_data_t *hd = header->ssa_data;
+  ssa_data_t *sd, *idd;
+  basic_block_t *pre, *prev, *after = NULL;
+  basic_block_t **preds;
+  phi_t *phi, **pphi;
+  int i, j, n = 0;
+
+  assert (hd->idom != NULL);
+  for (prev = ssa->func->blocks; prev->next != header; prev = prev->next)
+    ;
+  /* The preheader goes where control already passes into the header
+     from outside the loop: after a block which falls through into the
+     header, or after one which jumps to it, taking over the jump. The
+     back edges are never given an additional jump. */
+  if (!dominates(header, prev) && falls_through(prev))
+    after = prev;
+  else
+    {
+      for (i = 0; i < hd->preds_num; ++i)
+        {
+          basic_block_t *pred = hd->preds[i];
+          if (!dominates(header, pred) && pred->lst.tail != NULL &&
+              pred->lst.tail->op == Q_GOTO)
+            {
+              after = pred;
+              break;
+            }
+        }
+      if (after == NULL)
+        return NULL;
+    }
+
+  pre = new_func_basic_block(ssa->func);
+  sd = pre->ssa_data = new_ssa_data();
+  if (after->next != header)
+    {
+      quadr_t *jump = after->lst.tail;
+      if (after->lst.head == jump)
+        after->lst.head = after->lst.tail = NULL;
+      else
+        {
+          quadr_t *quadr = after->lst.head;
+          while (quadr->next != jump)
+            quadr = quadr->next;
+          quadr->next = NULL;
+          after->lst.tail = quadr;
+        }
+      pre->lst.head = pre->lst.tail = jump;
+      after->child1 = header;
+    }
+  pre->next = after->next;
+  after->next = pre;
+  pre->child1 = header;
+
+  // the header keeps the back edges, after the edge from the preheader
+  preds = xmalloc((hd->preds_num + 1) * sizeof(basic_block_t*));
+  preds[n++] = pre;
+  for (i = 0; i < hd->preds_num; ++i)
+    {
+      basic_block_t *pred = hd->preds[i];
+      if (dominates(header, pred))
+        preds[n++] = pred;
+      else
+        {
+          replace_child(pred, header, pre);
+          add_pred(pre, pred);
+        }
+    }
+  /* A phi function of the header takes the values coming from outside
+     the loop from the preheader, which needs a phi function of its own
+     if they differ. */
+  pphi = &sd->phis;
+  for (phi = hd->phis; phi != NULL; phi = phi->next)
+    {
+      var_t **args = xmalloc(n * sizeof(var_t*));
+      var_t *outer = NULL;
+      bool same = true;
+      int k = 1;
+      for (i = 0; i < hd->preds_num; ++i)
+        {
+          if (dominates(header, hd->preds[i]))
+            args[k++] = phi->args[i];
+          else if (outer == NULL)
+            outer = phi->args[i];
+          else if (outer != phi->args[i])
+            same = false;
+        }
+      if (!same)
+        {
+          phi_t *phi2 = xmalloc(sizeof(phi_t));
+          phi2->var = phi->var;
+          phi2->result = new_version(ssa, phi->var);
+          phi2->args = xmalloc(sd->preds_num * sizeof(var_t*));
+          for (i = 0, j = 0; i < hd->preds_num; ++i)
+            {
+              if (!dominates(header, hd->preds[i]))
+                phi2->args[j++] = phi->args[i];
+            }
+          phi2->next = NULL;
+          *pphi = phi2;
+          pphi = &phi2->next;
+          outer = phi2->result;
+          stats_add(phis_inserted, 1);
+        }
+      args[0] = outer;
+      free(phi->args);
+      phi->args = args;
+    }
+  free(hd->preds);
+  hd->preds = preds;
+  hd->preds_num = n;
+
+  // the preheader takes the place of the header in the dominator tree
+  idd = hd->idom->ssa_data;
+  for (i = 0; idd->dom_children[i] != header; ++i)
+    ;
+  idd->dom_children[i] = pre;
+  sd->idom = hd->idom;
+  sd->dom_children = xmalloc(sizeof(basic_block_t*));
+  sd->dom_children[0] = header;
+  sd->dom_children_num = 1;
+  hd->idom = pre;
+  ssa->blocks = xrealloc(ssa->blocks, (ssa->blocks_num + 1) * sizeof(basic_block_t*));
+  sd->index = ssa->blocks_num;
+  ssa->blocks[ssa->blocks_num++] = pre;
+  number_dom_tree(ssa);
+  return pre;
+}
+
+// -------------------------------------------------------------------
+
+/* Leaving SSA. The versions of the renamed variables take part in a
+   liveness analysis on bit sets, in which they are numbered densely
+   by `slots'. A phi argument is live at the end of its predecessor,
+   and a phi result is assigned at the beginning of its block. Two
+   versions of a variable interfere if one is live where the other is
+   assigned. */
+
+typedef struct{
+  bitset_word_t *def, *use, *in, *out;
+} ssa_live_t;
+
+typedef struct{
+  ssa_t *ssa;
+  int *slot; // the slots of the variables, or -1
+  var_t **slot_var;
+  int slots_num;
+  int vars_num; // the number of variables when leaving SSA started
+  size_t words;
+  bool *conflict; // whether the versions of an original variable interfere
+} ssa_destr_t;
+
+inline static var_t *slot_orig(ssa_destr_t *sx, int slot)
+{
+  return ssa_orig(sx->ssa, sx->slot_var[slot]);
+}
+
+inline static int var_slot(ssa_destr_t *sx, var_t *var)
+{
+  return var->id < sx->vars_num ? sx->slot[var->id] : -1;
+}
+
+static void compute_def_use(ssa_destr_t *sx, basic_block_t *block, ssa_live_t *lv)
+{
+  quadr_arg_t *uses[3];
+  phi_t *phi;
+  quadr_t *quadr;
+  int i, j, n, s;
+  lv->def = new_bitset(sx->words);
+  lv->use = new_bitset(sx->words);
+  lv->in = new_bitset(sx->words);
+  lv->out = new_bitset(sx->words);
+  for (phi = block->ssa_data->phis; phi != NULL; phi = phi->next)
+    {
+      if ((s = var_slot(sx, phi->result)) >= 0)
+        bitset_add(lv->def, s);
+    }
+  for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+    {
+      var_t *var;
+      n = quadr_uses(quadr, uses);
+      for (j = 0; j < n; ++j)
+        {
+          s = var_slot(sx, uses[j]->u.var);
+          if (s >= 0 && !bitset_contains(lv->def, s))
+            bitset_add(lv->use, s);
+        }
+      if ((var = quadr_def(quadr)) != NULL && (s = var_slot(sx, var)) >= 0)
+        bitset_add(lv->def, s);
+    }
+  // the phi arguments for the successors are used at the end
+  for (i = 0; i < 2; ++i)
+    {
+      basic_block_t *succ = (i == 0 ? block->child1 : block->child2);
+      if (succ == NULL || (i == 1 && succ == block->child1))
+        continue;
+      j = pred_index(succ, block);
+      for (phi = succ->ssa_data->phis; phi != NULL; phi = phi->next)
+        {
+          if ((s = var_slot(sx, phi->args[j])) >= 0)
+            bitset_add(lv->out, s);
+        }
+    }
+  memcpy(lv->in, lv->use, sx->words * sizeof(bitset_word_t));
+}
+
+static bool update_live(ssa_destr_t *sx, basic_block_t *block, ssa_live_t *lv,
+                        ssa_live_t *lv1, ssa_live_t *lv2)
+{
+  bool changed = false;
+  size_t i;
+  for (i = 0; i < sx->words; ++i)
+    {
+      bitset_word_t out = lv->out[i];
+      bitset_word_t in;
+      if (lv1 != NULL)
+        out |= lv1->in[i];
+      if (lv2 != NULL)
+        out |= lv2->in[i];
+      in = lv->use[i] | (out & ~lv->def[i]);
+      lv->out[i] = out;
+      if (in != lv->in[i])
+        {
+          lv->in[i] = in;
+          changed = true;
+        }
+    }
+  return changed;
+}
+
+inline static void live_add(ssa_destr_t *sx, bitset_word_t *live, int *count, int s)
+{
+  if (!bitset_contains(live, s))
+    {
+      bitset_add(live, s);
+      ++count[slot_orig(sx, s)->id];
+    }
+}
+
+/* Marks as conflicting the variable of slot s if another of its
+   versions is live at the assignment of s. */
+inline static void live_def(ssa_destr_t *sx, bitset_word_t *live, int *count, int s)
+{
+  var_t *var = slot_orig(sx, s);
+  if (bitset_contains(live, s))
+    {
+      bitset_remove(live, s);
+      --count[var->id];
+    }
+  if (count[var->id] > 0)
+    sx->conflict[var->id] = true;
+}
+
+static void find_conflicts(ssa_destr_t *sx, basic_block_t *block, ssa_live_t *lv,
+                           bitset_word_t *live, int *count, quadr_t ***pqstack, int *pqcap)
+{
+  quadr_arg_t *uses[3];
+  quadr_t **qstack = *pqstack;
+  quadr_t *quadr;
+  phi_t *phi;
+  int i, j, n, s, qsize = 0;
+  long id;
+  memcpy(live, lv->out, sx->words * sizeof(bitset_word_t));
+  for (id = bitset_next(live, sx->words, 0); id >= 0;
+       id = bitset_next(live, sx->words, id + 1))
+    {
+      ++count[slot_orig(sx, id)->id];
+    }
+  for (quadr = block->lst.head; quadr != NULL; quadr = quadr->next)
+    {
+      if (qsize == *pqcap)
+        {
+          *pqcap <<= 1;
+          qstack = xrealloc(qstack, *pqcap * sizeof(quadr_t*));
+        }
+      qstack[qsize++] = quadr;
+    }
+  for (i = qsize - 1; i >= 0; --i)
+    {
+      var_t *var;
+      quadr = qstack[i];
+      if ((var = quadr_def(quadr)) != NULL && (s = var_slot(sx, var)) >= 0)
+        live_def(sx, live, count, s);
+      n = quadr_uses(quadr, uses);
+      for (j = 0; j < n; ++j)
+        {
+          if ((s = var_slot(sx, uses[j]->u.var)) >= 0)
+            live_add(sx, live, count, s);
+        }
+    }
+  for (phi = block->ssa_data->phis; phi != NULL; phi = phi->next)
+    {
+      if ((s = var_slot(sx, phi->result)) >= 0)
+        live_def(sx, live, count, s);
+    }
+  for (id = bitset_next(live, sx->words, 0); id >= 0;
+       id = bitset_next(live, sx->words, id + 1))
+    {
+      --count[slot_orig(sx, id)->id];
+    }
+  *pqstack = qstack;
+}
+
+/* Returns the name the variable gets out of SSA. */
+inline static var_t *final_var(ssa_destr_t *sx, var_t *var)
+{
+  var_t *orig;
+  if (var_slot(sx, var) < 0)
+    return var;
+  orig = ssa_orig(sx->ssa, var);
+  return sx->conflict[orig->id] ? var : orig;
+}
+
+/* Inserts quadr at the end of block, before the final jump. */
+static void insert_at_end(basic_block_t *block, quadr_t *quadr)
+{
+  quadr_t *last = block->lst.tail;
+  if (last != NULL && (last->op == Q_GOTO || is_if_op(last->op)))
+    {
+      quadr_t *prev = block->lst.head;
+      if (prev == last)
+        {
+          quadr->next = last;
+          block->lst.head = quadr;
+        }
+      else
+        {
+          while (prev->next != last)
+            prev = prev->next;
+          quadr->next = last;
+          prev->next = quadr;
+        }
+    }
+  else
+    {
+      quadr->next = NULL;
+      if (last != NULL)
+        last->next = quadr;
+      else
+        block->lst.head = quadr;
+      block->lst.tail = quadr;
+    }
+}
+
+/* Renames the variables and removes the copies which became
+   assignments of variables to themselves. */
+static void rewrite_block(ssa_destr_t *sx, basic_block_t *block)
+{
+  quadr_t *quadr = block->lst.head, *prev = NULL, *next;
+  while (quadr != NULL)
+    {
+      next = quadr->next;
+      if (quadr->result.tag == QA_VAR)
+        quadr->result.u.var = final_var(sx, quadr->result.u.var);
+      if (quadr->arg1.tag == QA_VAR)
+        quadr->arg1.u.var = final_var(sx, quadr->arg1.u.var);
+      if (quadr->arg2.tag == QA_VAR)
+        quadr->arg2.u.var = final_var(sx, quadr->arg2.u.var);
+      if (quadr->op == Q_COPY && quadr->arg1.tag == QA_VAR &&
+          quadr->arg1.u.var == quadr->result.u.var)
+        {
+          if (prev != NULL)
+            prev->next = next;
+          else
+            block->lst.head = next;
+          if (block->lst.tail == quadr)
+            block->lst.tail = prev;
+          free_quadr(quadr);
+        }
+      else
+        prev = quadr;
+      quadr = next;
+    }
+}
+
+/* Replaces the phi functions of the conflicting variables with
+   copies through a new variable: the predecessors assign it the
+   argument at their ends, and the block copies it into the result at
+   its beginning. The new variable keeps the copies independent of
+   one another. */
+static void lower_phis(ssa_destr_t *sx, basic_block_t *block)
+{
+  ssa_data_t *sd = block->ssa_data;
+  phi_t *phi;
+  int i;
+  for (phi = sd->phis; phi != NULL; phi = phi->next)
+    {
+      var_t *tmp;
+      quadr_t *quadr;
+      if (!sx->conflict[phi->var->id])
+        continue;
+      tmp = declare_var(sx->ssa->func, phi->var->type);
+      tmp->qtype = phi->var->qtype;
+      for (i = 0; i < sd->preds_num; ++i)
+        {
+          insert_at_end(sd->preds[i], new_copy_var_quadr(tmp, final_var(sx, phi->args[i])));
+          stats_add(phi_copies, 1);
+        }
+      quadr = new_copy_var_quadr(phi->result, tmp);
+      quadr->next = block->lst.head;
+      block->lst.head = quadr;
+      if (block->lst.tail == NULL)
+        block->lst.tail = quadr;
+      stats_add(phi_copies, 1);
+    }
+}
+
+void destroy_ssa(ssa_t *ssa)
+{
+  quadr_func_t *func = ssa->func;
+  ssa_destr_t sx;
+  basic_block_t *block;
+  basic_block_t **blocks;
+  ssa_live_t *lv;
+  int blocks_num = 0, vars_num = func->vars_num, i;
+  vars_node_t *node;
+  phi_t *phi;
+
+  sx.ssa = ssa;
+  sx.vars_num = vars_num;
+  sx.slot = xmalloc(vars_num * sizeof(int) + 1);
+  sx.slot_var = xmalloc(vars_num * sizeof(var_t*) + 1);
+  sx.conflict = xmalloc(ssa->vars_num * sizeof(bool) + 1);
+  sx.slots_num = 0;
+  for (i = 0; i < ssa->vars_num; ++i)
+    {
+      sx.conflict[i] = false;
+    }
+  node = func->vars_lst.head;
+  while (node != NULL)
+    {
+      for (i = 0; i <= node->last_var; ++i)
+        {
+          var_t *var = &node->vars[i];
+          var_t *orig = ssa_orig(ssa, var);
+          if (orig->id < ssa->vars_num && ssa->renamed[orig->id])
+            {
+              sx.slot[var->id] = sx.slots_num;
+              sx.slot_var[sx.slots_num++] = var;
+            }
+          else
+            sx.slot[var->id] = -1;
+        }
+      node = node->next;
+    }
+  sx.words = BITSET_WORDS(sx.slots_num);
+
+  for (block = func->blocks; block != NULL; block = block->next)
+    {
+      ++blocks_num;
+      /* A phi argument which is not a version of the phi's variable
+         (e.g. after copy propagation) needs a copy. */
+      for (phi = block->ssa_data->phis; phi != NULL; phi = phi->next)
+        {
+          for (i = 0; i < block->ssa_data->preds_num; ++i)
+            {
+              if (ssa_orig(ssa, phi->args[i]) != phi->var)
+                sx.conflict[phi->var->id] = true;
+            }
+        }
+    }
+  blocks = xmalloc(blocks_num * sizeof(basic_block_t*));
+  lv = xmalloc(blocks_num * sizeof(ssa_live_t));
+  blocks_num = 0;
+  for (block = func->blocks; block != NULL; block = block->next)
+    {
+      block->ssa_data->index = blocks_num;
+      blocks[blocks_num++] = block;
+    }
+
+  if (sx.slots_num > 0)
+    {
+      bitset_word_t *live = new_bitset(sx.words);
+      int *count = xmalloc(ssa->vars_num * sizeof(int) + 1);
+      int qcap = 128;
+      quadr_t **qstack = xmalloc(qcap * sizeof(quadr_t*));
+      bool changed = true;
+      for (i = 0; i < blocks_num; ++i)
+        {
+          compute_def_use(&sx, blocks[i], &lv[i]);
+        }
+      // most jumps go forward, so the blocks are visited backwards
+      while (changed)
+        {
+          changed = false;
+          for (i = blocks_num - 1; i >= 0; --i)
+            {
+              block = blocks[i];
+              changed |= update_live(&sx, block, &lv[i],
+                                     block->child1 ? &lv[block->child1->ssa_data->index] : NULL,
+                                     block->child2 ? &lv[block->child2->ssa_data->index] : NULL);
+            }
+        }
+      for (i = 0; i < ssa->vars_num; ++i)
+        {
+          count[i] = 0;
+        }
+      for (i = 0; i < blocks_num; ++i)
+        {
+          find_conflicts(&sx, blocks[i], &lv[i], live, count, &qstack, &qcap);
+          free_bitset(lv[i].def);
+          free_bitset(lv[i].use);
+          free_bitset(lv[i].in);
+          free_bitset(lv[i].out);
+        }
+      free_bitset(live);
+      free(count);
+      free(qstack);
+    }
+
+  for (i = 0; i < blocks_num; ++i)
+    {
+      rewrite_block(&sx, blocks[i]);
+    }
+  for (i = 0; i < blocks_num; ++i)
+    {
+      lower_phis(&sx, blocks[i]);
+      free_ssa_data(blocks[i]->ssa_data);
+      blocks[i]->ssa_data = NULL;
+    }
+  free(blocks);
+  free(lv);
+  free(sx.slot);
+  free(sx.slot_var);
+  free(sx.conflict);
+  free(ssa->blocks);
+  free(ssa->orig);
+  free(ssa->renamed);
+  free(ssa);
+}
@@ -0,0 +1,115 @@
+/* ssa.h - static single assignment form of the quadruple code
+
+   In SSA form every variable is assigned at most once, and every use
+   of a variable is dominated by its assignment (or the variable is
+   not assigned at all, e.g. a parameter). The assignments of a
+   variable of the original code get separate versions, which are new
+   variables of the function; the entry value of a variable is the
+   variable itself. Where the versions of a variable meet, a phi
+   function chooses between them. The phi functions are kept in the
+   ssa_data of the blocks, so that the code of a block stays an
+   ordinary quadruple list. */
+
+#ifndef SSA_H
+#define SSA_H
+
+#include "quadr.h"
+
+typedef struct Phi{
+  var_t *var; // the variable of the original code
+  var_t *result;
+  // args[i] is the value coming from the i-th predecessor of the block
+  var_t **args;
+  struct Phi *next;
+} phi_t;
+
+typedef struct Ssa_data{
+  int index; // the position of the block in reverse postorder
+  struct Basic_block **preds;
+  int preds_num;
+  // the immediate dominator; NULL for the root
+  struct Basic_block *idom;
+  // the children in the dominator tree
+  struct Basic_block **dom_children;
+  int dom_children_num;
+  /* the numbers of the block in a depth-first walk of the dominator
+     tree, before and after its children */
+  int dom_pre, dom_post;
+  // the dominance frontier; used only during the construction
+  struct Basic_block **df;
+  int df_num, df_cap;
+  phi_t *phis;
+  int dfs_child; // the next child to visit in a depth-first search
+} ssa_data_t;
+
+typedef struct{
+  quadr_func_t *func;
+  // the reachable blocks in reverse postorder; blocks[0] is the root
+  basic_block_t **blocks;
+  int blocks_num;
+  /* orig[id] is the variable of the original code of which the
+     variable numbered id is a version; variables declared after
+     orig_num are their own originals */
+  var_t **orig;
+  int orig_num, orig_cap;
+  // renamed[id] tells whether the original variable id has versions
+  bool *renamed;
+  int vars_num; // the number of variables of the original code
+} ssa_t;
+
+/* Puts func into SSA form. The block graph must be computed. Blocks
+   unreachable from the root are removed. Returns NULL, leaving func
+   unchanged, if the root is the target of a jump. */
+ssa_t *build_ssa(quadr_func_t *func);
+/* Declares a new variable of the type of var, which is not a version
+   of another. */
+var_t *ssa_new_var(ssa_t *ssa, var_t *var);
+/* Inserts an empty block through which all the edges entering the
+   loop header from outside the loop pass, and makes it the immediate
+   dominator of the header. The block is placed so that no jump is
+   added to the loop; returns NULL, changing nothing, if there is no
+   such place. */
+basic_block_t *insert_preheader(ssa_t *ssa, basic_block_t *header);
+/* Translates the function back into ordinary quadruples and frees
+   ssa. The versions of a variable whose live ranges do not overlap
+   are given back the name of the variable, and their phi functions
+   disappear; for the others the phi functions become copies. The
+   code may be changed in between as long as the blocks keep their
+   ssa_data, preds and phi arguments in agreement with the graph. */
+void destroy_ssa(ssa_t *ssa);
+
+/* Returns true if block a dominates block b. */
+inline static bool dominates(basic_block_t *a, basic_block_t *b)
+{
+  return a->ssa_data->dom_pre <= b->ssa_data->dom_pre &&
+    b->ssa_data->dom_post <= a->ssa_data->dom_post;
+}
+
+/* Returns the variable assigned by the quadruple, or NULL. */
+inline static var_t *quadr_def(quadr_t *quadr)
+{
+  if (quadr->result.tag == QA_VAR && quadr->op != Q_WRITE_PTR)
+    return quadr->result.u.var;
+  return NULL;
+}
+
+/* Stores the arguments of the quadruple which are uses of variables
+   in uses, and returns their number. */
+inline static int quadr_uses(quadr_t *quadr, quadr_arg_t **uses)
+{
+  int n = 0;
+  if (quadr->arg1.tag == QA_VAR)
+    uses[n++] = &quadr->arg1;
+  if (quadr->arg2.tag == QA_VAR)
+    uses[n++] = &quadr->arg2;
+  if (quadr->op == Q_WRITE_PTR)
+    uses[n++] = &quadr->result;
+  return n;
+}
+
+inline static var_t *ssa_orig(ssa_t *ssa, var_t *var)
+{
+  return var->id < ssa->orig_num ? ssa->orig[var->id] : var;
+}
+
+#endif
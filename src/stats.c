@@ -0,0 +1,30 @@
+#include "stats.h"
+
+stats_t stats;
+
+void print_stats(FILE *fout)
+{
+  fprintf(fout, "functions:                %lu\n", stats.funcs);
+  fprintf(fout, "basic blocks:             %lu\n", stats.blocks);
+  fprintf(fout, "variables:                %lu\n", stats.vars);
+  fprintf(fout, "liveness iterations:      %lu", stats.liveness_iterations);
+  if (stats.blocks > 0)
+    {
+      fprintf(fout, " (%.2f per block)", (double) stats.liveness_iterations / stats.blocks);
+    }
+  fprintf(fout, "\n");
+  fprintf(fout, "use distance iterations:  %lu", stats.nud_iterations);
+  if (stats.blocks > 0)
+    {
+      fprintf(fout, " (%.2f per block)", (double) stats.nud_iterations / stats.blocks);
+    }
+  fprintf(fout, "\n");
+  fprintf(fout, "constants propagated:     %lu\n", stats.consts_propagated);
+  fprintf(fout, "jumps folded:             %lu\n", stats.jumps_folded);
+  fprintf(fout, "blocks removed:           %lu\n", stats.blocks_removed);
+  fprintf(fout, "phi functions:            %lu\n", stats.phis_inserted);
+  fprintf(fout, "copies for phi functions: %lu\n", stats.phi_copies);
+  fprintf(fout, "dead assignments removed: %lu\n", stats.dead_removed);
+  fprintf(fout, "values reused:            %lu\n", stats.values_reused);
+  fprintf(fout, "invariants hoisted:       %lu\n", stats.invariants_hoisted);
+}
@@ -0,0 +1,37 @@
+/* stats.h - compilation statistics */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+typedef struct{
+  unsigned long funcs; // user-defined functions compiled
+  unsigned long blocks; // basic blocks analysed
+  unsigned long vars; // variables analysed
+  // blocks taken off the worklist while computing the live sets
+  unsigned long liveness_iterations;
+  // blocks taken off the worklist while computing nearest use distances
+  unsigned long nud_iterations;
+  // assignments turned into copies of constants by the global
+  // constant propagation
+  unsigned long consts_propagated;
+  unsigned long jumps_folded; // conditional jumps decided at compile time
+  unsigned long blocks_removed; // unreachable blocks removed
+  unsigned long phis_inserted; // phi functions placed by the SSA construction
+  unsigned long phi_copies; // copies which replaced phi functions
+  unsigned long dead_removed; // dead assignments removed in SSA form
+  // computations replaced by values available from dominating blocks
+  unsigned long values_reused;
+  unsigned long invariants_hoisted; // quadruples moved out of loops
+} stats_t;
+
+extern stats_t stats;
+
+/* Adds n to a counter in stats; may be called from many threads. */
+#define stats_add(counter, n) __atomic_fetch_add(&stats.counter, (n), __ATOMIC_RELAXED)
+
+/* Prints the statistics gathered if the --stats option was given. */
+void print_stats(FILE *fout);
+
+#endif
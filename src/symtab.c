@@ -1,4 +1,5 @@
 
+#include <string.h>
 #include "mem.h"
 #include "symtab.h"
 
@@ -7,6 +8,8 @@ static strtab_t *symtab;
 void symtab_init()
 {
   symtab = new_strtab(8 * 1024, 1024 * sizeof(sym_t), sizeof(sym_t));
+  symtab->strbuf->name = "symbol names";
+  symtab->databuf->name = "symbols";
 }
 
 void symtab_cleanup()
@@ -15,10 +18,15 @@ void symtab_cleanup()
 }
 
 sym_t *add_sym(const char *str)
+{
+  return add_symn(str, strlen(str));
+}
+
+sym_t *add_symn(const char *str, size_t len)
 {
   sym_t *sym;
   char *s;
-  if (add_str(symtab, str, &s, &sym)) // this is OK, in spite of GCC's warning
+  if (add_strn(symtab, str, len, &s, &sym)) // this is OK, in spite of GCC's warning
     {
       sym->str = s;
       sym->decl = NULL;
@@ -2,6 +2,8 @@
 #ifndef SYMTAB_H
 #define SYMTAB_H
 
+#include <stddef.h>
+
 struct Decl;
 
 /* Symbols - symtab entries */
@@ -17,5 +19,7 @@ void symtab_cleanup();
 /* Adds str to symbol table if it doesn't exist; if it is already
    there just returns the associated symbol structure. */
 sym_t *add_sym(const char *str);
+/* Same as add_sym(), for the first len characters of str. */
+sym_t *add_symn(const char *str, size_t len);
 
 #endif
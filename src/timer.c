@@ -0,0 +1,252 @@
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include "utils.h"
+#include "mem.h"
+#include "flags.h"
+#include "timer.h"
+
+// the number of the slowest functions reported
+#define TOP_FUNCS_NUM 10
+#define MAX_PHASE_DEPTH 8
+
+static const char *phase_name[PHASES_NUM] = {
+  "parsing", "semantic check", "local optimization", "flow analysis",
+  "global optimization", "code generation", "function epilogue",
+  "output", "assembler", "linker"
+};
+
+typedef struct{
+  const char *filename;
+  char *name;
+  long long wall;
+  long long cpu;
+} func_time_t;
+
+static timer_mark_t start_mark;
+// the times of the phases, updated atomically
+static long long phase_wall[PHASES_NUM];
+static long long phase_cpu[PHASES_NUM];
+
+static __thread phase_t phase_stack[MAX_PHASE_DEPTH];
+static __thread int phase_depth = 0;
+static __thread timer_mark_t last_mark;
+
+// the slowest functions, sorted by wall time
+static func_time_t top_funcs[TOP_FUNCS_NUM];
+static int top_funcs_num = 0;
+static pthread_mutex_t top_funcs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static long long nsec(const struct timespec *ts)
+{
+  return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+static void get_mark(timer_mark_t *mark, clockid_t cpu_clock)
+{
+  struct timespec ts;
+  struct rusage ru;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  mark->wall = nsec(&ts);
+  clock_gettime(cpu_clock, &ts);
+  mark->cpu = nsec(&ts);
+  // the assembler and the linker are child processes
+  getrusage(RUSAGE_CHILDREN, &ru);
+  mark->cpu += (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000LL +
+    (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000LL;
+}
+
+void timer_init()
+{
+  get_mark(&start_mark, CLOCK_PROCESS_CPUTIME_ID);
+}
+
+/* Charges the time since the last mark to the current phase. */
+static void charge_phase()
+{
+  timer_mark_t mark;
+  get_mark(&mark, CLOCK_THREAD_CPUTIME_ID);
+  if (phase_depth > 0)
+    {
+      phase_t phase = phase_stack[phase_depth - 1];
+      __atomic_fetch_add(&phase_wall[phase], mark.wall - last_mark.wall, __ATOMIC_RELAXED);
+      __atomic_fetch_add(&phase_cpu[phase], mark.cpu - last_mark.cpu, __ATOMIC_RELAXED);
+    }
+  last_mark = mark;
+}
+
+void timer_push(phase_t phase)
+{
+  if (f_time_report == TIME_REPORT_NONE)
+    return;
+  charge_phase();
+  if (phase_depth == MAX_PHASE_DEPTH)
+    xabort("timer_push(): phases nested too deeply");
+  phase_stack[phase_depth++] = phase;
+}
+
+void timer_pop()
+{
+  if (f_time_report == TIME_REPORT_NONE)
+    return;
+  charge_phase();
+  assert (phase_depth > 0);
+  --phase_depth;
+}
+
+void timer_start_func(timer_mark_t *mark)
+{
+  if (f_time_report == TIME_REPORT_NONE)
+    return;
+  get_mark(mark, CLOCK_THREAD_CPUTIME_ID);
+}
+
+void timer_end_func(const char *name, timer_mark_t *mark)
+{
+  timer_mark_t end;
+  int i;
+  if (f_time_report == TIME_REPORT_NONE)
+    return;
+  get_mark(&end, CLOCK_THREAD_CPUTIME_ID);
+  end.wall -= mark->wall;
+  end.cpu -= mark->cpu;
+  pthread_mutex_lock(&top_funcs_lock);
+  if (top_funcs_num < TOP_FUNCS_NUM || end.wall > top_funcs[TOP_FUNCS_NUM - 1].wall)
+    {
+      if (top_funcs_num < TOP_FUNCS_NUM)
+        ++top_funcs_num;
+      else
+        free(top_funcs[TOP_FUNCS_NUM - 1].name);
+      // insertion into the sorted array
+      for (i = top_funcs_num - 1; i > 0 && top_funcs[i - 1].wall < end.wall; --i)
+        top_funcs[i] = top_funcs[i - 1];
+      top_funcs[i].filename = cur_filename;
+      top_funcs[i].name = xstrdup(name);
+      top_funcs[i].wall = end.wall;
+      top_funcs[i].cpu = end.cpu;
+    }
+  pthread_mutex_unlock(&top_funcs_lock);
+}
+
+//--------------------------------------------------------------------
+
+/* report */
+
+static double sec(long long ns)
+{
+  return ns * 1e-9;
+}
+
+static void print_json_str(FILE *fout, const char *str)
+{
+  fputc('"', fout);
+  for (; *str != '\0'; ++str)
+    {
+      if (*str == '"' || *str == '\\')
+        fprintf(fout, "\\%c", *str);
+      else if ((unsigned char) *str < 0x20)
+        fprintf(fout, "\\u%04x", *str);
+      else
+        fputc(*str, fout);
+    }
+  fputc('"', fout);
+}
+
+static void print_text_report(FILE *fout, timer_mark_t *total, long long other_wall,
+                              long long other_cpu)
+{
+  const mem_usage_t *u;
+  int i;
+  fprintf(fout, "%-32s %10s %10s\n", "phase", "wall (s)", "cpu (s)");
+  for (i = 0; i < PHASES_NUM; ++i)
+    {
+      fprintf(fout, "  %-30s %10.4f %10.4f\n", phase_name[i], sec(phase_wall[i]),
+              sec(phase_cpu[i]));
+    }
+  fprintf(fout, "  %-30s %10.4f %10.4f\n", "other", sec(other_wall), sec(other_cpu));
+  fprintf(fout, "  %-30s %10.4f %10.4f\n", "total", sec(total->wall), sec(total->cpu));
+  if (top_funcs_num > 0)
+    {
+      fprintf(fout, "%-32s %10s %10s\n", "slowest functions", "wall (s)", "cpu (s)");
+      for (i = 0; i < top_funcs_num; ++i)
+        {
+          fprintf(fout, "  %-30s %10.4f %10.4f  (%s)\n", top_funcs[i].name,
+                  sec(top_funcs[i].wall), sec(top_funcs[i].cpu), top_funcs[i].filename);
+        }
+    }
+  fprintf(fout, "%-32s %10s\n", "peak memory", "bytes");
+  for (u = get_mem_usage(); u != NULL; u = u->next)
+    {
+      fprintf(fout, "  %-30s %10lu\n", u->name, (unsigned long) u->peak_bytes);
+    }
+}
+
+static void print_json_report(FILE *fout, timer_mark_t *total, long long other_wall,
+                              long long other_cpu)
+{
+  const mem_usage_t *u;
+  int i;
+  fprintf(fout, "{\n  \"phases\": [\n");
+  for (i = 0; i < PHASES_NUM; ++i)
+    {
+      fprintf(fout, "    {\"name\": \"%s\", \"wall\": %.6f, \"cpu\": %.6f},\n",
+              phase_name[i], sec(phase_wall[i]), sec(phase_cpu[i]));
+    }
+  fprintf(fout, "    {\"name\": \"other\", \"wall\": %.6f, \"cpu\": %.6f}\n  ],\n",
+          sec(other_wall), sec(other_cpu));
+  fprintf(fout, "  \"total\": {\"wall\": %.6f, \"cpu\": %.6f},\n",
+          sec(total->wall), sec(total->cpu));
+  fprintf(fout, "  \"functions\": [");
+  for (i = 0; i < top_funcs_num; ++i)
+    {
+      fprintf(fout, "%s\n    {\"name\": ", i == 0 ? "" : ",");
+      print_json_str(fout, top_funcs[i].name);
+      fprintf(fout, ", \"file\": ");
+      print_json_str(fout, top_funcs[i].filename);
+      fprintf(fout, ", \"wall\": %.6f, \"cpu\": %.6f}", sec(top_funcs[i].wall),
+              sec(top_funcs[i].cpu));
+    }
+  fprintf(fout, "%s],\n  \"memory\": [", top_funcs_num > 0 ? "\n  " : "");
+  for (u = get_mem_usage(); u != NULL; u = u->next)
+    {
+      fprintf(fout, "%s\n    {\"name\": \"%s\", \"peak_bytes\": %lu}",
+              u == get_mem_usage() ? "" : ",", u->name, (unsigned long) u->peak_bytes);
+    }
+  fprintf(fout, "%s]\n}\n", get_mem_usage() != NULL ? "\n  " : "");
+}
+
+void print_time_report(FILE *fout)
+{
+  timer_mark_t total;
+  long long other_wall, other_cpu;
+  int i;
+  get_mark(&total, CLOCK_PROCESS_CPUTIME_ID);
+  total.wall -= start_mark.wall;
+  total.cpu -= start_mark.cpu;
+  // with many threads the phases may take more time than the whole
+  // compilation
+  other_wall = total.wall;
+  other_cpu = total.cpu;
+  for (i = 0; i < PHASES_NUM; ++i)
+    {
+      other_wall -= phase_wall[i];
+      other_cpu -= phase_cpu[i];
+    }
+  if (other_wall < 0)
+    other_wall = 0;
+  if (other_cpu < 0)
+    other_cpu = 0;
+
+  if (f_time_report == TIME_REPORT_JSON)
+    print_json_report(fout, &total, other_wall, other_cpu);
+  else
+    print_text_report(fout, &total, other_wall, other_cpu);
+
+  for (i = 0; i < top_funcs_num; ++i)
+    {
+      free(top_funcs[i].name);
+    }
+  top_funcs_num = 0;
+  free_mem_usage();
+}
@@ -0,0 +1,49 @@
+/* timer.h - compile time and memory report (--time-report) */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdio.h>
+
+typedef enum{
+  PHASE_PARSE,
+  PHASE_SEMANTIC_CHECK,
+  PHASE_LOCAL_OPT,
+  PHASE_FLOW,
+  PHASE_GLOBAL_OPT,
+  PHASE_GENCODE,
+  PHASE_END_FUNC,
+  PHASE_OUTPUT,
+  PHASE_ASSEMBLE,
+  PHASE_LINK,
+  PHASES_NUM
+} phase_t;
+
+/* A point in time: the wall clock and the CPU time of the current
+   thread, together with the CPU time of the finished child
+   processes. In nanoseconds. */
+typedef struct{
+  long long wall;
+  long long cpu;
+} timer_mark_t;
+
+/* Starts the clock for the whole compilation. */
+void timer_init();
+
+/* Phases nest: a phase entered while another one is running
+   interrupts it, so the time of a phase does not include the time of
+   the phases inside it. Each thread has its own stack of phases; the
+   times of a phase run by several threads are summed up. Both
+   functions do nothing unless --time-report was given. */
+void timer_push(phase_t phase);
+void timer_pop();
+
+/* Per-function times, for the report of the slowest functions. */
+void timer_start_func(timer_mark_t *mark);
+void timer_end_func(const char *name, timer_mark_t *mark);
+
+/* Prints the report in the format selected by --time-report, and
+   frees the data gathered. */
+void print_time_report(FILE *fout);
+
+#endif
@@ -29,7 +29,9 @@ static char* strings[MAX_STRINGS_NUM];
 void tree_init()
 {
   alc = new_alloc(128 * 1024);
+  alc->name = "syntax trees";
   decl_init();
+  functions_declared = false;
 }
 
 void tree_cleanup()
@@ -38,6 +40,11 @@ void tree_cleanup()
   free_alloc(alc);
 }
 
+void tree_reset()
+{
+  reset_alloc(alc);
+}
+
 void strings_cleanup()
 {
   int i;
@@ -45,6 +52,7 @@ void strings_cleanup()
     {
       free(strings[i]);
     }
+  strings_num = 0;
 }
 
 /****************************************************/
@@ -292,7 +300,6 @@ node_t *new_node(node_type_t type, src_pos_t src_pos, ...)
       arg_t *arg;
       type_list_t *tp;
       int args_num;
-      decl_t *decl;
       func_t *node = alloc(alc, sizeof(func_t));
       type_t *ret_type = va_arg(ap, type_t*);
       node->ident = va_arg(ap, sym_t*);
@@ -329,10 +336,10 @@ node_t *new_node(node_type_t type, src_pos_t src_pos, ...)
         }
       node->type = (func_type_t*) cons_type(TYPE_FUNC, ret_type, args_num, tp);
 
-      declare(node->ident, (type_t*) node->type, src_pos);
-      decl = node->ident->decl;
-      assert (decl != NULL);
-      decl->u.func = declare_function(node->type, QF_USER_DEFINED, node->ident->str);
+      if (!functions_declared)
+        {
+          declare_user_function(node->ident, node->type, src_pos);
+        }
 
       result = (node_t*) node;
       break;
@@ -375,6 +382,7 @@ static void decl_init()
   decls_free = 0;
   scopes[0] = 0;
   decl_pool = new_pool(1024, sizeof(decl_t));
+  decl_pool->name = "declarations";
 }
 
 static void decl_cleanup()
@@ -430,11 +438,22 @@ void declare(sym_t *sym, type_t *type, src_pos_t src_pos)
   if (decls_free == decls_size)
     {
       decls_size <<= 1;
-      decls = xrealloc(decls, decls_size);
+      decls = xrealloc(decls, decls_size * sizeof(sym_t*));
     }
   decls[decls_free++] = sym;
 }
 
+bool functions_declared = false;
+
+void declare_user_function(sym_t *sym, func_type_t *type, src_pos_t src_pos)
+{
+  declare(sym, (type_t*) type, src_pos);
+  if (sym->decl->type == (type_t*) type)
+    {
+      sym->decl->u.func = declare_function(type, QF_USER_DEFINED, sym->str);
+    }
+}
+
 
 /****************************************************/
 
@@ -1126,20 +1145,37 @@ static void do_semantic_check(node_t *xnode, bool *was_return)
   }
 }
 
-void semantic_check(node_t *xnode)
+void begin_semantic_check()
 {
-  bool was_return;
   last_func_type = NULL;
   was_main = false;
   main_sym = add_sym("main");
   main_type = cons_type(TYPE_FUNC, cons_type(TYPE_INT), 0, NULL);
-  do_semantic_check(xnode, &was_return);
+}
+
+void semantic_check_function(func_t *node)
+{
+  bool was_return;
+  assert (node->next == NULL);
+  do_semantic_check((node_t*) node, &was_return);
+}
+
+void end_semantic_check()
+{
   if (!was_main)
     {
       error(0, 0, "no main function");
     }
 }
 
+void semantic_check(node_t *xnode)
+{
+  bool was_return;
+  begin_semantic_check();
+  do_semantic_check(xnode, &was_return);
+  end_semantic_check();
+}
+
 
 /****************************************************************************/
 /* Syntax tree printing */
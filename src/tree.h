@@ -11,6 +11,8 @@
 
 void tree_init();
 void tree_cleanup();
+/* Frees all the nodes created so far. The declarations are kept. */
+void tree_reset();
 void strings_cleanup();
 
 /* Source file locations */
@@ -375,6 +377,14 @@ typedef struct Decl{
 } decl_t;
 
 void declare(sym_t *sym, type_t *type, src_pos_t src_pos);
+/* Declares a user-defined function and the quadruple function for
+   it. */
+void declare_user_function(sym_t *sym, func_type_t *type, src_pos_t src_pos);
+
+/* Whether the functions have been declared before parsing (see
+   declare_functions() in parse.y); new_node() then doesn't declare
+   NODE_FUNC nodes again. */
+extern bool functions_declared;
 
 
 /****************************************************/
@@ -389,5 +399,14 @@ extern bool suppress_code_generation;
    errors have occurred or suppress_code_generation is true. */
 void semantic_check(node_t *xnode);
 
+/* The functions of a program may also be checked one at a time, as
+   they are parsed: begin_semantic_check() is called first,
+   semantic_check_function() for every function, and
+   end_semantic_check() at the end. semantic_check() does just that
+   for a list of functions. */
+void begin_semantic_check();
+void semantic_check_function(func_t *node);
+void end_semantic_check();
+
 
 #endif
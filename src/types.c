@@ -26,6 +26,7 @@ alloc_t *type_alc = NULL;
 void types_init()
 {
   type_alc = new_alloc(1024);
+  type_alc->name = "types";
 }
 
 void types_cleanup()
@@ -6,6 +6,7 @@
 
 const char *cur_filename;
 int errors_num = 0;
+bool suppress_errors = false;
 
 void warn(int line, int col, const char *str, ...)
 {
@@ -20,6 +21,8 @@ void warn(int line, int col, const char *str, ...)
 void error(int line, int col, const char *str, ...)
 {
   va_list ap;
+  if (suppress_errors)
+    return;
   fprintf(stderr, "%s:%d:%d: error: ", cur_filename, line, col);
   va_start(ap, str);
   vfprintf(stderr, str, ap);
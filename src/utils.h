@@ -57,11 +57,13 @@ typedef unsigned char bool;
 
 extern const char *cur_filename;
 extern int errors_num;
+// while set, errors are neither reported nor counted
+extern bool suppress_errors;
 
 void warn(int line, int col, const char *str, ...);
 void error(int line, int col, const char *str, ...);
-void fatal(int line, int col, const char *str, ...);
-void xabort(const char *s);
+void fatal(int line, int col, const char *str, ...) __attribute__((noreturn));
+void xabort(const char *s) __attribute__((noreturn));
 
 /* Memory allocation */
 
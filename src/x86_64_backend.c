@@ -0,0 +1,1300 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "outbuf.h"
+#include "flags.h"
+#include "i386_ir.h"
+#include "x86_64_backend.h"
+
+static __thread outbuf_t *outbuf;
+static __thread i386_code_t *code;
+
+//--------------------------------------------------------------------
+
+/* The general-purpose registers as numbered for gencode: the
+   caller-saved ones first, so that the callee-saved ones (which the
+   prologue has to store) are used only when the others are taken;
+   rsp is not available. */
+#define R_RAX 0
+#define R_RCX 1
+#define R_RDX 2
+#define R_RSI 3
+#define R_RDI 4
+#define R_R8 5
+#define R_R9 6
+#define R_R10 7
+#define R_R11 8
+#define REGS_NUM 15
+
+static const int hw_reg[REGS_NUM] = {
+  REG_EAX, REG_ECX, REG_EDX, REG_ESI, REG_EDI, REG_R8, REG_R9, REG_R10, REG_R11,
+  REG_EBX, REG_EBP, REG_R12, REG_R13, REG_R14, REG_R15
+};
+
+#define CALLEE_SAVED_REGS ((1 << REG_EBX) | (1 << REG_EBP) | (1 << REG_R12) | \
+                           (1 << REG_R13) | (1 << REG_R14) | (1 << REG_R15))
+
+#define XMM_REGS_NUM 16
+
+#define INT_ARG_REGS_NUM 6
+#define XMM_ARG_REGS_NUM 8
+
+static const reg_t int_arg_reg[INT_ARG_REGS_NUM] = {
+  R_RDI, R_RSI, R_RDX, R_RCX, R_R8, R_R9
+};
+
+// this is a per-function limit
+#define MAX_DOUBLE_CONSTS 256
+
+static __thread double double_consts[MAX_DOUBLE_CONSTS];
+static __thread int dc_num = -1; // the number of double constants - 1
+
+static __thread const char *cur_func_name;
+
+static __thread int stack_adjustment_off;
+static __thread bool made_call; // rsp must then be 16-byte aligned in the body
+static __thread int str_const_num = 0; // per function, like the double constants
+
+#define RUNTIME_CHUNK_SIZE 4096
+
+static char *runtime; // the text of the runtime routines
+static size_t runtime_size;
+
+//--------------------------------------------------------------------
+
+static i386_opcode_t jmp_op(quadr_op_t op, bool is_double)
+{
+  // ucomisd sets the flags like an unsigned comparison
+  switch (op){
+  case Q_IF_EQ:
+    return I_JE;
+  case Q_IF_NE:
+    return I_JNE;
+  case Q_IF_LT:
+    return is_double ? I_JB : I_JL;
+  case Q_IF_GT:
+    return is_double ? I_JA : I_JG;
+  case Q_IF_LE:
+    return is_double ? I_JBE : I_JLE;
+  case Q_IF_GE:
+    return is_double ? I_JAE : I_JGE;
+  default:
+    xabort("jmp_op()");
+    return I_JMP;
+  };
+}
+
+inline static int hw(reg_t reg)
+{
+  return hw_reg[reg];
+}
+
+static i386_operand_t loc_opd_sized(loc_t *loc, int size)
+{
+  switch(loc->tag){
+  case LOC_INT:
+    return opd_imm(loc->u.int_val);
+  case LOC_DOUBLE:
+    {
+      int i;
+      double val = loc->u.double_val;
+      // compared bitwise, so that 0.0 and -0.0 are kept apart
+      for (i = 0; i <= dc_num; ++i)
+        {
+          if (memcmp(&double_consts[i], &val, sizeof(double)) == 0)
+            break;
+        }
+      if (i > dc_num)
+        {
+          ++dc_num;
+          if (dc_num == MAX_DOUBLE_CONSTS)
+            xabort("too many floating point constants");
+          double_consts[dc_num] = val;
+          i = dc_num;
+        }
+      return opd_dconst(i);
+    }
+  case LOC_REG:
+    return opd_reg(hw(loc->u.reg), size);
+  case LOC_FPU_REG:
+    return opd_xmm_reg(loc->u.fpu_reg);
+  case LOC_STACK:
+    return opd_stack(loc->u.stack_elem->size, loc->u.stack_elem->offset +
+                     loc->u.stack_elem->size - stack_adjustment_off);
+  default:
+    xabort("programming error - loc_opd_sized()");
+  };
+  return opd_imm(0);
+}
+
+/* Integer variables are 32-bit and only pointers take the whole
+   register; the upper halves of the registers holding integers are
+   zero, since every 32-bit operation clears them. */
+inline static i386_operand_t loc_opd(loc_t *loc)
+{
+  return loc_opd_sized(loc, 4);
+}
+
+/* The address of a stack slot, without the size. */
+static i386_operand_t array_loc_opd(loc_t *loc)
+{
+  assert (loc->tag == LOC_STACK);
+  return opd_stack(0, loc->u.stack_elem->offset + loc->u.stack_elem->size -
+                   stack_adjustment_off);
+}
+
+/* [base + index] where index is a register or a constant */
+static i386_operand_t lea_addr_opd(loc_t *base, loc_t *index)
+{
+  assert (base->tag == LOC_REG);
+  if (index->tag == LOC_REG)
+    return opd_mem_index(0, hw(base->u.reg), hw(index->u.reg), 0);
+  assert (index->tag == LOC_INT);
+  return opd_mem_disp(0, hw(base->u.reg), '+', index->u.int_val);
+}
+
+/* [base + size * index] -- an array element */
+static i386_operand_t ptr_opd(int size, loc_t *base, loc_t *index)
+{
+  assert (base->tag == LOC_REG);
+  if (index->tag == LOC_REG)
+    return opd_mem_index(size, hw(base->u.reg), hw(index->u.reg), size);
+  assert (index->tag == LOC_INT);
+  return opd_mem_const_index(size, hw(base->u.reg), index->u.int_val, size);
+}
+
+/* a jump target */
+inline static i386_operand_t opd_label(basic_block_t *block)
+{
+  return opd_block_label(code, cur_func_name, get_label_for_block(block));
+}
+
+inline static bool is_zero_const(loc_t *loc)
+{
+  return loc->tag == LOC_DOUBLE && loc->u.double_val == 0.0 &&
+    !signbit(loc->u.double_val);
+}
+
+/* Copies src to dest, at most one of which is in memory; the flags
+   are left intact. */
+static void emit_mov(loc_t *dest, loc_t *src, int size)
+{
+  if (dest->tag == LOC_FPU_REG || src->tag == LOC_FPU_REG || src->tag == LOC_DOUBLE)
+    {
+      if (dest->tag == LOC_FPU_REG && is_zero_const(src))
+        emit2(code, I_XORPD, loc_opd(dest), loc_opd(dest));
+      else if (dest->tag == LOC_FPU_REG && src->tag == LOC_FPU_REG)
+        {
+          // movsd between registers would depend on the old value of dest
+          if (dest->u.fpu_reg != src->u.fpu_reg)
+            emit2(code, I_MOVAPD, loc_opd(dest), loc_opd(src));
+        }
+      else
+        emit2(code, I_MOVSD, loc_opd(dest), loc_opd(src));
+    }
+  else
+    emit2(code, I_MOV, loc_opd_sized(dest, size), loc_opd_sized(src, size));
+}
+
+/* Prevents the register holding var from being allocated until
+   release_reg() is called, so that loading another operand of the
+   current instruction does not evict var. Returns the register, or -1
+   if var is not in an allocatable register. */
+static reg_t keep_reg(var_t *var)
+{
+  loc_t *loc = std_find_best_src_loc(var);
+  if (loc->tag != LOC_REG || !loc_is_allowed(loc))
+    return -1;
+  deny_reg(loc->u.reg, LOC_REG);
+  return loc->u.reg;
+}
+
+static void release_reg(reg_t reg)
+{
+  if (reg != -1)
+    allow_reg(reg, LOC_REG);
+}
+
+static void gen_return()
+{
+  emit0(code, I_EPILOGUE);
+  emit0(code, I_RET);
+}
+
+//--------------------------------------------------------------------
+
+/* The runtime routines are read once, when the first program is
+   initialized (so a missing data file is not reported for programs
+   that fail to compile), and shared by all the programs compiled
+   with the backend. */
+
+static bool data_loaded;
+
+static const char *load_data()
+{
+  FILE *fin;
+  size_t n;
+  runtime_size = 0;
+  runtime = NULL;
+  if (f_runtime_path == NULL)
+    return NULL;
+  fin = fopen(f_runtime_path, "r");
+  if (fin == NULL)
+    {
+      return "Cannot open data file with runtime routines. Check whether the data\n"
+        "directory (JL_DATA_DIR environment variable) is set correctly.";
+    }
+  runtime = xmalloc(RUNTIME_CHUNK_SIZE);
+  while ((n = fread(runtime + runtime_size, 1, RUNTIME_CHUNK_SIZE, fin)) > 0)
+    {
+      runtime_size += n;
+      runtime = xrealloc(runtime, runtime_size + RUNTIME_CHUNK_SIZE);
+    }
+  fclose(fin);
+  return NULL;
+}
+
+static const char *init()
+{
+  if (!data_loaded)
+    {
+      const char *error = load_data();
+      if (error != NULL)
+        return error;
+      data_loaded = true;
+    }
+  if (runtime != NULL)
+    fwrite(runtime, 1, runtime_size, backend->fout);
+  return NULL;
+}
+
+static void final()
+{
+}
+
+static void init_thread()
+{
+  outbuf = new_outbuf();
+  code = new_i386_code(64);
+}
+
+static void final_thread()
+{
+  free_outbuf(outbuf);
+  free_i386_code(code);
+}
+
+static void start_func(quadr_func_t *func)
+{
+  size_t i;
+  int int_num = 0, xmm_num = 0, stack_num = 0;
+
+  clear_i386_code(code);
+
+  emit0(code, I_SECTION_TEXT);
+  // the functions are global, so that they can be found in the code
+  // loaded by --run
+  emit1(code, I_GLOBAL, opd_sym(code, func->name));
+  emit1(code, I_LABEL, opd_sym(code, func->name));
+  emit0(code, I_PROLOGUE);
+  assert (func->vars_lst.head != NULL);
+  assert (func->type->args_num <= func->vars_lst.head->vars_size);
+  for (i = 0; i < func->type->args_num; ++i)
+    {
+      var_t *var = &func->vars_lst.head->vars[i];
+      loc_t sloc;
+      if (var->qtype == VT_INT && int_num < INT_ARG_REGS_NUM)
+        {
+          init_loc(&sloc, LOC_REG, int_arg_reg[int_num]);
+          ++int_num;
+          update_var_loc(var, &sloc);
+        }
+      else if (var->qtype == VT_DOUBLE && xmm_num < XMM_ARG_REGS_NUM)
+        {
+          init_loc(&sloc, LOC_FPU_REG, xmm_num);
+          ++xmm_num;
+          update_var_loc(var, &sloc);
+        }
+      else
+        {
+          // in 8-byte slots above the return address
+          stack_param(var, -(8 + 8 * stack_num) - var->size);
+          ++stack_num;
+        }
+    }
+  cur_func_name = func->name;
+  stack_adjustment_off = 0;
+  made_call = false;
+  dc_num = -1;
+  str_const_num = 0;
+}
+
+static void end_func(quadr_func_t *func, size_t stack_size)
+{
+  int i;
+  int frame_size;
+
+  // this is not strictly necessary, because tree.c should generate a
+  // return quadruple at the end of every function, so we will never
+  // generate a return here
+  basic_block_t *block = func->blocks;
+  basic_block_t *prev = NULL;
+  if (block != NULL)
+    {
+      while (block->next != NULL)
+        {
+          prev = block;
+          block = block->next;
+        }
+    }
+  if (!(block != NULL &&
+        ((block->lst.tail != NULL && block->lst.tail->op == Q_RETURN) ||
+         (block->lst.tail == NULL && prev != NULL && prev->lst.tail != NULL &&
+          prev->lst.tail->op == Q_RETURN))))
+    {
+      gen_return();
+    }
+
+  // the callee-saved registers go below the variables
+  code->saved_regs = used_regs(code) & CALLEE_SAVED_REGS;
+  frame_size = stack_size;
+  for (i = 0; i <= REG_R15; ++i)
+    {
+      if (code->saved_regs & (1 << i))
+        frame_size += 8;
+    }
+  if (made_call)
+    { // the return address is 8 bytes
+      frame_size = (frame_size + 8 + 15) / 16 * 16 - 8;
+    }
+
+  render_i386_code(code, outbuf, cur_func_name, frame_size);
+
+  writeln(outbuf, "section .data");
+  for (i = 0; i <= dc_num; ++i)
+    {
+      uint64_t bits;
+      memcpy(&bits, &double_consts[i], sizeof(bits));
+      writeln(outbuf, "__dconst_%s_%d dq 0x%016llx ; %f", cur_func_name, i,
+              (unsigned long long) bits, double_consts[i]);
+    }
+
+  writeout(outbuf, gencode_fout);
+  clearbuf(outbuf);
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/* gen_code */
+
+static __thread var_t *var0; // the result
+static __thread var_t *var1; // first arg
+static __thread var_t *var2; // second arg
+static __thread loc_t *loc0;
+static __thread loc_t *loc1;
+static __thread loc_t *loc2;
+static __thread bool live1; // liveness status of var1 _after_ the current quadruple
+static __thread bool live2;
+static __thread bool should_free_loc0;
+static __thread bool should_free_loc1;
+static __thread bool should_free_loc2;
+
+#define we_may_change_loc(v, l, lv) (!loc_is_const(l) && (loc_num(v) > 1 || !lv) && ref_num(l) == 1)
+#define swap_args()                              \
+  {                                              \
+    swap(var1, var2, var_t*);                    \
+    swap(loc1, loc2, loc_t*);                    \
+    swap(live1, live2, bool);                    \
+  }
+
+/* This function saves all variables present in `loc' (the location
+   where we're going to save the result) and assigns it to loc0. It
+   should be called immediately _before_ writing any code. The
+   function that all varN variables are set appropriately, and also
+   restores their liveness status. */
+static void update_locations(loc_t *aloc)
+{
+  loc0 = aloc;
+  if (loc1 != NULL)
+    {
+      loc1 = copy_loc_shallow(loc1);
+      should_free_loc1 = true;
+    }
+  if (loc2 != NULL)
+    {
+      loc2 = copy_loc_shallow(loc2);
+      should_free_loc2 = true;
+    }
+  if (loc0 != NULL)
+    {
+      loc_t *loc = loc0;
+      loc0 = copy_loc_shallow(loc0);
+      if (should_free_loc0)
+        free_loc(loc);
+      should_free_loc0 = true;
+    }
+  if (var1 != NULL)
+    var1->live = live1;
+  if (var2 != NULL)
+    var2->live = live2;
+  /* note that var0->live may be true here, since var0 may be one of
+     var1 or var2; hence, we have to discard var0 first to avoid
+     saving it (it is not really live until after the instruction). */
+  discard_var(var0);
+  if (var1 != NULL && !var1->live)
+    discard_var(var1);
+  if (var2 != NULL && !var2->live)
+    discard_var(var2);
+  flush_loc_keeping(loc0, loc1, loc2);
+  update_var_loc(var0, loc0);
+  var0->live = true;
+}
+
+static void write_reg32_op_3(quadr_op_t op)
+{
+  assert (loc0->tag == LOC_REG);
+  if (op == Q_SUB)
+    {
+      if (loc1->tag == LOC_REG && loc2->tag == LOC_INT)
+        {
+          emit2(code, I_LEA, loc_opd(loc0),
+                opd_mem_disp(0, hw(loc1->u.reg), '-', loc2->u.int_val));
+        }
+      else
+        {
+          emit2(code, I_MOV, loc_opd(loc0), loc_opd(loc1));
+          emit2(code, I_SUB, loc_opd(loc0), loc_opd(loc2));
+        }
+    }
+  else if (op == Q_ADD)
+    {
+      if (loc2->tag == LOC_REG && (loc1->tag == LOC_REG || loc1->tag == LOC_INT))
+        {
+          emit2(code, I_LEA, loc_opd(loc0), lea_addr_opd(loc2, loc1));
+        }
+      else if (loc1->tag == LOC_REG && (loc2->tag == LOC_REG || loc2->tag == LOC_INT))
+        {
+          emit2(code, I_LEA, loc_opd(loc0), lea_addr_opd(loc1, loc2));
+        }
+      else
+        {
+          emit2(code, I_MOV, loc_opd(loc0), loc_opd(loc1));
+          emit2(code, I_ADD, loc_opd(loc0), loc_opd(loc2));
+        }
+    }
+  else
+    {
+      assert (op == Q_MUL);
+      if (loc1->tag == LOC_INT && loc2->tag == LOC_INT)
+        {
+          emit2(code, I_MOV, loc_opd(loc0), opd_imm(loc1->u.int_val * loc2->u.int_val));
+        }
+      else if (loc1->tag == LOC_INT)
+        {
+          emit3(code, I_IMUL, loc_opd(loc0), loc_opd(loc2), loc_opd(loc1));
+        }
+      else
+        {
+          emit2(code, I_MOV, loc_opd(loc0), loc_opd(loc1));
+          emit2(code, I_IMUL, loc_opd(loc0), loc_opd(loc2));
+        }
+    }
+}
+
+static void write_reg32_op_2(quadr_op_t op)
+{
+  assert (loc0->tag == LOC_REG || (loc0->tag == LOC_STACK && loc2->tag != LOC_STACK));
+  if (op == Q_SUB)
+    {
+      emit2(code, I_SUB, loc_opd(loc0), loc_opd(loc2));
+    }
+  else if (op == Q_ADD)
+    {
+      emit2(code, I_ADD, loc_opd(loc0), loc_opd(loc2));
+    }
+  else
+    {
+      assert (op == Q_MUL);
+      emit2(code, I_IMUL, loc_opd(loc0), loc_opd(loc2));
+    }
+}
+
+static void gen_div_mod_32(quadr_op_t op)
+{
+  loc_t *loc;
+  if (loc2->tag == LOC_INT)
+    {
+      unsigned val = loc2->u.int_val;
+      bool sign = false;
+      int cnt = 0;
+      int lg = -1;
+      if (loc2->u.int_val < 0)
+        {
+          sign = true;
+          val = -val;
+        }
+      while (val != 0)
+        {
+          if (val & 1)
+            {
+              if (lg != -1)
+                {
+                  lg = -1;
+                  break;
+                }
+              lg = cnt;
+            }
+          val >>= 1;
+          ++cnt;
+        }
+      if (lg != -1)
+        {
+          if (lg > 0 || sign)
+            {
+              if (we_may_change_loc(var1, loc1, live1))
+                {
+                  loc0 = loc1;
+                }
+              else
+                {
+                  move_to_reg(var1);
+                  loc0 = std_find_best_dest_loc(var1);
+                }
+              update_locations(loc0);
+              if (lg > 0)
+                {
+                  /* SAR rounds towards minus infinity, so 2^lg - 1 is
+                     added to a negative dividend first; the remainder
+                     is then taken from the biased dividend and the
+                     bias subtracted again */
+                  loc_t *tmp;
+                  i386_operand_t bias;
+                  bool deny = loc0->tag == LOC_REG && loc_is_allowed(loc0);
+                  if (deny)
+                    deny_reg(loc0->u.reg, LOC_REG);
+                  tmp = alloc_reg(LOC_REG);
+                  if (deny)
+                    allow_reg(loc0->u.reg, LOC_REG);
+                  bias = loc_opd(tmp);
+                  emit2(code, I_MOV, bias, loc_opd(loc0));
+                  emit2(code, I_SAR, bias, opd_imm(31));
+                  emit2(code, I_AND, bias, opd_imm((1u << lg) - 1));
+                  emit2(code, I_ADD, loc_opd(loc0), bias);
+                  if (op == Q_DIV)
+                    {
+                      emit2(code, I_SAR, loc_opd(loc0), opd_imm(lg));
+                    }
+                  else
+                    {
+                      assert (op == Q_MOD);
+                      emit2(code, I_AND, loc_opd(loc0), opd_imm((1u << lg) - 1));
+                      emit2(code, I_SUB, loc_opd(loc0), bias);
+                    }
+                  free_loc(tmp);
+                }
+              else if (op == Q_MOD)
+                { // x % -1 == 0
+                  emit2(code, I_AND, loc_opd(loc0), opd_imm(0));
+                }
+              if (op == Q_DIV && sign)
+                {
+                  emit1(code, I_NEG, loc_opd(loc0));
+                }
+            }
+          else
+            { // x / 1 == x, x % 1 == 0
+              quadr_arg_t arg;
+              if (op == Q_DIV)
+                {
+                  arg.tag = QA_VAR;
+                  arg.u.var = var1;
+                }
+              else
+                {
+                  arg.tag = QA_INT;
+                  arg.u.int_val = 0;
+                }
+              var1->live = live1;
+              var2->live = live2;
+              var0->live = true;
+              loc0 = loc1;
+              // copy_to_var() discards the old locations of var0
+              if (arg.tag != QA_VAR || var0 != var1)
+                copy_to_var(var0, arg);
+            }
+          return;
+        }
+    }
+  loc = var1->loc;
+  while (loc != NULL && (loc->dirty || loc->tag != LOC_REG || loc->u.reg != R_RAX))
+    {
+      loc = loc->next;
+    }
+  if (loc != NULL)
+    {
+      loc1 = loc;
+      var1->live = live1;
+    }
+  deny_reg(R_RAX, LOC_REG);
+  deny_reg(R_RDX, LOC_REG);
+  free_reg(R_RAX);
+  free_reg(R_RDX);
+  loc2 = std_find_best_src_loc(var2);
+  if (loc == NULL)
+    {
+      loc1 = std_find_best_src_loc(var1);
+      emit2(code, I_MOV, opd_reg32(REG_EAX), loc_opd(loc1));
+    }
+  if (op == Q_DIV)
+    {
+      loc0 = new_loc(LOC_REG, R_RAX);
+    }
+  else
+    {
+      assert (op == Q_MOD);
+      loc0 = new_loc(LOC_REG, R_RDX);
+    }
+  should_free_loc0 = true;
+  update_locations(loc0);
+
+  emit2(code, I_XOR, opd_reg32(REG_EDX), opd_reg32(REG_EDX));
+  emit2(code, I_TEST, opd_reg32(REG_EAX), opd_reg32(REG_EAX));
+  emit1(code, I_SETS, opd_reg(REG_EDX, 1));
+  emit1(code, I_NEG, opd_reg32(REG_EDX));
+  if (loc2->tag == LOC_INT)
+    {
+      free_reg(R_R11);
+      emit2(code, I_MOV, opd_reg32(REG_R11), loc_opd(loc2));
+      emit1(code, I_IDIV, opd_reg32(REG_R11));
+    }
+  else
+    emit1(code, I_IDIV, loc_opd(loc2));
+  allow_reg(R_RAX, LOC_REG);
+  allow_reg(R_RDX, LOC_REG);
+}
+
+static void gen_cmp(quadr_op_t op, i386_operand_t label)
+{
+  bool is_double = (var1->qtype == VT_DOUBLE);
+  // it may be worthwile to move var2 instead...
+  move_to_reg(var1);
+  loc1 = std_find_best_src_loc(var1);
+  loc2 = std_find_best_src_loc(var2);
+  assert (loc_is_reg(loc1));
+  emit2(code, is_double ? I_UCOMISD : I_CMP, loc_opd(loc1), loc_opd(loc2));
+  // only arithmetic instructions change flags -- moves don't
+  save_live();
+  if (var1 != NULL && !live1)
+    discard_var(var1);
+  if (var2 != NULL && !live2)
+    discard_var(var2);
+  emit1(code, jmp_op(op, is_double), label);
+}
+
+inline static i386_opcode_t sse_op(quadr_op_t op)
+{
+  switch (op){
+  case Q_ADD:
+    return I_ADDSD;
+  case Q_SUB:
+    return I_SUBSD;
+  case Q_MUL:
+    return I_MULSD;
+  case Q_DIV:
+    return I_DIVSD;
+  case Q_MOD: // modulo unsupported for real numbers -- what would it mean, anyway?
+  default:
+    xabort("sse_op()");
+    return I_ADDSD;
+  };
+}
+
+/* SSE2 arithmetic is two-address: the result replaces the first
+   operand, which has to be in a register. */
+static void gen_sse_arithmetic_op(quadr_op_t op)
+{
+  if (var0 != var2 && loc1->tag == LOC_FPU_REG &&
+      (var0 == var1 || we_may_change_loc(var1, loc1, live1)))
+    {
+      loc0 = loc1;
+      update_locations(loc0);
+    }
+  else
+    {
+      loc0 = alloc_reg(LOC_FPU_REG);
+      should_free_loc0 = true;
+      loc1 = std_find_best_src_loc(var1);
+      loc2 = std_find_best_src_loc(var2);
+      update_locations(loc0);
+      emit_mov(loc0, loc1, 8);
+    }
+  emit2(code, sse_op(op), loc_opd(loc0), loc_opd(loc2));
+}
+
+static void gen_arithmetic_op(quadr_op_t op)
+{
+  if (var0 == var2 && (op == Q_ADD || op == Q_MUL))
+    {
+      swap_args();
+    }
+
+  if (var1->qtype == VT_DOUBLE)
+    {
+      gen_sse_arithmetic_op(op);
+      return;
+    }
+  assert (var1->qtype == VT_INT);
+  if (op == Q_DIV || op == Q_MOD)
+    {
+      gen_div_mod_32(op);
+      return;
+    }
+  assert (op == Q_ADD || op == Q_SUB || op == Q_MUL);
+
+  if (var0 == var1)
+    {
+      assert (var0->loc != NULL);
+      loc0 = std_find_best_dest_loc(var0);
+      // there is no imul with a memory destination
+      if (loc0->tag == LOC_STACK && (loc2->tag == LOC_STACK || op == Q_MUL))
+        {
+          loc0 = alloc_reg(LOC_REG);
+          should_free_loc0 = true;
+          loc1 = std_find_best_src_loc(var1);
+          loc2 = std_find_best_src_loc(var2);
+          update_locations(loc0);
+          write_reg32_op_3(op);
+          return;
+        }
+      else if (loc0->tag == LOC_INT)
+        {
+          assert (loc1->tag == LOC_INT);
+          should_free_loc0 = true;
+          if (op != Q_SUB && we_may_change_loc(var2, loc2, live2) &&
+              (loc2->tag == LOC_REG || op != Q_MUL))
+            {
+              loc0 = copy_loc_shallow(loc2);
+              discard_var_loc(var2, loc2);
+              loc2 = loc0;
+              swap_args();
+            }
+          else
+            {
+              loc0 = alloc_reg(LOC_REG);
+              loc1 = std_find_best_src_loc(var1);
+              loc2 = std_find_best_src_loc(var2);
+              update_locations(loc0);
+              write_reg32_op_3(op);
+              return;
+            }
+        }
+      assert (loc0->tag == LOC_REG || (loc0->tag == LOC_STACK && loc2->tag != LOC_STACK && op != Q_MUL));
+      update_locations(loc0);
+      write_reg32_op_2(op);
+    }
+  else if (var0 == var2)
+    {
+      assert (op == Q_SUB);
+      if (we_may_change_loc(var1, loc1, live1) && loc1->tag != LOC_INT &&
+          (loc2->tag == LOC_REG || loc2->tag == LOC_INT || loc1->tag == LOC_REG))
+        {
+          loc0 = loc1;
+          update_locations(loc0);
+          emit2(code, I_SUB, loc_opd(loc1), loc_opd(loc2));
+        }
+      else if (we_may_change_loc(var2, loc2, live2) && loc2->tag == LOC_REG)
+        {
+          loc0 = loc2;
+          update_locations(loc0);
+          emit1(code, I_NEG, loc_opd(loc2));
+          emit2(code, I_ADD, loc_opd(loc2), loc_opd(loc1));
+        }
+      else
+        {
+          should_free_loc0 = true;
+          loc0 = alloc_reg(LOC_REG);
+          loc1 = std_find_best_src_loc(var1);
+          loc2 = std_find_best_src_loc(var2);
+          update_locations(loc0);
+          emit2(code, I_MOV, loc_opd(loc0), loc_opd(loc1));
+          emit2(code, I_SUB, loc_opd(loc0), loc_opd(loc2));
+        }
+    }
+  else
+    { // all different from var0
+      if (we_may_change_loc(var1, loc1, live1) &&
+          (loc1->tag == LOC_REG || (loc1->tag == LOC_STACK && loc2->tag != LOC_STACK && op != Q_MUL)))
+        {
+          loc0 = loc1;
+          update_locations(loc0);
+          write_reg32_op_2(op);
+        }
+      else if ((op == Q_ADD || op == Q_MUL) && we_may_change_loc(var2, loc2, live2) &&
+               (loc2->tag == LOC_REG || (loc2->tag == LOC_STACK && loc1->tag != LOC_STACK && op != Q_MUL)))
+        {
+          swap_args();
+          loc0 = loc1;
+          update_locations(loc0);
+          write_reg32_op_2(op);
+        }
+      else
+        {
+          loc0 = alloc_reg(LOC_REG);
+          should_free_loc0 = true;
+          loc1 = std_find_best_src_loc(var1);
+          loc2 = std_find_best_src_loc(var2);
+          update_locations(loc0);
+          write_reg32_op_3(op);
+        }
+    }
+}
+
+static void gen_ptr_op(quadr_op_t op)
+{
+  reg_t keep0, keep1, keep2;
+  switch (op){
+  case Q_READ_PTR:
+    loc1 = std_find_best_src_loc(var1);
+    if (loc1->tag == LOC_STACK)
+      {
+        move_to_reg(var1);
+      }
+    keep1 = keep_reg(var1);
+    loc2 = std_find_best_src_loc(var2);
+    if (loc2->tag == LOC_STACK)
+      {
+        move_to_reg(var2);
+      }
+    keep2 = keep_reg(var2);
+    loc0 = std_find_best_dest_loc(var0);
+    if (loc0 == NULL || loc0->tag != reg_type(var0))
+      {
+        loc0 = alloc_reg(reg_type(var0));
+        should_free_loc0 = true;
+      }
+    release_reg(keep1);
+    release_reg(keep2);
+    loc1 = std_find_best_src_loc(var1);
+    loc2 = std_find_best_src_loc(var2);
+    update_locations(loc0);
+    emit2(code, var0->qtype == VT_DOUBLE ? I_MOVSD : I_MOV, loc_opd(loc0),
+          ptr_opd(var0->size, loc1, loc2));
+    break;
+
+  case Q_WRITE_PTR:
+    move_to_reg(var0);
+    keep0 = keep_reg(var0);
+    loc1 = std_find_best_src_loc(var1);
+    if (loc1->tag == LOC_STACK)
+      {
+        move_to_reg(var1);
+      }
+    keep1 = keep_reg(var1);
+    loc2 = std_find_best_src_loc(var2);
+    // a double is stored from an XMM register
+    if (loc2->tag == LOC_STACK || loc2->tag == LOC_DOUBLE)
+      {
+        move_to_reg(var2);
+        loc2 = std_find_best_src_loc(var2);
+      }
+    release_reg(keep0);
+    release_reg(keep1);
+    loc1 = std_find_best_src_loc(var1);
+    loc0 = std_find_best_src_loc(var0);
+    //    update_locations(); -- we don't _write_ to loc0 itself here
+    assert (loc1->tag == LOC_REG || loc1->tag == LOC_INT);
+    assert (var2->size == 4 || var2->size == 8);
+    emit2(code, var2->qtype == VT_DOUBLE ? I_MOVSD : I_MOV,
+          ptr_opd(var2->size, loc0, loc1), loc_opd(loc2));
+    break;
+
+  case Q_GET_ADDR:
+    var1->live = live1;
+    loc0 = alloc_reg(LOC_REG);
+    should_free_loc0 = true;
+    loc1 = std_find_best_src_loc(var1);
+    update_locations(loc0);
+    emit2(code, I_LEA, loc_opd_sized(loc0, 8), array_loc_opd(loc1));
+    break;
+
+  default:
+    xabort("gen_ptr_op()");
+  };
+}
+
+static void gen_code(quadr_t *quadr)
+{
+  loc0 = NULL;
+  loc1 = NULL;
+  loc2 = NULL;
+  var0 = NULL; // result variable
+  var1 = NULL;
+  var2 = NULL;
+  should_free_loc0 = false;
+  should_free_loc1 = false;
+  should_free_loc2 = false;
+
+  if (quadr->arg1.tag == QA_VAR)
+    {
+      var1 = quadr->arg1.u.var;
+      loc1 = std_find_best_src_loc(var1);
+    }
+  if (quadr->arg2.tag == QA_VAR)
+    {
+      var2 = quadr->arg2.u.var;
+      loc2 = std_find_best_src_loc(var2);
+    }
+  if (quadr->result.tag == QA_VAR)
+    {
+      var0 = quadr->result.u.var;
+      if (var0->loc != NULL && quadr->op == Q_WRITE_PTR)
+        {
+          loc0 = std_find_best_src_loc(var0);
+        }
+      else
+        {
+          loc0 = NULL;
+        }
+    }
+
+  if (var1 != NULL)
+    {
+      live1 = var1->live;
+    }
+  if (var2 != NULL)
+    {
+      live2 = var2->live;
+    }
+  if (var0 != NULL && assigned_in_quadr(quadr, var0))
+    {
+      assert (var0->live);
+      var0->live = false;
+    }
+  if (var1 != NULL)
+    {
+      var1->live = true;
+    }
+  if (var2 != NULL)
+    {
+      var2->live = true;
+    }
+
+  switch (quadr->op){
+  case Q_ADD:
+  case Q_SUB:
+  case Q_DIV:
+  case Q_MUL:
+  case Q_MOD:
+    gen_arithmetic_op(quadr->op);
+    break;
+
+  case Q_RETURN:
+    if (var1 != NULL)
+      {
+        loc_t sloc;
+        loc1 = std_find_best_src_loc(var1);
+        // the result goes to eax or xmm0
+        init_loc(&sloc, reg_type(var1), 0);
+        if (!eq_loc(loc1, &sloc))
+          emit_mov(&sloc, loc1, 4);
+      }
+    gen_return();
+    break;
+
+  case Q_IF_EQ:
+  case Q_IF_NE:
+  case Q_IF_LT:
+  case Q_IF_GT:
+  case Q_IF_LE:
+  case Q_IF_GE:
+    gen_cmp(quadr->op, opd_label(quadr->result.u.label));
+    break;
+
+  case Q_GOTO:
+    assert (quadr->result.tag == QA_LABEL);
+    assert (quadr->arg1.tag == QA_NONE);
+    assert (quadr->arg2.tag == QA_NONE);
+    save_live();
+    emit1(code, I_JMP, opd_label(quadr->result.u.label));
+    break;
+
+  case Q_READ_PTR:
+  case Q_WRITE_PTR:
+  case Q_GET_ADDR:
+    gen_ptr_op(quadr->op);
+    break;
+
+  default:
+    xabort("gen_code() - x86_64");
+  };
+
+  assert (var0 == NULL || !assigned_in_quadr(quadr, var0) || var0->live);
+  if (should_free_loc0)
+    {
+      loc0->next = NULL;
+      free_loc(loc0);
+    }
+  if (should_free_loc1)
+    {
+      loc1->next = NULL;
+      free_loc(loc1);
+    }
+  if (should_free_loc2)
+    {
+      loc2->next = NULL;
+      free_loc(loc2);
+    }
+
+  if (var1 != NULL)
+    var1->live = live1;
+  if (var2 != NULL)
+    var2->live = live2;
+  if (var0 != NULL && assigned_in_quadr(quadr, var0))
+    var0->live = true;
+
+  if (var0 != NULL && !var0->live)
+    discard_var(var0);
+  if (var1 != NULL && !var1->live)
+    discard_var(var1);
+  if (var2 != NULL && !var2->live)
+    discard_var(var2);
+}
+
+//------------------------------------------------------------------------------
+
+static bool in_list(var_list_t *lst, var_t *var)
+{
+  while (lst != NULL)
+    {
+      if (lst->var == var)
+        return true;
+      lst = lst->next;
+    }
+  return false;
+}
+
+/* The first six integer and eight double arguments are passed in
+   registers, the rest in 8-byte stack slots from left to right. All
+   the registers are caller-saved as far as gencode is concerned. */
+static void gen_call(quadr_func_t *func, var_list_t *args, var_t *retvar)
+{
+  switch (func->tag){
+  case QF_PRINT_INT:
+  case QF_PRINT_DOUBLE:
+  case QF_READ_INT:
+  case QF_READ_DOUBLE:
+  case QF_USER_DEFINED:
+  case QF_ERROR:
+    {
+      var_list_t *lst;
+      int args_num = 0;
+      int int_num = 0, xmm_num = 0, stack_num = 0;
+      int i, stack_args_size;
+      bool *live;
+      int *slot; // the register, or -1 - the number of the stack slot
+
+      for (lst = args; lst != NULL; lst = lst->next)
+        ++args_num;
+      live = xmalloc(sizeof(bool) * args_num);
+      slot = xmalloc(sizeof(int) * args_num);
+      for (i = 0, lst = args; lst != NULL; ++i, lst = lst->next)
+        {
+          var_t *var = lst->var;
+          live[i] = var->live;
+          var->live = true;
+          if (var->qtype == VT_DOUBLE && xmm_num < XMM_ARG_REGS_NUM)
+            slot[i] = xmm_num++;
+          else if (var->qtype == VT_INT && int_num < INT_ARG_REGS_NUM)
+            slot[i] = int_arg_reg[int_num++];
+          else
+            slot[i] = -1 - stack_num++;
+        }
+
+      // rsp has to stay 16-byte aligned
+      stack_args_size = 8 * (stack_num + (stack_num & 1));
+      if (stack_args_size > 0)
+        {
+          emit2(code, I_SUB, opd_reg(REG_ESP, 8), opd_imm(stack_args_size));
+          stack_adjustment_off = stack_args_size;
+        }
+      for (i = 0, lst = args; lst != NULL; ++i, lst = lst->next)
+        {
+          var_t *var = lst->var;
+          if (slot[i] < 0)
+            {
+              loc_t *loc = std_find_best_src_loc(var);
+              if (loc->tag == LOC_STACK || loc->tag == LOC_DOUBLE)
+                {
+                  move_to_reg(var);
+                  loc = std_find_best_src_loc(var);
+                }
+              emit2(code, var->qtype == VT_DOUBLE ? I_MOVSD : I_MOV,
+                    opd_mem_disp(var->size, REG_ESP, '+', 8 * (-1 - slot[i])),
+                    loc_opd(loc));
+            }
+        }
+
+      /* The registers are loaded last, so that nothing is evicted to
+         them. Once loaded, a register is marked free and denied:
+         the variable need not be saved from it, it just must not be
+         overwritten before the call. */
+      for (i = 0, lst = args; lst != NULL; ++i, lst = lst->next)
+        {
+          var_t *var = lst->var;
+          if (slot[i] >= 0)
+            {
+              loc_t sloc;
+              loc_tag_t tag = reg_type(var);
+              var->live = live[i] || in_list(lst->next, var);
+              init_loc(&sloc, tag, slot[i]);
+              save_var_to_loc(var, &sloc);
+              deny_reg(slot[i], tag);
+              if (tag == LOC_REG)
+                free_reg(slot[i]);
+              else
+                free_fpu_reg(slot[i], false);
+            }
+        }
+
+      for (i = 0, lst = args; lst != NULL; ++i, lst = lst->next)
+        lst->var->live = live[i];
+      free(live);
+      free(slot);
+      discard_dead_vars(args);
+
+      free_all(LOC_REG);
+      free_all(LOC_FPU_REG);
+
+      emit1(code, I_CALL, opd_sym(code, func->name));
+      if (stack_args_size > 0)
+        {
+          emit2(code, I_ADD, opd_reg(REG_ESP, 8), opd_imm(stack_args_size));
+          stack_adjustment_off = 0;
+        }
+      made_call = true;
+      if (retvar != NULL)
+        {
+          loc_t sloc;
+          discard_var(retvar);
+          // eax or xmm0
+          init_loc(&sloc, reg_type(retvar), 0);
+          update_var_loc(retvar, &sloc);
+        }
+    }
+    break;
+  default:
+    xabort("gen_call()");
+    break;
+  };
+}
+
+static void gen_print_string(const char *str)
+{
+  deny_all(LOC_REG);
+  deny_all(LOC_FPU_REG);
+  free_all(LOC_REG);
+  free_all(LOC_FPU_REG);
+
+  emit0(code, I_SECTION_DATA);
+  emit2(code, I_STRING, opd_str_const(str_const_num), opd_sym(code, str));
+  emit0(code, I_SECTION_TEXT);
+  emit2(code, I_LEA, opd_reg(REG_EDI, 8), opd_str_const(str_const_num));
+  emit1(code, I_CALL, opd_sym(code, "printString"));
+  ++str_const_num;
+  made_call = true;
+
+  allow_all(LOC_REG);
+  allow_all(LOC_FPU_REG);
+}
+
+static void gen_mov(loc_t *dest, var_t *src)
+{
+  loc_t *loc = std_find_best_src_loc(src);
+  switch (dest->tag){
+  case LOC_STACK:
+    if (loc->tag == LOC_STACK || loc->tag == LOC_DOUBLE)
+      { // through a register
+        loc_t *tmp_loc = alloc_reg(reg_type(src));
+        emit_mov(tmp_loc, loc, src->size);
+        emit_mov(dest, tmp_loc, src->size);
+        update_var_loc(src, tmp_loc);
+        free_loc(tmp_loc);
+      }
+    else
+      emit_mov(dest, loc, src->size);
+    break;
+  case LOC_REG:
+  case LOC_FPU_REG:
+    emit_mov(dest, loc, src->size);
+    break;
+  default:
+    xabort("EGENMOV");
+  };
+}
+
+/* Unused, since the XMM registers do not form a stack. */
+static void gen_swap(loc_t *loc1, loc_t *loc2)
+{
+  if (loc2->tag == LOC_STACK)
+    {
+      swap(loc1, loc2, loc_t*);
+    }
+  if (loc1->tag == LOC_REG && loc2->tag != LOC_FPU_REG)
+    emit2(code, I_XCHG, loc_opd(loc1), loc_opd(loc2));
+  else
+    xabort("gen_swap()");
+}
+
+static void gen_label(const char *label_str)
+{
+  emit1(code, I_LABEL, opd_block_label(code, cur_func_name, label_str));
+}
+
+static void fpu_reg_free(reg_t fpu_reg)
+{
+  // no-op
+}
+
+//--------------------------------------------------------------------
+
+backend_t *new_x86_64_backend()
+{
+  backend_t *xback = xmalloc(sizeof(backend_t));
+  xback->init = init;
+  xback->final = final;
+  xback->init_thread = init_thread;
+  xback->final_thread = final_thread;
+  xback->start_func = start_func;
+  xback->end_func = end_func;
+  xback->gen_code = gen_code;
+  xback->gen_mov = gen_mov;
+  xback->gen_swap = gen_swap;
+  xback->gen_call = gen_call;
+  xback->gen_print_string = gen_print_string;
+  xback->gen_fpu_load = NULL;
+  xback->gen_fpu_store = NULL;
+  xback->gen_fpu_pop = NULL;
+  xback->gen_label = gen_label;
+  xback->find_best_src_loc = std_find_best_src_loc;
+  xback->find_best_dest_loc = std_find_best_dest_loc;
+  xback->fpu_reg_free = fpu_reg_free;
+  xback->fpu_stack = false;
+  xback->fast_swap = false;
+  xback->alloc_reg = bellady_ra;
+  xback->alloc_fpu_reg = bellady_ra;
+  xback->int_size = 4;
+  xback->double_size = 8;
+  xback->ptr_size = 8;
+  xback->sp_size = 8;
+  xback->reg_num = REGS_NUM;
+  xback->fpu_reg_num = XMM_REGS_NUM;
+  data_loaded = false;
+  return xback;
+}
+
+void free_x86_64_backend(backend_t *x86_64_backend)
+{
+  free(runtime);
+  runtime = NULL;
+  free(x86_64_backend);
+}
@@ -0,0 +1,12 @@
+/* 64-bit x86 code generation (System V ABI, SSE2 floating point;
+   target: NASM assembly). */
+
+#ifndef X86_64_BACKEND_H
+#define X86_64_BACKEND_H
+
+#include "gencode.h"
+
+backend_t *new_x86_64_backend();
+void free_x86_64_backend(backend_t *x86_64_backend);
+
+#endif
@@ -0,0 +1,109 @@
+#!/bin/bash
+
+# Runs the programs in examples/bench compiled with every backend and
+# optimization level, and reports the run time, the number of
+# instructions executed (when perf is available) and the code size.
+# The code size is the number of instructions in the generated
+# assembly (without the runtime routines) or the number of quadruples.
+#
+# usage: ./bench_jl.sh [benchmark...]
+
+levels="0 1 2"
+
+if [ $# -gt 0 ]; then
+    benchmarks="$@"
+else
+    benchmarks=`ls examples/bench/*.jl | xargs -n1 basename | sed 's/\.jl$//'`
+fi
+
+have_perf=false
+if perf stat -e instructions:u true >/dev/null 2>&1; then
+    have_perf=true
+fi
+
+# $1 - assembly file
+asm_size() {
+    grep -v '^[[:space:]]' $1 | grep -v ':$' | \
+        awk '$1 != "" && $1 != "section" && $1 != "global" && $1 != "extern" && $1 !~ /^__/' | \
+        wc -l
+}
+
+# $1 - quadruple file
+qua_size() {
+    grep -v ':$' $1 | grep -v '^function' | wc -l
+}
+
+# $1 - benchmark; $2 - expected output; rest - the command to run
+run() {
+    b=$1
+    expected=$2
+    shift 2
+    TIMEFORMAT=%3R
+    if $have_perf; then
+        t=`{ time perf stat -x, -e instructions:u -o perf.out $@ < examples/bench/$b.input > out 2>/dev/null ; } 2>&1`
+        insns=`grep instructions perf.out | cut -d, -f1`
+        rm -f perf.out
+    else
+        t=`{ time $@ < examples/bench/$b.input > out 2>/dev/null ; } 2>&1`
+        insns=-
+    fi
+    if diff -q out $expected >/dev/null; then
+        status=ok
+    else
+        status=wrong
+    fi
+}
+
+printf "%-12s %-8s %-6s %-8s %10s %14s %10s\n" benchmark backend level status "time (s)" instructions "code size"
+for b in $benchmarks
+do
+    f=examples/bench/$b.jl
+    for o in $levels
+    do
+        # quadr
+        q=examples/bench/$b.qua
+        rm $q >/dev/null 2>&1
+        if ../jl -d../data -O$o -bquadr $f > /dev/null 2>&1; then
+            size=`qua_size $q`
+            if [ -f iquadr ]; then
+                run $b examples/bench/$b.output ./iquadr quiet $q
+            else
+                status=skipped; t=-; insns=-
+            fi
+        else
+            status=failed; t=-; insns=-; size=-
+        fi
+        printf "%-12s %-8s %-6s %-8s %10s %14s %10s\n" $b quadr -O$o $status $t $insns $size
+
+        # i386
+        a=examples/bench/$b.asm
+        p=examples/bench/$b
+        rm $a $p >/dev/null 2>&1
+        if ../jl -d../data -O$o -bi386 --no-assemble -o $a $f > /dev/null 2>&1; then
+            size=`asm_size $a`
+            if ../jl -d../data -O$o -bi386 $f > /dev/null 2>&1; then
+                run $b examples/bench/$b.i386.output ./$p
+            else
+                status=skipped; t=-; insns=-
+            fi
+        else
+            status=failed; t=-; insns=-; size=-
+        fi
+        printf "%-12s %-8s %-6s %-8s %10s %14s %10s\n" $b i386 -O$o $status $t $insns $size
+
+        # x86_64
+        rm $a $p >/dev/null 2>&1
+        if ../jl -d../data -O$o -bx86_64 --no-assemble -o $a $f > /dev/null 2>&1; then
+            size=`asm_size $a`
+            if ../jl -d../data -O$o -bx86_64 $f > /dev/null 2>&1; then
+                run $b examples/bench/$b.i386.output ./$p
+            else
+                status=skipped; t=-; insns=-
+            fi
+        else
+            status=failed; t=-; insns=-; size=-
+        fi
+        printf "%-12s %-8s %-6s %-8s %10s %14s %10s\n" $b x86_64 -O$o $status $t $insns $size
+    done
+done
+rm -f out
@@ -0,0 +1,19 @@
+/* the Ackermann function A(3, n) */
+
+int ack(int m, int n)
+{
+  if (m == 0)
+    return n + 1;
+  if (n == 0)
+    return ack(m - 1, 1);
+  return ack(m - 1, ack(m, n - 1));
+}
+
+int main()
+{
+  int n = readInt();
+  int i;
+  for (i = 1; i <= n; i++)
+    printInt(ack(3, i));
+  return 0;
+}
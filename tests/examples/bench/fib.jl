@@ -0,0 +1,14 @@
+/* doubly recursive Fibonacci numbers */
+
+int fib(int n)
+{
+  if (n < 2)
+    return n;
+  return fib(n - 1) + fib(n - 2);
+}
+
+int main()
+{
+  printInt(fib(readInt()));
+  return 0;
+}
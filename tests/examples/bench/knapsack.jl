@@ -0,0 +1,30 @@
+/* 0-1 knapsack by dynamic programming: n pseudo-random items and the
+   capacity 20000 */
+
+int main()
+{
+  int best[20001];
+  int n = readInt();
+  int i, c, x, weight, value, v;
+  for (c = 0; c <= 20000; c++)
+    best[c] = 0;
+  x = 7;
+  for (i = 0; i < n; i++)
+    {
+      x = (x * 1103 + 12345) % 65536;
+      weight = x % 1000 + 1;
+      x = (x * 1103 + 12345) % 65536;
+      value = x % 500 + 1;
+      c = 20000;
+      while (c >= weight)
+        {
+          v = best[c - weight] + value;
+          if (v > best[c])
+            best[c] = v;
+          c--;
+        }
+    }
+  printInt(best[20000]);
+  printInt(best[10000]);
+  return 0;
+}
@@ -0,0 +1,40 @@
+/* multiplication of n x n double matrices stored row by row in flat
+   arrays, n <= 200 */
+
+int main()
+{
+  double a[40000];
+  double b[40000];
+  double c[40000];
+  int n = readInt();
+  int i, j, k;
+  double v, w, s;
+  v = 0.0;
+  w = 1.0;
+  for (i = 0; i < n * n; i++)
+    {
+      a[i] = v;
+      b[i] = w;
+      v = v + 0.5;
+      if (v > 3.0)
+        v = -3.0;
+      w = w - 0.25;
+      if (w < -2.0)
+        w = 2.0;
+    }
+  for (i = 0; i < n; i++)
+    {
+      for (j = 0; j < n; j++)
+        {
+          s = 0.0;
+          for (k = 0; k < n; k++)
+            s = s + a[i * n + k] * b[k * n + j];
+          c[i * n + j] = s;
+        }
+    }
+  s = 0.0;
+  for (i = 0; i < n; i++)
+    s = s + c[i * n + i] + c[i * n + n - 1 - i];
+  printDouble(s);
+  return 0;
+}
@@ -0,0 +1,125 @@
+/* the n-body simulation of the Jovian planets, with the given number
+   of steps; prints the energy before and after */
+
+double sqrt(double x)
+{
+  double g = x;
+  int i;
+  if (g < 1.0)
+    g = 1.0;
+  for (i = 0; i < 40; i++)
+    g = (g + x / g) / 2.0;
+  return g;
+}
+
+int main()
+{
+  double x[5];
+  double y[5];
+  double z[5];
+  double vx[5];
+  double vy[5];
+  double vz[5];
+  double m[5];
+  int steps = readInt();
+  int s, i, j;
+  double dx, dy, dz, d2, mag, e, px, py, pz;
+  double solar_mass = 39.47841760435743;
+  double days = 365.24;
+  double dt = 0.01;
+
+  x[0] = 0.0; y[0] = 0.0; z[0] = 0.0;
+  vx[0] = 0.0; vy[0] = 0.0; vz[0] = 0.0;
+  m[0] = solar_mass;
+
+  x[1] = 4.84143144246472090;
+  y[1] = -1.16032004402742839;
+  z[1] = -0.103622044471123109;
+  vx[1] = 0.00166007664274403694 * days;
+  vy[1] = 0.00769901118419740425 * days;
+  vz[1] = -0.0000690460016972063023 * days;
+  m[1] = 0.000954791938424326609 * solar_mass;
+
+  x[2] = 8.34336671824457987;
+  y[2] = 4.12479856412430479;
+  z[2] = -0.403523417114321381;
+  vx[2] = -0.00276742510726862411 * days;
+  vy[2] = 0.00499852801234917238 * days;
+  vz[2] = 0.0000230417297573763929 * days;
+  m[2] = 0.000285885980666130812 * solar_mass;
+
+  x[3] = 12.8943695621391310;
+  y[3] = -15.1111514016986312;
+  z[3] = -0.223307578892655734;
+  vx[3] = 0.00296460137564761618 * days;
+  vy[3] = 0.00237847173959480950 * days;
+  vz[3] = -0.0000296589568540237556 * days;
+  m[3] = 0.0000436624404335156298 * solar_mass;
+
+  x[4] = 15.3796971148509165;
+  y[4] = -25.9193146099879641;
+  z[4] = 0.179258772950371181;
+  vx[4] = 0.00268067772490389322 * days;
+  vy[4] = 0.00162824170038242295 * days;
+  vz[4] = -0.0000951592254519715870 * days;
+  m[4] = 0.0000515138902046611451 * solar_mass;
+
+  // offset the momentum of the sun
+  px = 0.0; py = 0.0; pz = 0.0;
+  for (i = 0; i < 5; i++)
+    {
+      px = px + vx[i] * m[i];
+      py = py + vy[i] * m[i];
+      pz = pz + vz[i] * m[i];
+    }
+  vx[0] = -px / solar_mass;
+  vy[0] = -py / solar_mass;
+  vz[0] = -pz / solar_mass;
+
+  for (s = 0; s <= steps; s++)
+    {
+      if (s == 0 || s == steps)
+        {
+          e = 0.0;
+          for (i = 0; i < 5; i++)
+            {
+              e = e + 0.5 * m[i] * (vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+              for (j = i + 1; j < 5; j++)
+                {
+                  dx = x[i] - x[j];
+                  dy = y[i] - y[j];
+                  dz = z[i] - z[j];
+                  e = e - m[i] * m[j] / sqrt(dx * dx + dy * dy + dz * dz);
+                }
+            }
+          printDouble(e);
+        }
+      if (s < steps)
+        {
+          for (i = 0; i < 5; i++)
+            {
+              for (j = i + 1; j < 5; j++)
+                {
+                  dx = x[i] - x[j];
+                  dy = y[i] - y[j];
+                  dz = z[i] - z[j];
+                  d2 = dx * dx + dy * dy + dz * dz;
+                  mag = dt / (d2 * sqrt(d2));
+                  vx[i] = vx[i] - dx * m[j] * mag;
+                  vy[i] = vy[i] - dy * m[j] * mag;
+                  vz[i] = vz[i] - dz * m[j] * mag;
+                  vx[j] = vx[j] + dx * m[i] * mag;
+                  vy[j] = vy[j] + dy * m[i] * mag;
+                  vz[j] = vz[j] + dz * m[i] * mag;
+                }
+            }
+          for (i = 0; i < 5; i++)
+            {
+              x[i] = x[i] + dt * vx[i];
+              y[i] = y[i] + dt * vy[i];
+              z[i] = z[i] + dt * vz[i];
+            }
+        }
+    }
+  return 0;
+}
@@ -0,0 +1,36 @@
+/* sieve of Eratosthenes: the number of primes below 500000, computed
+   the given number of times */
+
+int main()
+{
+  int p[500000];
+  int rounds = readInt();
+  int r, i, j, count;
+  count = 0;
+  for (r = 0; r < rounds; r++)
+    {
+      for (i = 0; i < 500000; i++)
+        p[i] = 1;
+      p[0] = 0;
+      p[1] = 0;
+      i = 2;
+      while (i * i < 500000)
+        {
+          if (p[i] == 1)
+            {
+              j = i * i;
+              while (j < 500000)
+                {
+                  p[j] = 0;
+                  j = j + i;
+                }
+            }
+          i++;
+        }
+      count = 0;
+      for (i = 0; i < 500000; i++)
+        count = count + p[i];
+    }
+  printInt(count);
+  return 0;
+}
@@ -0,0 +1,82 @@
+/* heapsort of 100000 pseudo-random numbers, repeated the given number
+   of times */
+
+int main()
+{
+  int a[100000];
+  int rounds = readInt();
+  int r, i, n, x, root, child, tmp, sum;
+  boolean sorted;
+  sum = 0;
+  sorted = true;
+  for (r = 0; r < rounds; r++)
+    {
+      x = r + 1;
+      for (i = 0; i < 100000; i++)
+        {
+          x = (x * 1103 + 12345) % 65536;
+          a[i] = x;
+        }
+      // build the heap
+      i = 100000 / 2 - 1;
+      while (i >= 0)
+        {
+          root = i;
+          child = 2 * root + 1;
+          while (child < 100000)
+            {
+              if (child + 1 < 100000 && a[child + 1] > a[child])
+                child++;
+              if (a[root] >= a[child])
+                child = 100000;
+              else
+                {
+                  tmp = a[root];
+                  a[root] = a[child];
+                  a[child] = tmp;
+                  root = child;
+                  child = 2 * root + 1;
+                }
+            }
+          i--;
+        }
+      // move the maxima to the end
+      n = 100000 - 1;
+      while (n > 0)
+        {
+          tmp = a[0];
+          a[0] = a[n];
+          a[n] = tmp;
+          root = 0;
+          child = 1;
+          while (child < n)
+            {
+              if (child + 1 < n && a[child + 1] > a[child])
+                child++;
+              if (a[root] >= a[child])
+                child = n;
+              else
+                {
+                  tmp = a[root];
+                  a[root] = a[child];
+                  a[child] = tmp;
+                  root = child;
+                  child = 2 * root + 1;
+                }
+            }
+          n--;
+        }
+      for (i = 1; i < 100000; i++)
+        {
+          if (a[i - 1] > a[i])
+            sorted = false;
+        }
+      sum = (sum + a[0] + a[50000] + a[99999]) % 1000000;
+    }
+  if (sorted)
+    printString("sorted");
+  else
+    printString("not sorted");
+  printInt(sum);
+  return 0;
+}
@@ -0,0 +1,19 @@
+/* A stack slot freed by a double is not reused for an int. */
+
+int main() {
+  printInt(f(0, 0.5));
+  printInt(f(7, 1.5));
+  return 0;
+}
+
+int f(int p, double q) {
+  int i0 = p + 80;
+  int i1 = p + 30;
+  int i2 = p + 29;
+  double d2 = q * 2.25;
+  int i3 = p + 46;
+  d2 = d2 * d2;
+  printDouble(d2);
+  int i4 = i0 * i1;
+  return i0 + i1 + i2 + i3 + i4;
+}
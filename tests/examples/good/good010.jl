@@ -0,0 +1,35 @@
+/* The second operand of an FPU operation may stay in memory although
+   it dies in the operation. */
+
+int leaf(int x, double y)
+{
+  return x * 3 - 1;
+}
+int f(int p, double q)
+{
+  int i0 = p + 54;
+  double d0 = q * 2.25;
+  int i1 = p + 94;
+  double d1 = q * 3.25;
+  int i2 = p + 77;
+  double d2 = q * 0.25;
+  int i3 = p + 4;
+  double d3 = q * 2.25;
+  if (i3 >= i0) {
+    i1 = leaf(i1, d1);
+    if (i2 <= i1 && i1 < 80) {
+    } else
+      i0 = i3 - i1;
+    d0 = d1 + 49.5;
+  } else
+  d3 = d1 * 37.5;
+  d2 = d0 * d2;
+  if (d0 > 1000000.0 || d0 < -1000000.0)
+    i0 = i0 + 1;
+  return i0 + i1 + i2 + i3;
+}
+int main()
+{
+  printInt(f(0, 0.5));
+  return 0;
+}
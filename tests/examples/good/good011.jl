@@ -0,0 +1,24 @@
+/* A call in the block emitted before does not mean that the FPU stack
+   is empty. */
+
+int main() {
+  printDouble(f(1.5, 1));
+  printDouble(f(1.5, 0));
+  return 0;
+}
+
+int g(int x) {
+  return x * 2;
+}
+
+double f(double d, int p) {
+  double e = d * 2.0;
+  int i = 0;
+  if (p > 0) {
+    i = g(p);
+  } else {
+    e = e + 1.0;
+  }
+  printInt(i);
+  return e * d;
+}
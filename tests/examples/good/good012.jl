@@ -0,0 +1,26 @@
+/* Register allocation in a loop where a variable is assigned again
+   before its value is used. */
+
+int main()
+{
+  printInt(f(0));
+  return 0;
+}
+
+int f(int p)
+{
+  int i0 = p + 52;
+  int i1 = p + 50;
+  int i2 = p + 43;
+  int i3 = p + 53;
+  int l0;
+  for (l0 = 0; l0 < 2; l0++) {
+    i0 = i1 % 7;
+    if (i1 == i0 && i2 != 50) {
+    } else
+      i3 = i3 / 7;
+  }
+  i0 = i3 / 3;
+  i3 = i2 / 6;
+  return i0 + i1 + i2 + i3;
+}
@@ -0,0 +1,36 @@
+/* Loading the index of an array access does not evict the array or a
+   value needed by the same instruction. */
+
+int main() {
+  printInt(f(3));
+  printInt(f(11));
+  return 0;
+}
+
+int f(int x) {
+  int a[16];
+  int i;
+  for (i = 0; i < 16; i++) {
+    a[i] = i;
+  }
+  int j = x + 2;
+  int b = x + 1;
+  int c = x + 2;
+  int d = x + 3;
+  int e = x + 4;
+  int g = x + 5;
+  int h = x + 6;
+  int k = x + 7;
+  int m = x + 8;
+  int n = x + 9;
+  a[(j + 0) % 16] = b * a[(b + j) % 16] + b;
+  a[(j + 1) % 16] = c * a[(c + j) % 16] + c;
+  a[(j + 2) % 16] = d * a[(d + j) % 16] + d;
+  a[(j + 3) % 16] = e * a[(e + j) % 16] + e;
+  a[(j + 4) % 16] = g * a[(g + j) % 16] + g;
+  a[(j + 5) % 16] = h * a[(h + j) % 16] + h;
+  a[(j + 6) % 16] = k * a[(k + j) % 16] + k;
+  a[(j + 7) % 16] = m * a[(m + j) % 16] + m;
+  a[(j + 8) % 16] = n * a[(n + j) % 16] + n;
+  return b + c + d + e + g + h + k + m + n + a[j % 16] + a[x % 16] + a[15];
+}
@@ -0,0 +1,18 @@
+/* Elements of double arrays are loaded onto the FPU stack. */
+
+int main()
+{
+  printDouble(f(2, 0.5));
+  return 0;
+}
+
+double f(int p, double q)
+{
+  double b[16];
+  b[p] = q + 1.0;
+  b[p + 1] = 2.5;
+  printDouble(b[p + 1]);
+  double d = b[p] * q;
+  printDouble(d);
+  return q;
+}
@@ -0,0 +1,37 @@
+/* Variables are saved before a register is reused, and not into the
+   register being freed. */
+
+int main()
+{
+  printInt(f(2));
+  printInt(f(-9));
+  return 0;
+}
+
+int f(int p)
+{
+  int i0 = p + 14;
+  int i1 = p + 19;
+  int i2 = p + 1;
+  int i3 = p + 29;
+  int i4 = p + 21;
+  int i5 = p + 25;
+  int l1;
+  int l2;
+  int a[16];
+  for (l1 = 0; l1 < 16; l1++) {
+    a[l1] = l1 * 3;
+  }
+  if (i4 > i5) {
+    i0 = i2 + 818;
+    for (l1 = 0; l1 < 3; l1++) {
+      for (l2 = 0; l2 < 2; l2++) {
+        i4 = i5 % 3;
+        i5 = a[(i0 % 16 + 16) % 16] - i2;
+        i4 = i0 / 1;
+      }
+    }
+  } else
+    i3 = i2 - i5;
+  return i0 + i1 + i2 + i3 + i4 + i5;
+}
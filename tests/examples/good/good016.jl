@@ -0,0 +1,21 @@
+/* Division and remainder by 1 and -1. */
+
+int main() {
+  printInt(divs(17));
+  printInt(divs(-17));
+  int x = readInt();
+  printInt(x / 1);
+  printInt(x % 1);
+  x = x % 1;
+  printInt(x);
+  return 0;
+}
+
+int divs(int x) {
+  int a = x / 1;
+  int b = x % 1;
+  int c = x / -1;
+  int d = x % -1;
+  x = x / 1;
+  return a * 1000 + b * 100 + c * 10 + d + x;
+}
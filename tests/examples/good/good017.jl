@@ -0,0 +1,27 @@
+/* Division and remainder by powers of two round towards zero, also
+   for negative dividends. */
+
+int main() {
+  int i = -9;
+  while (i <= 9) {
+    printInt(pow2(i * 3));
+    i = i + 3;
+  }
+  printInt(big(-2147483647));
+  printInt(big(2147483647));
+  return 0;
+}
+
+int pow2(int x) {
+  int a = x / 2;
+  int b = x % 2;
+  int c = x / 8;
+  int d = x % 8;
+  int e = x / -4;
+  int f = x % -4;
+  return ((((a * 10 + b) * 10 + c) * 10 + d) * 10 + e) * 10 + f;
+}
+
+int big(int x) {
+  return x / 1024 + x % 65536 + x / -2147483647;
+}
@@ -0,0 +1,50 @@
+/* A double argument that dies in a call is not evicted from a full FPU
+   stack by its own load. */
+
+int leaf(int x, double y)
+{
+  return x * 3 - 1;
+}
+
+int f(int p, double q)
+{
+  int i0 = p + 27;
+  double d0 = q * 2.25;
+  int i1 = p + 12;
+  double d1 = q * 4.25;
+  int i2 = p + 2;
+  double d2 = q * 4.25;
+  int i3 = p + 93;
+  double d3 = q * 2.25;
+  int i4 = p + 79;
+  double d4 = q * 9.25;
+  int i5 = p + 47;
+  double d5 = q * 4.25;
+  int i6 = p + 60;
+  double d6 = q * 9.25;
+  int i7 = p + 31;
+  int i8 = p + 72;
+  int i9 = p + 21;
+  double d9 = q * 4.25;
+  int l0;
+  int l1;
+  i3 = leaf(i8, d4);
+  for (l0 = 0; l0 < 3; l0++) {
+    d6 = d3 - 91.5;
+    for (l1 = 0; l1 < 3; l1++) {
+      d1 = d1 * 66.5;
+      d5 = d6 - d2;
+    }
+    d1 = d9 / 1.0;
+  }
+  d3 = d6 + d5;
+  if (d0 > 1000000.0)
+    i0 = i0 + 1;
+  return i0 + i1 + i2 + i3 + i4 + i5 + i6 + i7 + i8 + i9;
+}
+
+int main()
+{
+  printInt(f(0, 0.5));
+  return 0;
+}
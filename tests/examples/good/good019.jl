@@ -0,0 +1,36 @@
+/* Variables live into a loop must be in the locations the loop header
+   expects on every edge, also after a call has moved them to the
+   stack. */
+
+int leaf(int x, double y)
+{
+  return x * 3 - 1;
+}
+
+int f(int p, double q)
+{
+  int i0 = p + 10;
+  int i1 = p + 5;
+  int i2 = p + 73;
+  double d2 = q * 4.25;
+  int i3 = p + 22;
+  int i4 = p + 50;
+  int i5 = p + 39;
+  int i6 = p + 86;
+  int i7 = p + 53;
+  int l0;
+  int l1;
+  i5 = leaf(i3, d2);
+  for (l0 = 0; l0 < 4; l0++) {
+    i7 = (i6 + i3) + i1;
+    for (l1 = 0; l1 < 2; l1++) {
+    }
+  }
+  return i0 + i1 + i2 + i3 + i4 + i5 + i6 + i7;
+}
+
+int main()
+{
+  printInt(f(0, 0.5));
+  return 0;
+}
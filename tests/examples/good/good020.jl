@@ -0,0 +1,40 @@
+/* A double copied between two stack slots on i386 (this used to go
+   through a 32-bit register, which the assembler rejects). */
+
+int leaf(int x, double y)
+{
+  return x * 3 - 1;
+}
+
+int f(int p, double q)
+{
+  int i0 = p + 66;
+  int i1 = p + 38;
+  int i2 = p + 8;
+  double d2 = q * 3.25;
+  int i3 = p + 27;
+  double d3 = q * 1.25;
+  int i4 = p + 74;
+  double d4 = q * 5.25;
+  int i5 = p + 39;
+  double d5 = q * 2.25;
+  int i6 = p + 17;
+  int i7 = p + 82;
+  double d7 = q * 5.25;
+  if (i0 == i0) {
+    if (i7 <= i0) {
+      i0 = leaf(i7, d2);
+    } else
+    d3 = d3 + d2;
+    d2 = d5 - 58.5;
+  } else
+    i0 = leaf(i1, d7);
+  i6 = leaf(i5, d4);
+  return i0 + i1 + i2 + i3 + i4 + i5 + i6 + i7;
+}
+
+int main()
+{
+  printInt(f(1, 1.5));
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+/* The result of a call is assigned to a variable whose old value
+   shares a register with another variable (i6 and i7 at -O1). */
+
+int leaf(int x, double y)
+{
+  return x * 3 - 1;
+}
+
+int f(int p, double q)
+{
+  int i0 = p + 57;
+  int i1 = p + 81;
+  int i2 = p + 50;
+  int i3 = p + 49;
+  int i4 = p + 83;
+  double d4 = q * 3.25;
+  int i5 = p + 9;
+  int i6 = p + 26;
+  int i7 = p + 26;
+  i7 = leaf(i7, d4);
+  if (i6 <= i5) {
+  } else
+    i1 = i1 % 6;
+  return i0 + i1 + i2 + i3 + i4 + i5 + i6 + i7;
+}
+
+int main()
+{
+  printInt(f(2, 2.5));
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+/* Constants known across blocks: conditions decided at compile
+   time, and divisions which must be left to run time. */
+
+int main() {
+  printInt(loop(2));
+  printInt(divide());
+  printInt(guarded(0));
+  int d = -1;
+  int c = 5;
+  while (c > 0) {
+    c--;
+    if (c == 100)
+      d = 1;
+  }
+  if (d == -1)
+    printString("d unchanged");
+  printInt(c);
+  return 0;
+}
+
+int loop(int x) {
+  int k = 3;
+  boolean flag = true;
+  int i = 0;
+  int s = 0;
+  while (i < 10) {
+    if (flag)
+      s = s + k * x;
+    else
+      s = s - 1;
+    if (k == 4)
+      printString("never printed");
+    i++;
+  }
+  double d = 1.5;
+  double e = d * 2.0;
+  if (e > 2.9)
+    printDouble(e);
+  else
+    printString("never printed");
+  return s;
+}
+
+int divide() {
+  int z = 0;
+  int m = -2147483647 - 1;
+  int q = 7;
+  if (q > 100)
+    return q / z;
+  printInt(m / q);
+  printInt(m % q);
+  return m / (q - 6) + 1;
+}
+
+int guarded(int a) {
+  int z = 0;
+  if (a > 0)
+    return a / z;
+  return 1;
+}
@@ -0,0 +1,80 @@
+/* Variables assigned in loops and branches, whose values meet at the
+   heads of the loops and after the branches, and assignments whose
+   values are never used. */
+
+int main() {
+  printInt(fib(30));
+  printInt(swap(7));
+  printInt(nested(4));
+  printDouble(branches(3));
+  printInt(unused(10));
+  return 0;
+}
+
+int fib(int n) {
+  int a = 0;
+  int b = 1;
+  while (n > 0) {
+    int t = a + b;
+    a = b;
+    b = t;
+    n--;
+  }
+  return a;
+}
+
+/* the values of x and y cross at the head of the loop */
+int swap(int n) {
+  int x = 1;
+  int y = 2;
+  int i = 0;
+  while (i < n) {
+    int t = x;
+    x = y;
+    y = t;
+    i++;
+  }
+  return x * 10 + y;
+}
+
+int nested(int n) {
+  int i = 0;
+  int s = 0;
+  int last = -1;
+  while (i < n) {
+    int j = 0;
+    while (j < i) {
+      s = s + i * j;
+      last = j;
+      j++;
+    }
+    i++;
+  }
+  return s * 100 + last;
+}
+
+double branches(int k) {
+  double d = 1.0;
+  int i = 0;
+  while (i < k) {
+    if (i % 2 == 0)
+      d = d * 2.0;
+    else
+      d = d + 0.5;
+    i++;
+  }
+  return d;
+}
+
+int unused(int n) {
+  int dead = n * 3;
+  int i = 0;
+  int r = 1;
+  while (i < n) {
+    dead = dead + i;
+    r = r * 2;
+    i++;
+  }
+  dead = r / n;
+  return r;
+}
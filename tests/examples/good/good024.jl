@@ -0,0 +1,78 @@
+/* Computations repeated in different blocks, array reads separated by
+   stores and calls, and divisions guarded by conditions. */
+
+int main() {
+  printInt(sum(5));
+  printInt(stores(2));
+  printInt(calls(3));
+  printInt(divs(17, 4));
+  printInt(divs(17, 0));
+  printDouble(dbl(2.5, 3));
+  return 0;
+}
+
+/* a[i] * k is computed both in the test and in the body */
+int sum(int k) {
+  int a[8];
+  int i = 0;
+  while (i < 8) {
+    a[i] = i * 3 + 1;
+    i++;
+  }
+  i = 0;
+  int s = 0;
+  while (i < 8 && a[i] * k < 100) {
+    s = s + a[i] * k;
+    i++;
+  }
+  return s;
+}
+
+/* the second read of a[j] must see the store */
+int stores(int j) {
+  int a[4];
+  a[j] = j + 5;
+  int x = a[j] + 1;
+  if (x > 3)
+    a[j] = x * 2;
+  int y = a[j] + 1;
+  return x * 100 + y;
+}
+
+int bump(int x) {
+  printInt(x);
+  return x + 10;
+}
+
+/* a call between two reads of the same element */
+int calls(int j) {
+  int a[5];
+  a[j] = 7;
+  int x = a[j];
+  a[j] = bump(a[j]);
+  int y = a[j];
+  if (x < y)
+    return y - x + a[j] * 2;
+  return x;
+}
+
+/* the division in the branch must not be moved before the test */
+int divs(int n, int d) {
+  int r = n + d;
+  if (d != 0) {
+    r = n / d + n % d;
+    if (r > 2)
+      r = r + n / d;
+  }
+  return r + (n + d);
+}
+
+double dbl(double x, int n) {
+  double s = x * x;
+  int i = 0;
+  while (i < n) {
+    s = s + x * x;
+    i++;
+  }
+  return s;
+}
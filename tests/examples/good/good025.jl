@@ -0,0 +1,88 @@
+/* Computations which do not change in loops, next to divisions which
+   may trap, and reads of arrays written in the loops or read only
+   after their tests. */
+
+int main() {
+  printInt(nested(4, 3));
+  printInt(divs(10, 2, 5));
+  printInt(divs(10, 0, 0));
+  printInt(writes(6));
+  printInt(exits(5, 0));
+  printInt(exits(5, 3));
+  printDouble(scale(1.5, 4));
+  return 0;
+}
+
+/* k * 3 + 1 is invariant in both loops, a[j] only in the inner one */
+int nested(int n, int k) {
+  int a[4];
+  int i = 0;
+  while (i < 4) {
+    a[i] = i + k;
+    i++;
+  }
+  int s = 0;
+  int j = 0;
+  while (j < 4) {
+    i = 0;
+    while (i < n) {
+      s = s + (k * 3 + 1) + a[j] * 2;
+      i++;
+    }
+    j++;
+  }
+  return s;
+}
+
+/* the loop is not executed when d is 0 */
+int divs(int n, int d, int m) {
+  int s = 0;
+  int i = 0;
+  while (i < m) {
+    s = s + n / d + n % 3 + n / 4;
+    i++;
+  }
+  return s;
+}
+
+/* a[0] is written in the loop */
+int writes(int n) {
+  int a[2];
+  a[0] = 1;
+  a[1] = 5;
+  int i = 0;
+  while (i < n) {
+    a[0] = a[0] + a[1];
+    i++;
+  }
+  return a[0];
+}
+
+/* a[k] is read only when the loop goes on */
+int exits(int n, int k) {
+  int a[4];
+  int i = 0;
+  while (i < 4) {
+    a[i] = i * 10;
+    i++;
+  }
+  int s = 0;
+  i = 0;
+  while (i < n) {
+    if (i == k)
+      return s;
+    s = s + a[k];
+    i++;
+  }
+  return s;
+}
+
+double scale(double x, int n) {
+  double s = 0.0;
+  int i = 0;
+  while (i < n) {
+    s = s + x * 2.0 + 0.25;
+    i++;
+  }
+  return s;
+}
@@ -0,0 +1,34 @@
+/* The moves at the end of the inner loop need a scratch register,
+   which must not be taken from a variable already moved to the
+   register the loop header expects it in. */
+
+int f(int p)
+{
+  int i0 = p + 51;
+  int i1 = p + 55;
+  int i2 = p + 53;
+  int i3 = p + 98;
+  int i4 = p + 84;
+  int i5 = p + 20;
+  int i6 = p + 27;
+  int i7 = p + 48;
+  int l0;
+  int l1;
+  int a[16];
+  for (l0 = 0; l0 < 16; l0++) { a[l0] = l0; }
+  for (l0 = 0; l0 < 4; l0++) {
+    for (l1 = 0; l1 < 2; l1++) {
+      i5 = i0 + i2;
+      a[(i6 % 16 + 16) % 16] = (i7 + i5) - i5;
+      a[(i4 % 16 + 16) % 16] = i4 + i1;
+    }
+    i1 = (i3 - i6) + i4;
+  }
+  return i0 + i1 + i2 + i3 + i4 + i5 + i6 + i7;
+}
+
+int main()
+{
+  printInt(f(4));
+  return 0;
+}
@@ -8,6 +8,14 @@ if [ -f iquadr ]; then
     ./test_jl_quadr.sh
 fi
 
+if [ -f qbindump ]; then
+    ./test_qbin.sh
+fi
+
 ./test_jl_i386.sh
 
+./test_jl_x86_64.sh
+
+./test_jl_run.sh
+
 ) 2>&1 | tee test_results
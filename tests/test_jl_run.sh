@@ -0,0 +1,19 @@
+#!/bin/bash
+
+for o in 0 1 2
+do
+    printf "\ngood examples (-O$o --run):\n\n"
+    for f in examples/good/*.jl
+    do
+        printf "$f\n";
+        b=`basename $f .jl`
+        if [ -f examples/good/$b.input ]; then
+            ../jl -d../data -O$o --run $f < examples/good/$b.input > out 2>/dev/null
+        else
+            ../jl -d../data -O$o --run $f > out 2>/dev/null
+        fi
+        if [ -f examples/good/$b.i386.output ]; then
+            diff -q out examples/good/$b.i386.output
+        fi
+    done
+done
@@ -0,0 +1,15 @@
+#!/bin/bash
+
+for o in 0 1 2
+do
+    printf "\ngood examples (-O$o -bx86_64):\n\n"
+    for f in examples/good/*.jl
+    do
+        printf "$f\n";
+        b=`basename $f .jl`
+        f2=examples/good/$b
+        rm $f2 >/dev/null 2>&1
+        ../jl -d../data -O$o -bx86_64 $f > /dev/null
+        ./test_prog.sh "$f2" examples/good/$b.input examples/good/$b.i386.output
+    done
+done
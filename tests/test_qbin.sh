@@ -0,0 +1,19 @@
+#!/bin/bash
+
+# the binary intermediate code, printed by qbindump, must be the same
+# as the textual one
+
+for o in 0 1 2
+do
+    printf "\ngood examples (-O$o --icode-bin):\n\n"
+    for f in examples/good/*.jl
+    do
+        printf "$f\n";
+        b=`basename $f .jl`
+        rm out.icode out.qbin >/dev/null 2>&1
+        ../jl -d../data -O$o -bquadr -o out.qua --icode=out.icode --icode-bin=out.qbin $f > /dev/null
+        ./qbindump out.qbin > out
+        diff -q out out.icode
+    done
+done
+rm out.icode out.qbin out.qua >/dev/null 2>&1